@@ -0,0 +1,185 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//every thread keeps a set of live blocks and keeps replacing random ones with blocks of the
+//sizes lists and strings ask for, growing some of them like an append would.  between rounds the
+//sets move one thread over, so the first free of each block in a round is of a block another
+//thread allocated.
+
+#define ALLOC_BENCH_SLOTS       512
+#define ALLOC_BENCH_MAX_GROW    0x8000
+
+struct AllocBenchSlot
+{
+    LPVOID lpData;
+    size_t size;
+};
+
+struct AllocBenchData
+{
+    Alloc *allocator;
+    UINT numThreads, opsPerRound;
+
+    List<AllocBenchSlot> slots;     //numThreads sets of ALLOC_BENCH_SLOTS
+    List<UINT> seeds;
+};
+
+static size_t RandomBlockSize(UINT &seed)
+{
+    UINT bucket = BenchRandom(seed)%100;
+    UINT r = BenchRandom(seed);
+
+    if(bucket < 70)
+        return 8 + r%120;
+    else if(bucket < 95)
+        return 128 + r%896;
+
+    return 1024 + r%15360;
+}
+
+static void AllocBenchRound(LPVOID param, UINT thread, UINT round)
+{
+    AllocBenchData *data = (AllocBenchData*)param;
+    Alloc *allocator = data->allocator;
+
+    AllocBenchSlot *slots = data->slots.Array() + ((thread+round)%data->numThreads)*ALLOC_BENCH_SLOTS;
+    UINT seed = data->seeds[thread*16];
+
+    for(UINT i=0; i<data->opsPerRound; i++)
+    {
+        AllocBenchSlot &slot = slots[BenchRandom(seed)%ALLOC_BENCH_SLOTS];
+
+        if(slot.lpData && slot.size < ALLOC_BENCH_MAX_GROW && (BenchRandom(seed)%10) == 0)
+        {
+            slot.size += slot.size/2 + 1;
+            slot.lpData = allocator->_ReAllocate(slot.lpData, slot.size);
+        }
+        else
+        {
+            if(slot.lpData)
+                allocator->_Free(slot.lpData);
+
+            slot.size = RandomBlockSize(seed);
+            slot.lpData = allocator->_Allocate(slot.size);
+        }
+
+        *(BYTE*)slot.lpData = (BYTE)i;
+    }
+
+    data->seeds[thread*16] = seed;
+}
+
+static Alloc* CreateBenchAllocator(UINT id)
+{
+    switch(id)
+    {
+        case 0:  return new FastAlloc;
+        case 1:  return new DebugAlloc;
+        case 2:  return new DefaultAlloc;
+        default: return new ThreadCacheAlloc;
+    }
+}
+
+static CTSTR allocatorNames[] = {TEXT("FastAlloc"), TEXT("DebugAlloc"), TEXT("DefaultAlloc"), TEXT("ThreadCacheAlloc")};
+
+static void PrintThreadCacheStats(ThreadCacheAlloc *allocator)
+{
+    AllocSizeClassStats total;
+    zero(&total, sizeof(total));
+
+    for(UINT i=0; i<allocator->NumSizeClasses(); i++)
+    {
+        AllocSizeClassStats stats;
+        allocator->GetSizeClassStats(i, stats);
+
+        total.hits        += stats.hits;
+        total.misses      += stats.misses;
+        total.contentions += stats.contentions;
+        total.remoteFrees += stats.remoteFrees;
+    }
+
+    double allocs = double(MAX(total.hits+total.misses, 1));
+    _tprintf(TEXT("%38s hit rate %.2f%%, %llu misses, %llu contentions, %llu remote frees\n"), TEXT(""),
+        double(total.hits)*100.0/allocs, total.misses, total.contentions, total.remoteFrees);
+}
+
+int AllocBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-threads"), TEXT("-ops"), TEXT("-rounds")};
+    UINT values[]   = {MIN(MAX((UINT)OSGetLogicalCores(), 2), 16), 100000, 20};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench alloc [-threads max] [-ops per round per thread] [-rounds n]"), 3, lpNames, values))
+        return 1;
+
+    UINT maxThreads = MAX(values[0], 1);
+    UINT opsPerRound = MAX(values[1], 1);
+    UINT numRounds = MAX(values[2], 1);
+
+    _tprintf(TEXT("%u ops per thread per round, %u rounds, %u live blocks per thread\n\n"), opsPerRound, numRounds, ALLOC_BENCH_SLOTS);
+
+    List<UINT> threadCounts;
+    for(UINT numThreads=1; numThreads<maxThreads; numThreads *= 2)
+        threadCounts << numThreads;
+    threadCounts << maxThreads;
+
+    for(UINT count=0; count<threadCounts.Num(); count++)
+    {
+        UINT numThreads = threadCounts[count];
+
+        for(UINT i=0; i<4; i++)
+        {
+            AllocBenchData data;
+            data.allocator = CreateBenchAllocator(i);
+            data.numThreads = numThreads;
+            data.opsPerRound = opsPerRound;
+
+            data.slots.SetSize(numThreads*ALLOC_BENCH_SLOTS);
+
+            //spaced out so the threads don't share a cache line
+            data.seeds.SetSize(numThreads*16);
+            for(UINT j=0; j<numThreads; j++)
+                data.seeds[j*16] = 0x7654321 + j*0x1111;
+
+            BenchThreads threads(numThreads, AllocBenchRound, &data);
+            QWORD wallTime = threads.Run(numRounds);
+
+            double ops = double(opsPerRound)*double(numRounds)*double(numThreads);
+            _tprintf(TEXT("%-18s %2u threads: %8.1f ns/op per thread, %7.2f Mops/s total\n"), allocatorNames[i], numThreads,
+                double(wallTime)*1000.0*double(numThreads)/ops, ops/double(wallTime));
+
+            if(i == 3)
+                PrintThreadCacheStats((ThreadCacheAlloc*)data.allocator);
+
+            for(UINT j=0; j<data.slots.Num(); j++)
+            {
+                if(data.slots[j].lpData)
+                    data.allocator->_Free(data.slots[j].lpData);
+            }
+
+            delete data.allocator;
+        }
+
+        _tprintf(TEXT("\n"));
+    }
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//benchmarks for the OBSApi utility code: allocators, profiler, config and locale parsing,
+//strings and logging.  nothing here needs the app or a device.
+//
+//  ApiBench <bench> [options]
+//
+//run a bench with -help to see its options.
+
+struct BenchInfo
+{
+    CTSTR lpName;
+    BENCHPROC proc;
+    CTSTR lpDescription;
+};
+
+static BenchInfo benches[] =
+{
+    {TEXT("alloc"),     AllocBench,     TEXT("multithreaded allocation stress, ThreadCacheAlloc against FastAlloc/DebugAlloc/DefaultAlloc")},
+    {TEXT("profiler"),  ProfilerBench,  TEXT("per-scope cost of profileIn/profileOut, checked against PROFILE_SCOPE_BUDGET")},
+    {TEXT("xconfig"),   XConfigBench,   TEXT("open a synthetic 1000-source scene collection and look up scenes, sources and settings")},
+    {TEXT("config"),    ConfigFileBench, TEXT("open a large ini and time typed lookups, a burst of Set calls and the save")},
+    {TEXT("locale"),    LocaleBench,    TEXT("string file load through the text parser and the compiled table, and Str() lookups")},
+    {TEXT("string"),    StringBench,    TEXT("log line, config key and long report building with String, StringBuilder and exact reallocation")},
+    {TEXT("log"),       LogBench,       TEXT("caller-side cost of Log() under contention, queued against written on the calling thread")},
+};
+
+#define NUM_BENCHES (sizeof(benches)/sizeof(benches[0]))
+
+//-----------------------------------------------------------------------------
+
+static void PrintBenches()
+{
+    _tprintf(TEXT("usage: ApiBench <bench> [options]\n\n"));
+    for(UINT i=0; i<NUM_BENCHES; i++)
+        _tprintf(TEXT("  %-10s %s\n"), benches[i].lpName, benches[i].lpDescription);
+}
+
+int _tmain(int argc, TCHAR *argv[])
+{
+    if(argc < 2)
+    {
+        PrintBenches();
+        return 1;
+    }
+
+    BenchInfo *bench = NULL;
+    for(UINT i=0; i<NUM_BENCHES; i++)
+    {
+        if(scmpi(argv[1], benches[i].lpName) == 0)
+            bench = benches+i;
+    }
+
+    if(!bench)
+    {
+        PrintBenches();
+        return 1;
+    }
+
+    if(!InitXT(TEXT("ApiBench.log"), TEXT("FastAlloc")))
+        return 1;
+
+    int ret = bench->proc(argc-2, argv+2);
+
+    TerminateXT();
+
+    return ret;
+}
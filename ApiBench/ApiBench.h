@@ -0,0 +1,31 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+#include "BenchCommon.h"
+
+
+int AllocBench(int argc, TCHAR *argv[]);
+int ProfilerBench(int argc, TCHAR *argv[]);
+int XConfigBench(int argc, TCHAR *argv[]);
+int ConfigFileBench(int argc, TCHAR *argv[]);
+int LocaleBench(int argc, TCHAR *argv[]);
+int StringBench(int argc, TCHAR *argv[]);
+int LogBench(int argc, TCHAR *argv[]);
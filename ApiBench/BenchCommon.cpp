@@ -0,0 +1,113 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "BenchCommon.h"
+
+
+bool BenchParseArgs(int argc, TCHAR *argv[], CTSTR lpUsage, UINT numOptions, CTSTR *lpNames, UINT *values)
+{
+    for(int i=0; i<argc; i++)
+    {
+        UINT option;
+        for(option=0; option<numOptions; option++)
+        {
+            if(scmpi(argv[i], lpNames[option]) == 0)
+                break;
+        }
+
+        if(option == numOptions || i+1 >= argc)
+        {
+            _tprintf(TEXT("%s\n"), lpUsage);
+            return false;
+        }
+
+        values[option] = (UINT)MAX(tstoi(argv[++i]), 0);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+BenchThreads::BenchThreads(UINT numThreads, ROUNDPROC roundProc, LPVOID param)
+    : roundProc(roundProc), param(param), numThreads(MAX(numThreads, 1)), numRounds(0)
+{
+}
+
+void BenchThreads::Wait()
+{
+    UINT curGeneration = generation;
+
+    if(++numWaiting == numThreads)
+    {
+        numWaiting = 0;
+        ++generation;
+    }
+    else
+    {
+        while(generation == curGeneration)
+            SwitchToThread();
+    }
+}
+
+DWORD STDCALL BenchThreads::ThreadProc(ThreadInfo *info)
+{
+    BenchThreads *threads = info->threads;
+
+    threads->Wait();
+    if(info->id == 0)
+        threads->startTime = OSGetTimeMicroseconds();
+
+    for(UINT round=0; round<threads->numRounds; round++)
+    {
+        threads->roundProc(threads->param, info->id, round);
+        threads->Wait();
+    }
+
+    if(info->id == 0)
+        threads->endTime = OSGetTimeMicroseconds();
+
+    return 0;
+}
+
+QWORD BenchThreads::Run(UINT numRounds)
+{
+    this->numRounds = numRounds;
+    numWaiting = 0;
+    generation = 0;
+
+    List<ThreadInfo> info;
+    List<HANDLE> handles;
+
+    info.SetSize(numThreads);
+    for(UINT i=0; i<numThreads; i++)
+    {
+        info[i].threads = this;
+        info[i].id = i;
+        handles << OSCreateThread((XTHREAD)ThreadProc, info.Array()+i);
+    }
+
+    for(UINT i=0; i<numThreads; i++)
+    {
+        OSWaitForThread(handles[i], NULL);
+        OSCloseThread(handles[i]);
+    }
+
+    return MAX(endTime-startTime, 1);
+}
@@ -0,0 +1,71 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+#include "OBSApi.h"
+
+#include <tchar.h>
+#include <stdio.h>
+
+
+//helpers shared by ApiBench and AudioBench
+
+//each bench gets the arguments that follow its name and returns the exit code
+typedef int (*BENCHPROC)(int argc, TCHAR *argv[]);
+
+inline UINT BenchRandom(UINT &seed)
+{
+    seed = seed*1664525+1013904223;
+    return seed>>8;
+}
+
+//reads "-name value" pairs.  returns false and prints the usage line on anything else
+bool BenchParseArgs(int argc, TCHAR *argv[], CTSTR lpUsage, UINT numOptions, CTSTR *lpNames, UINT *values);
+
+//runs a number of rounds on several threads at once.  every thread finishes a round before any
+//starts the next, so a round can pick up what another thread left behind in the one before.
+class BenchThreads
+{
+public:
+    typedef void (*ROUNDPROC)(LPVOID param, UINT thread, UINT round);
+
+private:
+    struct ThreadInfo
+    {
+        BenchThreads *threads;
+        UINT id;
+    };
+
+    ROUNDPROC roundProc;
+    LPVOID param;
+    UINT numThreads, numRounds;
+
+    std::atomic<UINT> numWaiting, generation;
+    QWORD startTime, endTime;
+
+    void Wait();
+    static DWORD STDCALL ThreadProc(ThreadInfo *info);
+
+public:
+    BenchThreads(UINT numThreads, ROUNDPROC roundProc, LPVOID param);
+
+    //returns the wall time of all the rounds in microseconds, not counting thread creation
+    QWORD Run(UINT numRounds);
+};
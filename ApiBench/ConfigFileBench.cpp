@@ -0,0 +1,197 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//writes an ini with -sections sections of -keys keys each (ints, floats and strings), then times
+//opening it, random typed lookups, the same key over and over like RTMPPublisher::SocketLoop
+//does, and a burst of Set calls followed by the save.
+
+#define CONFIG_BENCH_FILE TEXT("ApiBench.ini")
+
+inline String ConfigBenchKey(UINT key)
+{
+    return FormattedString(TEXT("Key%u"), key);
+}
+
+inline String ConfigBenchSection(UINT section)
+{
+    return FormattedString(TEXT("Section %u"), section);
+}
+
+int ConfigFileBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-sections"), TEXT("-keys"), TEXT("-opens"), TEXT("-queries"), TEXT("-sets")};
+    UINT values[]   = {200, 50, 20, 500000, 200};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench config [-sections n] [-keys per section] [-opens n] [-queries n] [-sets n]"), 5, lpNames, values))
+        return 1;
+
+    UINT numSections = MAX(values[0], 1);
+    UINT numKeys     = MAX(values[1], 3);
+    UINT numOpens    = MAX(values[2], 1);
+    UINT numQueries  = MAX(values[3], 1);
+    UINT numSets     = MAX(values[4], 1);
+
+    //-----------------------------------------
+
+    String strData;
+    for(UINT i=0; i<numSections; i++)
+    {
+        strData << TEXT("[") << ConfigBenchSection(i) << TEXT("]\r\n");
+
+        for(UINT j=0; j<numKeys; j++)
+        {
+            strData << ConfigBenchKey(j) << TEXT("=");
+
+            switch(j%3)
+            {
+                case 0: strData << IntString(int(i*numKeys+j)); break;
+                case 1: strData << FormattedString(TEXT("%g"), float(j)*0.25f); break;
+                case 2: strData << TEXT("some text value ") << UIntString(j); break;
+            }
+
+            strData << TEXT("\r\n");
+        }
+    }
+
+    {
+        XFile file;
+        if(!file.Open(CONFIG_BENCH_FILE, XFILE_WRITE, XFILE_CREATEALWAYS))
+        {
+            _tprintf(TEXT("could not write %s\n"), CONFIG_BENCH_FILE);
+            return 1;
+        }
+
+        file.WriteAsUTF8(strData, strData.Length());
+    }
+
+    _tprintf(TEXT("%u sections, %u keys, %u KB\n"), numSections, numSections*numKeys, strData.Length()/1024);
+
+    //-----------------------------------------
+
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT i=0; i<numOpens; i++)
+    {
+        ConfigFile config;
+        if(!config.Open(CONFIG_BENCH_FILE))
+        {
+            _tprintf(TEXT("could not open %s\n"), CONFIG_BENCH_FILE);
+            return 1;
+        }
+    }
+
+    QWORD openTime = OSGetTimeMicroseconds()-startTime;
+    _tprintf(TEXT("open + close:        %8.3f ms\n"), double(openTime)*0.001/double(numOpens));
+
+    //-----------------------------------------
+
+    ConfigFile config;
+    config.Open(CONFIG_BENCH_FILE);
+
+    //names are made up front so the lookups are the only thing timed
+    StringList sectionNames, keyNames;
+    for(UINT i=0; i<numSections; i++)
+        sectionNames << ConfigBenchSection(i);
+    for(UINT i=0; i<numKeys; i++)
+        keyNames << ConfigBenchKey(i);
+
+    List<UINT> queries;
+    queries.SetSize(numQueries);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numQueries; i++)
+        queries[i] = BenchRandom(seed)%(numSections*numKeys);
+
+    bool bWrong = false;
+    volatile UPARAM sink = 0;
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numQueries; i++)
+    {
+        UINT section = queries[i]/numKeys, key = queries[i]%numKeys;
+
+        switch(key%3)
+        {
+            case 0: sink += config.GetInt(sectionNames[section], keyNames[key]); break;
+            case 1: sink += (UPARAM)config.GetFloat(sectionNames[section], keyNames[key]); break;
+            case 2: sink += (UPARAM)config.GetStringPtr(sectionNames[section], keyNames[key]); break;
+        }
+    }
+    QWORD randomTime = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numQueries; i++)
+        sink += config.GetInt(sectionNames[numSections/2], keyNames[0]);
+    QWORD sameKeyTime = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numQueries; i++)
+        sink += config.GetInt(sectionNames[i%numSections], TEXT("Missing"), 1);
+    QWORD missingTime = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    //spot check the values that were written
+    for(UINT i=0; i<numSections; i+=7)
+    {
+        if(config.GetInt(sectionNames[i], keyNames[0]) != int(i*numKeys) ||
+           !CloseFloat(config.GetFloat(sectionNames[i], keyNames[1]), 0.25f) ||
+           scmp(config.GetStringPtr(sectionNames[i], keyNames[2], TEXT("")), TEXT("some text value 2")) != 0)
+        {
+            _tprintf(TEXT("wrong value in [%s]\n"), sectionNames[i].Array());
+            bWrong = true;
+        }
+    }
+
+    _tprintf(TEXT("random typed lookup: %8.1f ns\n"), double(randomTime)*1000.0/double(numQueries));
+    _tprintf(TEXT("same key lookup:     %8.1f ns\n"), double(sameKeyTime)*1000.0/double(numQueries));
+    _tprintf(TEXT("missing key lookup:  %8.1f ns\n"), double(missingTime)*1000.0/double(numQueries));
+
+    //-----------------------------------------
+    //the caller only pays for editing the text; the file is written once, later
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numSets; i++)
+        config.SetInt(sectionNames[i%numSections], keyNames[0], int(i));
+    QWORD setTime = OSGetTimeMicroseconds()-startTime;
+
+    startTime = OSGetTimeMicroseconds();
+    config.Flush();
+    QWORD flushTime = OSGetTimeMicroseconds()-startTime;
+
+    _tprintf(TEXT("SetInt:              %8.1f us per call, %u calls\n"), double(setTime)/double(numSets), numSets);
+    _tprintf(TEXT("save after the burst:%8.3f ms\n"), double(flushTime)*0.001);
+
+    config.Close();
+
+    ConfigFile check;
+    check.Open(CONFIG_BENCH_FILE);
+    UINT lastSet = numSets-1;
+    if(check.GetInt(sectionNames[lastSet%numSections], keyNames[0]) != int(lastSet))
+    {
+        _tprintf(TEXT("the saved file is missing the last SetInt\n"));
+        bWrong = true;
+    }
+    check.Close();
+
+    OSDeleteFile(CONFIG_BENCH_FILE);
+
+    return bWrong ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//writes a string file laid out like locale/en.txt with -strings entries, then times loading it
+//with the text parser and from the compiled table, and times Str() style lookups against a copy
+//of the radix tree LocaleStringLookup used before it had the hash table.
+
+#define LOCALE_BENCH_FILE       TEXT("ApiBench.locale.txt")
+#define LOCALE_BENCH_COMPILED   TEXT(".\\ApiBench.locale.txt.bin")
+
+static CTSTR lpLocaleBenchPrefixes[] =
+{
+    TEXT("Settings.Publish"), TEXT("Settings.Advanced"), TEXT("Settings.Audio"), TEXT("Settings.Encoding.Video"),
+    TEXT("Settings.Encoding.Audio"), TEXT("Settings.Video"), TEXT("Sources.SoftwareCaptureSource"),
+    TEXT("Sources.TextSource"), TEXT("Sources.BitmapSource"), TEXT("MainWindow"), TEXT("Plugins.NoiseGate"),
+    TEXT("Listbox"), TEXT("Scene"),
+};
+
+#define NUM_LOCALE_BENCH_PREFIXES (sizeof(lpLocaleBenchPrefixes)/sizeof(lpLocaleBenchPrefixes[0]))
+
+//-----------------------------------------
+//the old lookup: a radix tree on the case-folded name, each node scanning its children
+
+struct RadixLookupNode
+{
+    String str;
+    List<RadixLookupNode*> subNodes;
+    CTSTR lpValue;
+
+    RadixLookupNode() : lpValue(NULL) {}
+    ~RadixLookupNode()
+    {
+        for(UINT i=0; i<subNodes.Num(); i++)
+            delete subNodes[i];
+    }
+
+    RadixLookupNode* FindSubNodeByChar(TCHAR ch)
+    {
+        for(UINT i=0; i<subNodes.Num(); i++)
+        {
+            RadixLookupNode *node = subNodes[i];
+            if(node->str.IsValid() && node->str[0] == ch)
+                return node;
+        }
+        return NULL;
+    }
+
+    RadixLookupNode* FindSubNode(CTSTR lpLookup)
+    {
+        for(UINT i=0; i<subNodes.Num(); i++)
+        {
+            RadixLookupNode *node = subNodes[i];
+            if(scmpi_n(node->str, lpLookup, node->str.Length()) == 0)
+                return node;
+        }
+        return NULL;
+    }
+};
+
+static void RadixAdd(RadixLookupNode *node, CTSTR lookupVal, CTSTR lpValue)
+{
+    if(!*lookupVal)
+    {
+        node->lpValue = lpValue;
+        return;
+    }
+
+    RadixLookupNode *child = node->FindSubNodeByChar(*lookupVal);
+    if(!child)
+    {
+        RadixLookupNode *newNode = new RadixLookupNode;
+        newNode->str = lookupVal;
+        newNode->lpValue = lpValue;
+        node->subNodes << newNode;
+        return;
+    }
+
+    UINT len;
+    for(len=0; len<child->str.Length(); len++)
+    {
+        TCHAR val1 = child->str[len], val2 = lookupVal[len];
+        if((val1 >= 'A') && (val1 <= 'Z'))
+            val1 += 0x20;
+        if((val2 >= 'A') && (val2 <= 'Z'))
+            val2 += 0x20;
+        if(val1 != val2)
+            break;
+    }
+
+    if(len == child->str.Length())
+    {
+        RadixAdd(child, lookupVal+len, lpValue);
+        return;
+    }
+
+    RadixLookupNode *childSplit = new RadixLookupNode;
+    childSplit->str = child->str.Array()+len;
+    childSplit->lpValue = child->lpValue;
+    childSplit->subNodes.TransferFrom(child->subNodes);
+    child->lpValue = NULL;
+    child->str.SetLength(len);
+    child->subNodes << childSplit;
+
+    if(lookupVal[len])
+    {
+        RadixLookupNode *newNode = new RadixLookupNode;
+        newNode->str = lookupVal+len;
+        newNode->lpValue = lpValue;
+        child->subNodes << newNode;
+    }
+    else
+        child->lpValue = lpValue;
+}
+
+static CTSTR RadixFind(RadixLookupNode *node, CTSTR lookupVal)
+{
+    RadixLookupNode *child = node->FindSubNode(lookupVal);
+    if(!child)
+        return NULL;
+
+    lookupVal += child->str.Length();
+    if(*lookupVal)
+        return RadixFind(child, lookupVal);
+
+    return child->lpValue;
+}
+
+//-----------------------------------------
+
+//returns the mean time of one LoadStringFile in microseconds
+static double TimeLocaleLoads(UINT numLoads)
+{
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT i=0; i<numLoads; i++)
+    {
+        LocaleStringLookup lookup;
+        lookup.LoadStringFile(LOCALE_BENCH_FILE);
+    }
+
+    return double(OSGetTimeMicroseconds()-startTime)/double(numLoads);
+}
+
+int LocaleBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-strings"), TEXT("-loads"), TEXT("-queries")};
+    UINT values[]   = {2000, 20, 1000000};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench locale [-strings n] [-loads n] [-queries n]"), 3, lpNames, values))
+        return 1;
+
+    UINT numStrings = MAX(values[0], 1);
+    UINT numLoads   = MAX(values[1], 1);
+    UINT numQueries = MAX(values[2], 1);
+
+    StringList lookupNames;
+
+    //-----------------------------------------
+
+    {
+        String strData;
+        for(UINT i=0; i<numStrings; i++)
+        {
+            lookupNames << FormattedString(TEXT("%s.Item%u"), lpLocaleBenchPrefixes[i%NUM_LOCALE_BENCH_PREFIXES], i);
+            strData << lookupNames.Last() << TEXT("=\"Some localized text for item ") << UIntString(i) << TEXT("\\nwith a second line\"\r\n");
+        }
+
+        XFile file;
+        if(!file.Open(LOCALE_BENCH_FILE, XFILE_WRITE, XFILE_CREATEALWAYS))
+        {
+            _tprintf(TEXT("could not write %s\n"), LOCALE_BENCH_FILE);
+            return 1;
+        }
+
+        file.WriteAsUTF8(strData, strData.Length());
+    }
+
+    OSDeleteFile(LOCALE_BENCH_COMPILED);
+
+    //-----------------------------------------
+    //with no cache directory every load goes through the text parser
+
+    SetLocaleCacheDirectory(NULL);
+    double parseTime = TimeLocaleLoads(numLoads);
+
+    SetLocaleCacheDirectory(TEXT("."));
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    {
+        LocaleStringLookup lookup;
+        lookup.LoadStringFile(LOCALE_BENCH_FILE);
+    }
+    QWORD compileTime = OSGetTimeMicroseconds()-startTime;
+
+    bool bCompiled = OSFileExists(LOCALE_BENCH_COMPILED) != 0;
+    double compiledTime = TimeLocaleLoads(numLoads);
+
+    _tprintf(TEXT("%u strings\n"), numStrings);
+    _tprintf(TEXT("load, text parser:      %8.3f ms\n"), parseTime*0.001);
+    _tprintf(TEXT("load, parse + compile:  %8.3f ms\n"), double(compileTime)*0.001);
+    if(bCompiled)
+        _tprintf(TEXT("load, compiled table:   %8.3f ms (%.1fx)\n\n"), compiledTime*0.001, parseTime/MAX(compiledTime, 1.0));
+    else
+        _tprintf(TEXT("the compiled table was not written\n\n"));
+
+    //-----------------------------------------
+
+    LocaleStringLookup lookup;
+    lookup.LoadStringFile(LOCALE_BENCH_FILE);
+
+    SetLocaleCacheDirectory(NULL);
+    OSDeleteFile(LOCALE_BENCH_COMPILED);
+    OSDeleteFile(LOCALE_BENCH_FILE);
+
+    RadixLookupNode radix;
+    const LocaleStringCache &cache = lookup.GetCache();
+    for(UINT i=0; i<cache.Num(); i++)
+        RadixAdd(&radix, cache[i]->lookup, cache[i]->strValue);
+
+    List<UINT> queries;
+    queries.SetSize(numQueries);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numQueries; i++)
+        queries[i] = BenchRandom(seed)%numStrings;
+
+    volatile UPARAM sink = 0;
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numQueries; i++)
+        sink += (UPARAM)lookup.LookupString(lookupNames[queries[i]]);
+    QWORD hashTime = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numQueries; i++)
+        sink += (UPARAM)RadixFind(&radix, lookupNames[queries[i]]);
+    QWORD radixTime = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    _tprintf(TEXT("lookup: %6.1f ns hash table, %6.1f ns radix tree (%.1fx)\n"),
+        double(hashTime)*1000.0/double(numQueries), double(radixTime)*1000.0/double(numQueries), double(radixTime)/double(hashTime));
+
+    //both have to agree on every name, in any case
+    bool bMismatch = (cache.Num() != numStrings);
+    for(UINT i=0; i<numStrings && !bMismatch; i++)
+    {
+        String strUpper = lookupNames[i];
+        strUpper.MakeUpper();
+
+        CTSTR lpValue = lookup.LookupString(strUpper);
+        if(!lookup.HasLookup(strUpper) || lpValue != RadixFind(&radix, strUpper) ||
+           scmp(lpValue, FormattedString(TEXT("Some localized text for item %u\r\nwith a second line"), i)) != 0)
+        {
+            _tprintf(TEXT("lookup mismatch for %s\n"), lookupNames[i].Array());
+            bMismatch = true;
+        }
+    }
+
+    if(!bCompiled)
+        bMismatch = true;
+
+    return bMismatch ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//times what Log() costs the thread that calls it, on one thread and on several logging at once.
+//each thread logs a burst of -lines lines per round, then waits (untimed) for the writer thread
+//to catch up.  the same bursts are also run through a copy of the old Log, which formatted and
+//wrote every line to the file on the calling thread.  lines the writer dropped because a ring
+//was full are counted from the log text.
+
+#define LOG_BENCH_SYNC_FILE     TEXT("ApiBench.sync.log")
+#define LOG_BENCH_DRAIN_WAIT    50
+
+struct LogBenchData
+{
+    UINT numLines;
+    UINT run;
+    bool bSync;
+    List<QWORD> threadTime;     //spaced out so the threads don't share a cache line
+};
+
+static HANDLE hSyncLogMutex = NULL;
+static XFile syncLogFile;
+static String strSyncLog;
+
+//the old Log: format, write the file, append to the window text, all on the calling thread
+static void SyncLog(CTSTR format, ...)
+{
+    va_list arglist;
+    va_start(arglist, format);
+
+    String strCurTime = CurrentTimeString();
+    strCurTime << TEXT(": ");
+    String strOut = strCurTime;
+    strOut << FormattedStringva(format, arglist);
+
+    strOut.FindReplace(TEXT("\n"), String() << TEXT("\n") << strCurTime);
+
+    OSEnterMutex(hSyncLogMutex);
+    syncLogFile.WriteAsUTF8(strOut, strOut.Length());
+    syncLogFile.WriteAsUTF8(TEXT("\r\n"));
+    strSyncLog << strOut << TEXT("\r\n");
+    OSLeaveMutex(hSyncLogMutex);
+
+    va_end(arglist);
+}
+
+static void LogBenchRound(LPVOID param, UINT thread, UINT round)
+{
+    LogBenchData *data = (LogBenchData*)param;
+
+    if(!data->bSync)
+        OSSleep(LOG_BENCH_DRAIN_WAIT);
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<data->numLines; i++)
+    {
+        if(data->bSync)
+            SyncLog(TEXT("log bench %u: thread %u, round %u, line %u, %d ms"), data->run, thread, round, i, int(i%33));
+        else
+            Log(TEXT("log bench %u: thread %u, round %u, line %u, %d ms"), data->run, thread, round, i, int(i%33));
+    }
+    data->threadTime[thread*8] += OSGetTimeMicroseconds()-startTime;
+}
+
+static UINT CountLines(CTSTR lpLog, CTSTR lpTag)
+{
+    UINT count = 0, tagLen = slen(lpTag);
+
+    while(lpLog = sstr(lpLog, lpTag))
+    {
+        count++;
+        lpLog += tagLen;
+    }
+
+    return count;
+}
+
+int LogBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-threads"), TEXT("-lines"), TEXT("-rounds")};
+    UINT values[]   = {MIN(MAX((UINT)OSGetLogicalCores(), 2), 16), 200, 20};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench log [-threads max] [-lines per round] [-rounds n]"), 3, lpNames, values))
+        return 1;
+
+    UINT maxThreads = MAX(values[0], 1);
+    UINT numLines   = MAX(values[1], 1);
+    UINT numRounds  = MAX(values[2], 1);
+
+    if(!syncLogFile.Open(LOG_BENCH_SYNC_FILE, XFILE_WRITE, XFILE_CREATEALWAYS))
+    {
+        _tprintf(TEXT("could not write %s\n"), LOG_BENCH_SYNC_FILE);
+        return 1;
+    }
+
+    hSyncLogMutex = OSCreateMutex();
+
+    _tprintf(TEXT("%u lines per thread per round, %u rounds\n\n"), numLines, numRounds);
+
+    UINT run = 0;
+    bool bLost = false;
+
+    List<UINT> threadCounts;
+    for(UINT numThreads=1; numThreads<maxThreads; numThreads *= 2)
+        threadCounts << numThreads;
+    threadCounts << maxThreads;
+
+    for(UINT count=0; count<threadCounts.Num(); count++)
+    {
+        UINT numThreads = threadCounts[count];
+        double lineTime[2];
+        UINT numLogged = 0;
+        UINT numExpected = numThreads*numLines*numRounds;
+
+        for(UINT sync=0; sync<2; sync++)
+        {
+            LogBenchData data;
+            data.numLines = numLines;
+            data.run = ++run;
+            data.bSync = (sync != 0);
+            data.threadTime.SetSize(numThreads*8);
+
+            BenchThreads threads(numThreads, LogBenchRound, &data);
+            threads.Run(numRounds);
+
+            QWORD totalTime = 0;
+            for(UINT i=0; i<numThreads; i++)
+                totalTime += data.threadTime[i*8];
+
+            lineTime[sync] = double(totalTime)*1000.0/double(numExpected);
+
+            String strLog, strTag = FormattedString(TEXT("log bench %u:"), run);
+            if(sync)
+            {
+                if(CountLines(strSyncLog, strTag) != numExpected)
+                    bLost = true;
+                strSyncLog.Clear();
+            }
+            else
+            {
+                ReadLog(strLog);
+                numLogged = CountLines(strLog, strTag);
+            }
+        }
+
+        _tprintf(TEXT("%2u threads: %7.1f ns per line queued, %7.1f ns written on the caller, %u of %u lines dropped\n"),
+            numThreads, lineTime[0], lineTime[1], numExpected-numLogged, numExpected);
+    }
+
+    syncLogFile.Close();
+    OSDeleteFile(LOG_BENCH_SYNC_FILE);
+    OSCloseMutex(hSyncLogMutex);
+    strSyncLog.Clear();
+
+    //dropping is the policy when a ring is full, losing lines on the synchronous path is a bug
+    return bLost ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//times profileIn/profileOut scopes with profiling off and on, nested and not, on one thread and
+//on several at once.  each round is a batch small enough for the thread's event buffer, and the
+//threads sleep between rounds (untimed) so the collector can empty the buffers; a full buffer
+//would only measure the drop path.
+
+#define PROFILER_BENCH_BATCH        4096
+#define PROFILER_BENCH_DRAIN_WAIT   250
+
+struct ProfilerBenchData
+{
+    UINT depth;
+    DWORD drainWait;
+    List<QWORD> threadTime;     //spaced out so the threads don't share a cache line
+};
+
+static void NestedScopes(UINT depth)
+{
+    profileIn("ApiBench scope")
+        if(depth > 1)
+            NestedScopes(depth-1);
+    profileOut
+}
+
+static void ProfilerBenchRound(LPVOID param, UINT thread, UINT round)
+{
+    ProfilerBenchData *data = (ProfilerBenchData*)param;
+
+    if(data->drainWait)
+        OSSleep(data->drainWait);
+
+    UINT numCalls = PROFILER_BENCH_BATCH/data->depth;
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numCalls; i++)
+        NestedScopes(data->depth);
+    data->threadTime[thread*8] += OSGetTimeMicroseconds()-startTime;
+}
+
+//returns the mean cost of one scope in microseconds
+static double TimeScopes(UINT numThreads, UINT depth, UINT numRounds)
+{
+    ProfilerBenchData data;
+    data.depth = depth;
+    data.drainWait = bProfilingEnabled ? PROFILER_BENCH_DRAIN_WAIT : 0;
+    data.threadTime.SetSize(numThreads*8);
+
+    BenchThreads threads(numThreads, ProfilerBenchRound, &data);
+    threads.Run(numRounds);
+
+    QWORD totalTime = 0;
+    for(UINT i=0; i<numThreads; i++)
+        totalTime += data.threadTime[i*8];
+
+    double numScopes = double(PROFILER_BENCH_BATCH/depth*depth)*double(numRounds)*double(numThreads);
+    return double(totalTime)/numScopes;
+}
+
+int ProfilerBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-threads"), TEXT("-rounds")};
+    UINT values[]   = {MIN(MAX((UINT)OSGetLogicalCores(), 2), 16), 20};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench profiler [-threads max] [-rounds n]"), 2, lpNames, values))
+        return 1;
+
+    UINT maxThreads = MAX(values[0], 1);
+    UINT numRounds = MAX(values[1], 1);
+
+    UINT threadCounts[] = {1, maxThreads};
+    UINT depths[] = {1, 4};
+
+    _tprintf(TEXT("%u scopes per thread per round, %u rounds, budget %g us per scope\n\n"), PROFILER_BENCH_BATCH, numRounds, PROFILE_SCOPE_BUDGET);
+
+    bool bOverBudget = false;
+
+    for(UINT enabled=0; enabled<2; enabled++)
+    {
+        if(enabled)
+            EnableProfiling(TRUE);
+
+        for(UINT i=0; i<2; i++)
+        {
+            if(i == 1 && maxThreads == 1)
+                break;
+
+            for(UINT j=0; j<2; j++)
+            {
+                double scopeTime = TimeScopes(threadCounts[i], depths[j], numRounds);
+                bool bOver = enabled && scopeTime > PROFILE_SCOPE_BUDGET;
+
+                _tprintf(TEXT("profiling %-3s %2u threads, depth %u: %7.3f us per scope%s\n"), enabled ? TEXT("on") : TEXT("off"),
+                    threadCounts[i], depths[j], scopeTime, bOver ? TEXT("  (over budget)") : TEXT(""));
+
+                //only the single thread case is held to the budget, more threads than cores would
+                //just measure the scheduler
+                if(bOver && threadCounts[i] == 1)
+                    bOverBudget = true;
+            }
+        }
+
+        if(enabled)
+        {
+            EnableProfiling(FALSE);
+            FreeProfileData();
+        }
+    }
+
+    return bOverBudget ? 1 : 0;
+}
@@ -0,0 +1,227 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//times the ways strings get built in OBS: formatting a log line, composing a config key from a
+//section and a name, and growing one long report a line at a time.  each is run with String,
+//with a reused StringBuilder, and with a copy of how String appended before it tracked its
+//capacity (a reallocation to the exact length and a scat on every append).
+
+struct ExactString
+{
+    TSTR lpString;
+    UINT curLength;
+
+    ExactString() : lpString(NULL), curLength(0) {}
+    ~ExactString() {Free(lpString);}
+
+    ExactString& operator<<(CTSTR str)
+    {
+        UINT strLength = str ? slen(str) : 0;
+        if(!strLength)
+            return *this;
+
+        curLength += strLength;
+        if(lpString)
+        {
+            lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
+            scat(lpString, str);
+        }
+        else
+        {
+            lpString = (TSTR)Allocate((curLength+1)*sizeof(TCHAR));
+            scpy(lpString, str);
+        }
+
+        return *this;
+    }
+
+    ExactString& operator<<(const String &str)  {return *this << str.Array();}
+    ExactString& operator<<(int number)         {return *this << IntString(number);}
+    ExactString& operator<<(unsigned int number) {return *this << UIntString(number);}
+};
+
+static CTSTR lpStringBenchSections[] = {TEXT("Audio"), TEXT("Video Encoding"), TEXT("Publish"), TEXT("Advanced")};
+
+//-----------------------------------------
+
+//"frame 1234: 16 ms, 2 duplicated, 0.50% dropped" and the like
+static UINT LogLineString(UINT i)
+{
+    String strLine;
+    strLine << TEXT("frame ") << i << TEXT(": ") << int(i%33) << TEXT(" ms, ") << (i%5) << TEXT(" duplicated, ")
+            << FloatString(double(i%100)*0.01) << TEXT("% dropped");
+    return strLine.Length();
+}
+
+static UINT LogLineFormatted(UINT i)
+{
+    String strLine = FormattedString(TEXT("frame %u: %d ms, %u duplicated, %g%% dropped"), i, int(i%33), i%5, double(i%100)*0.01);
+    return strLine.Length();
+}
+
+static UINT LogLineExact(UINT i)
+{
+    ExactString strLine;
+    strLine << TEXT("frame ") << i << TEXT(": ") << int(i%33) << TEXT(" ms, ") << (i%5) << TEXT(" duplicated, ")
+            << FloatString(double(i%100)*0.01) << TEXT("% dropped");
+    return strLine.curLength;
+}
+
+static UINT LogLineBuilder(StringBuilder &builder, UINT i)
+{
+    builder.Clear() << TEXT("frame ") << i << TEXT(": ") << int(i%33) << TEXT(" ms, ") << (i%5) << TEXT(" duplicated, ");
+    builder.AppendFormat(TEXT("%g"), double(i%100)*0.01) << TEXT("% dropped");
+    return builder.Length();
+}
+
+//-----------------------------------------
+
+//"Audio.Item123" built from a section and a key name
+static UINT ConfigKeyString(UINT i)
+{
+    String strKey = lpStringBenchSections[i&3];
+    strKey << TEXT(".Item") << i;
+    return strKey.Length();
+}
+
+static UINT ConfigKeyExact(UINT i)
+{
+    ExactString strKey;
+    strKey << lpStringBenchSections[i&3] << TEXT(".Item") << i;
+    return strKey.curLength;
+}
+
+static UINT ConfigKeyBuilder(StringBuilder &builder, UINT i)
+{
+    builder.Clear() << lpStringBenchSections[i&3] << TEXT(".Item") << i;
+    return builder.Length();
+}
+
+//-----------------------------------------
+
+int StringBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-lines"), TEXT("-report")};
+    UINT values[]   = {200000, 4000};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench string [-lines n] [-report lines]"), 2, lpNames, values))
+        return 1;
+
+    UINT numLines  = MAX(values[0], 1);
+    UINT numReport = MAX(values[1], 1);
+
+    bool bMismatch = false;
+    volatile UINT sink = 0;
+    StringBuilder builder;
+
+    //-----------------------------------------
+
+    QWORD times[4];
+    for(UINT method=0; method<4; method++)
+    {
+        QWORD startTime = OSGetTimeMicroseconds();
+        for(UINT i=0; i<numLines; i++)
+        {
+            switch(method)
+            {
+                case 0: sink += LogLineString(i); break;
+                case 1: sink += LogLineFormatted(i); break;
+                case 2: sink += LogLineBuilder(builder, i); break;
+                case 3: sink += LogLineExact(i); break;
+            }
+        }
+        times[method] = MAX(OSGetTimeMicroseconds()-startTime, 1);
+    }
+
+    _tprintf(TEXT("log line:    %6.1f ns String <<, %6.1f ns FormattedString, %6.1f ns StringBuilder, %6.1f ns exact realloc\n"),
+        double(times[0])*1000.0/double(numLines), double(times[1])*1000.0/double(numLines),
+        double(times[2])*1000.0/double(numLines), double(times[3])*1000.0/double(numLines));
+
+    for(UINT i=0; i<numLines; i+=997)
+    {
+        if(LogLineString(i) != LogLineBuilder(builder, i) || LogLineString(i) != LogLineExact(i))
+            bMismatch = true;
+    }
+
+    //-----------------------------------------
+
+    for(UINT method=0; method<3; method++)
+    {
+        QWORD startTime = OSGetTimeMicroseconds();
+        for(UINT i=0; i<numLines; i++)
+        {
+            switch(method)
+            {
+                case 0: sink += ConfigKeyString(i); break;
+                case 1: sink += ConfigKeyBuilder(builder, i); break;
+                case 2: sink += ConfigKeyExact(i); break;
+            }
+        }
+        times[method] = MAX(OSGetTimeMicroseconds()-startTime, 1);
+    }
+
+    _tprintf(TEXT("config key:  %6.1f ns String, %6.1f ns StringBuilder, %6.1f ns exact realloc\n"),
+        double(times[0])*1000.0/double(numLines), double(times[1])*1000.0/double(numLines), double(times[2])*1000.0/double(numLines));
+
+    for(UINT i=0; i<numLines; i+=997)
+    {
+        if(ConfigKeyString(i) != ConfigKeyBuilder(builder, i) || ConfigKeyString(i) != ConfigKeyExact(i))
+            bMismatch = true;
+    }
+
+    //-----------------------------------------
+    //one long report, like the bandwidth analysis or the log file
+
+    UINT lengths[3];
+    for(UINT method=0; method<3; method++)
+    {
+        QWORD startTime = OSGetTimeMicroseconds();
+
+        String strReport;
+        ExactString strExact;
+        StringBuilder reportBuilder;
+
+        for(UINT i=0; i<numReport; i++)
+        {
+            switch(method)
+            {
+                case 0: strReport     << TEXT("line ") << i << TEXT(": some report text\r\n"); break;
+                case 1: reportBuilder << TEXT("line ") << i << TEXT(": some report text\r\n"); break;
+                case 2: strExact      << TEXT("line ") << i << TEXT(": some report text\r\n"); break;
+            }
+        }
+
+        times[method] = MAX(OSGetTimeMicroseconds()-startTime, 1);
+        lengths[method] = strReport.Length() + reportBuilder.Length() + strExact.curLength;
+    }
+
+    if(lengths[0] != lengths[1] || lengths[0] != lengths[2])
+        bMismatch = true;
+
+    _tprintf(TEXT("%u line report: %8.3f ms String, %8.3f ms StringBuilder, %8.3f ms exact realloc\n"), numReport,
+        double(times[0])*0.001, double(times[1])*0.001, double(times[2])*0.001);
+
+    if(bMismatch)
+        _tprintf(TEXT("the methods built different strings\n"));
+
+    return bMismatch ? 1 : 0;
+}
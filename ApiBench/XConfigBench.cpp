@@ -0,0 +1,254 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "ApiBench.h"
+
+
+//writes a scene collection laid out like scenes.xconfig with -sources sources, then times
+//opening it and looking up scenes, sources and their settings.  lookups are timed through the
+//name index and through a linear scan of the sub-items, which is how XElement looked names up
+//before it had an index.
+
+#define XCONFIG_BENCH_FILE TEXT("ApiBench.xconfig")
+
+static XElement* LinearGetElement(XElement *parent, CTSTR lpName)
+{
+    DWORD numItems = parent->NumBaseItems();
+    for(DWORD i=0; i<numItems; i++)
+    {
+        XBaseItem *item = parent->GetBaseItemByID(i);
+        if(item->IsElement() && scmpi(item->GetName(), lpName) == 0)
+            return static_cast<XElement*>(item);
+    }
+
+    return NULL;
+}
+
+static XDataItem* LinearGetDataItem(XElement *parent, CTSTR lpName)
+{
+    DWORD numItems = parent->NumBaseItems();
+    for(DWORD i=0; i<numItems; i++)
+    {
+        XBaseItem *item = parent->GetBaseItemByID(i);
+        if(item->IsData() && scmpi(item->GetName(), lpName) == 0)
+            return static_cast<XDataItem*>(item);
+    }
+
+    return NULL;
+}
+
+static void AddSourceSettings(XElement *source, UINT id)
+{
+    source->SetInt(TEXT("render"), 1);
+    source->SetString(TEXT("class"), TEXT("BitmapImageSource"));
+    source->SetFloat(TEXT("x"), float(id%1920));
+    source->SetFloat(TEXT("y"), float(id%1080));
+    source->SetFloat(TEXT("cx"), 640.0f);
+    source->SetFloat(TEXT("cy"), 360.0f);
+    source->SetInt(TEXT("crop.left"), 0);
+    source->SetInt(TEXT("crop.top"), 0);
+    source->SetInt(TEXT("crop.right"), 0);
+    source->SetInt(TEXT("crop.bottom"), 0);
+
+    XElement *data = source->CreateElement(TEXT("data"));
+    data->SetString(TEXT("path"), FormattedString(TEXT("C:\\Users\\someone\\Pictures\\overlay %u.png"), id));
+    data->SetInt(TEXT("monitor"), 0);
+    data->SetInt(TEXT("opacity"), 100);
+    data->SetHex(TEXT("color"), 0xFFFFFFFF);
+    data->SetInt(TEXT("useColorKey"), 0);
+    data->SetHex(TEXT("keyColor"), 0xFF00FF00);
+    data->SetInt(TEXT("keySimilarity"), 10);
+    data->SetInt(TEXT("keyBlend"), 0);
+    data->SetInt(TEXT("width"), 640);
+    data->SetInt(TEXT("height"), 360);
+}
+
+int XConfigBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-sources"), TEXT("-perscene"), TEXT("-opens"), TEXT("-queries")};
+    UINT values[]   = {1000, 100, 20, 200000};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: ApiBench xconfig [-sources n] [-perscene n] [-opens n] [-queries n]"), 4, lpNames, values))
+        return 1;
+
+    UINT numSources  = MAX(values[0], 1);
+    UINT perScene    = MAX(values[1], 1);
+    UINT numOpens    = MAX(values[2], 1);
+    UINT numQueries  = MAX(values[3], 1);
+    UINT numScenes   = (numSources+perScene-1)/perScene;
+    UINT numGlobal   = MAX(numSources/10, 1);
+
+    StringList sceneNames, sourceNames;
+
+    //-----------------------------------------
+
+    OSDeleteFile(XCONFIG_BENCH_FILE);
+
+    {
+        XConfig config;
+        config.Open(XCONFIG_BENCH_FILE);
+
+        XElement *globalSources = config.CreateElement(TEXT("global sources"));
+        for(UINT i=0; i<numGlobal; i++)
+        {
+            XElement *source = globalSources->CreateElement(FormattedString(TEXT("Global %u"), i));
+            AddSourceSettings(source, i);
+        }
+
+        XElement *scenes = config.CreateElement(TEXT("scenes"));
+        for(UINT i=0; i<numScenes; i++)
+        {
+            sceneNames << FormattedString(TEXT("Scene %u"), i);
+
+            XElement *scene = scenes->CreateElement(sceneNames.Last());
+            scene->SetString(TEXT("class"), TEXT("Scene"));
+
+            XElement *sources = scene->CreateElement(TEXT("sources"));
+            for(UINT j=i*perScene; j<MIN((i+1)*perScene, numSources); j++)
+            {
+                sourceNames << FormattedString(TEXT("Source %u"), j);
+
+                XElement *source = sources->CreateElement(sourceNames.Last());
+                AddSourceSettings(source, j);
+            }
+        }
+
+        config.Close(true);
+    }
+
+    //-----------------------------------------
+
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT i=0; i<numOpens; i++)
+    {
+        XConfig config;
+        if(!config.Open(XCONFIG_BENCH_FILE))
+        {
+            _tprintf(TEXT("could not open %s\n"), XCONFIG_BENCH_FILE);
+            return 1;
+        }
+        config.Close();
+    }
+
+    QWORD openTime = OSGetTimeMicroseconds()-startTime;
+
+    _tprintf(TEXT("%u sources in %u scenes, %u global sources\n"), numSources, numScenes, numGlobal);
+    _tprintf(TEXT("open + close:                 %8.3f ms (%.2f us per source)\n\n"), double(openTime)*0.001/double(numOpens),
+        double(openTime)/double(numOpens)/double(numSources+numGlobal));
+
+    //-----------------------------------------
+
+    XConfig config;
+    config.Open(XCONFIG_BENCH_FILE);
+    XElement *scenes = config.GetElement(TEXT("scenes"));
+
+    List<UINT> queries;
+    queries.SetSize(numQueries);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numQueries; i++)
+        queries[i] = BenchRandom(seed)%numSources;
+
+    bool bMismatch = false;
+    volatile UPARAM sink = 0;
+
+    //scene -> "sources" -> source, like switching scenes or updating a source
+    QWORD elementTime[2];
+    for(UINT linear=0; linear<2; linear++)
+    {
+        startTime = OSGetTimeMicroseconds();
+
+        for(UINT i=0; i<numQueries; i++)
+        {
+            UINT source = queries[i];
+            CTSTR lpScene  = sceneNames[source/perScene];
+            CTSTR lpSource = sourceNames[source];
+
+            XElement *element;
+            if(linear)
+                element = LinearGetElement(LinearGetElement(LinearGetElement(scenes, lpScene), TEXT("sources")), lpSource);
+            else
+                element = scenes->GetElement(lpScene)->GetElement(TEXT("sources"))->GetElement(lpSource);
+
+            sink += (UPARAM)element;
+        }
+
+        elementTime[linear] = MAX(OSGetTimeMicroseconds()-startTime, 1);
+    }
+
+    //the first and the last setting of a source
+    List<XElement*> sourceElements;
+    for(UINT i=0; i<numSources; i++)
+        sourceElements << scenes->GetElement(sceneNames[i/perScene])->GetElement(TEXT("sources"))->GetElement(sourceNames[i]);
+
+    QWORD itemTime[2];
+    for(UINT linear=0; linear<2; linear++)
+    {
+        startTime = OSGetTimeMicroseconds();
+
+        for(UINT i=0; i<numQueries; i++)
+        {
+            XElement *source = sourceElements[queries[i]];
+
+            XDataItem *render, *crop;
+            if(linear)
+            {
+                render = LinearGetDataItem(source, TEXT("render"));
+                crop   = LinearGetDataItem(source, TEXT("crop.bottom"));
+            }
+            else
+            {
+                render = source->GetDataItem(TEXT("render"));
+                crop   = source->GetDataItem(TEXT("crop.bottom"));
+            }
+
+            sink += (UPARAM)render + (UPARAM)crop;
+        }
+
+        itemTime[linear] = MAX(OSGetTimeMicroseconds()-startTime, 1);
+    }
+
+    //both ways have to find the same items
+    for(UINT i=0; i<numSources && !bMismatch; i++)
+    {
+        XElement *scene = scenes->GetElement(sceneNames[i/perScene]);
+        XElement *source = sourceElements[i];
+
+        if(!source || source != LinearGetElement(LinearGetElement(scene, TEXT("sources")), sourceNames[i]) ||
+           source->GetDataItem(TEXT("crop.bottom")) != LinearGetDataItem(source, TEXT("crop.bottom")) ||
+           source->GetElement(TEXT("data")) != LinearGetElement(source, TEXT("data")))
+        {
+            _tprintf(TEXT("lookup mismatch for %s\n"), sourceNames[i].Array());
+            bMismatch = true;
+        }
+    }
+
+    config.Close();
+    OSDeleteFile(XCONFIG_BENCH_FILE);
+
+    _tprintf(TEXT("scene/sources/source lookup: %8.1f ns indexed, %8.1f ns linear (%.1fx)\n"),
+        double(elementTime[0])*1000.0/double(numQueries), double(elementTime[1])*1000.0/double(numQueries),
+        double(elementTime[1])/double(elementTime[0]));
+    _tprintf(TEXT("two settings of a source:    %8.1f ns indexed, %8.1f ns linear (%.1fx)\n"),
+        double(itemTime[0])*1000.0/double(numQueries), double(itemTime[1])*1000.0/double(numQueries),
+        double(itemTime[1])/double(itemTime[0]));
+
+    return bMismatch ? 1 : 0;
+}
@@ -0,0 +1,500 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "AudioBench.h"
+#include "SyntheticAudioSource.h"
+
+
+//the default mode runs generated audio through the same query/mix/encode sequence as
+//OBS::MainAudioLoop, on a simulated clock, so it needs no audio hardware and doesn't have to wait
+//in real time.
+//
+//  AudioBench [pipeline] [-seconds n] [-rate 44100|48000] [-buffer ms] [-codec aac|mp3|both] [-bitrate kbps]
+//             [-mic] [-sourcerate hz] [-jitter ms] [-burst intervalms lengthms] [-drift ppm]
+//
+//prints the throughput, how far behind the clock blocks were mixed, the cost of each block,
+//late and dropped segments per source and the encoders' cpu time.
+//
+//the other modes test and time one piece of the audio path on its own:
+//
+//  AudioBench <mode> [options]
+
+AudioEncoder* CreateMP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels);
+AudioEncoder* CreateAACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads);
+
+#define BENCH_START_TIME    10000   //the sources treat a time of 0 as not started
+
+struct BenchSettings
+{
+    UINT  seconds;
+    UINT  sampleRateHz;
+    QWORD bufferingTime;
+    UINT  bitRate;
+    bool  bAAC, bMP3;
+    bool  bMic;
+
+    SyntheticAudioSettings source;
+
+    inline BenchSettings()
+        : seconds(60), sampleRateHz(44100), bufferingTime(700), bitRate(96), bAAC(true), bMP3(true), bMic(false) {}
+};
+
+struct BenchSource
+{
+    SyntheticAudioSource *source;
+    CTSTR lpName;
+    QWORD segmentsIn, segmentsMixed, lateBlocks;
+};
+
+struct BenchEncoder
+{
+    AudioEncoder *encoder;
+    MetricHistogram *encodeTime;
+    QWORD packetsOut, bytesOut;
+};
+
+class AudioBench
+{
+    BenchSettings settings;
+    UINT blockFrames;
+
+    BenchSource desktop, mic;
+    List<BenchEncoder> encoders;
+
+    List<QWORD> bufferedAudioTimes;
+    QWORD latestAudioTime;
+    List<float> mixBuffer;
+
+    QWORD curTime;
+    QWORD numBlocks;
+    UINT  numOverBuffered;
+
+    MetricHistogram *mixLatency, *blockTime;
+
+    void InitSource(BenchSource &benchSource, CTSTR lpName, const SyntheticAudioSettings &sourceSettings);
+    void AddEncoder(AudioEncoder *encoder);
+
+    bool QueryAudioBuffers();
+    bool QueryNewAudio();
+    void MixBlock();
+
+    void PrintSource(BenchSource &benchSource);
+
+public:
+    AudioBench(const BenchSettings &settings);
+    ~AudioBench();
+
+    void Run();
+};
+
+AudioBench::AudioBench(const BenchSettings &settings)
+    : settings(settings)
+{
+    blockFrames = settings.sampleRateHz/100;
+    mixBuffer.SetSize(blockFrames*2);
+
+    InitSource(desktop, TEXT("Synthetic Desktop"), settings.source);
+
+    zero(&mic, sizeof(mic));
+    if(settings.bMic)
+    {
+        SyntheticAudioSettings micSettings = settings.source;
+        micSettings.toneHz = 220.0f;
+        micSettings.seed   = 0x1234567;
+
+        InitSource(mic, TEXT("Synthetic Mic"), micSettings);
+    }
+
+    if(settings.bAAC)
+        AddEncoder(CreateAACEncoder(settings.bitRate, settings.sampleRateHz, 2, 1));
+    if(settings.bMP3)
+        AddEncoder(CreateMP3Encoder(settings.bitRate, settings.sampleRateHz, 2));
+
+    latestAudioTime = 0;
+    curTime = 0;
+    numBlocks = 0;
+    numOverBuffered = 0;
+
+    mixLatency = GetMetricHistogram(TEXT("bench.mixLatency"));
+    blockTime  = GetMetricHistogram(TEXT("bench.block"));
+}
+
+AudioBench::~AudioBench()
+{
+    for(UINT i=0; i<encoders.Num(); i++)
+        delete encoders[i].encoder;
+
+    delete desktop.source;
+    delete mic.source;
+}
+
+void AudioBench::InitSource(BenchSource &benchSource, CTSTR lpName, const SyntheticAudioSettings &sourceSettings)
+{
+    benchSource.source = new SyntheticAudioSource(lpName, sourceSettings);
+    benchSource.lpName = lpName;
+    benchSource.segmentsIn = benchSource.segmentsMixed = benchSource.lateBlocks = 0;
+}
+
+void AudioBench::AddEncoder(AudioEncoder *encoder)
+{
+    BenchEncoder *benchEncoder = encoders.CreateNew();
+    benchEncoder->encoder = encoder;
+    benchEncoder->encodeTime = GetMetricHistogram(FormattedString(TEXT("bench.encode.%s"), encoder->GetCodec()));
+    benchEncoder->packetsOut = benchEncoder->bytesOut = 0;
+}
+
+//-----------------------------------------------------------------------------
+// the same steps as OBS::QueryAudioBuffers and OBS::QueryNewAudio, with the mic as the only
+// other source
+
+bool AudioBench::QueryAudioBuffers()
+{
+    if(!latestAudioTime)
+        desktop.source->GetEarliestTimestamp(latestAudioTime);
+    else
+    {
+        QWORD latestDesktopTimestamp;
+        if(desktop.source->GetLatestTimestamp(latestDesktopTimestamp))
+        {
+            if((latestAudioTime+10) > latestDesktopTimestamp)
+                return false;
+        }
+        latestAudioTime += 10;
+    }
+
+    bufferedAudioTimes << latestAudioTime;
+
+    if(mic.source && mic.source->QueryAudio2(1.0f, true) != NoAudioAvailable)
+    {
+        mic.segmentsIn++;
+        return true;
+    }
+
+    return false;
+}
+
+bool AudioBench::QueryNewAudio()
+{
+    bool bAudioBufferFilled = false;
+
+    while(!bAudioBufferFilled)
+    {
+        bool bGotAudio = false;
+
+        if(desktop.source->GetBufferedTime() > settings.bufferingTime*3/2)
+        {
+            numOverBuffered++;
+            bAudioBufferFilled = true;
+        }
+        else
+        {
+            if(desktop.source->QueryAudio2(1.0f) != NoAudioAvailable)
+            {
+                desktop.segmentsIn++;
+                QueryAudioBuffers();
+                bGotAudio = true;
+            }
+
+            bAudioBufferFilled = desktop.source->GetBufferedTime() >= settings.bufferingTime;
+        }
+
+        if(!bGotAudio && bAudioBufferFilled)
+            QueryAudioBuffers();
+
+        if(bAudioBufferFilled || !bGotAudio)
+            break;
+    }
+
+    if(!bAudioBufferFilled && mic.source)
+    {
+        while(mic.source->QueryAudio2(1.0f, true) != NoAudioAvailable)
+            mic.segmentsIn++;
+
+        QWORD timestamp;
+        if(mic.source->GetLatestTimestamp(timestamp))
+            mic.source->SortAudio(timestamp);
+    }
+
+    return bAudioBufferFilled;
+}
+
+//the mixing half of OBS::MainAudioLoop, and then each encoder in turn.  the app encodes on its own
+//threads; here everything is on one thread so the block cost includes the encoders.
+void AudioBench::MixBlock()
+{
+    MetricTimer timer(blockTime);
+
+    QWORD timestamp = bufferedAudioTimes[0];
+    bufferedAudioTimes.Remove(0);
+
+    if(curTime > timestamp)
+        mixLatency->Record(DWORD((curTime-timestamp)*1000));
+
+    zero(mixBuffer.Array(), blockFrames*2*sizeof(float));
+
+    float *desktopBuffer, *micBuffer;
+
+    if(desktop.source->GetBuffer(&desktopBuffer, timestamp))
+        desktop.segmentsMixed++;
+    else
+        desktop.lateBlocks++;
+
+    MixAudio(mixBuffer.Array(), desktopBuffer, blockFrames*2, false);
+
+    if(mic.source)
+    {
+        if(mic.source->GetBuffer(&micBuffer, timestamp))
+            mic.segmentsMixed++;
+        else
+            mic.lateBlocks++;
+
+        MixAudio(mixBuffer.Array(), micBuffer, blockFrames*2, false);
+    }
+
+    for(UINT i=0; i<encoders.Num(); i++)
+    {
+        BenchEncoder &benchEncoder = encoders[i];
+
+        DataPacket packet;
+        QWORD packetTimestamp = timestamp;
+        bool bEncoded;
+
+        {
+            MetricTimer encodeTimer(benchEncoder.encodeTime);
+            bEncoded = benchEncoder.encoder->Encode(mixBuffer.Array(), blockFrames, packet, packetTimestamp);
+        }
+
+        if(bEncoded)
+        {
+            benchEncoder.packetsOut++;
+            benchEncoder.bytesOut += packet.size;
+        }
+    }
+
+    numBlocks++;
+}
+
+void AudioBench::Run()
+{
+    QWORD endTime = BENCH_START_TIME + QWORD(settings.seconds)*1000;
+
+    curTime = BENCH_START_TIME;
+    desktop.source->SetTime(curTime);
+    desktop.source->StartCapture();
+
+    if(mic.source)
+    {
+        mic.source->SetTime(curTime);
+        mic.source->StartCapture();
+    }
+
+    QWORD startWallTime = OSGetTimeMicroseconds();
+
+    for(; curTime < endTime; curTime++)
+    {
+        desktop.source->SetTime(curTime);
+        if(mic.source)
+            mic.source->SetTime(curTime);
+
+        while(QueryNewAudio() && bufferedAudioTimes.Num())
+            MixBlock();
+    }
+
+    QWORD wallTime = MAX(OSGetTimeMicroseconds()-startWallTime, 1);
+
+    //---------------------------------------------
+
+    double audioSeconds = double(numBlocks)*0.01;
+    double wallSeconds  = double(wallTime)*0.000001;
+
+    _tprintf(TEXT("%u hz, %llu ms buffering, %u simulated seconds\n"), settings.sampleRateHz, settings.bufferingTime, settings.seconds);
+    _tprintf(TEXT("mixed %llu blocks (%.1f s of audio) in %.3f s, %.1fx real time, %.1f us per block\n"),
+        numBlocks, audioSeconds, wallSeconds, audioSeconds/wallSeconds, double(wallTime)/double(MAX(numBlocks, 1)));
+
+    if(numOverBuffered)
+        _tprintf(TEXT("desktop was buffered past 1.5x the buffering time %u times\n"), numOverBuffered);
+
+    PrintSource(desktop);
+    if(mic.source)
+        PrintSource(mic);
+
+    for(UINT i=0; i<encoders.Num(); i++)
+    {
+        BenchEncoder &benchEncoder = encoders[i];
+
+        double seconds = double(benchEncoder.encodeTime->Count()*benchEncoder.encodeTime->Mean())*0.000001;
+        _tprintf(TEXT("%s: %llu packets, %.1f kbps, %.3f s cpu (%.2f%% of the audio)\n"), benchEncoder.encoder->GetCodec(),
+            benchEncoder.packetsOut, double(benchEncoder.bytesOut*8)/audioSeconds/1000.0, seconds, seconds/audioSeconds*100.0);
+    }
+
+    //---------------------------------------------
+
+    List<MetricStats> stats;
+    GetMetricStats(stats);
+
+    _tprintf(TEXT("\n%-32s %10s %10s %10s %10s %10s\n"), TEXT("histogram (us)"), TEXT("count"), TEXT("mean"), TEXT("p50"), TEXT("p99"), TEXT("max"));
+
+    for(UINT i=0; i<stats.Num(); i++)
+    {
+        MetricStats &stat = stats[i];
+        if(stat.type == MetricType_Histogram && stat.value)
+            _tprintf(TEXT("%-32s %10llu %10.1f %10llu %10llu %10llu\n"), stat.lpName, stat.value, stat.mean, stat.p50, stat.p99, stat.maxValue);
+    }
+}
+
+void AudioBench::PrintSource(BenchSource &benchSource)
+{
+    //whatever is still queued at the end wasn't dropped
+    QWORD leftOver = 0, timestamp;
+    float *buffer;
+
+    while(benchSource.source->GetEarliestTimestamp(timestamp) && benchSource.source->GetBuffer(&buffer, timestamp))
+        leftOver++;
+
+    QWORD dropped = benchSource.segmentsIn - benchSource.segmentsMixed - leftOver;
+
+    _tprintf(TEXT("%s: %llu frames generated, %u bursts, %llu segments in, %llu mixed, %llu late blocks (silence), %llu segments dropped\n"),
+        benchSource.lpName, benchSource.source->NumFramesDelivered(), benchSource.source->NumBursts(),
+        benchSource.segmentsIn, benchSource.segmentsMixed, benchSource.lateBlocks, dropped);
+}
+
+//-----------------------------------------------------------------------------
+
+static int PipelineBench(int argc, TCHAR *argv[])
+{
+    BenchSettings settings;
+
+    for(int i=0; i<argc; i++)
+    {
+        CTSTR lpArg = argv[i];
+        bool bHasValue = (i+1 < argc);
+
+        if(scmpi(lpArg, TEXT("-seconds")) == 0 && bHasValue)
+            settings.seconds = (UINT)MAX(tstoi(argv[++i]), 1);
+        else if(scmpi(lpArg, TEXT("-rate")) == 0 && bHasValue)
+            settings.sampleRateHz = (tstoi(argv[++i]) == 48000) ? 48000 : 44100;
+        else if(scmpi(lpArg, TEXT("-buffer")) == 0 && bHasValue)
+            settings.bufferingTime = (QWORD)MAX(tstoi(argv[++i]), 10);
+        else if(scmpi(lpArg, TEXT("-bitrate")) == 0 && bHasValue)
+            settings.bitRate = (UINT)MAX(tstoi(argv[++i]), 32);
+        else if(scmpi(lpArg, TEXT("-codec")) == 0 && bHasValue)
+        {
+            CTSTR lpCodec = argv[++i];
+            settings.bAAC = scmpi(lpCodec, TEXT("mp3")) != 0;
+            settings.bMP3 = scmpi(lpCodec, TEXT("aac")) != 0;
+        }
+        else if(scmpi(lpArg, TEXT("-mic")) == 0)
+            settings.bMic = true;
+        else if(scmpi(lpArg, TEXT("-sourcerate")) == 0 && bHasValue)
+            settings.source.sampleRate = (UINT)MAX(tstoi(argv[++i]), 0);
+        else if(scmpi(lpArg, TEXT("-jitter")) == 0 && bHasValue)
+            settings.source.jitterMS = MAX(tstoi(argv[++i]), 0);
+        else if(scmpi(lpArg, TEXT("-burst")) == 0 && i+2 < argc)
+        {
+            settings.source.burstIntervalMS = (QWORD)MAX(tstoi(argv[++i]), 0);
+            settings.source.burstMS         = (QWORD)MAX(tstoi(argv[++i]), 0);
+        }
+        else if(scmpi(lpArg, TEXT("-drift")) == 0 && bHasValue)
+            settings.source.driftPPM = tstoi(argv[++i]);
+        else
+        {
+            _tprintf(TEXT("usage: AudioBench [pipeline] [-seconds n] [-rate 44100|48000] [-buffer ms] [-codec aac|mp3|both] [-bitrate kbps]\n")
+                     TEXT("                             [-mic] [-sourcerate hz] [-jitter ms] [-burst intervalms lengthms] [-drift ppm]\n"));
+            return 1;
+        }
+    }
+
+    API = CreateBenchAPIInterface(settings.sampleRateHz);
+
+    {
+        AudioBench bench(settings);
+        bench.Run();
+    }
+
+    delete API;
+    API = NULL;
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+struct BenchMode
+{
+    CTSTR lpName;
+    BENCHPROC proc;
+    CTSTR lpDescription;
+};
+
+static BenchMode modes[] =
+{
+    {TEXT("pipeline"),  PipelineBench,  TEXT("query, mix and encode generated audio on a simulated clock (the default)")},
+    {TEXT("kernels"),   KernelBench,    TEXT("every sse2/avx2 kernel against its scalar version, and the cost of each")},
+    {TEXT("workers"),   WorkerBench,    TEXT("1 to 32 sources processed on 0 to n worker threads, and that the output doesn't change")},
+    {TEXT("resampler"), ResamplerBench, TEXT("polyphase resampler snr/thd and speed against libsamplerate")},
+    {TEXT("sinc"),      SincBench,      TEXT("libsamplerate's sinc converters: speed of each, and the sse2 loops against the scalar ones")},
+    {TEXT("noisegate"), NoiseGateBench, TEXT("the block noise gate against the per-sample one it replaced, and the cost of each")},
+    {TEXT("meter"),     MeterBench,     TEXT("audio meter cost with loudness off and on against the old levels mix, and its readings")},
+    {TEXT("encoders"),  EncoderBench,   TEXT("aac and mp3 encoding the same mix on encode threads, checked against encoding directly")},
+    {TEXT("faac"),      FaacBench,      TEXT("libfaac's bitstream against a recorded hash, its encode speed, and scaling with channel threads")},
+    {TEXT("timestamp"), TimestampBench, TEXT("aac and mp3 packet timestamps against the encoder wrappers' old timestamp queues")},
+};
+
+#define NUM_MODES (sizeof(modes)/sizeof(modes[0]))
+
+static void PrintModes()
+{
+    _tprintf(TEXT("usage: AudioBench [mode] [options]\n\n"));
+    for(UINT i=0; i<NUM_MODES; i++)
+        _tprintf(TEXT("  %-10s %s\n"), modes[i].lpName, modes[i].lpDescription);
+}
+
+int _tmain(int argc, TCHAR *argv[])
+{
+    //no mode name means the pipeline, so the old command lines still work
+    BenchMode *mode = modes;
+    int firstArg = 1;
+
+    if(argc > 1 && argv[1][0] != '-')
+    {
+        mode = NULL;
+        for(UINT i=0; i<NUM_MODES; i++)
+        {
+            if(scmpi(argv[1], modes[i].lpName) == 0)
+                mode = modes+i;
+        }
+
+        if(!mode)
+        {
+            PrintModes();
+            return 1;
+        }
+
+        firstArg = 2;
+    }
+
+    if(!InitXT(TEXT("AudioBench.log"), TEXT("FastAlloc")))
+        return 1;
+
+    int ret = mode->proc(argc-firstArg, argv+firstArg);
+
+    TerminateXT();
+
+    return ret;
+}
@@ -0,0 +1,39 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+#include "../Source/Main.h"
+#include "../ApiBench/BenchCommon.h"
+
+
+//an APIInterface that only knows the output sample rate, which is all the audio sources ask for
+APIInterface* CreateBenchAPIInterface(UINT sampleRateHz);
+
+
+//modes other than the pipeline, each in its own file
+int KernelBench(int argc, TCHAR *argv[]);
+int WorkerBench(int argc, TCHAR *argv[]);
+int ResamplerBench(int argc, TCHAR *argv[]);
+int SincBench(int argc, TCHAR *argv[]);
+int NoiseGateBench(int argc, TCHAR *argv[]);
+int MeterBench(int argc, TCHAR *argv[]);
+int EncoderBench(int argc, TCHAR *argv[]);
+int FaacBench(int argc, TCHAR *argv[]);
+int TimestampBench(int argc, TCHAR *argv[]);
@@ -0,0 +1,168 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "OBSApi.h"
+
+
+//the audio sources only ask the api for the output sample rate.  there's no app, scene or window
+//in the bench, so everything else is empty.
+class BenchAPIInterface : public APIInterface
+{
+    UINT sampleRateHz;
+
+public:
+    inline BenchAPIInterface(UINT sampleRateHz) : sampleRateHz(sampleRateHz) {}
+
+    virtual UINT GetSampleRateHz() const {return sampleRateHz;}
+
+    //-----------------------------------------
+
+    virtual void EnterSceneMutex() {}
+    virtual void LeaveSceneMutex() {}
+
+    virtual void RegisterSceneClass(CTSTR lpClassName, CTSTR lpDisplayName, OBSCREATEPROC createProc, OBSCONFIGPROC configProc) {}
+    virtual void RegisterImageSourceClass(CTSTR lpClassName, CTSTR lpDisplayName, OBSCREATEPROC createProc, OBSCONFIGPROC configProc) {}
+
+    virtual ImageSource* CreateImageSource(CTSTR lpClassName, XElement *data) {return NULL;}
+
+    virtual XElement* GetSceneListElement() {return NULL;}
+    virtual XElement* GetGlobalSourceListElement() {return NULL;}
+
+    virtual bool SetScene(CTSTR lpScene, bool bPost) {return false;}
+    virtual Scene* GetScene() const {return NULL;}
+
+    virtual CTSTR GetSceneName() const {return TEXT("");}
+    virtual XElement* GetSceneElement() {return NULL;}
+
+    virtual UINT CreateHotkey(DWORD hotkey, OBSHOTKEYPROC hotkeyProc, UPARAM param) {return 0;}
+    virtual void DeleteHotkey(UINT hotkeyID) {}
+
+    virtual Vect2 GetBaseSize() const {return Vect2(0.0f, 0.0f);}
+    virtual Vect2 GetRenderFrameSize() const {return Vect2(0.0f, 0.0f);}
+    virtual Vect2 GetOutputSize() const {return Vect2(0.0f, 0.0f);}
+
+    virtual void GetBaseSize(UINT &width, UINT &height) const {width = height = 0;}
+    virtual void GetRenderFrameSize(UINT &width, UINT &height) const {width = height = 0;}
+    virtual void GetOutputSize(UINT &width, UINT &height) const {width = height = 0;}
+    virtual UINT GetMaxFPS() const {return 0;}
+
+    virtual CTSTR GetLanguage() const {return TEXT("en");}
+
+    virtual HWND GetMainWindow() const {return NULL;}
+
+    virtual CTSTR GetAppDataPath() const {return TEXT(".");}
+    virtual String GetPluginDataPath() const {return String(TEXT("."));}
+
+    virtual UINT AddStreamInfo(CTSTR lpInfo, StreamInfoPriority priority) {return 0;}
+    virtual void SetStreamInfo(UINT infoID, CTSTR lpInfo) {}
+    virtual void SetStreamInfoPriority(UINT infoID, StreamInfoPriority priority) {}
+    virtual void RemoveStreamInfo(UINT infoID) {}
+
+    virtual bool UseMultithreadedOptimizations() const {return false;}
+
+    virtual void AddAudioSource(AudioSource *source) {}
+    virtual void RemoveAudioSource(AudioSource *source) {}
+
+    virtual QWORD GetAudioTime() const {return 0;}
+
+    virtual CTSTR GetAppPath() const {return TEXT(".");}
+
+    virtual void StartStopStream() {}
+    virtual void StartStopPreview() {}
+    virtual bool GetStreaming() {return false;}
+    virtual bool GetPreviewOnly() {return false;}
+
+    virtual void SetSourceOrder(StringList &sourceNames) {}
+    virtual void SetSourceRender(CTSTR lpSource, bool render) {}
+
+    virtual void SetDesktopVolume(float val, bool finalValue) {}
+    virtual float GetDesktopVolume() {return 1.0f;}
+    virtual void ToggleDesktopMute() {}
+    virtual bool GetDesktopMuted() {return false;}
+
+    virtual void SetMicVolume(float val, bool finalValue) {}
+    virtual float GetMicVolume() {return 1.0f;}
+    virtual void ToggleMicMute() {}
+    virtual bool GetMicMuted() {return false;}
+
+    virtual DWORD GetOBSVersion() const {return 0;}
+    virtual bool IsTestVersion() const {return true;}
+
+    virtual UINT NumAuxAudioSources() const {return 0;}
+    virtual AudioSource* GetAuxAudioSource(UINT id) {return NULL;}
+
+    virtual AudioSource* GetDesktopAudioSource() {return NULL;}
+    virtual AudioSource* GetMicAudioSource() {return NULL;}
+
+    virtual void GetCurDesktopVolumeStats(float *rms, float *max, float *peak) const {*rms = *max = *peak = VOL_MIN;}
+    virtual void GetCurMicVolumeStats(float *rms, float *max, float *peak) const {*rms = *max = *peak = VOL_MIN;}
+
+    virtual void AddSettingsPane(SettingsPane *pane) {}
+    virtual void RemoveSettingsPane(SettingsPane *pane) {}
+
+    virtual void SetChangedSettings(bool isModified) {}
+
+    virtual Vect2 GetRenderFrameOffset() const {return Vect2(0.0f, 0.0f);}
+    virtual Vect2 GetRenderFrameControlSize() const {return Vect2(0.0f, 0.0f);}
+
+    virtual void GetRenderFrameOffset(UINT &x, UINT &y) const {x = y = 0;}
+    virtual void GetRenderFrameControlSize(UINT &width, UINT &height) const {width = height = 0;}
+
+    virtual bool GetRenderFrameIn1To1Mode() const {return false;}
+
+    virtual Vect2 MapWindowToFramePos(Vect2 mousePos) const {return mousePos;}
+    virtual Vect2 MapFrameToWindowPos(Vect2 framePos) const {return framePos;}
+    virtual Vect2 MapWindowToFrameSize(Vect2 windowSize) const {return windowSize;}
+    virtual Vect2 MapFrameToWindowSize(Vect2 frameSize) const {return frameSize;}
+    virtual Vect2 GetWindowToFrameScale() const {return Vect2(1.0f, 1.0f);}
+    virtual Vect2 GetFrameToWindowScale() const {return Vect2(1.0f, 1.0f);}
+
+    virtual void SetAbortApplySettings(bool abort) {}
+
+    virtual void StartStopRecording() {}
+    virtual bool GetRecording() const {return false;}
+
+    virtual bool GetKeepRecording() const {return false;}
+
+    virtual UINT GetCaptureFPS() const {return 0;}
+    virtual UINT GetTotalFrames() const {return 0;}
+    virtual UINT GetFramesDropped() const {return 0;}
+    virtual UINT GetTotalStreamTime() const {return 0;}
+    virtual UINT GetBytesPerSec() const {return 0;}
+
+    virtual void SetCanOptimizeSettings(bool canOptimize) {}
+
+    virtual void StartStopRecordingReplayBuffer() {}
+    virtual bool GetRecordingReplayBuffer() const {return false;}
+    virtual void SaveReplayBuffer() {}
+
+    virtual bool SetSceneCollection(CTSTR lpCollection, CTSTR lpScene) {return false;}
+    virtual CTSTR GetSceneCollectionName() const {return TEXT("");}
+    virtual void GetSceneCollectionNames(StringList &list) const {}
+
+    virtual void GetPipelineStats(List<MetricStats> &stats) const {GetMetricStats(stats);}
+
+    virtual void GetCurDesktopLoudness(float *momentary, float *shortTerm, float *truePeak) const {*momentary = *shortTerm = *truePeak = VOL_MIN;}
+    virtual void GetCurMicLoudness(float *momentary, float *shortTerm, float *truePeak) const {*momentary = *shortTerm = *truePeak = VOL_MIN;}
+};
+
+APIInterface* CreateBenchAPIInterface(UINT sampleRateHz)
+{
+    return new BenchAPIInterface(sampleRateHz);
+}
@@ -0,0 +1,189 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "AudioBench.h"
+#include "../Source/AudioEncodeThreads.h"
+
+
+//feeds the same mix to an aac and an mp3 encoder through the encode threads OBS::EncodeAudioSegment
+//uses, pushing as fast as it can so the slower encoder keeps holding up the mixer, and checks that
+//each encoder's packets and timestamps are exactly what it puts out when it's called directly.
+//a dropped or reordered block shows up as a mismatch.
+
+AudioEncoder* CreateMP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels);
+AudioEncoder* CreateAACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads);
+
+#define ENCODE_BENCH_START_TIME 10000
+#define NUM_BENCH_ENCODERS      2
+
+struct EncodedStream
+{
+    UINT  hash;
+    UINT  numPackets;
+    QWORD numBytes;
+};
+
+static AudioEncoder* CreateBenchEncoder(UINT index, UINT bitRate, UINT sampleRate)
+{
+    return index ? CreateMP3Encoder(bitRate, sampleRate, 2) : CreateAACEncoder(bitRate, sampleRate, 2, 1);
+}
+
+inline void HashPacket(EncodedStream &stream, const BYTE *data, UINT size, QWORD timestamp)
+{
+    for(UINT i=0; i<size; i++)
+        stream.hash = (stream.hash ^ data[i])*16777619;
+    for(UINT i=0; i<sizeof(timestamp); i++)
+        stream.hash = (stream.hash ^ BYTE(timestamp >> (i*8)))*16777619;
+
+    stream.numPackets++;
+    stream.numBytes += size;
+}
+
+inline void ResetStream(EncodedStream &stream)
+{
+    stream.hash = 2166136261;
+    stream.numPackets = 0;
+    stream.numBytes = 0;
+}
+
+int EncoderBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds"), TEXT("-rate"), TEXT("-bitrate")};
+    UINT values[]   = {30, 44100, 128};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench encoders [-seconds n] [-rate hz] [-bitrate kbps]"), 3, lpNames, values))
+        return 1;
+
+    UINT seconds    = MAX(values[0], 1);
+    UINT sampleRate = (values[1] == 48000) ? 48000 : 44100;
+    UINT bitRate    = values[2];
+
+    UINT blockFrames = sampleRate/100;
+    UINT numBlocks   = seconds*100;
+
+    API = CreateBenchAPIInterface(sampleRate);
+
+    //a tone plus noise, different on each channel
+    List<float> mix;
+    mix.SetSize(numBlocks*blockFrames*2);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numBlocks*blockFrames; i++)
+    {
+        float tone = float(sin(double(i)*0.0575))*0.4f;
+        mix[i*2]   = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+        mix[i*2+1] = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+    }
+
+    //each encoder called directly, one after the other
+    EncodedStream expected[NUM_BENCH_ENCODERS], threaded[NUM_BENCH_ENCODERS];
+    QWORD serialTime = 0;
+
+    for(UINT i=0; i<NUM_BENCH_ENCODERS; i++)
+    {
+        AudioEncoder *encoder = CreateBenchEncoder(i, bitRate, sampleRate);
+        ResetStream(expected[i]);
+
+        QWORD startTime = OSGetTimeMicroseconds();
+
+        for(UINT block=0; block<numBlocks; block++)
+        {
+            DataPacket packet;
+            QWORD timestamp = ENCODE_BENCH_START_TIME + QWORD(block)*10;
+
+            if(encoder->Encode(mix.Array()+block*blockFrames*2, blockFrames, packet, timestamp))
+                HashPacket(expected[i], packet.lpPacket, packet.size, timestamp);
+        }
+
+        serialTime += OSGetTimeMicroseconds()-startTime;
+        delete encoder;
+    }
+
+    //both through encode threads.  every block can produce at most one packet, so the output
+    //queues can take the whole run without anything reading them
+    AudioEncoder *encoders[NUM_BENCH_ENCODERS];
+    SPSCQueue<FrameAudio> outputs[NUM_BENCH_ENCODERS];
+    AudioEncodeThread *threads[NUM_BENCH_ENCODERS];
+    UINT numMixerStalls[NUM_BENCH_ENCODERS];
+
+    for(UINT i=0; i<NUM_BENCH_ENCODERS; i++)
+    {
+        encoders[i] = CreateBenchEncoder(i, bitRate, sampleRate);
+        outputs[i].SetCapacity(numBlocks+1);
+        threads[i] = CreateAudioEncodeThread(encoders[i], &outputs[i], i ? TEXT("bench.mp3") : TEXT("bench.aac"));
+    }
+
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        for(UINT i=0; i<NUM_BENCH_ENCODERS; i++)
+            PushMixedAudio(threads[i], mix.Array()+block*blockFrames*2, blockFrames, ENCODE_BENCH_START_TIME + QWORD(block)*10);
+    }
+
+    QWORD pushTime = OSGetTimeMicroseconds()-startTime;
+
+    for(UINT i=0; i<NUM_BENCH_ENCODERS; i++)
+    {
+        numMixerStalls[i] = threads[i]->numMixerStalls;
+        DestroyAudioEncodeThread(threads[i]);
+    }
+
+    QWORD threadedTime = OSGetTimeMicroseconds()-startTime;
+
+    bool bFailed = false;
+
+    _tprintf(TEXT("%u seconds at %u hz, %u kbps, %d cores\n\n"), seconds, sampleRate, bitRate, OSGetTotalCores());
+    _tprintf(TEXT("%6s %10s %12s %14s %8s\n"), TEXT(""), TEXT("packets"), TEXT("bytes"), TEXT("mixer stalls"), TEXT(""));
+
+    for(UINT i=0; i<NUM_BENCH_ENCODERS; i++)
+    {
+        ResetStream(threaded[i]);
+
+        FrameAudio *frameAudio;
+        while((frameAudio = outputs[i].Peek()) != NULL)
+        {
+            HashPacket(threaded[i], frameAudio->audioData.Array(), frameAudio->audioData.Num(), frameAudio->timestamp);
+            outputs[i].Pop();
+        }
+
+        bool bMatch = threaded[i].hash == expected[i].hash && threaded[i].numPackets == expected[i].numPackets &&
+                      threaded[i].numBytes == expected[i].numBytes;
+        if(!bMatch)
+            bFailed = true;
+
+        _tprintf(TEXT("%6s %10u %12llu %14u %8s\n"), i ? TEXT("mp3") : TEXT("aac"), threaded[i].numPackets, threaded[i].numBytes,
+            numMixerStalls[i], bMatch ? TEXT("match") : TEXT("DIFFER"));
+
+        delete encoders[i];
+    }
+
+    _tprintf(TEXT("\nencoded one after the other: %.0fx real time\n"), double(seconds)*1000000.0/double(MAX(serialTime, 1)));
+    _tprintf(TEXT("encode threads:              %.0fx real time (mixer done after %.0f ms)\n"),
+        double(seconds)*1000000.0/double(MAX(threadedTime, 1)), double(pushTime)/1000.0);
+
+    if(bFailed)
+        _tprintf(TEXT("\nan encode thread's output differs from calling its encoder directly\n"));
+
+    delete API;
+    API = NULL;
+
+    return bFailed ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "AudioBench.h"
+#include "../libfaac/include/faac.h"
+
+
+//encodes a fixed input with libfaac directly, set up the way Encoder_AAC.cpp sets it up, and
+//checks the bitstream against hashes taken from libfaac before the sse2 quantizer and the paired
+//huffman book search went in.  build libfaac with FAAC_SIMD_QUANT 0 and 1 and both have to match.
+//the input is built from integers only so it's the same on every compiler; the encoder's own
+//floating point isn't, so the hashes are for an sse2 build (x64 or /arch:SSE2) and an x87 build
+//can come out different without anything being wrong.  then times the same encode.
+//
+//after that it times 48k stereo and 5.1 with faacEncConfiguration::numThreads from 1 to -threads
+//(what [Audio] AACEncodeThreads sets), and each threaded bitstream has to match the single
+//threaded one.
+
+struct FaacCase
+{
+    UINT sampleRate, channels, bitRate;
+    UINT hash;      //fnv-1a of every output byte, for FAAC_HASH_SECONDS of audio
+};
+
+static const FaacCase faacCases[] =
+{
+    {44100, 2, 128, 0xA3D9827A},
+    {48000, 2, 160, 0x983D7D29},
+    {44100, 1,  64, 0x822417BD},
+};
+
+static const FaacCase faacThreadCases[] =
+{
+    {48000, 2, 160, 0},
+    {48000, 6, 384, 0},
+};
+
+#define NUM_FAAC_CASES          (sizeof(faacCases)/sizeof(faacCases[0]))
+#define NUM_FAAC_THREAD_CASES   (sizeof(faacThreadCases)/sizeof(faacThreadCases[0]))
+#define FAAC_HASH_SECONDS       10
+
+//a triangle wave whose pitch and level change every quarter second, with noise on top.  every
+//value is an integer in 16bit range, which is what faac expects for float input
+static void MakeFaacInput(List<float> &input, UINT numFrames, UINT channels)
+{
+    input.SetSize(numFrames*channels);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numFrames; i++)
+    {
+        UINT section = i/11025;
+        int  period  = 40 + int(section%7)*23;
+        int  level   = 1000 + int(section%5)*1500;
+
+        for(UINT ch=0; ch<channels; ch++)
+        {
+            int phase = int((i + ch*period/4) % UINT(period));
+            int tri   = (phase < period/2) ? phase : period-phase;
+            int noise = int(BenchRandom(seed) >> 13) - 1024;
+
+            input[i*channels+ch] = float((tri*4 - period)*level/period + noise);
+        }
+    }
+}
+
+//encodes all of input and flushes the encoder.  returns the time faacEncEncode took in
+//microseconds, or 0 on an error
+static QWORD RunFaac(const FaacCase &faacCase, UINT numThreads, const List<float> &input, UINT &hash, QWORD &numBytes)
+{
+    unsigned long numReadSamples, outputSize;
+    faacEncHandle faac = faacEncOpen(faacCase.sampleRate, faacCase.channels, &numReadSamples, &outputSize);
+    if(!faac)
+        return 0;
+
+    faacEncConfigurationPtr config = faacEncGetCurrentConfiguration(faac);
+    config->bitRate = (faacCase.bitRate*1000)/faacCase.channels;
+    config->quantqual = 100;
+    config->inputFormat = FAAC_INPUT_FLOAT;
+    config->mpegVersion = MPEG4;
+    config->aacObjectType = LOW;
+    config->useLfe = 0;
+    config->outputFormat = 0;
+    config->numThreads = numThreads;
+
+    if(!faacEncSetConfiguration(faac, config))
+    {
+        faacEncClose(faac);
+        return 0;
+    }
+
+    List<BYTE> output;
+    output.SetSize(outputSize);
+
+    hash = 2166136261;
+    numBytes = 0;
+
+    QWORD time = 0;
+    UINT pos = 0;
+    int ret;
+
+    do
+    {
+        UINT numSamples = MIN(UINT(numReadSamples), input.Num()-pos);
+
+        QWORD startTime = OSGetTimeMicroseconds();
+        ret = faacEncEncode(faac, (int32_t*)(input.Array()+pos), numSamples, output.Array(), outputSize);
+        time += OSGetTimeMicroseconds()-startTime;
+
+        pos += numSamples;
+
+        for(int i=0; i<ret; i++)
+            hash = (hash ^ output[i])*16777619;
+        if(ret > 0)
+            numBytes += ret;
+
+    } while(ret > 0 || (ret == 0 && pos < input.Num()));
+
+    faacEncClose(faac);
+
+    return (ret < 0) ? 0 : MAX(time, 1);
+}
+
+int FaacBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds"), TEXT("-runs"), TEXT("-threads")};
+    UINT values[]   = {30, 3, (UINT)MAX(OSGetTotalCores(), 1)};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench faac [-seconds of audio to time] [-runs n] [-threads max]"), 3, lpNames, values))
+        return 1;
+
+    UINT seconds    = MAX(values[0], 1);
+    UINT numRuns    = MAX(values[1], 1);
+    UINT maxThreads = MAX(values[2], 1);
+
+    bool bFailed = false;
+
+    _tprintf(TEXT("bitstream hash for %u seconds, and the best of %u runs over %u seconds\n\n"), FAAC_HASH_SECONDS, numRuns, seconds);
+    _tprintf(TEXT("%6s %3s %5s %10s %10s %12s\n"), TEXT("hz"), TEXT("ch"), TEXT("kbps"), TEXT("hash"), TEXT(""), TEXT("real time"));
+
+    for(UINT i=0; i<NUM_FAAC_CASES; i++)
+    {
+        const FaacCase &faacCase = faacCases[i];
+        _tprintf(TEXT("%6u %3u %5u"), faacCase.sampleRate, faacCase.channels, faacCase.bitRate);
+
+        List<float> input;
+        MakeFaacInput(input, faacCase.sampleRate*FAAC_HASH_SECONDS, faacCase.channels);
+
+        UINT hash;
+        QWORD numBytes;
+        if(!RunFaac(faacCase, 1, input, hash, numBytes))
+        {
+            _tprintf(TEXT("  encode failed\n"));
+            bFailed = true;
+            continue;
+        }
+
+        bool bMatch = (hash == faacCase.hash);
+        if(!bMatch)
+            bFailed = true;
+
+        _tprintf(TEXT(" %10.8X %10s"), hash, bMatch ? TEXT("match") : TEXT("DIFFERS"));
+
+        MakeFaacInput(input, faacCase.sampleRate*seconds, faacCase.channels);
+
+        QWORD bestTime = 0;
+        for(UINT run=0; run<numRuns; run++)
+        {
+            QWORD time = RunFaac(faacCase, 1, input, hash, numBytes);
+            if(time && (!bestTime || time < bestTime))
+                bestTime = time;
+        }
+
+        if(bestTime)
+            _tprintf(TEXT(" %11.1fx\n"), double(seconds)*1000000.0/double(bestTime));
+        else
+            _tprintf(TEXT(" %12s\n"), TEXT("failed"));
+    }
+
+    if(bFailed)
+        _tprintf(TEXT("\nthe bitstream differs from the one libfaac made before the sse2 quantizer\n"));
+
+    //channel threads
+    List<UINT> threadCounts;
+    for(UINT numThreads=1; numThreads<maxThreads; numThreads *= 2)
+        threadCounts << numThreads;
+    threadCounts << maxThreads;
+
+    bool bThreadsDiffer = false;
+
+    _tprintf(TEXT("\ntimes real time with numThreads, best of %u runs over %u seconds, %d cores\n\n%6s %3s"), numRuns, seconds, OSGetTotalCores(), TEXT("hz"), TEXT("ch"));
+    for(UINT i=0; i<threadCounts.Num(); i++)
+        _tprintf(TEXT("  %5u threads"), threadCounts[i]);
+    _tprintf(TEXT("\n"));
+
+    for(UINT i=0; i<NUM_FAAC_THREAD_CASES; i++)
+    {
+        const FaacCase &faacCase = faacThreadCases[i];
+        _tprintf(TEXT("%6u %3u"), faacCase.sampleRate, faacCase.channels);
+
+        List<float> input;
+        MakeFaacInput(input, faacCase.sampleRate*seconds, faacCase.channels);
+
+        UINT serialHash = 0;
+
+        for(UINT j=0; j<threadCounts.Num(); j++)
+        {
+            QWORD bestTime = 0, numBytes;
+            UINT hash = 0;
+
+            for(UINT run=0; run<numRuns; run++)
+            {
+                QWORD time = RunFaac(faacCase, threadCounts[j], input, hash, numBytes);
+                if(time && (!bestTime || time < bestTime))
+                    bestTime = time;
+            }
+
+            if(!j)
+                serialHash = hash;
+
+            bool bDiffers = !bestTime || hash != serialHash;
+            if(bDiffers)
+                bThreadsDiffer = true;
+
+            if(bestTime)
+                _tprintf(TEXT(" %12.1fx%s"), double(seconds)*1000000.0/double(bestTime), bDiffers ? TEXT("!") : TEXT(" "));
+            else
+                _tprintf(TEXT(" %14s"), TEXT("failed"));
+        }
+
+        _tprintf(TEXT("\n"));
+    }
+
+    if(bThreadsDiffer)
+        _tprintf(TEXT("\n! the threaded bitstream differs from the single threaded one\n"));
+
+    return (bFailed || bThreadsDiffer) ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "AudioBench.h"
+#include "AudioKernelsInternal.h"
+
+
+//checks every kernel of every kernel set the cpu can run against the scalar version, over every
+//length from 0 to KERNEL_CHECK_MAX_LENGTH (so each vector tail is hit) and a few block sizes,
+//3 to 8 channel downmixes and 16/24/32 bit conversion, plus 8 bit through ConvertAudioToFloat.
+//then times each kernel on a 10ms 48khz stereo block.
+//
+//  AudioBench kernels [-blocks n]
+
+#define KERNEL_CHECK_MAX_LENGTH     67
+#define KERNEL_CHECK_TOLERANCE      1e-5f
+#define KERNEL_BLOCK_FRAMES         480
+#define KERNEL_FILTER_TAPS          32
+#define KERNEL_MAX_FAILURES         20
+
+//the fir filter has no scalar version in OBSApi, this is what the simd versions compute
+static void FilterStereoScalar(float *output, const float *input, const float *coefficients, UINT numTaps)
+{
+    float left = 0.0f, right = 0.0f;
+    for(UINT i=0; i<numTaps; i++)
+    {
+        left  += input[i*2]  *coefficients[i*2];
+        right += input[i*2+1]*coefficients[i*2+1];
+    }
+
+    output[0] = left;
+    output[1] = right;
+}
+
+static float MidPeakWholeScalar(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak)
+{
+    return MidPeakScalar(buffer, numFrames, rampStep, rampedPeak);
+}
+
+static void GainRampWholeScalar(float *buffer, UINT numFrames, float gain, float gainStep)
+{
+    GainRampScalar(buffer, numFrames, gain, gainStep);
+}
+
+static const AudioKernelTable scalarKernels =
+{
+    TEXT("scalar"),
+    MixScalar,
+    MultiplyScalar,
+    StereoToMonoScalar,
+    SumSquaresScalar,
+    ConvertInt16Scalar,
+    ConvertInt24Scalar,
+    ConvertInt32Scalar,
+    DownmixScalar,
+    FilterStereoScalar,
+    MidPeakWholeScalar,
+    GainRampWholeScalar
+};
+
+//-----------------------------------------
+
+class KernelCheck
+{
+    UINT seed;
+
+    inline float RandomFloat(float range) {return (float(BenchRandom(seed)&0xFFFF)/32767.5f - 1.0f)*range;}
+    inline void  RandomFloats(float *buffer, UINT count, float range) {for(UINT i=0; i<count; i++) buffer[i] = RandomFloat(range);}
+
+    //scale is how large the terms that went into the value were, for sums done in another order
+    void Compare(CTSTR lpKernel, UINT length, const float *output, const float *expected, UINT count, float scale=1.0f)
+    {
+        for(UINT i=0; i<count; i++)
+        {
+            if(fabsf(output[i]-expected[i]) > KERNEL_CHECK_TOLERANCE*(scale+fabsf(expected[i])))
+            {
+                Fail(lpKernel, length, i, output[i], expected[i]);
+                return;
+            }
+        }
+    }
+
+    void Fail(CTSTR lpKernel, UINT length, UINT index, float value, float expected)
+    {
+        if(numFailed++ < KERNEL_MAX_FAILURES)
+            _tprintf(TEXT("  %s %s: length %u, index %u: %g, expected %g\n"), table->lpName, lpKernel, length, index, value, expected);
+    }
+
+    void CheckLength(UINT length);
+
+public:
+    const AudioKernelTable *table;
+    UINT numFailed;
+
+    KernelCheck(const AudioKernelTable *table) : seed(0x2468ACE), table(table), numFailed(0) {}
+
+    void Run();
+};
+
+void KernelCheck::CheckLength(UINT n)
+{
+    List<float> a, b, expectedA;
+    a.SetSize(n+1); b.SetSize(n+1); expectedA.SetSize(n+1);
+
+    //mix has to clamp, so the sums go past 1
+    RandomFloats(a.Array(), n, 0.9f);
+    RandomFloats(b.Array(), n, 0.9f);
+    expectedA.CopyArray(a.Array(), n);
+    table->Mix(a.Array(), b.Array(), n);
+    MixScalar(expectedA.Array(), b.Array(), n);
+    Compare(TEXT("Mix"), n, a.Array(), expectedA.Array(), n);
+
+    table->Multiply(a.Array(), n, 0.3f);
+    MultiplyScalar(expectedA.Array(), n, 0.3f);
+    Compare(TEXT("Multiply"), n, a.Array(), expectedA.Array(), n);
+
+    RandomFloats(a.Array(), n, 1.0f);
+    expectedA.CopyArray(a.Array(), n);
+    table->StereoToMono(a.Array(), n);
+    StereoToMonoScalar(expectedA.Array(), n);
+    Compare(TEXT("StereoToMono"), n, a.Array(), expectedA.Array(), n);
+
+    float sum = 0.0f, maxSquare = 0.0f, expectedSum = 0.0f, expectedMax = 0.0f;
+    table->SumSquares(a.Array(), n, 1.7f, sum, maxSquare);
+    SumSquaresScalar(a.Array(), n, 1.7f, expectedSum, expectedMax);
+    Compare(TEXT("SumSquares sum"), n, &sum, &expectedSum, 1, float(n));
+    Compare(TEXT("SumSquares max"), n, &maxSquare, &expectedMax, 1);
+
+    //whole frames only from here
+    UINT frames = n/2;
+
+    RandomFloats(a.Array(), frames*2, 1.0f);
+    expectedA.CopyArray(a.Array(), frames*2);
+    table->GainRamp(a.Array(), frames, 0.2f, 0.031f);
+    GainRampScalar(expectedA.Array(), frames, 0.2f, 0.031f);
+    Compare(TEXT("GainRamp"), n, a.Array(), expectedA.Array(), frames*2);
+
+    float rampedPeak, expectedRampedPeak;
+    float peak = table->MidPeak(a.Array(), frames, 0.013f, rampedPeak);
+    float expectedPeak = MidPeakScalar(a.Array(), frames, 0.013f, expectedRampedPeak);
+    Compare(TEXT("MidPeak"), n, &peak, &expectedPeak, 1);
+    Compare(TEXT("MidPeak ramped"), n, &rampedPeak, &expectedRampedPeak, 1);
+
+    //-----------------------------------------
+
+    List<short> input16;
+    List<int>   input32;
+    List<BYTE>  input24;
+    List<char>  input8;
+    input16.SetSize(n+1); input32.SetSize(n+1); input24.SetSize(n*3+1); input8.SetSize(n+1);
+
+    for(UINT i=0; i<n; i++)
+    {
+        UINT val = BenchRandom(seed) ^ (BenchRandom(seed) << 24);
+
+        //the extremes are where a wrong sign extension shows
+        if(i%11 == 0)       val = 0x80000000;
+        else if(i%11 == 1)  val = 0x7FFFFFFF;
+
+        input32[i] = int(val);
+        input16[i] = short(val >> 16);
+        input8[i]  = char(val >> 24);
+        input24[i*3]   = BYTE(val >> 8);
+        input24[i*3+1] = BYTE(val >> 16);
+        input24[i*3+2] = BYTE(val >> 24);
+    }
+
+    table->ConvertInt16(a.Array(), input16.Array(), n, 0.5f);
+    ConvertInt16Scalar(expectedA.Array(), input16.Array(), n, 0.5f);
+    Compare(TEXT("ConvertInt16"), n, a.Array(), expectedA.Array(), n);
+
+    table->ConvertInt24(a.Array(), input24.Array(), n, 1.0f);
+    ConvertInt24Scalar(expectedA.Array(), input24.Array(), n, 1.0f);
+    Compare(TEXT("ConvertInt24"), n, a.Array(), expectedA.Array(), n);
+
+    table->ConvertInt32(a.Array(), input32.Array(), n, 0.75f);
+    ConvertInt32Scalar(expectedA.Array(), input32.Array(), n, 0.75f);
+    Compare(TEXT("ConvertInt32"), n, a.Array(), expectedA.Array(), n);
+
+    //8 bit has no simd version, it only goes through the exported function
+    ConvertAudioToFloat(a.Array(), input8.Array(), n, 8, 0.5f);
+    for(UINT i=0; i<n; i++)
+        expectedA[i] = float(input8[i])*(0.5f/127.0f);
+    Compare(TEXT("ConvertInt8"), n, a.Array(), expectedA.Array(), n);
+
+    //-----------------------------------------
+
+    for(UINT channels=3; channels<=AUDIO_DOWNMIX_MAX_CHANNELS; channels++)
+    {
+        UINT downmixFrames = n/channels;
+
+        AudioDownmixMatrix matrix;
+        zero(&matrix, sizeof(matrix));
+        for(UINT i=0; i<channels; i++)
+        {
+            matrix.left[i]  = RandomFloat(1.0f);
+            matrix.right[i] = RandomFloat(1.0f);
+        }
+
+        RandomFloats(b.Array(), downmixFrames*channels, 1.0f);
+        table->Downmix(a.Array(), b.Array(), downmixFrames, channels, matrix);
+        DownmixScalar(expectedA.Array(), b.Array(), downmixFrames, channels, matrix);
+        Compare(FormattedString(TEXT("Downmix %u channels"), channels), n, a.Array(), expectedA.Array(), downmixFrames*2, float(channels));
+    }
+
+    //one output frame from every multiple of 4 taps that fits
+    for(UINT taps=4; taps*2<=n; taps += 4)
+    {
+        RandomFloats(a.Array(), taps*2, 1.0f);
+        RandomFloats(b.Array(), taps*2, 1.0f);
+
+        float output[2], expected[2];
+        table->FilterStereo(output, a.Array(), b.Array(), taps);
+        FilterStereoScalar(expected, a.Array(), b.Array(), taps);
+        Compare(FormattedString(TEXT("FilterStereo %u taps"), taps), n, output, expected, 2, float(taps));
+    }
+}
+
+void KernelCheck::Run()
+{
+    for(UINT n=0; n<=KERNEL_CHECK_MAX_LENGTH; n++)
+        CheckLength(n);
+
+    CheckLength(KERNEL_BLOCK_FRAMES*2);
+    CheckLength(KERNEL_BLOCK_FRAMES*2+3);
+    CheckLength(441*2+1);
+}
+
+//-----------------------------------------
+
+enum KernelID
+{
+    Kernel_Mix,
+    Kernel_Multiply,
+    Kernel_StereoToMono,
+    Kernel_SumSquares,
+    Kernel_ConvertInt16,
+    Kernel_ConvertInt24,
+    Kernel_ConvertInt32,
+    Kernel_Downmix,
+    Kernel_FilterStereo,
+    Kernel_MidPeak,
+    Kernel_GainRamp,
+
+    Kernel_Count
+};
+
+static CTSTR lpKernelNames[Kernel_Count] =
+{
+    TEXT("Mix"), TEXT("Multiply"), TEXT("StereoToMono"), TEXT("SumSquares"), TEXT("ConvertInt16"), TEXT("ConvertInt24"),
+    TEXT("ConvertInt32"), TEXT("Downmix 6ch"), TEXT("FilterStereo 32"), TEXT("MidPeak"), TEXT("GainRamp")
+};
+
+//returns the mean time of one 10ms block in nanoseconds
+static double TimeKernel(const AudioKernelTable *table, KernelID kernel, UINT numBlocks)
+{
+    const UINT totalFloats = KERNEL_BLOCK_FRAMES*2;
+
+    List<float> a, b, coefficients;
+    List<short> input16;
+    List<int>   input32;
+    List<BYTE>  input24;
+
+    a.SetSize(totalFloats);
+    b.SetSize((KERNEL_BLOCK_FRAMES+KERNEL_FILTER_TAPS)*AUDIO_DOWNMIX_MAX_CHANNELS);
+    coefficients.SetSize(KERNEL_FILTER_TAPS*2);
+    input16.SetSize(totalFloats);
+    input32.SetSize(totalFloats);
+    input24.SetSize(totalFloats*3);
+
+    UINT seed = 0x1357;
+    for(UINT i=0; i<a.Num(); i++)           a[i] = float(int(BenchRandom(seed)&0xFFFF)-32768)/40000.0f;
+    for(UINT i=0; i<b.Num(); i++)           b[i] = float(int(BenchRandom(seed)&0xFFFF)-32768)/40000.0f;
+    for(UINT i=0; i<coefficients.Num(); i++) coefficients[i] = 1.0f/KERNEL_FILTER_TAPS;
+    for(UINT i=0; i<input16.Num(); i++)     input16[i] = short(BenchRandom(seed));
+    for(UINT i=0; i<input32.Num(); i++)     input32[i] = int(BenchRandom(seed) << 8);
+    for(UINT i=0; i<input24.Num(); i++)     input24[i] = BYTE(BenchRandom(seed));
+
+    AudioDownmixMatrix matrix;
+    zero(&matrix, sizeof(matrix));
+    for(UINT i=0; i<6; i++)
+        matrix.left[i] = matrix.right[i] = 0.3f;
+
+    float output[totalFloats];
+    float sum = 0.0f, maxSquare = 0.0f;
+    volatile float sink = 0.0f;
+
+    //the in-place kernels use values that keep the buffer the same, so it can't run into denormals
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        switch(kernel)
+        {
+            case Kernel_Mix:            table->Mix(a.Array(), b.Array(), totalFloats); break;
+            case Kernel_Multiply:       table->Multiply(a.Array(), totalFloats, 1.0f); break;
+            case Kernel_StereoToMono:   table->StereoToMono(a.Array(), totalFloats); break;
+            case Kernel_SumSquares:     table->SumSquares(a.Array(), totalFloats, 1.0f, sum, maxSquare); break;
+            case Kernel_ConvertInt16:   table->ConvertInt16(output, input16.Array(), totalFloats, 1.0f); break;
+            case Kernel_ConvertInt24:   table->ConvertInt24(output, input24.Array(), totalFloats, 1.0f); break;
+            case Kernel_ConvertInt32:   table->ConvertInt32(output, input32.Array(), totalFloats, 1.0f); break;
+            case Kernel_Downmix:        table->Downmix(output, b.Array(), KERNEL_BLOCK_FRAMES, 6, matrix); break;
+            case Kernel_MidPeak:        sink += table->MidPeak(a.Array(), KERNEL_BLOCK_FRAMES, 0.0f, sum); break;
+            case Kernel_GainRamp:       table->GainRamp(a.Array(), KERNEL_BLOCK_FRAMES, 1.0f, 0.0f); break;
+
+            case Kernel_FilterStereo:
+                for(UINT i=0; i<KERNEL_BLOCK_FRAMES; i++)
+                    table->FilterStereo(output+i*2, b.Array()+i*2, coefficients.Array(), KERNEL_FILTER_TAPS);
+                break;
+        }
+    }
+
+    QWORD elapsed = OSGetTimeMicroseconds()-startTime;
+    sink += sum + output[0];
+
+    return double(elapsed)*1000.0/double(numBlocks);
+}
+
+int KernelBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-blocks")};
+    UINT values[]   = {20000};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench kernels [-blocks n]"), 1, lpNames, values))
+        return 1;
+
+    UINT numBlocks = MAX(values[0], 1);
+
+    List<const AudioKernelTable*> tables;
+    while(const AudioKernelTable *table = GetAudioKernelTable(tables.Num()))
+        tables << table;
+
+    _tprintf(TEXT("selected kernels: %s\n"), GetAudioKernelName());
+    if(tables.Num() < 2)
+        _tprintf(TEXT("no avx2 on this cpu, only the sse2 kernels are checked\n"));
+
+    UINT numFailed = 0;
+    for(UINT i=0; i<tables.Num(); i++)
+    {
+        KernelCheck check(tables[i]);
+        check.Run();
+
+        _tprintf(TEXT("%s: %s\n"), tables[i]->lpName, check.numFailed ? TEXT("FAILED") : TEXT("all kernels match the scalar versions"));
+        numFailed += check.numFailed;
+    }
+
+    //-----------------------------------------
+
+    tables.Insert(0, &scalarKernels);
+
+    _tprintf(TEXT("\nns per %u frame stereo block\n%-18s"), KERNEL_BLOCK_FRAMES, TEXT(""));
+    for(UINT i=0; i<tables.Num(); i++)
+        _tprintf(i ? TEXT(" %10s        ") : TEXT(" %10s"), tables[i]->lpName);
+    _tprintf(TEXT("\n"));
+
+    for(UINT kernel=0; kernel<Kernel_Count; kernel++)
+    {
+        _tprintf(TEXT("%-18s"), lpKernelNames[kernel]);
+
+        double scalarTime = 0.0;
+        for(UINT i=0; i<tables.Num(); i++)
+        {
+            double time = TimeKernel(tables[i], (KernelID)kernel, numBlocks);
+            if(i == 0)
+                scalarTime = time;
+
+            _tprintf(TEXT(" %10.1f"), time);
+            if(i > 0)
+                _tprintf(TEXT(" (%4.1fx)"), scalarTime/MAX(time, 0.001));
+        }
+        _tprintf(TEXT("\n"));
+    }
+
+    return numFailed ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "AudioBench.h"
+
+
+//times AudioMeter on 1 to -sources sources per 10ms block, with loudness off (rms and peak only,
+//what the volume meters use) and on, against what the audio loop did before the meters: mix the
+//newest block of every desktop/aux source into a levels buffer and take its rms and peak.  also
+//checks that the meter reads a -23 dBFS 997hz stereo sine as -23 LUFS, and that with loudness
+//off it reads the same rms and peak as CalculateAudioLevels.
+
+#define METER_LOUDNESS_TOLERANCE    0.1f    //LU
+#define METER_LEVEL_TOLERANCE       1e-6f
+
+static const double pi = 3.14159265358979323846;
+
+struct MeterTimes
+{
+    double oldTime, levelsTime, loudnessTime;   //microseconds per 10ms block
+};
+
+static void TimeMeters(UINT numSources, UINT numBlocks, UINT sampleRate, const List<float> &audio, MeterTimes &times)
+{
+    UINT blockFrames = sampleRate/100;
+    UINT audioBlocks = audio.Num()/(blockFrames*2);
+
+    List<float> levelsBuffer;
+    levelsBuffer.SetSize(blockFrames*2);
+
+    AudioMeter *meters = new AudioMeter[numSources];
+    for(UINT i=0; i<numSources; i++)
+        meters[i].Init(sampleRate);
+
+    //each source reads a different part of the audio
+    List<const float*> sourceBlocks;
+    sourceBlocks.SetSize(numBlocks*numSources);
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        for(UINT i=0; i<numSources; i++)
+            sourceBlocks[block*numSources+i] = audio.Array() + ((block+i*7)%audioBlocks)*blockFrames*2;
+    }
+
+    float rms, peak;
+    AudioMeterStats total;
+
+    //each one is timed over all the blocks, a single block is too short for the timer
+    QWORD startTime = OSGetTimeMicroseconds();
+
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        const float **blockSources = sourceBlocks.Array()+block*numSources;
+
+        zero(levelsBuffer.Array(), blockFrames*2*sizeof(float));
+        for(UINT i=0; i<numSources; i++)
+            MixAudio(levelsBuffer.Array(), (float*)blockSources[i], blockFrames*2, false);
+        CalculateAudioLevels(levelsBuffer.Array(), blockFrames*2, 1.0f, rms, peak);
+    }
+
+    QWORD levelsStart = OSGetTimeMicroseconds();
+
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        const float **blockSources = sourceBlocks.Array()+block*numSources;
+
+        for(UINT i=0; i<numSources; i++)
+        {
+            meters[i].Process(blockSources[i], blockFrames, false);
+            if(i)
+                CombineAudioMeterStats(total, meters[i].GetStats());
+            else
+                total = meters[i].GetStats();
+        }
+    }
+
+    QWORD loudnessStart = OSGetTimeMicroseconds();
+
+    for(UINT block=0; block<numBlocks; block++)
+    {
+        const float **blockSources = sourceBlocks.Array()+block*numSources;
+
+        for(UINT i=0; i<numSources; i++)
+        {
+            meters[i].Process(blockSources[i], blockFrames, true);
+            if(i)
+                CombineAudioMeterStats(total, meters[i].GetStats());
+            else
+                total = meters[i].GetStats();
+        }
+    }
+
+    QWORD endTime = OSGetTimeMicroseconds();
+
+    QWORD oldTime = levelsStart-startTime, levelsTime = loudnessStart-levelsStart, loudnessTime = endTime-loudnessStart;
+
+    delete [] meters;
+
+    times.oldTime      = double(oldTime)/double(numBlocks);
+    times.levelsTime   = double(levelsTime)/double(numBlocks);
+    times.loudnessTime = double(loudnessTime)/double(numBlocks);
+}
+
+static bool CheckMeter(UINT sampleRate)
+{
+    UINT blockFrames = sampleRate/100;
+    float amplitude = powf(10.0f, -23.0f/20.0f);
+
+    AudioMeter meter;
+    meter.Init(sampleRate);
+
+    List<float> block;
+    block.SetSize(blockFrames*2);
+
+    bool bFailed = false;
+
+    //3 seconds fills the short-term window
+    for(UINT frame=0; frame<sampleRate*3; frame += blockFrames)
+    {
+        for(UINT i=0; i<blockFrames; i++)
+            block[i*2] = block[i*2+1] = amplitude*float(sin(2.0*pi*997.0*double(frame+i)/double(sampleRate)));
+
+        //with loudness off the levels have to be exactly what CalculateAudioLevels gives
+        meter.Process(block.Array(), blockFrames, false);
+
+        float rms, peak;
+        CalculateAudioLevels(block.Array(), blockFrames*2, 1.0f, rms, peak);
+
+        const AudioMeterStats &stats = meter.GetStats();
+        if(fabsf(stats.rms-rms) > METER_LEVEL_TOLERANCE || fabsf(stats.peak-peak) > METER_LEVEL_TOLERANCE)
+            bFailed = true;
+    }
+
+    meter.Reset();
+    for(UINT frame=0; frame<sampleRate*3; frame += blockFrames)
+    {
+        for(UINT i=0; i<blockFrames; i++)
+            block[i*2] = block[i*2+1] = amplitude*float(sin(2.0*pi*997.0*double(frame+i)/double(sampleRate)));
+        meter.Process(block.Array(), blockFrames, true);
+    }
+
+    float momentary = PowerToLUFS(meter.GetStats().momentaryPower);
+    float shortTerm = PowerToLUFS(meter.GetStats().shortTermPower);
+
+    if(fabsf(momentary+23.0f) > METER_LOUDNESS_TOLERANCE || fabsf(shortTerm+23.0f) > METER_LOUDNESS_TOLERANCE)
+        bFailed = true;
+
+    _tprintf(TEXT("%u hz: -23 dBFS 997hz sine reads %.2f LUFS momentary, %.2f short-term%s\n"), sampleRate, momentary, shortTerm,
+        bFailed ? TEXT(" !") : TEXT(""));
+
+    return !bFailed;
+}
+
+int MeterBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-sources"), TEXT("-blocks"), TEXT("-rate")};
+    UINT values[]   = {8, 20000, 44100};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench meter [-sources max] [-blocks n] [-rate hz]"), 3, lpNames, values))
+        return 1;
+
+    UINT maxSources = MIN(MAX(values[0], 1), 64);
+    UINT numBlocks  = MAX(values[1], 1);
+    UINT sampleRate = (values[2] == 48000) ? 48000 : 44100;
+
+    bool bFailed = !CheckMeter(44100);
+    bFailed |= !CheckMeter(48000);
+
+    //a second of noisy tones to read from
+    List<float> audio;
+    audio.SetSize(sampleRate*2);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<sampleRate; i++)
+    {
+        float tone = float(sin(double(i)*0.0575))*0.3f;
+        audio[i*2]   = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.1f;
+        audio[i*2+1] = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.1f;
+    }
+
+    _tprintf(TEXT("\nus per 10ms block at %u hz for all the sources, over %u blocks\n\n"), sampleRate, numBlocks);
+    _tprintf(TEXT("%8s %12s %12s %12s %16s\n"), TEXT("sources"), TEXT("old mix"), TEXT("levels"), TEXT("loudness"), TEXT("levels per src"));
+
+    for(UINT numSources=1; numSources<=maxSources; numSources *= 2)
+    {
+        MeterTimes times;
+        TimeMeters(numSources, numBlocks, sampleRate, audio, times);
+
+        _tprintf(TEXT("%8u %12.2f %12.2f %12.2f %16.2f%s\n"), numSources, times.oldTime, times.levelsTime, times.loudnessTime,
+            times.levelsTime/double(numSources), (times.levelsTime > times.oldTime) ? TEXT(" (slower than the old mix)") : TEXT(""));
+    }
+
+    if(bFailed)
+        _tprintf(TEXT("\n! the meter is off by more than %g LU, or its levels don't match CalculateAudioLevels\n"), METER_LOUDNESS_TOLERANCE);
+
+    return bFailed ? 1 : 0;
+}
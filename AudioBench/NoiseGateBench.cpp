@@ -0,0 +1,239 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "AudioBench.h"
+#include "../NoiseGate/NoiseGateProcess.h"
+
+
+//runs the noise gate plugin's gate and the per-sample gate it replaced over the same generated
+//voice-like bursts in 10ms packets.  the gate now opens from the peak of each GATE_BLOCK_FRAMES
+//block, so it can open up to a block (plus the partial attack step) before the old one did, and
+//its holds and releases start on block boundaries.  checks that every open and close happens
+//within NOISEGATE_MAX_OFFSET frames of the old gate's, that the difference in output stays under
+//NOISEGATE_MAX_ERROR_DB relative to the output, and times both per packet.
+
+#define NOISEGATE_MAX_OFFSET    (GATE_BLOCK_FRAMES*2)
+#define NOISEGATE_MAX_ERROR_DB  -30.0
+
+static const double pi = 3.14159265358979323846;
+
+//the gate from before the block version, per sample
+static void OldNoiseGate(NoiseGateState &state, const NoiseGateParams &params, float *buffer, UINT numFrames, UINT sampleRate)
+{
+    const float SAMPLE_RATE_F = float(sampleRate);
+    const float dtPerSample = 1.0f / SAMPLE_RATE_F;
+
+    const float attackRate = 1.0f / (params.attackTime * SAMPLE_RATE_F);
+    const float releaseRate = 1.0f / (params.releaseTime * SAMPLE_RATE_F);
+
+    const float thresholdDiff = params.openThreshold - params.closeThreshold;
+    const float minDecayPeriod = (1.0f / 75.0f) * SAMPLE_RATE_F;
+    const float decayRate = thresholdDiff / minDecayPeriod;
+
+    for(UINT i = 0; i < numFrames*2; i += 2)
+    {
+        float curLvl = fabsf(buffer[i] + buffer[i+1]) * 0.5f;
+
+        if(curLvl > params.openThreshold && !state.isOpen)
+            state.isOpen = true;
+        if(state.level < params.closeThreshold && state.isOpen)
+        {
+            state.heldTime = 0.0f;
+            state.isOpen = false;
+        }
+
+        state.level = max(state.level, curLvl) - decayRate;
+
+        if(state.isOpen)
+            state.attenuation = min(1.0f, state.attenuation + attackRate);
+        else
+        {
+            state.heldTime += dtPerSample;
+            if(state.heldTime > params.holdTime)
+                state.attenuation = max(0.0f, state.attenuation - releaseRate);
+        }
+
+        if(params.applyGain) {
+            buffer[i] *= state.attenuation;
+            buffer[i+1] *= state.attenuation;
+        }
+    }
+}
+
+inline float DbToRms(float db)
+{
+    return powf(10.0f, db/20.0f);
+}
+
+inline float BenchNoise(UINT &seed)
+{
+    return float(BenchRandom(seed))/float(1<<24) - 0.5f;
+}
+
+//bursts of a 100-250hz tone with a few harmonics between -40 and -6 dB, so some sit right at the
+//thresholds, with -60 dB noise everywhere
+static void GenerateBursts(List<float> &buffer, UINT numFrames, UINT sampleRate, UINT seed)
+{
+    buffer.SetSize(numFrames*2);
+
+    UINT frame = 0;
+    while(frame < numFrames)
+    {
+        UINT gapFrames   = sampleRate/10 + BenchRandom(seed)%(sampleRate*9/10);
+        UINT burstFrames = sampleRate/10 + BenchRandom(seed)%(sampleRate*7/10);
+        float amplitude  = DbToRms(-40.0f + float(BenchRandom(seed)%35));
+        double pitch     = 100.0 + double(BenchRandom(seed)%150);
+
+        for(UINT i=0; i<gapFrames+burstFrames && frame<numFrames; i++, frame++)
+        {
+            float voice = 0.0f;
+            if(i >= gapFrames)
+            {
+                double t = double(i-gapFrames)/double(sampleRate);
+                double envelope = sin(pi*double(i-gapFrames)/double(burstFrames));
+                voice = amplitude*float(envelope*(sin(2.0*pi*pitch*t) + 0.5*sin(4.0*pi*pitch*t) + 0.25*sin(6.0*pi*pitch*t))/1.75);
+            }
+
+            buffer[frame*2]   = voice + BenchNoise(seed)*0.002f;
+            buffer[frame*2+1] = voice + BenchNoise(seed)*0.002f;
+        }
+    }
+}
+
+//frames where the gain crosses 0.5, read back from the left channel
+static void FindTransitions(const List<float> &input, const List<float> &output, List<UINT> &transitions)
+{
+    float gain = 0.0f;
+    bool bOpen = false;
+
+    for(UINT i=0; i<input.Num()/2; i++)
+    {
+        if(fabsf(input[i*2]) > 1e-5f)
+            gain = output[i*2]/input[i*2];
+
+        if((gain > 0.5f) != bOpen)
+        {
+            bOpen = !bOpen;
+            transitions << i;
+        }
+    }
+}
+
+//returns microseconds
+static QWORD RunGate(bool bOld, const NoiseGateParams &params, const List<float> &input, List<float> &output, UINT sampleRate)
+{
+    output.CopyArray(input.Array(), input.Num());
+
+    NoiseGateState state;
+    UINT packetFrames = sampleRate/100;
+    UINT numFrames = input.Num()/2;
+    QWORD time = 0;
+
+    for(UINT frame=0; frame<numFrames; frame += packetFrames)
+    {
+        float *packet = output.Array()+frame*2;
+        UINT count = MIN(packetFrames, numFrames-frame);
+
+        QWORD startTime = OSGetTimeMicroseconds();
+        if(bOld)
+            OldNoiseGate(state, params, packet, count, sampleRate);
+        else
+            state.Process(params, packet, count, sampleRate);
+        time += OSGetTimeMicroseconds()-startTime;
+    }
+
+    return MAX(time, 1);
+}
+
+int NoiseGateBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds")};
+    UINT values[]   = {60};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench noisegate [-seconds of audio per run]"), 1, lpNames, values))
+        return 1;
+
+    UINT seconds = MAX(values[0], 1);
+
+    //the plugin's defaults
+    NoiseGateParams params;
+    params.openThreshold  = DbToRms(-26.0f);
+    params.closeThreshold = DbToRms(-32.0f);
+    params.attackTime     = 0.025f;
+    params.holdTime       = 0.2f;
+    params.releaseTime    = 0.15f;
+    params.applyGain      = true;
+
+    const UINT sampleRates[] = {44100, 48000};
+    bool bFailed = false;
+
+    _tprintf(TEXT("block gate against the per-sample one over %u seconds of bursts, in 10ms packets\n\n"), seconds);
+    _tprintf(TEXT("%8s %12s %12s %10s %12s %12s\n"), TEXT("rate"), TEXT("transitions"), TEXT("max offset"), TEXT("error"), TEXT("old ns/10ms"), TEXT("new ns/10ms"));
+
+    for(UINT rate=0; rate<sizeof(sampleRates)/sizeof(sampleRates[0]); rate++)
+    {
+        UINT sampleRate = sampleRates[rate];
+        UINT numPackets = seconds*100;
+
+        List<float> input, oldOutput, newOutput;
+        GenerateBursts(input, seconds*sampleRate, sampleRate, 0x7654321);
+
+        QWORD oldTime = RunGate(true, params, input, oldOutput, sampleRate);
+        QWORD newTime = RunGate(false, params, input, newOutput, sampleRate);
+
+        List<UINT> oldTransitions, newTransitions;
+        FindTransitions(input, oldOutput, oldTransitions);
+        FindTransitions(input, newOutput, newTransitions);
+
+        //every open and close has to line up with the old gate's
+        bool bBad = oldTransitions.Num() != newTransitions.Num();
+        UINT maxOffset = 0;
+        for(UINT i=0; i<oldTransitions.Num() && !bBad; i++)
+        {
+            UINT offset = (UINT)abs(int(newTransitions[i]) - int(oldTransitions[i]));
+            maxOffset = MAX(maxOffset, offset);
+        }
+        if(maxOffset > NOISEGATE_MAX_OFFSET)
+            bBad = true;
+
+        double signal = 0.0, error = 0.0;
+        for(UINT i=0; i<input.Num(); i++)
+        {
+            double diff = double(newOutput[i]) - double(oldOutput[i]);
+            signal += double(oldOutput[i])*double(oldOutput[i]);
+            error  += diff*diff;
+        }
+
+        double errorDb = 10.0*log10(MAX(error, 1e-30)/MAX(signal, 1e-30));
+        if(errorDb > NOISEGATE_MAX_ERROR_DB)
+            bBad = true;
+
+        if(bBad)
+            bFailed = true;
+
+        _tprintf(TEXT("%8u %5u / %-5u %12u %7.1f dB %12.0f %12.0f%s\n"), sampleRate, newTransitions.Num(), oldTransitions.Num(), maxOffset, errorDb,
+            double(oldTime)*1000.0/double(numPackets), double(newTime)*1000.0/double(numPackets), bBad ? TEXT(" !") : TEXT(""));
+    }
+
+    if(bFailed)
+        _tprintf(TEXT("\n! transitions don't match, are more than %u frames off, or the error is above %g dB\n"), NOISEGATE_MAX_OFFSET, NOISEGATE_MAX_ERROR_DB);
+
+    return bFailed ? 1 : 0;
+}
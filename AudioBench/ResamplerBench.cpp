@@ -0,0 +1,294 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "AudioBench.h"
+#include "AudioResampler.h"
+#include "../libsamplerate/samplerate.h"
+
+
+//resamples one second of a sine with PolyphaseResampler (in 10ms packets, the way AudioSource
+//feeds it) and with libsamplerate's best sinc, for each rate pair and tone.  for each output it
+//fits the tone and reports:
+//
+//  snr - the tone against everything else that's left (noise, distortion and aliasing)
+//  thd - the 2nd to 5th harmonics that are below the output nyquist frequency against the tone
+//
+//then times both engines on 10ms packets.  fails if the polyphase snr or thd is worse than the
+//limits below, which leave about 10 dB of room under what it measured when it was added.
+
+#define RESAMPLER_MIN_SNR       100.0
+#define RESAMPLER_MAX_THD       -135.0
+#define RESAMPLER_TONE_LEVEL    0.5
+#define RESAMPLER_SKIP_MS       50      //left out at each end of the output
+
+static const double pi = 3.14159265358979323846;
+
+static const UINT resamplerRates[][2] =
+{
+    {44100, 48000}, {48000, 44100}, {32000, 48000}, {22050, 48000}, {96000, 48000}, {48000, 32000},
+};
+
+static const double resamplerTones[] = {440.0, 1000.0, 5000.0, 15000.0, 19000.0};
+
+#define NUM_RESAMPLER_RATES (sizeof(resamplerRates)/sizeof(resamplerRates[0]))
+#define NUM_RESAMPLER_TONES (sizeof(resamplerTones)/sizeof(resamplerTones[0]))
+
+//least squares fit of a sine and cosine at toneHz to signal.  returns the power of the fitted tone
+//and subtracts it from signal
+static double RemoveTone(List<double> &signal, UINT rate, double toneHz)
+{
+    double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+    double step = 2.0*pi*toneHz/double(rate);
+
+    for(UINT i=0; i<signal.Num(); i++)
+    {
+        double s = sin(step*double(i)), c = cos(step*double(i));
+        ss += s*s; cc += c*c; sc += s*c;
+        ys += signal[i]*s;
+        yc += signal[i]*c;
+    }
+
+    double det = ss*cc - sc*sc;
+    double a = (ys*cc - yc*sc)/det, b = (yc*ss - ys*sc)/det;
+
+    double power = 0.0;
+    for(UINT i=0; i<signal.Num(); i++)
+    {
+        double fitted = a*sin(step*double(i)) + b*cos(step*double(i));
+        power += fitted*fitted;
+        signal[i] -= fitted;
+    }
+
+    return power;
+}
+
+struct ToneQuality
+{
+    double snr, thd;        //dB
+    bool bHarmonics;        //false if no harmonic is below nyquist, thd is meaningless then
+};
+
+//measures the left channel, leaving out the filter warm up at the start and libsamplerate's
+//flush at the end
+static ToneQuality MeasureTone(const float *output, UINT numFrames, UINT rate, double toneHz)
+{
+    UINT skip = rate*RESAMPLER_SKIP_MS/1000;
+
+    ToneQuality quality;
+    zero(&quality, sizeof(quality));
+    if(numFrames <= skip*4)
+        return quality;
+
+    List<double> residual;
+    residual.SetSize(numFrames-skip*2);
+    for(UINT i=0; i<residual.Num(); i++)
+        residual[i] = double(output[(i+skip)*2]);
+
+    double tonePower = RemoveTone(residual, rate, toneHz);
+
+    double noisePower = 0.0;
+    for(UINT i=0; i<residual.Num(); i++)
+        noisePower += residual[i]*residual[i];
+
+    //the harmonics are fitted to what's left once the tone is gone
+    double harmonicPower = 0.0;
+
+    for(UINT harmonic=2; harmonic<=5; harmonic++)
+    {
+        if(toneHz*double(harmonic) >= double(rate)*0.5)
+            break;
+
+        harmonicPower += RemoveTone(residual, rate, toneHz*double(harmonic));
+        quality.bHarmonics = true;
+    }
+
+    quality.snr = 10.0*log10(tonePower/MAX(noisePower, 1e-30));
+    quality.thd = 10.0*log10(MAX(harmonicPower, 1e-30)/tonePower);
+    return quality;
+}
+
+static UINT ResamplePolyphase(const List<float> &input, UINT inputRate, UINT outputRate, List<float> &output)
+{
+    PolyphaseResampler resampler;
+    resampler.Init(inputRate, outputRate);
+
+    UINT packetFrames = inputRate/100;
+    UINT numInputFrames = input.Num()/2;
+
+    output.SetSize((resampler.MaxOutputFrames(packetFrames)*(numInputFrames/packetFrames+1))*2);
+
+    UINT numFrames = 0;
+    for(UINT frame=0; frame+packetFrames <= numInputFrames; frame += packetFrames)
+        numFrames += resampler.Process(input.Array()+frame*2, packetFrames, output.Array()+numFrames*2);
+
+    return numFrames;
+}
+
+static UINT ResampleSinc(const List<float> &input, UINT inputRate, UINT outputRate, List<float> &output)
+{
+    output.SetSize((UINT(QWORD(input.Num()/2)*outputRate/inputRate) + 64)*2);
+
+    SRC_DATA data;
+    zero(&data, sizeof(data));
+    data.data_in       = input.Array();
+    data.input_frames  = input.Num()/2;
+    data.data_out      = output.Array();
+    data.output_frames = output.Num()/2;
+    data.src_ratio     = double(outputRate)/double(inputRate);
+    data.end_of_input  = 1;
+
+    if(src_simple(&data, SRC_SINC_BEST_QUALITY, 2) != 0)
+        return 0;
+
+    return (UINT)data.output_frames_gen;
+}
+
+//-----------------------------------------
+
+static double TimePolyphase(UINT inputRate, UINT outputRate, UINT numPackets)
+{
+    PolyphaseResampler resampler;
+    resampler.Init(inputRate, outputRate);
+
+    UINT packetFrames = inputRate/100;
+    List<float> input, output;
+    input.SetSize(packetFrames*2);
+    output.SetSize(resampler.MaxOutputFrames(packetFrames)*2);
+
+    for(UINT i=0; i<packetFrames*2; i++)
+        input[i] = float(sin(double(i)*0.01))*0.5f;
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numPackets; i++)
+        resampler.Process(input.Array(), packetFrames, output.Array());
+
+    return double(MAX(OSGetTimeMicroseconds()-startTime, 1));
+}
+
+static double TimeSinc(int converterType, UINT inputRate, UINT outputRate, UINT numPackets)
+{
+    int error;
+    SRC_STATE *state = src_new(converterType, 2, &error);
+    if(!state)
+        return 0.0;
+
+    UINT packetFrames = inputRate/100;
+    List<float> input, output;
+    input.SetSize(packetFrames*2);
+    output.SetSize((packetFrames*outputRate/inputRate + 64)*2);
+
+    for(UINT i=0; i<packetFrames*2; i++)
+        input[i] = float(sin(double(i)*0.01))*0.5f;
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<numPackets; i++)
+    {
+        SRC_DATA data;
+        zero(&data, sizeof(data));
+        data.data_in       = input.Array();
+        data.input_frames  = packetFrames;
+        data.data_out      = output.Array();
+        data.output_frames = output.Num()/2;
+        data.src_ratio     = double(outputRate)/double(inputRate);
+        src_process(state, &data);
+    }
+    QWORD time = MAX(OSGetTimeMicroseconds()-startTime, 1);
+
+    src_delete(state);
+    return double(time);
+}
+
+int ResamplerBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds")};
+    UINT values[]   = {60};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench resampler [-seconds of audio to time]"), 1, lpNames, values))
+        return 1;
+
+    UINT seconds = MAX(values[0], 1);
+    bool bFailed = false;
+
+    _tprintf(TEXT("%s kernels\n\n"), GetAudioKernelName());
+    _tprintf(TEXT("%-16s %8s   %10s %10s   %10s %10s\n"), TEXT(""), TEXT(""), TEXT("polyphase"), TEXT(""), TEXT("best sinc"), TEXT(""));
+    _tprintf(TEXT("%-16s %8s   %10s %10s   %10s %10s\n"), TEXT("rates"), TEXT("tone"), TEXT("snr"), TEXT("thd"), TEXT("snr"), TEXT("thd"));
+
+    for(UINT rate=0; rate<NUM_RESAMPLER_RATES; rate++)
+    {
+        UINT inputRate = resamplerRates[rate][0], outputRate = resamplerRates[rate][1];
+        if(!PolyphaseResampler::CanResample(inputRate, outputRate))
+        {
+            _tprintf(TEXT("%u -> %u can't be resampled by the polyphase resampler\n"), inputRate, outputRate);
+            bFailed = true;
+            continue;
+        }
+
+        for(UINT tone=0; tone<NUM_RESAMPLER_TONES; tone++)
+        {
+            double toneHz = resamplerTones[tone];
+
+            //only tones in the passband of both rates
+            if(toneHz >= double(MIN(inputRate, outputRate))*0.45)
+                continue;
+
+            List<float> input, polyphaseOutput, sincOutput;
+            input.SetSize(inputRate*2);
+
+            for(UINT i=0; i<inputRate; i++)
+                input[i*2] = input[i*2+1] = float(sin(2.0*pi*toneHz*double(i)/double(inputRate))*RESAMPLER_TONE_LEVEL);
+
+            UINT polyphaseFrames = ResamplePolyphase(input, inputRate, outputRate, polyphaseOutput);
+            UINT sincFrames      = ResampleSinc(input, inputRate, outputRate, sincOutput);
+
+            ToneQuality polyphase = MeasureTone(polyphaseOutput.Array(), polyphaseFrames, outputRate, toneHz);
+            ToneQuality sinc      = MeasureTone(sincOutput.Array(), sincFrames, outputRate, toneHz);
+
+            bool bBad = polyphase.snr < RESAMPLER_MIN_SNR || (polyphase.bHarmonics && polyphase.thd > RESAMPLER_MAX_THD);
+            if(bBad)
+                bFailed = true;
+
+            if(polyphase.bHarmonics)
+                _tprintf(TEXT("%6u -> %6u %8.0f   %7.1f dB %7.1f dB   %7.1f dB %7.1f dB%s\n"), inputRate, outputRate, toneHz,
+                    polyphase.snr, polyphase.thd, sinc.snr, sinc.thd, bBad ? TEXT("  below the limit") : TEXT(""));
+            else
+                _tprintf(TEXT("%6u -> %6u %8.0f   %7.1f dB %10s   %7.1f dB %10s%s\n"), inputRate, outputRate, toneHz,
+                    polyphase.snr, TEXT("-"), sinc.snr, TEXT("-"), bBad ? TEXT("  below the limit") : TEXT(""));
+        }
+    }
+
+    //-----------------------------------------
+
+    _tprintf(TEXT("\ntimes real time, %u seconds of stereo in 10ms packets\n"), seconds);
+    _tprintf(TEXT("%-16s %10s %10s %10s %10s\n"), TEXT("rates"), TEXT("polyphase"), TEXT("fastest"), TEXT("medium"), TEXT("best"));
+
+    for(UINT rate=0; rate<2; rate++)
+    {
+        UINT inputRate = resamplerRates[rate][0], outputRate = resamplerRates[rate][1];
+        double audioTime = double(seconds)*1000000.0;
+        UINT numPackets = seconds*100;
+
+        _tprintf(TEXT("%6u -> %6u %9.0fx %9.0fx %9.0fx %9.0fx\n"), inputRate, outputRate,
+            audioTime/TimePolyphase(inputRate, outputRate, numPackets),
+            audioTime/TimeSinc(SRC_SINC_FASTEST, inputRate, outputRate, numPackets),
+            audioTime/TimeSinc(SRC_SINC_MEDIUM_QUALITY, inputRate, outputRate, numPackets),
+            audioTime/TimeSinc(SRC_SINC_BEST_QUALITY, inputRate, outputRate, numPackets));
+    }
+
+    return bFailed ? 1 : 0;
+}
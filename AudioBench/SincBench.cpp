@@ -0,0 +1,172 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "AudioBench.h"
+#include "../libsamplerate/samplerate.h"
+
+
+//times libsamplerate's fastest, medium and best sinc converters on mono and stereo, fed in 10ms
+//packets like AudioSource does, at a few ratios.  the mono and stereo converters have SSE2 inner
+//loops (ENABLE_SINC_SSE2 in libsamplerate/config.h).  the converter for other channel counts
+//still has the plain scalar loop, so the same audio is also run through it as three channels
+//with the third one silent, and each mono/stereo output has to stay within SINC_TOLERANCE of it.
+
+#define SINC_TOLERANCE  1e-6f
+
+static const int sincConverters[] = {SRC_SINC_FASTEST, SRC_SINC_MEDIUM_QUALITY, SRC_SINC_BEST_QUALITY};
+static CTSTR lpSincConverterNames[] = {TEXT("fastest"), TEXT("medium"), TEXT("best")};
+
+//48k -> 44.1k, 44.1k -> 48k, 48k -> 96k
+static const double sincRatios[] = {0.91875, 1.0884353741496598, 2.0};
+
+#define NUM_SINC_CONVERTERS (sizeof(sincConverters)/sizeof(sincConverters[0]))
+#define NUM_SINC_RATIOS     (sizeof(sincRatios)/sizeof(sincRatios[0]))
+
+//runs input (numChannels interleaved) through a new converter 10ms at a time.  returns the time
+//src_process took in microseconds, or 0 on an error
+static QWORD RunSinc(int converter, UINT numChannels, double ratio, const List<float> &input, List<float> &output)
+{
+    int error;
+    SRC_STATE *state = src_new(converter, numChannels, &error);
+    if(!state)
+        return 0;
+
+    UINT packetFrames = 480;
+    UINT numFrames = input.Num()/numChannels;
+    UINT maxOutputFrames = UINT(double(packetFrames)*ratio) + 64;
+
+    output.SetSize(UINT(double(numFrames)*ratio + 64.0)*numChannels);
+
+    UINT numOutputFrames = 0;
+    QWORD time = 0;
+
+    for(UINT frame=0; frame < numFrames; frame += packetFrames)
+    {
+        if(numOutputFrames+maxOutputFrames > output.Num()/numChannels)
+            output.SetSize((numOutputFrames+maxOutputFrames)*numChannels);
+
+        SRC_DATA data;
+        zero(&data, sizeof(data));
+        data.data_in       = input.Array()+frame*numChannels;
+        data.input_frames  = MIN(packetFrames, numFrames-frame);
+        data.data_out      = output.Array()+numOutputFrames*numChannels;
+        data.output_frames = maxOutputFrames;
+        data.src_ratio     = ratio;
+
+        QWORD startTime = OSGetTimeMicroseconds();
+        int ret = src_process(state, &data);
+        time += OSGetTimeMicroseconds()-startTime;
+
+        if(ret != 0 || data.input_frames_used != data.input_frames)
+        {
+            src_delete(state);
+            return 0;
+        }
+
+        numOutputFrames += (UINT)data.output_frames_gen;
+    }
+
+    src_delete(state);
+
+    output.SetSize(numOutputFrames*numChannels);
+    return MAX(time, 1);
+}
+
+int SincBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds")};
+    UINT values[]   = {10};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench sinc [-seconds of audio per run]"), 1, lpNames, values))
+        return 1;
+
+    UINT seconds   = MAX(values[0], 1);
+    UINT numFrames = seconds*48000;
+
+    //a tone plus noise, different on each channel
+    List<float> stereo, mono;
+    stereo.SetSize(numFrames*2);
+    mono.SetSize(numFrames);
+
+    UINT seed = 0x7654321;
+    for(UINT i=0; i<numFrames; i++)
+    {
+        float tone = float(sin(double(i)*0.0575))*0.4f;
+        stereo[i*2]   = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+        stereo[i*2+1] = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+        mono[i]       = stereo[i*2];
+    }
+
+    bool bFailed = false;
+
+    _tprintf(TEXT("times real time for %u seconds in 10ms packets, and the largest difference from the scalar converter\n\n"), seconds);
+    _tprintf(TEXT("%-8s %8s %10s %10s %10s %10s\n"), TEXT(""), TEXT("ratio"), TEXT("mono"), TEXT(""), TEXT("stereo"), TEXT(""));
+
+    for(UINT converter=0; converter<NUM_SINC_CONVERTERS; converter++)
+    {
+        for(UINT ratio=0; ratio<NUM_SINC_RATIOS; ratio++)
+        {
+            _tprintf(TEXT("%-8s %8.4f"), lpSincConverterNames[converter], sincRatios[ratio]);
+
+            for(UINT numChannels=1; numChannels<=2; numChannels++)
+            {
+                const List<float> &input = (numChannels == 1) ? mono : stereo;
+
+                //the same channels plus a silent one go through the scalar multichannel converter
+                List<float> reference, output, referenceOutput;
+                reference.SetSize(numFrames*3);
+                for(UINT i=0; i<numFrames; i++)
+                {
+                    for(UINT ch=0; ch<numChannels; ch++)
+                        reference[i*3+ch] = input[i*numChannels+ch];
+                }
+
+                QWORD time = RunSinc(sincConverters[converter], numChannels, sincRatios[ratio], input, output);
+                QWORD referenceTime = RunSinc(sincConverters[converter], 3, sincRatios[ratio], reference, referenceOutput);
+
+                if(!time || !referenceTime || output.Num()/numChannels != referenceOutput.Num()/3)
+                {
+                    _tprintf(TEXT("  failed, or the frame counts differ"));
+                    bFailed = true;
+                    continue;
+                }
+
+                float maxDiff = 0.0f;
+                for(UINT i=0; i<output.Num()/numChannels; i++)
+                {
+                    for(UINT ch=0; ch<numChannels; ch++)
+                        maxDiff = MAX(maxDiff, fabsf(output[i*numChannels+ch] - referenceOutput[i*3+ch]));
+                }
+
+                bool bBad = maxDiff > SINC_TOLERANCE;
+                if(bBad)
+                    bFailed = true;
+
+                _tprintf(TEXT(" %9.0fx %9.1e%s"), double(seconds)*1000000.0/double(time), maxDiff, bBad ? TEXT("!") : TEXT(" "));
+            }
+
+            _tprintf(TEXT("\n"));
+        }
+    }
+
+    if(bFailed)
+        _tprintf(TEXT("\n! is more than %g from the scalar converter\n"), SINC_TOLERANCE);
+
+    return bFailed ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "OBSApi.h"
+#include "SyntheticAudioSource.h"
+
+
+#define SYNTHETIC_WINDOW_MS 10
+
+SyntheticAudioSource::SyntheticAudioSource(CTSTR lpName, const SyntheticAudioSettings &settings)
+    : settings(settings)
+{
+    strDeviceName = lpName;
+
+    if(this->settings.sampleRate < 8000 || this->settings.sampleRate > 192000)
+        this->settings.sampleRate = 48000;
+
+    UINT sampleRate = this->settings.sampleRate;
+
+    sampleWindowSize = sampleRate/(1000/SYNTHETIC_WINDOW_MS);
+    clockRatio = 1.0 + double(settings.driftPPM)*0.000001;
+
+    phase = 0.0;
+    phaseInc = 2.0*3.14159265358979323846*double(settings.toneHz)/double(sampleRate);
+
+    noiseSeed  = settings.seed;
+    jitterSeed = noiseSeed ^ 0xDEADBEEF;
+
+    curTime = startTime = visibleTime = nextReleaseTime = nextBurstTime = 0;
+    framesDelivered = 0;
+    numBursts = 0;
+
+    outputFrames.SetSize(sampleWindowSize*2);
+
+    Log(TEXT("%s: %u hz, drift %d ppm, jitter %d ms, %llu ms bursts every %llu ms"), strDeviceName.Array(),
+        sampleRate, settings.driftPPM, settings.jitterMS, settings.burstMS, settings.burstIntervalMS);
+
+    InitAudioData(true, 2, sampleRate, 32, 8, 0);
+}
+
+void SyntheticAudioSource::StartCapture()
+{
+    startTime = visibleTime = nextReleaseTime = curTime;
+    nextBurstTime = startTime+settings.burstIntervalMS;
+    framesDelivered = 0;
+}
+
+void SyntheticAudioSource::GenerateFrames(float *output, UINT numFrames)
+{
+    for(UINT i=0; i<numFrames; i++)
+    {
+        float tone = float(sin(phase))*settings.toneLevel;
+
+        phase += phaseInc;
+        if(phase > 2.0*3.14159265358979323846)
+            phase -= 2.0*3.14159265358979323846;
+
+        //noise in [-noiseLevel, noiseLevel], different on each channel
+        float left  = (float(NextRandom(noiseSeed)>>8)/float(1<<23) - 1.0f)*settings.noiseLevel;
+        float right = (float(NextRandom(noiseSeed)>>8)/float(1<<23) - 1.0f)*settings.noiseLevel;
+
+        output[i*2]   = tone+left;
+        output[i*2+1] = tone+right;
+    }
+}
+
+bool SyntheticAudioSource::GetNextBuffer(void **buffer, UINT *numFrames, QWORD *timestamp)
+{
+    if(!startTime)
+        return false;
+
+    //the "device" only makes new data visible at release times
+    if(curTime >= nextReleaseTime)
+    {
+        visibleTime = curTime;
+
+        int jitterMS = settings.jitterMS;
+        int jitter = jitterMS ? int(NextRandom(jitterSeed)%UINT(jitterMS*2+1))-jitterMS : 0;
+        nextReleaseTime = curTime+QWORD(MAX(SYNTHETIC_WINDOW_MS+jitter, 1));
+
+        if(settings.burstIntervalMS && curTime >= nextBurstTime)
+        {
+            nextReleaseTime += settings.burstMS;
+            nextBurstTime = curTime+settings.burstIntervalMS;
+            numBursts++;
+        }
+    }
+
+    QWORD framesVisible = QWORD(double(visibleTime-startTime)*double(settings.sampleRate)*clockRatio*0.001);
+    if(framesVisible < framesDelivered+sampleWindowSize)
+        return false;
+
+    GenerateFrames(outputFrames.Array(), sampleWindowSize);
+
+    *buffer = (void*)outputFrames.Array();
+    *numFrames = sampleWindowSize;
+    *timestamp = startTime + framesDelivered*1000/settings.sampleRate + GetTimeOffset();
+
+    return true;
+}
+
+void SyntheticAudioSource::ReleaseBuffer()
+{
+    framesDelivered += sampleWindowSize;
+}
@@ -0,0 +1,85 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+
+struct SyntheticAudioSettings
+{
+    UINT  sampleRate;
+    float toneHz;
+    float toneLevel, noiseLevel;
+    UINT  seed;
+
+    int   jitterMS;             //hand out data up to this much early or late instead of every 10ms
+    QWORD burstIntervalMS;      //every this often, hold data back for burstMS and then hand it all out at once
+    QWORD burstMS;
+    int   driftPPM;             //run the sample clock this fast (or slow if negative) against the timestamps
+
+    inline SyntheticAudioSettings()
+        : sampleRate(48000), toneHz(440.0f), toneLevel(0.25f), noiseLevel(0.05f), seed(0x7654321),
+          jitterMS(0), burstIntervalMS(0), burstMS(0), driftPPM(0) {}
+};
+
+//generates a tone plus noise instead of reading a device.  the output is deterministic for the
+//same settings.  it runs off a clock the bench moves forward with SetTime rather than the system
+//clock, so a run can go as fast as the audio path allows.
+class SyntheticAudioSource : public AudioSource
+{
+    String strDeviceName;
+    SyntheticAudioSettings settings;
+
+    UINT  sampleWindowSize;
+    double clockRatio;
+
+    double phase, phaseInc;
+    UINT noiseSeed, jitterSeed;
+
+    QWORD curTime, startTime;
+    QWORD visibleTime, nextReleaseTime, nextBurstTime;
+    QWORD framesDelivered;
+
+    List<float> outputFrames;
+
+    UINT numBursts;
+
+    inline UINT NextRandom(UINT &seed)
+    {
+        seed = seed*1664525+1013904223;
+        return seed;
+    }
+
+    void GenerateFrames(float *output, UINT numFrames);
+
+protected:
+    virtual bool GetNextBuffer(void **buffer, UINT *numFrames, QWORD *timestamp);
+    virtual void ReleaseBuffer();
+
+    virtual CTSTR GetDeviceName() const {return strDeviceName.Array();}
+
+public:
+    SyntheticAudioSource(CTSTR lpName, const SyntheticAudioSettings &settings);
+
+    virtual void StartCapture();
+
+    inline void SetTime(QWORD timeMS) {curTime = timeMS;}
+
+    inline QWORD NumFramesDelivered() const {return framesDelivered;}
+    inline UINT  NumBursts() const {return numBursts;}
+};
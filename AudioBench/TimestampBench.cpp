@@ -0,0 +1,201 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "AudioBench.h"
+
+
+//runs the aac and mp3 encoders over 10ms blocks and checks every packet's timestamp against the
+//bookkeeping each wrapper did before AudioEncoderInput, re-done here without the encoding.  each
+//old wrapper queued one timestamp per codec frame and popped one per packet it handed out, so
+//packet n always got frame n's timestamp, the same as AudioEncoderInput::GetTimestamp.
+//
+//the runs with blocks exactly 10ms apart have to match packet for packet.  the jittered run moves
+//each block's timestamp by up to 2ms, and there the aac wrapper can differ on a frame that starts
+//exactly where a block starts: the old one worked that frame's timestamp out from the block
+//before (previous timestamp plus the whole block's length), and the new one takes the timestamp
+//that came with the block.  at 48khz that's every 15th frame.  nothing else may differ, and the
+//old mp3 wrapper used the new block's timestamp there too, so mp3 has to match everywhere.
+
+AudioEncoder* CreateMP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels);
+AudioEncoder* CreateAACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads);
+
+#define TIMESTAMP_BENCH_START_TIME  10000
+#define TIMESTAMP_BENCH_JITTER      2
+
+struct TimestampRun
+{
+    CTSTR lpName;
+    UINT sampleRate;
+    bool bJitter;
+};
+
+static const TimestampRun timestampRuns[] =
+{
+    {TEXT("44.1k"),         44100, false},
+    {TEXT("48k"),           48000, false},
+    {TEXT("48k jittered"),  48000, true},
+};
+
+#define NUM_TIMESTAMP_RUNS (sizeof(timestampRuns)/sizeof(timestampRuns[0]))
+
+//the timestamp half of the old Encoder_AAC.cpp and Encoder_MP3.cpp Encode functions.  the aac one
+//took a frame out as soon as one was buffered, the mp3 one only once a block went past the end of
+//it, which is why the comparison is > there
+class OldEncoderTimestamps
+{
+    UINT frameSize, sampleRate;
+    bool bMP3, bFirstFrame;
+    UINT numBufferedFrames;
+    QWORD curEncodeTimestamp;
+
+public:
+    List<QWORD> frameTimestamps;
+
+    OldEncoderTimestamps(UINT frameSize, UINT sampleRate, bool bMP3)
+        : frameSize(frameSize), sampleRate(sampleRate), bMP3(bMP3), bFirstFrame(true), numBufferedFrames(0), curEncodeTimestamp(0) {}
+
+    void Push(UINT numInputFrames, QWORD timestamp)
+    {
+        if(bFirstFrame)
+        {
+            curEncodeTimestamp = timestamp;
+            bFirstFrame = false;
+        }
+
+        UINT lastSampleSize = numBufferedFrames;
+        numBufferedFrames += numInputFrames;
+
+        if(bMP3 ? (numBufferedFrames > frameSize) : (numBufferedFrames >= frameSize))
+        {
+            numBufferedFrames -= frameSize;
+
+            frameTimestamps << curEncodeTimestamp;
+            curEncodeTimestamp = timestamp + ((frameSize-lastSampleSize)*1000/sampleRate);
+        }
+    }
+};
+
+int TimestampBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-seconds"), TEXT("-bitrate")};
+    UINT values[]   = {30, 128};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench timestamp [-seconds n] [-bitrate kbps]"), 2, lpNames, values))
+        return 1;
+
+    UINT seconds = MAX(values[0], 1);
+    UINT bitRate = values[1];
+
+    bool bFailed = false;
+
+    _tprintf(TEXT("packet timestamps against the old encoder wrappers, %u seconds of 10ms blocks\n\n"), seconds);
+    _tprintf(TEXT("%-14s %6s %10s %10s %10s\n"), TEXT(""), TEXT(""), TEXT("packets"), TEXT("differ"), TEXT("boundary"));
+
+    for(UINT run=0; run<NUM_TIMESTAMP_RUNS; run++)
+    {
+        const TimestampRun &timestampRun = timestampRuns[run];
+
+        UINT sampleRate  = timestampRun.sampleRate;
+        UINT blockFrames = sampleRate/100;
+        UINT numBlocks   = seconds*100;
+
+        API = CreateBenchAPIInterface(sampleRate);
+
+        //a tone plus noise, different on each channel
+        List<float> mix;
+        mix.SetSize(numBlocks*blockFrames*2);
+
+        UINT seed = 0x7654321;
+        for(UINT i=0; i<numBlocks*blockFrames; i++)
+        {
+            float tone = float(sin(double(i)*0.0575))*0.4f;
+            mix[i*2]   = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+            mix[i*2+1] = tone + (float(BenchRandom(seed))/float(1<<24) - 0.5f)*0.2f;
+        }
+
+        List<QWORD> blockTimestamps;
+        blockTimestamps.SetSize(numBlocks);
+        for(UINT block=0; block<numBlocks; block++)
+        {
+            blockTimestamps[block] = TIMESTAMP_BENCH_START_TIME + QWORD(block)*10;
+            if(timestampRun.bJitter)
+                blockTimestamps[block] += BenchRandom(seed)%(TIMESTAMP_BENCH_JITTER*2+1);
+        }
+
+        for(UINT codec=0; codec<2; codec++)
+        {
+            bool bMP3 = (codec == 1);
+            AudioEncoder *encoder = bMP3 ? CreateMP3Encoder(bitRate, sampleRate, 2) : CreateAACEncoder(bitRate, sampleRate, 2, 1);
+
+            UINT frameSize = encoder->GetFrameSize();
+            OldEncoderTimestamps oldTimestamps(frameSize, sampleRate, bMP3);
+
+            UINT numPackets = 0, numDiffer = 0, numBoundary = 0;
+            bool bBad = false;
+
+            for(UINT block=0; block<numBlocks; block++)
+            {
+                DataPacket packet;
+                QWORD timestamp = blockTimestamps[block];
+
+                oldTimestamps.Push(blockFrames, timestamp);
+
+                if(!encoder->Encode(mix.Array()+block*blockFrames*2, blockFrames, packet, timestamp))
+                    continue;
+
+                if(numPackets >= oldTimestamps.frameTimestamps.Num())
+                {
+                    bBad = true;
+                    break;
+                }
+
+                if(timestamp != oldTimestamps.frameTimestamps[numPackets])
+                {
+                    numDiffer++;
+
+                    //only an aac frame starting right on a block, with jitter, may differ
+                    bool bBoundary = (QWORD(numPackets)*frameSize) % blockFrames == 0;
+                    if(bBoundary)
+                        numBoundary++;
+                    if(!bBoundary || bMP3 || !timestampRun.bJitter)
+                        bBad = true;
+                }
+
+                numPackets++;
+            }
+
+            if(bBad || !numPackets)
+                bFailed = true;
+
+            _tprintf(TEXT("%-14s %6s %10u %10u %10u %s\n"), timestampRun.lpName, bMP3 ? TEXT("mp3") : TEXT("aac"),
+                numPackets, numDiffer, numBoundary, (bBad || !numPackets) ? TEXT("FAILED") : TEXT("ok"));
+
+            delete encoder;
+        }
+
+        delete API;
+        API = NULL;
+    }
+
+    if(bFailed)
+        _tprintf(TEXT("\na packet's timestamp differs from the old wrapper's where it shouldn't\n"));
+
+    return bFailed ? 1 : 0;
+}
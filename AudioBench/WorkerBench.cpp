@@ -0,0 +1,188 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "AudioBench.h"
+#include "SyntheticAudioSource.h"
+#include "../Source/AudioWorkers.h"
+
+
+//runs 1 to -sources synthetic aux sources through the worker pool OBS::QueryNewAudio uses, with no
+//workers (everything on the calling thread) and with 1 to -workers of them.  the sources run at a
+//different rate than the output so every segment is resampled.  times the whole pass per 10ms
+//block, and hashes what each source buffered so any difference from the serial run shows up.
+
+#define WORKER_BENCH_START_TIME     10000
+
+struct WorkerRun
+{
+    double meanTime, maxTime;       //microseconds per 10ms block
+    List<UINT> sourceHashes;
+    List<QWORD> sourceFrames;
+};
+
+inline void HashAudio(UINT &hash, const float *data, UINT numFloats)
+{
+    const BYTE *bytes = (const BYTE*)data;
+    for(UINT i=0; i<numFloats*sizeof(float); i++)
+        hash = (hash ^ bytes[i])*16777619;
+}
+
+static void RunWorkers(UINT numSources, UINT numWorkers, UINT seconds, UINT sourceRate, WorkerRun &run)
+{
+    List<AudioSource*> sources;
+
+    for(UINT i=0; i<numSources; i++)
+    {
+        SyntheticAudioSettings settings;
+        settings.sampleRate = sourceRate;
+        settings.toneHz     = 220.0f + float(i)*55.0f;
+        settings.seed       = 0x7654321 + i*7919;
+
+        SyntheticAudioSource *source = new SyntheticAudioSource(FormattedString(TEXT("Worker Bench %u"), i), settings);
+        source->SetTime(WORKER_BENCH_START_TIME);
+        source->StartCapture();
+
+        sources << source;
+    }
+
+    run.sourceHashes.SetSize(numSources);
+    run.sourceFrames.SetSize(numSources);
+    for(UINT i=0; i<numSources; i++)
+        run.sourceHashes[i] = 2166136261;
+
+    AudioWorkerPool *pool = CreateAudioWorkers(numWorkers);
+
+    UINT numBlocks = seconds*100;
+    QWORD totalTime = 0, maxTime = 0;
+
+    for(UINT block=1; block<=numBlocks; block++)
+    {
+        QWORD curTime = WORKER_BENCH_START_TIME + QWORD(block)*10;
+        for(UINT i=0; i<numSources; i++)
+            static_cast<SyntheticAudioSource*>(sources[i])->SetTime(curTime);
+
+        QWORD startTime = OSGetTimeMicroseconds();
+        ProcessAudioSources(pool, AudioJob_Drain, NULL, 0.0f, sources);
+        QWORD blockTime = OSGetTimeMicroseconds()-startTime;
+
+        totalTime += blockTime;
+        if(blockTime > maxTime)
+            maxTime = blockTime;
+
+        //take everything each source buffered, in order, like the mixer would
+        for(UINT i=0; i<numSources; i++)
+        {
+            QWORD timestamp;
+            float *buffer;
+
+            while(sources[i]->GetEarliestTimestamp(timestamp) && sources[i]->GetBuffer(&buffer, timestamp))
+            {
+                UINT numFloats = OBSGetSampleRateHz()/100*2;
+                HashAudio(run.sourceHashes[i], buffer, numFloats);
+                run.sourceFrames[i] += numFloats/2;
+            }
+        }
+    }
+
+    DestroyAudioWorkers(pool);
+
+    for(UINT i=0; i<numSources; i++)
+        delete sources[i];
+
+    run.meanTime = double(totalTime)/double(numBlocks);
+    run.maxTime  = double(maxTime);
+}
+
+int WorkerBench(int argc, TCHAR *argv[])
+{
+    CTSTR lpNames[] = {TEXT("-sources"), TEXT("-workers"), TEXT("-seconds"), TEXT("-rate"), TEXT("-sourcerate")};
+    UINT values[]   = {32, (UINT)MIN(MAX(OSGetTotalCores()-1, 1), MAX_AUDIO_WORKERS), 10, 44100, 48000};
+
+    if(!BenchParseArgs(argc, argv, TEXT("usage: AudioBench workers [-sources max] [-workers max] [-seconds n] [-rate hz] [-sourcerate hz]"), 5, lpNames, values))
+        return 1;
+
+    UINT maxSources = MAX(values[0], 1);
+    UINT maxWorkers = MIN(values[1], MAX_AUDIO_WORKERS);
+    UINT seconds    = MAX(values[2], 1);
+    UINT sampleRate = (values[3] == 48000) ? 48000 : 44100;
+    UINT sourceRate = values[4];
+
+    API = CreateBenchAPIInterface(sampleRate);
+
+    List<UINT> sourceCounts, workerCounts;
+    for(UINT numSources=1; numSources<maxSources; numSources *= 2)
+        sourceCounts << numSources;
+    sourceCounts << maxSources;
+
+    workerCounts << 0;
+    for(UINT numWorkers=1; numWorkers<maxWorkers; numWorkers *= 2)
+        workerCounts << numWorkers;
+    if(maxWorkers)
+        workerCounts << maxWorkers;
+
+    _tprintf(TEXT("%u hz sources resampled to %u hz, %u seconds each, %d cores\n"), sourceRate, sampleRate, seconds, OSGetTotalCores());
+    _tprintf(TEXT("us per 10ms block to process every source, mean / max\n\n%8s"), TEXT("sources"));
+    for(UINT i=0; i<workerCounts.Num(); i++)
+        _tprintf(TEXT("  %2u workers%11s"), workerCounts[i], TEXT(""));
+    _tprintf(TEXT("\n"));
+
+    bool bMismatch = false;
+
+    for(UINT count=0; count<sourceCounts.Num(); count++)
+    {
+        UINT numSources = sourceCounts[count];
+        WorkerRun serial;
+
+        _tprintf(TEXT("%8u"), numSources);
+
+        for(UINT i=0; i<workerCounts.Num(); i++)
+        {
+            WorkerRun run;
+            RunWorkers(numSources, workerCounts[i], seconds, sourceRate, i ? run : serial);
+
+            if(!i)
+            {
+                _tprintf(TEXT("  %7.1f / %6.0f%7s"), serial.meanTime, serial.maxTime, TEXT(""));
+                continue;
+            }
+
+            _tprintf(TEXT("  %7.1f / %6.0f (%.1fx)"), run.meanTime, run.maxTime, serial.meanTime/MAX(run.meanTime, 0.1));
+
+            //each source has to come out the same no matter which thread processed it
+            for(UINT j=0; j<numSources; j++)
+            {
+                if(run.sourceHashes[j] != serial.sourceHashes[j] || run.sourceFrames[j] != serial.sourceFrames[j])
+                {
+                    _tprintf(TEXT("\nsource %u differs from the serial run with %u workers"), j, workerCounts[i]);
+                    bMismatch = true;
+                }
+            }
+        }
+
+        _tprintf(TEXT("\n"));
+    }
+
+    if(!bMismatch)
+        _tprintf(TEXT("\nevery source's output matches the serial run\n"));
+
+    delete API;
+    API = NULL;
+
+    return bMismatch ? 1 : 0;
+}
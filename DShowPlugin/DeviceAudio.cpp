@@ -111,7 +111,11 @@ void DeviceAudioSource::ReceiveAudio(LPBYTE lpData, UINT dataLength)
     {
         OSEnterMutex(hAudioMutex);
         sampleBuffer.AppendArray(lpData, dataLength);
+        bool bSegmentReady = sampleBuffer.Num() >= sampleSegmentSize;
         OSLeaveMutex(hAudioMutex);
+
+        if(bSegmentReady)
+            SignalAudioData();
     }
 }
 
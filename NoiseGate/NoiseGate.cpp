@@ -40,10 +40,7 @@ inline float dbToRms(float db)
 
 NoiseGateFilter::NoiseGateFilter(NoiseGate *parent)
     : parent(parent)
-    , attenuation(0.0f)
-    , level(0.0f)
-    , heldTime(0.0f)
-    , isOpen(false)
+    , state()
 {
 }
 
@@ -51,79 +48,27 @@ NoiseGateFilter::~NoiseGateFilter()
 {
 }
 
-AudioSegment *NoiseGateFilter::Process(AudioSegment *segment)
+void NoiseGateFilter::ProcessBlock(float *buffer, UINT numFrames, QWORD timestamp)
 {
     if(parent->isEnabled)
     {
-        ApplyNoiseGate(segment->audioData.Array(), segment->audioData.Num());
+        NoiseGateParams params;
+        params.openThreshold = parent->openThreshold;
+        params.closeThreshold = parent->closeThreshold;
+        params.attackTime = parent->attackTime;
+        params.holdTime = parent->holdTime;
+        params.releaseTime = parent->releaseTime;
+
+        // Test if disabled from the config window here so that the gate state is still
+        // processed when playing around with the configuration
+        params.applyGain = !parent->isDisabledFromConfig;
+
+        state.Process(params, buffer, numFrames, OBSGetSampleRateHz());
     }
     else
     {
         // Reset state
-        attenuation = 0.0f;
-        level = 0.0f;
-        heldTime = 0.0f;
-        isOpen = false;
-    }
-    return segment;
-}
-
-void NoiseGateFilter::ApplyNoiseGate(float *buffer, int totalFloats)
-{
-    // We assume stereo input
-    if(totalFloats % 2)
-        return; // Odd number of samples
-
-    const float SAMPLE_RATE_F = float(OBSGetSampleRateHz());
-    const float dtPerSample = 1.0f / SAMPLE_RATE_F;
-
-    // Convert configuration times into per-sample amounts
-    const float attackRate = 1.0f / (parent->attackTime * SAMPLE_RATE_F);
-    const float releaseRate = 1.0f / (parent->releaseTime * SAMPLE_RATE_F);
-
-    // Determine level decay rate. We don't want human voice (75-300Hz) to cross the close
-    // threshold if the previous peak crosses the open threshold.
-    const float thresholdDiff = parent->openThreshold - parent->closeThreshold;
-    const float minDecayPeriod = (1.0f / 75.0f) * SAMPLE_RATE_F;
-    const float decayRate = thresholdDiff / minDecayPeriod;
-
-    // We can't use SSE as the processing of each sample depends on the processed
-    // result of the previous sample.
-    for(int i = 0; i < totalFloats; i += 2)
-    {
-        // Get current input level
-        float curLvl = abs(buffer[i] + buffer[i+1]) * 0.5f;
-
-        // Test thresholds
-        if(curLvl > parent->openThreshold && !isOpen)
-            isOpen = true;
-        if(level < parent->closeThreshold && isOpen)
-        {
-            heldTime = 0.0f;
-            isOpen = false;
-        }
-
-        // Decay level slowly so human voice (75-300Hz) doesn't cross the close threshold
-        // (Essentially a peak detector with very fast decay)
-        level = max(level, curLvl) - decayRate;
-
-        // Apply gate state to attenuation
-        if(isOpen)
-            attenuation = min(1.0f, attenuation + attackRate);
-        else
-        {
-            heldTime += dtPerSample;
-            if(heldTime > parent->holdTime)
-                attenuation = max(0.0f, attenuation - releaseRate);
-        }
-
-        // Test if disabled from the config window here so that the above state calculations
-        // are still processed when playing around with the configuration
-        if(!parent->isDisabledFromConfig) {
-            // Multiple input by gate multiplier (0.0f if fully closed, 1.0f if fully open)
-            buffer[i] *= attenuation;
-            buffer[i+1] *= attenuation;
-        }
+        state.Reset();
     }
 }
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "OBSApi.h"
+#include "NoiseGateProcess.h"
 
 class NoiseGate;
 
@@ -27,7 +28,7 @@ class NoiseGate;
 //============================================================================
 // NoiseGateFilter class
 
-class NoiseGateFilter : public AudioFilter
+class NoiseGateFilter : public BlockAudioFilter
 {
     //-----------------------------------------------------------------------
     // Private members
@@ -36,10 +37,7 @@ private:
     NoiseGate *     parent;
     
     // State
-    float   attenuation; // Current gate multiplier
-    float   level;  // Input level with delayed decay
-    float   heldTime; // The amount of time we've held the gate open after it we hit the close threshold
-    bool    isOpen;
+    NoiseGateState  state;
 
     //-----------------------------------------------------------------------
     // Constructor/destructor
@@ -52,10 +50,7 @@ public:
     // Methods
 
 public:
-    virtual AudioSegment *Process(AudioSegment *segment);
-
-private:
-    void ApplyNoiseGate(float *buffer, int totalFloats);
+    virtual void ProcessBlock(float *buffer, UINT numFrames, QWORD timestamp);
 };
 
 //============================================================================
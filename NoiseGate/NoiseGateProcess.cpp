@@ -0,0 +1,110 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "NoiseGateProcess.h"
+
+//============================================================================
+// NoiseGateState class
+
+NoiseGateState::NoiseGateState()
+{
+    Reset();
+}
+
+void NoiseGateState::Reset()
+{
+    attenuation = 0.0f;
+    level = 0.0f;
+    heldTime = 0.0f;
+    isOpen = false;
+}
+
+void NoiseGateState::Process(const NoiseGateParams &params, float *buffer, UINT numFrames, UINT sampleRate)
+{
+    const float SAMPLE_RATE_F = float(sampleRate);
+    const float dtPerSample = 1.0f / SAMPLE_RATE_F;
+
+    // Convert configuration times into per-sample amounts
+    const float attackRate = 1.0f / (params.attackTime * SAMPLE_RATE_F);
+    const float releaseRate = 1.0f / (params.releaseTime * SAMPLE_RATE_F);
+
+    // Determine level decay rate. We don't want human voice (75-300Hz) to cross the close
+    // threshold if the previous peak crosses the open threshold.
+    const float thresholdDiff = params.openThreshold - params.closeThreshold;
+    const float minDecayPeriod = (1.0f / 75.0f) * SAMPLE_RATE_F;
+    const float decayRate = thresholdDiff / minDecayPeriod;
+
+    // The gate state depends on the previous state so it can't be vectorized directly.
+    // Instead it's updated once per GATE_BLOCK_FRAMES frames using the peak of the block,
+    // and the attenuation ramp for the block is applied with SIMD.
+    for(UINT frame = 0; frame < numFrames; frame += GATE_BLOCK_FRAMES)
+    {
+        float *block = buffer + frame*2;
+        UINT blockFrames = MIN(GATE_BLOCK_FRAMES, numFrames-frame);
+
+        // Get current input level. decayedLvl is what the per-sample peak detector below would
+        // have reached by the end of the block, before the block's own decay is subtracted
+        float decayedLvl;
+        float curLvl = CalculateStereoMidPeak(block, blockFrames, decayRate, decayedLvl);
+
+        // Test thresholds
+        if(curLvl > params.openThreshold && !isOpen)
+            isOpen = true;
+        UINT closedFrames = blockFrames;
+        if(isOpen && level - decayRate * float(blockFrames) < params.closeThreshold)
+        {
+            // The level can dip under the close threshold part way through the block, so when
+            // it's that close find the frame the per-sample detector would have closed on
+            float frameLvl = level;
+            for(UINT i = 0; i < blockFrames; i++)
+            {
+                if(frameLvl < params.closeThreshold)
+                {
+                    heldTime = 0.0f;
+                    isOpen = false;
+                    closedFrames = blockFrames - i;
+                    break;
+                }
+                frameLvl = max(frameLvl, fabsf(block[i*2] + block[i*2+1]) * 0.5f) - decayRate;
+            }
+        }
+
+        // Decay level slowly so human voice (75-300Hz) doesn't cross the close threshold
+        // (Essentially a peak detector with very fast decay)
+        level = max(level, decayedLvl) - decayRate * float(blockFrames);
+
+        // Apply gate state to attenuation
+        float attenuationStep = 0.0f;
+        if(isOpen)
+            attenuationStep = attackRate;
+        else
+        {
+            heldTime += dtPerSample * float(closedFrames);
+            if(heldTime > params.holdTime)
+                attenuationStep = -releaseRate;
+        }
+
+        if(params.applyGain) {
+            // Multiply input by gate multiplier (0.0f if fully closed, 1.0f if fully open)
+            ApplyAudioGainRamp(block, blockFrames, attenuation, attenuationStep);
+        }
+
+        attenuation = min(1.0f, max(0.0f, attenuation + attenuationStep * float(blockFrames)));
+    }
+}
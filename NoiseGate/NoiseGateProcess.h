@@ -0,0 +1,58 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+#include "OBSApi.h"
+
+// Number of frames the gate state is updated once for (~0.7ms at 48kHz)
+#define GATE_BLOCK_FRAMES 32
+
+//============================================================================
+// NoiseGateParams struct
+
+struct NoiseGateParams
+{
+    float   openThreshold;
+    float   closeThreshold;
+    float   attackTime;
+    float   holdTime;
+    float   releaseTime;
+    bool    applyGain; // False still updates the gate state but leaves the audio untouched
+};
+
+//============================================================================
+// NoiseGateState class
+//
+// The gate itself, kept apart from the plugin so AudioBench can run it
+
+class NoiseGateState
+{
+public:
+    float   attenuation; // Current gate multiplier
+    float   level;  // Input level with delayed decay
+    float   heldTime; // The amount of time we've held the gate open after it we hit the close threshold
+    bool    isOpen;
+
+public:
+    NoiseGateState();
+
+    void Reset();
+    void Process(const NoiseGateParams &params, float *buffer, UINT numFrames, UINT sampleRate);
+};
@@ -97,6 +97,7 @@ bool OBSGetRenderFrameIn1To1Mode()                              {return API->Get
 UINT OBSGetCaptureFPS()                                         {return API->GetCaptureFPS();}
 UINT OBSGetTotalFrames()                                        {return API->GetTotalFrames();}
 UINT OBSGetFramesDropped()                                      {return API->GetFramesDropped();}
+void OBSGetPipelineStats(List<MetricStats> &stats)              {API->GetPipelineStats(stats);}
 
 CTSTR OBSGetLanguage()          {return API->GetLanguage();}
 
@@ -159,10 +160,12 @@ AudioSource* OBSGetMicAudioSource()         {return API->GetMicAudioSource();}
 
 void OBSGetCurDesktopVolumeStats(float *rms, float *max, float *peak)   {API->GetCurDesktopVolumeStats(rms, max, peak);}
 void OBSGetCurMicVolumeStats(float *rms, float *max, float *peak)       {API->GetCurMicVolumeStats(rms, max, peak);}
+void OBSGetCurDesktopLoudness(float *momentary, float *shortTerm, float *truePeak)  {API->GetCurDesktopLoudness(momentary, shortTerm, truePeak);}
+void OBSGetCurMicLoudness(float *momentary, float *shortTerm, float *truePeak)      {API->GetCurMicLoudness(momentary, shortTerm, truePeak);}
 
 void OBSAddSettingsPane(SettingsPane *pane)     {API->AddSettingsPane(pane);}
 void OBSRemoveSettingsPane(SettingsPane *pane)  {API->RemoveSettingsPane(pane);}
 
-UINT OBSGetAPIVersion()                         {return 0x0103;}
+UINT OBSGetAPIVersion()                         {return 0x0200;}
 
 UINT OBSGetSampleRateHz()                       {return API->GetSampleRateHz();}
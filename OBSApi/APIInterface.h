@@ -197,6 +197,15 @@ public:
     virtual bool SetSceneCollection(CTSTR lpCollection, CTSTR lpScene) = 0;
     virtual CTSTR GetSceneCollectionName() const = 0;
     virtual void GetSceneCollectionNames(StringList &list) const = 0;
+
+    //latency histograms, queue depths and counters of the capture/encode/send pipeline
+    virtual void GetPipelineStats(List<MetricStats> &stats) const = 0;
+
+    //momentary (400ms) and short term (3s) loudness in LUFS, and true peak in dBTP.  these are only
+    //measured while they're being asked for, so the first calls return silence and the windows
+    //fill up from there.
+    virtual void GetCurDesktopLoudness(float *momentary, float *shortTerm, float *truePeak) const = 0;
+    virtual void GetCurMicLoudness(float *momentary, float *shortTerm, float *truePeak) const = 0;
 };
 
 BASE_EXPORT extern APIInterface *API;
@@ -244,6 +253,7 @@ BASE_EXPORT bool OBSGetIn1To1Mode();
 BASE_EXPORT UINT OBSGetCaptureFPS();
 BASE_EXPORT UINT OBSGetTotalFrames();
 BASE_EXPORT UINT OBSGetFramesDropped();
+BASE_EXPORT void OBSGetPipelineStats(List<MetricStats> &stats);
 
 BASE_EXPORT CTSTR OBSGetLanguage();
 
@@ -323,11 +333,14 @@ BASE_EXPORT AudioSource* OBSGetMicAudioSource();
 
 BASE_EXPORT void OBSGetCurDesktopVolumeStats(float *rms, float *max, float *peak);
 BASE_EXPORT void OBSGetCurMicVolumeStats(float *rms, float *max, float *peak);
+BASE_EXPORT void OBSGetCurDesktopLoudness(float *momentary, float *shortTerm, float *truePeak);
+BASE_EXPORT void OBSGetCurMicLoudness(float *momentary, float *shortTerm, float *truePeak);
 
 BASE_EXPORT void OBSAddSettingsPane(SettingsPane *pane);
 BASE_EXPORT void OBSRemoveSettingsPane(SettingsPane *pane);
 
-/** gets API version.  version is formatted: 0xMMmm */
+/** gets API version.  version is formatted: 0xMMmm.  the major version changes when the layout
+    of an exported class (List, String, AudioSource...) changes and plugins have to be rebuilt */
 BASE_EXPORT UINT OBSGetAPIVersion();
 
 BASE_EXPORT UINT OBSGetSampleRateHz();
@@ -30,3 +30,17 @@ public:
 
     virtual AudioSegment* Process(AudioSegment *segment)=0;
 };
+
+//filters that work in place on a block of interleaved stereo floats.  they go in the same filter
+//chain as the segment filters above; Process just hands the segment's buffer to ProcessBlock.
+class BASE_EXPORT BlockAudioFilter : public AudioFilter
+{
+public:
+    //timestamp is the time of the first frame, in milliseconds
+    virtual void ProcessBlock(float *buffer, UINT numFrames, QWORD timestamp)=0;
+
+    //how many frames the filter delays the audio by
+    virtual UINT GetLatencyFrames() const {return 0;}
+
+    virtual AudioSegment* Process(AudioSegment *segment);
+};
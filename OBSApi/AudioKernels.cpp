@@ -0,0 +1,534 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "OBSApi.h"
+#include <intrin.h>
+#include "AudioKernelsInternal.h"
+
+
+
+//-----------------------------------------
+//scalar versions, used for the tails and as the reference for the simd versions.  the avx2 file
+//calls them too, after _mm256_zeroupper
+
+void MixScalar(float *dest, const float *src, UINT totalFloats)
+{
+    for(UINT i=0; i<totalFloats; i++)
+    {
+        float val = dest[i]+src[i];
+
+        if(val < -1.0f)     val = -1.0f;
+        else if(val > 1.0f) val = 1.0f;
+
+        dest[i] = val;
+    }
+}
+
+void MultiplyScalar(float *buffer, UINT totalFloats, float mulVal)
+{
+    for(UINT i=0; i<totalFloats; i++)
+        buffer[i] *= mulVal;
+}
+
+void StereoToMonoScalar(float *buffer, UINT totalFloats)
+{
+    for(UINT i=0; i+1<totalFloats; i += 2)
+        buffer[i] = buffer[i+1] = (buffer[i]+buffer[i+1])*0.5f;
+}
+
+void SumSquaresScalar(const float *buffer, UINT totalFloats, float mulVal, float &sum, float &maxSquare)
+{
+    for(UINT i=0; i<totalFloats; i++)
+    {
+        float val = buffer[i]*mulVal;
+        float pow2Val = val*val;
+
+        sum += pow2Val;
+        if(pow2Val > maxSquare)
+            maxSquare = pow2Val;
+    }
+}
+
+static void ConvertInt8Scalar(float *output, const char *input, UINT totalSamples, float mulVal)
+{
+    float scale = mulVal/127.0f;
+    for(UINT i=0; i<totalSamples; i++)
+        output[i] = float(input[i])*scale;
+}
+
+void ConvertInt16Scalar(float *output, const short *input, UINT totalSamples, float mulVal)
+{
+    float scale = mulVal/32767.0f;
+    for(UINT i=0; i<totalSamples; i++)
+        output[i] = float(input[i])*scale;
+}
+
+void ConvertInt24Scalar(float *output, const BYTE *input, UINT totalSamples, float mulVal)
+{
+    float scale = float(double(mulVal)/8388607.0);
+    for(UINT i=0; i<totalSamples; i++)
+    {
+        //shift up to the top of the int and back down to sign extend
+        int val = int(UINT(input[0]) << 8 | UINT(input[1]) << 16 | UINT(input[2]) << 24) >> 8;
+        output[i] = float(val)*scale;
+        input += 3;
+    }
+}
+
+void ConvertInt32Scalar(float *output, const int *input, UINT totalSamples, float mulVal)
+{
+    float scale = float(double(mulVal)/2147483647.0);
+    for(UINT i=0; i<totalSamples; i++)
+        output[i] = float(input[i])*scale;
+}
+
+void DownmixScalar(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix)
+{
+    for(UINT i=0; i<numFrames; i++)
+    {
+        float left = 0.0f, right = 0.0f;
+        for(UINT j=0; j<channels; j++)
+        {
+            left  += input[j]*matrix.left[j];
+            right += input[j]*matrix.right[j];
+        }
+
+        *(output++) = left;
+        *(output++) = right;
+        input += channels;
+    }
+}
+
+float MidPeakScalar(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak, UINT firstFrame)
+{
+    float peak = 0.0f;
+    rampedPeak = 0.0f;
+
+    for(UINT i=0; i<numFrames; i++)
+    {
+        float val = fabsf(buffer[i*2]+buffer[i*2+1])*0.5f;
+        if(val > peak)
+            peak = val;
+
+        float ramped = val + rampStep*float(firstFrame+i);
+        if(ramped > rampedPeak)
+            rampedPeak = ramped;
+    }
+
+    return peak;
+}
+
+static inline float ClampGain(float gain)
+{
+    if(gain < 0.0f)      return 0.0f;
+    else if(gain > 1.0f) return 1.0f;
+    return gain;
+}
+
+//firstFrame is the index of buffer[0] within the whole ramp
+void GainRampScalar(float *buffer, UINT numFrames, float gain, float gainStep, UINT firstFrame)
+{
+    for(UINT i=0; i<numFrames; i++)
+    {
+        float frameGain = ClampGain(gain + gainStep*float(firstFrame+i+1));
+        buffer[i*2]   *= frameGain;
+        buffer[i*2+1] *= frameGain;
+    }
+}
+
+//-----------------------------------------
+//sse2
+
+static void Mix_SSE2(float *dest, const float *src, UINT totalFloats)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFFC;
+
+    __m128 maxVal = _mm_set_ps1(1.0f);
+    __m128 minVal = _mm_set_ps1(-1.0f);
+
+    for(UINT i=0; i<alignedFloats; i += 4)
+    {
+        __m128 mix = _mm_add_ps(_mm_loadu_ps(dest+i), _mm_loadu_ps(src+i));
+        mix = _mm_min_ps(mix, maxVal);
+        mix = _mm_max_ps(mix, minVal);
+
+        _mm_storeu_ps(dest+i, mix);
+    }
+
+    MixScalar(dest+alignedFloats, src+alignedFloats, totalFloats-alignedFloats);
+}
+
+static void Multiply_SSE2(float *buffer, UINT totalFloats, float mulVal)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFFC;
+    __m128 sseMulVal = _mm_set_ps1(mulVal);
+
+    for(UINT i=0; i<alignedFloats; i += 4)
+        _mm_storeu_ps(buffer+i, _mm_mul_ps(_mm_loadu_ps(buffer+i), sseMulVal));
+
+    MultiplyScalar(buffer+alignedFloats, totalFloats-alignedFloats, mulVal);
+}
+
+static void StereoToMono_SSE2(float *buffer, UINT totalFloats)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFFC;
+    __m128 halfVal = _mm_set_ps1(0.5f);
+
+    for(UINT i=0; i<alignedFloats; i += 4)
+    {
+        __m128 val = _mm_loadu_ps(buffer+i);
+        __m128 shufVal = _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1));
+
+        _mm_storeu_ps(buffer+i, _mm_mul_ps(_mm_add_ps(val, shufVal), halfVal));
+    }
+
+    StereoToMonoScalar(buffer+alignedFloats, totalFloats-alignedFloats);
+}
+
+static inline float HorizontalSum(__m128 val)
+{
+    val = _mm_add_ps(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(1, 0, 3, 2)));
+    val = _mm_add_ss(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(val);
+}
+
+static inline float HorizontalMax(__m128 val)
+{
+    val = _mm_max_ps(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(1, 0, 3, 2)));
+    val = _mm_max_ss(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(val);
+}
+
+static float MidPeak_SSE2(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak)
+{
+    UINT alignedFrames = numFrames & 0xFFFFFFFE;
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 step = _mm_set1_ps(rampStep);
+    __m128 frameIndex = _mm_set_ps(1.0f, 1.0f, 0.0f, 0.0f);
+    __m128 frameInc = _mm_set1_ps(2.0f);
+    __m128 peak = _mm_setzero_ps();
+    __m128 ramped = _mm_setzero_ps();
+
+    for(UINT i=0; i<alignedFrames; i += 2)
+    {
+        __m128 val = _mm_loadu_ps(buffer+i*2);
+        val = _mm_add_ps(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1)));
+        val = _mm_mul_ps(_mm_and_ps(val, absMask), half);
+        peak = _mm_max_ps(peak, val);
+        ramped = _mm_max_ps(ramped, _mm_add_ps(val, _mm_mul_ps(step, frameIndex)));
+        frameIndex = _mm_add_ps(frameIndex, frameInc);
+    }
+
+    float tailRamped;
+    float peakVal = MAX(HorizontalMax(peak), MidPeakScalar(buffer+alignedFrames*2, numFrames-alignedFrames, rampStep, tailRamped, alignedFrames));
+    rampedPeak = MAX(HorizontalMax(ramped), tailRamped);
+    return peakVal;
+}
+
+static void GainRamp_SSE2(float *buffer, UINT numFrames, float gain, float gainStep)
+{
+    UINT alignedFrames = numFrames & 0xFFFFFFFE;
+
+    //the frame numbers are kept as floats so the ramp doesn't drift like a running sum would
+    __m128 frameNum = _mm_setr_ps(1.0f, 1.0f, 2.0f, 2.0f);
+    __m128 frameInc = _mm_set_ps1(2.0f);
+    __m128 sseGain = _mm_set_ps1(gain);
+    __m128 sseStep = _mm_set_ps1(gainStep);
+    __m128 minVal = _mm_setzero_ps();
+    __m128 maxVal = _mm_set_ps1(1.0f);
+
+    for(UINT i=0; i<alignedFrames; i += 2)
+    {
+        __m128 frameGain = _mm_add_ps(sseGain, _mm_mul_ps(sseStep, frameNum));
+        frameGain = _mm_max_ps(_mm_min_ps(frameGain, maxVal), minVal);
+
+        _mm_storeu_ps(buffer+i*2, _mm_mul_ps(_mm_loadu_ps(buffer+i*2), frameGain));
+        frameNum = _mm_add_ps(frameNum, frameInc);
+    }
+
+    GainRampScalar(buffer+alignedFrames*2, numFrames-alignedFrames, gain, gainStep, alignedFrames);
+}
+
+static void SumSquares_SSE2(const float *buffer, UINT totalFloats, float mulVal, float &sum, float &maxSquare)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFF8;
+    __m128 sseSum0 = _mm_setzero_ps(), sseSum1 = _mm_setzero_ps();
+    __m128 sseMax0 = _mm_setzero_ps(), sseMax1 = _mm_setzero_ps();
+
+    //two sums so each add doesn't wait on the last one, and mulVal is applied once at the end
+    for(UINT i=0; i<alignedFloats; i += 8)
+    {
+        __m128 val0 = _mm_loadu_ps(buffer+i);
+        __m128 val1 = _mm_loadu_ps(buffer+i+4);
+        __m128 squares0 = _mm_mul_ps(val0, val0);
+        __m128 squares1 = _mm_mul_ps(val1, val1);
+
+        sseSum0 = _mm_add_ps(sseSum0, squares0);
+        sseSum1 = _mm_add_ps(sseSum1, squares1);
+        sseMax0 = _mm_max_ps(sseMax0, squares0);
+        sseMax1 = _mm_max_ps(sseMax1, squares1);
+    }
+
+    float mulSquare = mulVal*mulVal;
+    sum += HorizontalSum(_mm_add_ps(sseSum0, sseSum1))*mulSquare;
+    maxSquare = max(maxSquare, HorizontalMax(_mm_max_ps(sseMax0, sseMax1))*mulSquare);
+
+    SumSquaresScalar(buffer+alignedFloats, totalFloats-alignedFloats, mulVal, sum, maxSquare);
+}
+
+static void ConvertInt16_SSE2(float *output, const short *input, UINT totalSamples, float mulVal)
+{
+    UINT alignedSamples = totalSamples & 0xFFFFFFF8;
+    __m128 scale = _mm_set_ps1(mulVal/32767.0f);
+
+    for(UINT i=0; i<alignedSamples; i += 8)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)(input+i));
+
+        //unpacking with itself puts each sample in the top half, the shift sign extends it
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(val, val), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(val, val), 16);
+
+        _mm_storeu_ps(output+i,   _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(output+i+4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+
+    ConvertInt16Scalar(output+alignedSamples, input+alignedSamples, totalSamples-alignedSamples, mulVal);
+}
+
+static void ConvertInt32_SSE2(float *output, const int *input, UINT totalSamples, float mulVal)
+{
+    UINT alignedSamples = totalSamples & 0xFFFFFFFC;
+    __m128 scale = _mm_set_ps1(float(double(mulVal)/2147483647.0));
+
+    for(UINT i=0; i<alignedSamples; i += 4)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)(input+i));
+        _mm_storeu_ps(output+i, _mm_mul_ps(_mm_cvtepi32_ps(val), scale));
+    }
+
+    ConvertInt32Scalar(output+alignedSamples, input+alignedSamples, totalSamples-alignedSamples, mulVal);
+}
+
+//two frames per pass.  each frame is loaded as one or two vectors (reading past the frame into
+//the next one, which the zeroed matrix entries cancel out), multiplied by both rows, and a
+//transpose turns the four products into [left0, right0, left1, right1].
+static void Downmix_SSE2(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix)
+{
+    UINT totalFloats = numFrames*channels;
+    UINT frame = 0;
+
+    __m128 left0  = _mm_loadu_ps(matrix.left);
+    __m128 right0 = _mm_loadu_ps(matrix.right);
+
+    if(channels <= 4)
+    {
+        for(; (frame+1)*channels+4 <= totalFloats; frame += 2)
+        {
+            __m128 a = _mm_loadu_ps(input+frame*channels);
+            __m128 b = _mm_loadu_ps(input+(frame+1)*channels);
+
+            __m128 leftA  = _mm_mul_ps(a, left0);
+            __m128 rightA = _mm_mul_ps(a, right0);
+            __m128 leftB  = _mm_mul_ps(b, left0);
+            __m128 rightB = _mm_mul_ps(b, right0);
+
+            _MM_TRANSPOSE4_PS(leftA, rightA, leftB, rightB);
+            _mm_storeu_ps(output+frame*2, _mm_add_ps(_mm_add_ps(leftA, rightA), _mm_add_ps(leftB, rightB)));
+        }
+    }
+    else
+    {
+        __m128 left1  = _mm_loadu_ps(matrix.left+4);
+        __m128 right1 = _mm_loadu_ps(matrix.right+4);
+
+        for(; (frame+1)*channels+8 <= totalFloats; frame += 2)
+        {
+            const float *inA = input+frame*channels;
+            const float *inB = inA+channels;
+
+            __m128 a0 = _mm_loadu_ps(inA), a1 = _mm_loadu_ps(inA+4);
+            __m128 b0 = _mm_loadu_ps(inB), b1 = _mm_loadu_ps(inB+4);
+
+            __m128 leftA  = _mm_add_ps(_mm_mul_ps(a0, left0),  _mm_mul_ps(a1, left1));
+            __m128 rightA = _mm_add_ps(_mm_mul_ps(a0, right0), _mm_mul_ps(a1, right1));
+            __m128 leftB  = _mm_add_ps(_mm_mul_ps(b0, left0),  _mm_mul_ps(b1, left1));
+            __m128 rightB = _mm_add_ps(_mm_mul_ps(b0, right0), _mm_mul_ps(b1, right1));
+
+            _MM_TRANSPOSE4_PS(leftA, rightA, leftB, rightB);
+            _mm_storeu_ps(output+frame*2, _mm_add_ps(_mm_add_ps(leftA, rightA), _mm_add_ps(leftB, rightB)));
+        }
+    }
+
+    DownmixScalar(output+frame*2, input+frame*channels, numFrames-frame, channels, matrix);
+}
+
+//numTaps is a multiple of 4, so this is four frames per pass with two accumulators
+static void FilterStereo_SSE2(float *output, const float *input, const float *coefficients, UINT numTaps)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+
+    for(UINT i=0; i<numTaps*2; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(input+i),   _mm_loadu_ps(coefficients+i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(input+i+4), _mm_loadu_ps(coefficients+i+4)));
+    }
+
+    //[L, R, L, R] -> [L+L, R+R]
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    _mm_storel_pi((__m64*)output, sum);
+}
+
+//-----------------------------------------
+
+static const AudioKernelTable sse2Kernels =
+{
+    TEXT("SSE2"),
+    Mix_SSE2,
+    Multiply_SSE2,
+    StereoToMono_SSE2,
+    SumSquares_SSE2,
+    ConvertInt16_SSE2,
+    ConvertInt24Scalar,
+    ConvertInt32_SSE2,
+    Downmix_SSE2,
+    FilterStereo_SSE2,
+    MidPeak_SSE2,
+    GainRamp_SSE2
+};
+
+static const AudioKernelTable *kernels = &sse2Kernels;
+
+static bool CPUHasAVX2()
+{
+    int cpuInfo[4];
+
+    __cpuid(cpuInfo, 0);
+    if(cpuInfo[0] < 7)
+        return false;
+
+    //the cpu has to support avx and the os has to save the ymm registers
+    __cpuid(cpuInfo, 1);
+    if((cpuInfo[2] & (1<<27)) == 0 || (cpuInfo[2] & (1<<28)) == 0)
+        return false;
+    if((_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & (1<<5)) != 0;
+}
+
+//called from DllMain
+void InitAudioKernels()
+{
+    kernels = CPUHasAVX2() ? &avx2AudioKernels : &sse2Kernels;
+}
+
+CTSTR GetAudioKernelName()
+{
+    return kernels->lpName;
+}
+
+const AudioKernelTable* GetAudioKernelTable(UINT index)
+{
+    switch(index)
+    {
+        case 0: return &sse2Kernels;
+        case 1: return CPUHasAVX2() ? &avx2AudioKernels : NULL;
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------
+
+void MixAudio(float *bufferDest, float *bufferSrc, UINT totalFloats, bool bForceMono)
+{
+    if(bForceMono)
+        kernels->StereoToMono(bufferSrc, totalFloats);
+
+    kernels->Mix(bufferDest, bufferSrc, totalFloats);
+}
+
+void MultiplyAudio(float *buffer, UINT totalFloats, float mulVal)
+{
+    kernels->Multiply(buffer, totalFloats, mulVal);
+}
+
+void StereoToMonoAudio(float *buffer, UINT totalFloats)
+{
+    kernels->StereoToMono(buffer, totalFloats);
+}
+
+void CalculateAudioLevels(const float *buffer, UINT totalFloats, float mulVal, float &rms, float &peak)
+{
+    if(!totalFloats)
+    {
+        rms = peak = 0.0f;
+        return;
+    }
+
+    float sum = 0.0f, maxSquare = 0.0f;
+    kernels->SumSquares(buffer, totalFloats, mulVal, sum, maxSquare);
+
+    rms  = sqrt(sum/totalFloats);
+    peak = sqrt(maxSquare);
+}
+
+void ConvertAudioToFloat(float *output, const void *input, UINT totalSamples, UINT bitsPerSample, float mulVal)
+{
+    switch(bitsPerSample)
+    {
+        case 8:  ConvertInt8Scalar(output, (const char*)input, totalSamples, mulVal); break;
+        case 16: kernels->ConvertInt16(output, (const short*)input, totalSamples, mulVal); break;
+        case 24: kernels->ConvertInt24(output, (const BYTE*)input, totalSamples, mulVal); break;
+        case 32: kernels->ConvertInt32(output, (const int*)input, totalSamples, mulVal); break;
+    }
+}
+
+void DownmixAudio(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix)
+{
+    if(channels == 1)
+    {
+        for(UINT i=0; i<numFrames; i++)
+            output[i*2] = output[i*2+1] = input[i];
+    }
+    else if(channels == 2)
+        mcpy(output, input, numFrames*2*sizeof(float));
+    else if(channels <= AUDIO_DOWNMIX_MAX_CHANNELS)
+        kernels->Downmix(output, input, numFrames, channels, matrix);
+}
+
+float CalculateStereoMidPeak(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak)
+{
+    return kernels->MidPeak(buffer, numFrames, rampStep, rampedPeak);
+}
+
+void ApplyAudioGainRamp(float *buffer, UINT numFrames, float gain, float gainStep)
+{
+    kernels->GainRamp(buffer, numFrames, gain, gainStep);
+}
+
+void FilterStereoAudio(float *output, const float *input, const float *coefficients, UINT numTaps)
+{
+    kernels->FilterStereo(output, input, coefficients, numTaps);
+}
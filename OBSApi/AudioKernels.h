@@ -0,0 +1,66 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+//audio processing kernels.  each one has an SSE2 and an AVX2 version and the best one the cpu
+//supports is picked when the dll loads.  buffers don't need to be aligned and can be any length.
+
+#define AUDIO_DOWNMIX_MAX_CHANNELS  8
+
+//downmix matrices are two rows of AUDIO_DOWNMIX_MAX_CHANNELS coefficients, left then right,
+//with unused channels set to zero
+struct AudioDownmixMatrix
+{
+    float left[AUDIO_DOWNMIX_MAX_CHANNELS];
+    float right[AUDIO_DOWNMIX_MAX_CHANNELS];
+};
+
+//bufferDest = clamp(bufferDest+bufferSrc, -1, 1)
+BASE_EXPORT void MixAudio(float *bufferDest, float *bufferSrc, UINT totalFloats, bool bForceMono);
+
+BASE_EXPORT void MultiplyAudio(float *buffer, UINT totalFloats, float mulVal);
+
+//replaces both channels of an interleaved stereo buffer with their average
+BASE_EXPORT void StereoToMonoAudio(float *buffer, UINT totalFloats);
+
+//rms and peak of buffer*mulVal
+BASE_EXPORT void CalculateAudioLevels(const float *buffer, UINT totalFloats, float mulVal, float &rms, float &peak);
+
+//converts 8, 16, 24 or 32 bit signed integer samples to floats in [-1, 1] scaled by mulVal
+BASE_EXPORT void ConvertAudioToFloat(float *output, const void *input, UINT totalSamples, UINT bitsPerSample, float mulVal=1.0f);
+
+//interleaved input with any number of channels to interleaved stereo.  mono is duplicated and
+//stereo copied, anything else goes through the matrix.
+BASE_EXPORT void DownmixAudio(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix);
+
+//largest abs((left+right)/2) of an interleaved stereo buffer.  rampedPeak is the largest
+//abs((left+right)/2) + rampStep*i, i being the frame index
+BASE_EXPORT float CalculateStereoMidPeak(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak);
+
+//multiplies frame i of an interleaved stereo buffer by clamp(gain+gainStep*(i+1), 0, 1)
+BASE_EXPORT void ApplyAudioGainRamp(float *buffer, UINT numFrames, float gain, float gainStep);
+
+BASE_EXPORT CTSTR GetAudioKernelName();
+
+void InitAudioKernels();
+
+//one output frame of an fir filter over interleaved stereo: input is numTaps frames, and each
+//coefficient is stored twice (left and right).  numTaps has to be a multiple of 4.
+void FilterStereoAudio(float *output, const float *input, const float *coefficients, UINT numTaps);
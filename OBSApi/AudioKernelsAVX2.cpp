@@ -0,0 +1,319 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+//the avx2 kernels.  this file is built with /arch:AVX2 so the 128 bit intrinsics used for the
+//reductions are VEX encoded as well, and nothing here runs until cpuid says it can.  every kernel
+//ends with _mm256_zeroupper before it calls back into the sse2 code in AudioKernels.cpp.
+
+#include <windows.h>
+#include <immintrin.h>
+#include "Utility/XT_Windows.h"
+#include "AudioKernels.h"
+#include "AudioKernelsInternal.h"
+
+
+static inline float HorizontalSum(__m128 val)
+{
+    val = _mm_add_ps(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(1, 0, 3, 2)));
+    val = _mm_add_ss(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(val);
+}
+
+static inline float HorizontalMax(__m128 val)
+{
+    val = _mm_max_ps(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(1, 0, 3, 2)));
+    val = _mm_max_ss(val, _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(val);
+}
+
+static void Mix_AVX2(float *dest, const float *src, UINT totalFloats)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFF8;
+
+    __m256 maxVal = _mm256_set1_ps(1.0f);
+    __m256 minVal = _mm256_set1_ps(-1.0f);
+
+    for(UINT i=0; i<alignedFloats; i += 8)
+    {
+        __m256 mix = _mm256_add_ps(_mm256_loadu_ps(dest+i), _mm256_loadu_ps(src+i));
+        mix = _mm256_min_ps(mix, maxVal);
+        mix = _mm256_max_ps(mix, minVal);
+
+        _mm256_storeu_ps(dest+i, mix);
+    }
+
+    _mm256_zeroupper();
+
+    MixScalar(dest+alignedFloats, src+alignedFloats, totalFloats-alignedFloats);
+}
+
+static void Multiply_AVX2(float *buffer, UINT totalFloats, float mulVal)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFF8;
+    __m256 avxMulVal = _mm256_set1_ps(mulVal);
+
+    for(UINT i=0; i<alignedFloats; i += 8)
+        _mm256_storeu_ps(buffer+i, _mm256_mul_ps(_mm256_loadu_ps(buffer+i), avxMulVal));
+
+    _mm256_zeroupper();
+
+    MultiplyScalar(buffer+alignedFloats, totalFloats-alignedFloats, mulVal);
+}
+
+static void StereoToMono_AVX2(float *buffer, UINT totalFloats)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFF8;
+    __m256 halfVal = _mm256_set1_ps(0.5f);
+
+    for(UINT i=0; i<alignedFloats; i += 8)
+    {
+        __m256 val = _mm256_loadu_ps(buffer+i);
+        __m256 shufVal = _mm256_permute_ps(val, _MM_SHUFFLE(2, 3, 0, 1));
+
+        _mm256_storeu_ps(buffer+i, _mm256_mul_ps(_mm256_add_ps(val, shufVal), halfVal));
+    }
+
+    _mm256_zeroupper();
+
+    StereoToMonoScalar(buffer+alignedFloats, totalFloats-alignedFloats);
+}
+
+static float MidPeak_AVX2(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak)
+{
+    UINT alignedFrames = numFrames & 0xFFFFFFFC;
+    __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 step = _mm256_set1_ps(rampStep);
+    __m256 frameIndex = _mm256_set_ps(3.0f, 3.0f, 2.0f, 2.0f, 1.0f, 1.0f, 0.0f, 0.0f);
+    __m256 frameInc = _mm256_set1_ps(4.0f);
+    __m256 peak = _mm256_setzero_ps();
+    __m256 ramped = _mm256_setzero_ps();
+
+    for(UINT i=0; i<alignedFrames; i += 4)
+    {
+        __m256 val = _mm256_loadu_ps(buffer+i*2);
+        val = _mm256_add_ps(val, _mm256_permute_ps(val, _MM_SHUFFLE(2, 3, 0, 1)));
+        val = _mm256_mul_ps(_mm256_and_ps(val, absMask), half);
+        peak = _mm256_max_ps(peak, val);
+        ramped = _mm256_max_ps(ramped, _mm256_add_ps(val, _mm256_mul_ps(step, frameIndex)));
+        frameIndex = _mm256_add_ps(frameIndex, frameInc);
+    }
+
+    __m128 peak128 = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    __m128 ramped128 = _mm_max_ps(_mm256_castps256_ps128(ramped), _mm256_extractf128_ps(ramped, 1));
+
+    _mm256_zeroupper();
+
+    float tailRamped;
+    float peakVal = max(HorizontalMax(peak128), MidPeakScalar(buffer+alignedFrames*2, numFrames-alignedFrames, rampStep, tailRamped, alignedFrames));
+    rampedPeak = max(HorizontalMax(ramped128), tailRamped);
+    return peakVal;
+}
+
+static void GainRamp_AVX2(float *buffer, UINT numFrames, float gain, float gainStep)
+{
+    UINT alignedFrames = numFrames & 0xFFFFFFFC;
+
+    __m256 frameNum = _mm256_setr_ps(1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f, 4.0f, 4.0f);
+    __m256 frameInc = _mm256_set1_ps(4.0f);
+    __m256 avxGain = _mm256_set1_ps(gain);
+    __m256 avxStep = _mm256_set1_ps(gainStep);
+    __m256 minVal = _mm256_setzero_ps();
+    __m256 maxVal = _mm256_set1_ps(1.0f);
+
+    for(UINT i=0; i<alignedFrames; i += 4)
+    {
+        __m256 frameGain = _mm256_add_ps(avxGain, _mm256_mul_ps(avxStep, frameNum));
+        frameGain = _mm256_max_ps(_mm256_min_ps(frameGain, maxVal), minVal);
+
+        _mm256_storeu_ps(buffer+i*2, _mm256_mul_ps(_mm256_loadu_ps(buffer+i*2), frameGain));
+        frameNum = _mm256_add_ps(frameNum, frameInc);
+    }
+
+    _mm256_zeroupper();
+
+    GainRampScalar(buffer+alignedFrames*2, numFrames-alignedFrames, gain, gainStep, alignedFrames);
+}
+
+static void SumSquares_AVX2(const float *buffer, UINT totalFloats, float mulVal, float &sum, float &maxSquare)
+{
+    UINT alignedFloats = totalFloats & 0xFFFFFFF0;
+    __m256 avxSum0 = _mm256_setzero_ps(), avxSum1 = _mm256_setzero_ps();
+    __m256 avxMax0 = _mm256_setzero_ps(), avxMax1 = _mm256_setzero_ps();
+
+    //two sums so each add doesn't wait on the last one, and mulVal is applied once at the end
+    for(UINT i=0; i<alignedFloats; i += 16)
+    {
+        __m256 val0 = _mm256_loadu_ps(buffer+i);
+        __m256 val1 = _mm256_loadu_ps(buffer+i+8);
+        __m256 squares0 = _mm256_mul_ps(val0, val0);
+        __m256 squares1 = _mm256_mul_ps(val1, val1);
+
+        avxSum0 = _mm256_add_ps(avxSum0, squares0);
+        avxSum1 = _mm256_add_ps(avxSum1, squares1);
+        avxMax0 = _mm256_max_ps(avxMax0, squares0);
+        avxMax1 = _mm256_max_ps(avxMax1, squares1);
+    }
+
+    __m256 avxSum = _mm256_add_ps(avxSum0, avxSum1);
+    __m256 avxMax = _mm256_max_ps(avxMax0, avxMax1);
+
+    __m128 sseSum = _mm_add_ps(_mm256_castps256_ps128(avxSum), _mm256_extractf128_ps(avxSum, 1));
+    __m128 sseMax = _mm_max_ps(_mm256_castps256_ps128(avxMax), _mm256_extractf128_ps(avxMax, 1));
+
+    _mm256_zeroupper();
+
+    float mulSquare = mulVal*mulVal;
+    sum += HorizontalSum(sseSum)*mulSquare;
+    maxSquare = max(maxSquare, HorizontalMax(sseMax)*mulSquare);
+
+    SumSquaresScalar(buffer+alignedFloats, totalFloats-alignedFloats, mulVal, sum, maxSquare);
+}
+
+static void ConvertInt16_AVX2(float *output, const short *input, UINT totalSamples, float mulVal)
+{
+    UINT alignedSamples = totalSamples & 0xFFFFFFF8;
+    __m256 scale = _mm256_set1_ps(mulVal/32767.0f);
+
+    for(UINT i=0; i<alignedSamples; i += 8)
+    {
+        __m256i val = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(input+i)));
+        _mm256_storeu_ps(output+i, _mm256_mul_ps(_mm256_cvtepi32_ps(val), scale));
+    }
+
+    _mm256_zeroupper();
+
+    ConvertInt16Scalar(output+alignedSamples, input+alignedSamples, totalSamples-alignedSamples, mulVal);
+}
+
+//eight samples per pass: 12 bytes go in each 128 bit lane, then a byte shuffle moves every
+//sample to the top three bytes of its int and an arithmetic shift sign extends it
+static void ConvertInt24_AVX2(float *output, const BYTE *input, UINT totalSamples, float mulVal)
+{
+    __m256 scale = _mm256_set1_ps(float(double(mulVal)/8388607.0));
+    __m256i shuffle = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+    //each pass reads 28 bytes
+    UINT i = 0;
+    for(; (i*3)+28 <= totalSamples*3; i += 8)
+    {
+        const BYTE *in = input+(i*3);
+
+        __m256i val = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)in));
+        val = _mm256_inserti128_si256(val, _mm_loadu_si128((const __m128i*)(in+12)), 1);
+        val = _mm256_srai_epi32(_mm256_shuffle_epi8(val, shuffle), 8);
+
+        _mm256_storeu_ps(output+i, _mm256_mul_ps(_mm256_cvtepi32_ps(val), scale));
+    }
+
+    _mm256_zeroupper();
+
+    ConvertInt24Scalar(output+i, input+(i*3), totalSamples-i, mulVal);
+}
+
+static void ConvertInt32_AVX2(float *output, const int *input, UINT totalSamples, float mulVal)
+{
+    UINT alignedSamples = totalSamples & 0xFFFFFFF8;
+    __m256 scale = _mm256_set1_ps(float(double(mulVal)/2147483647.0));
+
+    for(UINT i=0; i<alignedSamples; i += 8)
+    {
+        __m256i val = _mm256_loadu_si256((const __m256i*)(input+i));
+        _mm256_storeu_ps(output+i, _mm256_mul_ps(_mm256_cvtepi32_ps(val), scale));
+    }
+
+    _mm256_zeroupper();
+
+    ConvertInt32Scalar(output+alignedSamples, input+alignedSamples, totalSamples-alignedSamples, mulVal);
+}
+
+//two frames per pass, each loaded as one vector of up to eight channels.  three horizontal
+//adds reduce the four products to eight partial sums per lane, and adding the two lanes gives
+//[left0, right0, left1, right1].
+static void Downmix_AVX2(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix)
+{
+    UINT totalFloats = numFrames*channels;
+    UINT frame = 0;
+
+    __m256 left  = _mm256_loadu_ps(matrix.left);
+    __m256 right = _mm256_loadu_ps(matrix.right);
+
+    for(; (frame+1)*channels+8 <= totalFloats; frame += 2)
+    {
+        __m256 a = _mm256_loadu_ps(input+frame*channels);
+        __m256 b = _mm256_loadu_ps(input+(frame+1)*channels);
+
+        __m256 sumA = _mm256_hadd_ps(_mm256_mul_ps(a, left), _mm256_mul_ps(a, right));
+        __m256 sumB = _mm256_hadd_ps(_mm256_mul_ps(b, left), _mm256_mul_ps(b, right));
+        __m256 sums = _mm256_hadd_ps(sumA, sumB);
+
+        _mm_storeu_ps(output+frame*2, _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1)));
+    }
+
+    _mm256_zeroupper();
+
+    DownmixScalar(output+frame*2, input+frame*channels, numFrames-frame, channels, matrix);
+}
+
+static void FilterStereo_AVX2(float *output, const float *input, const float *coefficients, UINT numTaps)
+{
+    UINT totalFloats = numTaps*2;
+    UINT alignedFloats = totalFloats & 0xFFFFFFF0;
+
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+
+    for(UINT i=0; i<alignedFloats; i += 16)
+    {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(input+i),   _mm256_loadu_ps(coefficients+i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(input+i+8), _mm256_loadu_ps(coefficients+i+8)));
+    }
+
+    //numTaps being a multiple of 4 leaves at most one vector
+    if(alignedFloats < totalFloats)
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(input+alignedFloats), _mm256_loadu_ps(coefficients+alignedFloats)));
+
+    sum0 = _mm256_add_ps(sum0, sum1);
+
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    _mm_storel_pi((__m64*)output, sum);
+
+    _mm256_zeroupper();
+}
+
+//-----------------------------------------
+
+const AudioKernelTable avx2AudioKernels =
+{
+    TEXT("AVX2"),
+    Mix_AVX2,
+    Multiply_AVX2,
+    StereoToMono_AVX2,
+    SumSquares_AVX2,
+    ConvertInt16_AVX2,
+    ConvertInt24_AVX2,
+    ConvertInt32_AVX2,
+    Downmix_AVX2,
+    FilterStereo_AVX2,
+    MidPeak_AVX2,
+    GainRamp_AVX2
+};
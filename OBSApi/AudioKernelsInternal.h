@@ -0,0 +1,60 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+//shared between AudioKernels.cpp and AudioKernelsAVX2.cpp.  the avx2 file is the only one built
+//with /arch:AVX2, so every instruction in it is VEX encoded and there are no sse/avx transitions
+//inside the kernels.  it must not pull in inline code from the rest of OBSApi: the linker may
+//keep its avx2 copy of an inline function for every caller, even on cpus without avx2.
+
+struct AudioKernelTable
+{
+    CTSTR lpName;
+    void (*Mix)(float *dest, const float *src, UINT totalFloats);
+    void (*Multiply)(float *buffer, UINT totalFloats, float mulVal);
+    void (*StereoToMono)(float *buffer, UINT totalFloats);
+    void (*SumSquares)(const float *buffer, UINT totalFloats, float mulVal, float &sum, float &maxSquare);
+    void (*ConvertInt16)(float *output, const short *input, UINT totalSamples, float mulVal);
+    void (*ConvertInt24)(float *output, const BYTE *input, UINT totalSamples, float mulVal);
+    void (*ConvertInt32)(float *output, const int *input, UINT totalSamples, float mulVal);
+    void (*Downmix)(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix);
+    void (*FilterStereo)(float *output, const float *input, const float *coefficients, UINT numTaps);
+    float (*MidPeak)(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak);
+    void (*GainRamp)(float *buffer, UINT numFrames, float gain, float gainStep);
+};
+
+//scalar versions in AudioKernels.cpp, also used for the tails of the avx2 kernels.  they and
+//GetAudioKernelTable are exported so AudioBench can check every kernel against them
+BASE_EXPORT void MixScalar(float *dest, const float *src, UINT totalFloats);
+BASE_EXPORT void MultiplyScalar(float *buffer, UINT totalFloats, float mulVal);
+BASE_EXPORT void StereoToMonoScalar(float *buffer, UINT totalFloats);
+BASE_EXPORT void SumSquaresScalar(const float *buffer, UINT totalFloats, float mulVal, float &sum, float &maxSquare);
+BASE_EXPORT void ConvertInt16Scalar(float *output, const short *input, UINT totalSamples, float mulVal);
+BASE_EXPORT void ConvertInt24Scalar(float *output, const BYTE *input, UINT totalSamples, float mulVal);
+BASE_EXPORT void ConvertInt32Scalar(float *output, const int *input, UINT totalSamples, float mulVal);
+BASE_EXPORT void DownmixScalar(float *output, const float *input, UINT numFrames, UINT channels, const AudioDownmixMatrix &matrix);
+//firstFrame is the index of buffer[0] within the whole ramp
+BASE_EXPORT float MidPeakScalar(const float *buffer, UINT numFrames, float rampStep, float &rampedPeak, UINT firstFrame=0);
+BASE_EXPORT void GainRampScalar(float *buffer, UINT numFrames, float gain, float gainStep, UINT firstFrame=0);
+
+extern const AudioKernelTable avx2AudioKernels;
+
+//the kernel sets this cpu can run, sse2 first.  NULL past the last one
+BASE_EXPORT const AudioKernelTable* GetAudioKernelTable(UINT index);
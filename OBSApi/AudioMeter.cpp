@@ -0,0 +1,317 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "OBSApi.h"
+#include <emmintrin.h>
+
+
+#define TRUEPEAK_TOTAL_TAPS     (AUDIO_METER_TRUEPEAK_TAPS*4)
+#define TRUEPEAK_HISTORY_FRAMES (AUDIO_METER_TRUEPEAK_TAPS-1)
+
+static const double pi = 3.14159265358979323846; //M_PI is only a float
+
+//the k-weighting filters from bs.1770, redone for the actual sample rate
+static void GetShelfCoefficients(double sampleRate, double *coefficients)
+{
+    const double f0 = 1681.974450955533;
+    const double gain = 3.999843853973347;
+    const double Q = 0.7071752369554196;
+
+    double K  = tan(pi*f0/sampleRate);
+    double Vh = pow(10.0, gain/20.0);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K/Q + K*K;
+
+    coefficients[0] = (Vh + Vb*K/Q + K*K)/a0;
+    coefficients[1] = 2.0*(K*K - Vh)/a0;
+    coefficients[2] = (Vh - Vb*K/Q + K*K)/a0;
+    coefficients[3] = 2.0*(K*K - 1.0)/a0;
+    coefficients[4] = (1.0 - K/Q + K*K)/a0;
+}
+
+static void GetHighPassCoefficients(double sampleRate, double *coefficients)
+{
+    const double f0 = 38.13547087602444;
+    const double Q = 0.5003270373238773;
+
+    double K  = tan(pi*f0/sampleRate);
+    double a0 = 1.0 + K/Q + K*K;
+
+    coefficients[0] = 1.0;
+    coefficients[1] = -2.0;
+    coefficients[2] = 1.0;
+    coefficients[3] = 2.0*(K*K - 1.0)/a0;
+    coefficients[4] = (1.0 - K/Q + K*K)/a0;
+}
+
+AudioMeter::AudioMeter()
+{
+    Init(44100);
+}
+
+void AudioMeter::Init(UINT sampleRate)
+{
+    framesPerBlock = MAX(sampleRate/100, 1);
+
+    double coefficients[5];
+
+    GetShelfCoefficients(double(sampleRate), coefficients);
+    for(UINT i=0; i<5; i++)
+        shelfCoefficients[i*2] = shelfCoefficients[i*2+1] = coefficients[i];
+
+    GetHighPassCoefficients(double(sampleRate), coefficients);
+    for(UINT i=0; i<5; i++)
+        highPassCoefficients[i*2] = highPassCoefficients[i*2+1] = coefficients[i];
+
+    //hann windowed sinc cutting off at the original nyquist frequency, with each phase
+    //normalized so dc comes out unchanged
+    double taps[TRUEPEAK_TOTAL_TAPS];
+    double center = double(TRUEPEAK_TOTAL_TAPS-1)*0.5;
+
+    for(UINT i=0; i<TRUEPEAK_TOTAL_TAPS; i++)
+    {
+        double x = (double(i)-center)*0.25;
+        double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(pi*x)/(pi*x);
+        double window = 0.5 - 0.5*cos(2.0*pi*(double(i)+0.5)/double(TRUEPEAK_TOTAL_TAPS));
+
+        taps[i] = sinc*window;
+    }
+
+    for(UINT phase=0; phase<4; phase++)
+    {
+        double sum = 0.0;
+        for(UINT tap=0; tap<AUDIO_METER_TRUEPEAK_TAPS; tap++)
+            sum += taps[tap*4+phase];
+
+        //tap k multiplies the input frame k frames before the newest one
+        for(UINT tap=0; tap<AUDIO_METER_TRUEPEAK_TAPS; tap++)
+        {
+            float coefficient = float(taps[tap*4+phase]/sum);
+            truePeakCoefficients[tap*8+phase*2]   = coefficient;
+            truePeakCoefficients[tap*8+phase*2+1] = coefficient;
+        }
+    }
+
+    Reset();
+}
+
+void AudioMeter::Reset()
+{
+    zero(&stats, sizeof(stats));
+    ResetLoudness();
+}
+
+void AudioMeter::ResetLoudness()
+{
+    zero(filterState, sizeof(filterState));
+    zero(truePeakInput, sizeof(truePeakInput));
+    zero(blockPower, sizeof(blockPower));
+
+    blockPos = numBlocks = 0;
+    momentarySum = shortTermSum = 0.0;
+    curBlockPower = 0.0;
+    curBlockFrames = 0;
+
+    stats.truePeak = 0.0f;
+    stats.momentaryPower = stats.shortTermPower = 0.0f;
+
+    bMeasuringLoudness = false;
+}
+
+float AudioMeter::ProcessTruePeak(UINT numFrames)
+{
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peak = _mm_setzero_ps();
+
+    //each output frame is the four interpolated frames between this input frame and the next,
+    //phases 0-1 in one register and 2-3 in the other
+    for(UINT i=0; i<numFrames; i++)
+    {
+        const float *newest = truePeakInput+(i+TRUEPEAK_HISTORY_FRAMES)*2;
+
+        __m128 phases01 = _mm_setzero_ps();
+        __m128 phases23 = _mm_setzero_ps();
+
+        for(UINT tap=0; tap<AUDIO_METER_TRUEPEAK_TAPS; tap++)
+        {
+            const float *frame = newest-(tap*2);
+            __m128 input = _mm_castpd_ps(_mm_load1_pd((const double*)frame));
+
+            phases01 = _mm_add_ps(phases01, _mm_mul_ps(input, _mm_loadu_ps(truePeakCoefficients+tap*8)));
+            phases23 = _mm_add_ps(phases23, _mm_mul_ps(input, _mm_loadu_ps(truePeakCoefficients+tap*8+4)));
+        }
+
+        peak = _mm_max_ps(peak, _mm_and_ps(phases01, absMask));
+        peak = _mm_max_ps(peak, _mm_and_ps(phases23, absMask));
+    }
+
+    peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 0, 3, 2)));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(peak);
+}
+
+void AudioMeter::FinishBlock()
+{
+    double power = curBlockPower/double(framesPerBlock);
+
+    //the block leaving the momentary window, if there's been enough of them
+    if(numBlocks >= AUDIO_METER_MOMENTARY_BLOCKS)
+        momentarySum -= blockPower[(blockPos+AUDIO_METER_SHORTTERM_BLOCKS-AUDIO_METER_MOMENTARY_BLOCKS) % AUDIO_METER_SHORTTERM_BLOCKS];
+    if(numBlocks >= AUDIO_METER_SHORTTERM_BLOCKS)
+        shortTermSum -= blockPower[blockPos];
+
+    momentarySum += power;
+    shortTermSum += power;
+
+    blockPower[blockPos] = power;
+    if(numBlocks < AUDIO_METER_SHORTTERM_BLOCKS)
+        numBlocks++;
+
+    //redo the sums from scratch once in a while so rounding can't build up
+    if(++blockPos == AUDIO_METER_SHORTTERM_BLOCKS)
+    {
+        blockPos = 0;
+
+        shortTermSum = momentarySum = 0.0;
+        for(UINT i=0; i<AUDIO_METER_SHORTTERM_BLOCKS; i++)
+        {
+            shortTermSum += blockPower[i];
+            if(i >= AUDIO_METER_SHORTTERM_BLOCKS-AUDIO_METER_MOMENTARY_BLOCKS)
+                momentarySum += blockPower[i];
+        }
+    }
+
+    stats.momentaryPower = float(MAX(momentarySum, 0.0)/double(MIN(numBlocks, AUDIO_METER_MOMENTARY_BLOCKS)));
+    stats.shortTermPower = float(MAX(shortTermSum, 0.0)/double(numBlocks));
+
+    curBlockPower = 0.0;
+    curBlockFrames = 0;
+}
+
+void AudioMeter::ProcessLoudness(const float *buffer, UINT numFrames)
+{
+    __m128d b0 = _mm_loadu_pd(shelfCoefficients),   b1 = _mm_loadu_pd(shelfCoefficients+2);
+    __m128d b2 = _mm_loadu_pd(shelfCoefficients+4), a1 = _mm_loadu_pd(shelfCoefficients+6);
+    __m128d a2 = _mm_loadu_pd(shelfCoefficients+8);
+
+    __m128d hpA1 = _mm_loadu_pd(highPassCoefficients+6), hpA2 = _mm_loadu_pd(highPassCoefficients+8);
+
+    __m128d shelfZ1 = _mm_loadu_pd(filterState),   shelfZ2 = _mm_loadu_pd(filterState+2);
+    __m128d hpZ1    = _mm_loadu_pd(filterState+4), hpZ2    = _mm_loadu_pd(filterState+6);
+
+    while(numFrames)
+    {
+        UINT blockFrames = MIN(numFrames, framesPerBlock-curBlockFrames);
+        __m128d sum = _mm_setzero_pd();
+
+        //both channels at once, transposed direct form 2.  the high pass is b = 1 -2 1.
+        for(UINT i=0; i<blockFrames; i++)
+        {
+            __m128d x = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*)(buffer+i*2))));
+
+            __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), shelfZ1);
+            shelfZ1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), shelfZ2);
+            shelfZ2 = _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y));
+
+            x = y;
+            y = _mm_add_pd(x, hpZ1);
+            hpZ1 = _mm_sub_pd(_mm_sub_pd(hpZ2, _mm_add_pd(x, x)), _mm_mul_pd(hpA1, y));
+            hpZ2 = _mm_sub_pd(x, _mm_mul_pd(hpA2, y));
+
+            sum = _mm_add_pd(sum, _mm_mul_pd(y, y));
+        }
+
+        sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+        curBlockPower += _mm_cvtsd_f64(sum);
+
+        buffer += blockFrames*2;
+        numFrames -= blockFrames;
+
+        curBlockFrames += blockFrames;
+        if(curBlockFrames == framesPerBlock)
+            FinishBlock();
+    }
+
+    _mm_storeu_pd(filterState,   shelfZ1);
+    _mm_storeu_pd(filterState+2, shelfZ2);
+    _mm_storeu_pd(filterState+4, hpZ1);
+    _mm_storeu_pd(filterState+6, hpZ2);
+
+    //flush the state to zero once it's decayed away so silence doesn't end up in denormals
+    for(UINT i=0; i<8; i++)
+    {
+        if(fabs(filterState[i]) < 1e-20)
+            filterState[i] = 0.0;
+    }
+}
+
+void AudioMeter::Process(const float *buffer, UINT numFrames, bool bLoudness)
+{
+    if(!numFrames)
+        return;
+
+    CalculateAudioLevels(buffer, numFrames*2, 1.0f, stats.rms, stats.peak);
+
+    if(!bLoudness)
+    {
+        //old filter state and windows would be wrong once it's turned back on
+        if(bMeasuringLoudness)
+            ResetLoudness();
+
+        stats.truePeak = stats.peak;
+        return;
+    }
+
+    bMeasuringLoudness = true;
+
+    float truePeak = 0.0f;
+
+    while(numFrames)
+    {
+        UINT chunkFrames = MIN(numFrames, AUDIO_METER_CHUNK_FRAMES);
+
+        mcpy(truePeakInput+TRUEPEAK_HISTORY_FRAMES*2, buffer, chunkFrames*2*sizeof(float));
+        truePeak = MAX(truePeak, ProcessTruePeak(chunkFrames));
+        memmove(truePeakInput, truePeakInput+chunkFrames*2, TRUEPEAK_HISTORY_FRAMES*2*sizeof(float));
+
+        ProcessLoudness(buffer, chunkFrames);
+
+        buffer += chunkFrames*2;
+        numFrames -= chunkFrames;
+    }
+
+    //the interpolation filter is delayed, so the actual samples are checked as well
+    stats.truePeak = MAX(truePeak, stats.peak);
+}
+
+//-----------------------------------------------------------------------------
+
+static std::atomic<DWORD> lastLoudnessRequest(0);
+
+void STDCALL RequestAudioLoudness()
+{
+    //0 means never asked
+    lastLoudnessRequest.store(MAX(OSGetTime(), 1), std::memory_order_relaxed);
+}
+
+bool STDCALL AudioLoudnessRequested()
+{
+    DWORD lastRequest = lastLoudnessRequest.load(std::memory_order_relaxed);
+    return lastRequest && (OSGetTime()-lastRequest) < AUDIO_METER_REQUEST_TIMEOUT_MS;
+}
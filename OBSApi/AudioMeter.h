@@ -0,0 +1,113 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+#define AUDIO_METER_MIN_DB              -96.0f
+
+#define AUDIO_METER_TRUEPEAK_TAPS       12      //per phase, 4 phases
+#define AUDIO_METER_CHUNK_FRAMES        256
+#define AUDIO_METER_MOMENTARY_BLOCKS    40      //10ms blocks, 400ms
+#define AUDIO_METER_SHORTTERM_BLOCKS    300     //3s
+#define AUDIO_METER_REQUEST_TIMEOUT_MS  5000    //how long loudness keeps being measured after it was last asked for
+
+//levels are linear, loudness is the k-weighted mean square summed over both channels
+struct AudioMeterStats
+{
+    float rms, peak;        //of the last block processed
+    float truePeak;         //4x oversampled peak of the last block processed (just the peak if loudness isn't requested)
+    float momentaryPower;   //over the last 400ms
+    float shortTermPower;   //over the last 3 seconds
+};
+
+inline float AmplitudeToDB(float amplitude)
+{
+    if(amplitude <= 0.0f)
+        return AUDIO_METER_MIN_DB;
+    return MAX(20.0f*log10(amplitude), AUDIO_METER_MIN_DB);
+}
+
+inline float PowerToLUFS(float power)
+{
+    if(power <= 0.0f)
+        return AUDIO_METER_MIN_DB;
+    return MAX(-0.691f + 10.0f*log10(power), AUDIO_METER_MIN_DB);
+}
+
+//levels of the sum of two uncorrelated sources, without having to mix them
+inline void CombineAudioMeterStats(AudioMeterStats &total, const AudioMeterStats &stats)
+{
+    total.rms = sqrt(total.rms*total.rms + stats.rms*stats.rms);
+    total.peak = MAX(total.peak, stats.peak);
+    total.truePeak = MAX(total.truePeak, stats.truePeak);
+    total.momentaryPower += stats.momentaryPower;
+    total.shortTermPower += stats.shortTermPower;
+}
+
+//loudness and true peak cost far more than the levels (see AudioBench meter), so they're only
+//measured while something is reading them.  the loudness getters call RequestAudioLoudness, and
+//meters measure it until it hasn't been called for AUDIO_METER_REQUEST_TIMEOUT_MS.
+BASE_EXPORT void STDCALL RequestAudioLoudness();
+BASE_EXPORT bool STDCALL AudioLoudnessRequested();
+
+//incremental loudness (bs.1770 k-weighting) and true peak meter for interleaved stereo.  doesn't
+//allocate, everything is kept in fixed size buffers.
+class BASE_EXPORT AudioMeter
+{
+    UINT framesPerBlock;
+
+    //k-weighting is a high shelf followed by a high pass.  coefficients are b0 b1 b2 a1 a2, each
+    //stored twice so both channels go through one sse2 register, and the state is z1 z2 per stage
+    double shelfCoefficients[10], highPassCoefficients[10];
+    double filterState[8];
+
+    //4x oversampling filter, tap by tap with the 4 phases each stored twice
+    float truePeakCoefficients[AUDIO_METER_TRUEPEAK_TAPS*8];
+
+    //the last AUDIO_METER_TRUEPEAK_TAPS-1 frames followed by the chunk being processed
+    float truePeakInput[(AUDIO_METER_TRUEPEAK_TAPS-1+AUDIO_METER_CHUNK_FRAMES)*2];
+
+    double blockPower[AUDIO_METER_SHORTTERM_BLOCKS];
+    UINT   blockPos, numBlocks;
+    double momentarySum, shortTermSum;
+
+    double curBlockPower;
+    UINT   curBlockFrames;
+
+    AudioMeterStats stats;
+
+    bool bMeasuringLoudness;
+
+    float ProcessTruePeak(UINT numFrames);
+    void  ProcessLoudness(const float *buffer, UINT numFrames);
+    void  FinishBlock();
+    void  ResetLoudness();
+
+public:
+    AudioMeter();
+
+    void Init(UINT sampleRate);
+    void Reset();
+
+    //rms and peak are always measured, loudness and true peak only if bLoudness is set.  loudness
+    //starts over whenever it's turned back on.
+    void Process(const float *buffer, UINT numFrames, bool bLoudness);
+
+    inline const AudioMeterStats& GetStats() const {return stats;}
+};
@@ -0,0 +1,157 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "OBSApi.h"
+#include "AudioResampler.h"
+
+
+#define RESAMPLER_MAX_PHASES    1024
+#define RESAMPLER_PASSBAND      0.90    //fraction of the lower nyquist frequency that's kept
+#define RESAMPLER_ATTENUATION   90.0    //stopband attenuation in dB
+
+static const double pi = 3.14159265358979323846; //M_PI is only a float
+
+static UINT GreatestCommonDivisor(UINT a, UINT b)
+{
+    while(b)
+    {
+        UINT temp = a % b;
+        a = b;
+        b = temp;
+    }
+
+    return a;
+}
+
+//zeroth order modified bessel function, for the kaiser window
+static double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    double halfX = x*0.5;
+
+    for(int k=1; k<50; k++)
+    {
+        term *= (halfX/k)*(halfX/k);
+        sum += term;
+        if(term < sum*1e-12)
+            break;
+    }
+
+    return sum;
+}
+
+bool PolyphaseResampler::CanResample(UINT inputRate, UINT outputRate)
+{
+    if(!inputRate || !outputRate)
+        return false;
+
+    UINT upFactor = outputRate/GreatestCommonDivisor(inputRate, outputRate);
+    return upFactor <= RESAMPLER_MAX_PHASES;
+}
+
+void PolyphaseResampler::Init(UINT inputRate, UINT outputRate)
+{
+    UINT divisor = GreatestCommonDivisor(inputRate, outputRate);
+    upFactor   = outputRate/divisor;
+    downFactor = inputRate/divisor;
+
+    //the filter runs at inputRate*upFactor and has to cut off below the lower of the two nyquist
+    //frequencies.  the transition band goes from RESAMPLER_PASSBAND of it to the frequency itself.
+    double nyquist      = double(MIN(inputRate, outputRate))*0.5;
+    double transition   = nyquist*(1.0-RESAMPLER_PASSBAND);
+    double cutoff       = nyquist-(transition*0.5);
+    double filterRate   = double(inputRate)*double(upFactor);
+
+    //kaiser window design: length from the attenuation and transition width, per phase rounded
+    //up to a multiple of 4 frames for the simd kernels
+    double beta = 0.1102*(RESAMPLER_ATTENUATION-8.7);
+    double length = (RESAMPLER_ATTENUATION-8.0)/(2.285*2.0*pi*transition/filterRate);
+
+    numTaps = (UINT(ceil(length/double(upFactor)))+3) & 0xFFFFFFFC;
+
+    UINT totalTaps = numTaps*upFactor;
+    double center = double(totalTaps-1)*0.5;
+    double normCutoff = 2.0*cutoff/filterRate;
+    double windowScale = 1.0/BesselI0(beta);
+
+    coefficients.SetSize(totalTaps*2);
+
+    for(UINT i=0; i<totalTaps; i++)
+    {
+        double x = double(i)-center;
+        double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(pi*normCutoff*x)/(pi*normCutoff*x);
+
+        double windowPos = x/center;
+        double window = BesselI0(beta*sqrt(MAX(0.0, 1.0-windowPos*windowPos)))*windowScale;
+
+        float coefficient = float(double(upFactor)*normCutoff*sinc*window);
+
+        //tap i belongs to phase i%upFactor, and multiplies the input frame (i/upFactor) frames
+        //before the newest one
+        UINT curPhase = i%upFactor;
+        UINT tap = numTaps-1-(i/upFactor);
+
+        float *phaseCoefficients = coefficients.Array()+(curPhase*numTaps*2);
+        phaseCoefficients[tap*2]   = coefficient;
+        phaseCoefficients[tap*2+1] = coefficient;
+    }
+
+    //start out with silence as the history
+    numHistoryFrames = numTaps-1;
+    history.SetSize(numHistoryFrames*2);
+    zero(history.Array(), numHistoryFrames*2*sizeof(float));
+
+    phase = 0;
+}
+
+UINT PolyphaseResampler::Process(const float *input, UINT numFrames, float *output)
+{
+    UINT totalFrames = numHistoryFrames+numFrames;
+    if(history.Num() < totalFrames*2)
+        history.SetSize(totalFrames*2);
+
+    mcpy(history.Array()+(numHistoryFrames*2), input, numFrames*2*sizeof(float));
+
+    //curFrame is the newest input frame used by the next output frame
+    UINT curFrame = numTaps-1;
+    UINT numOutputFrames = 0;
+
+    const float *historyData = history.Array();
+    const float *phaseData   = coefficients.Array();
+
+    while(curFrame < totalFrames)
+    {
+        FilterStereoAudio(output, historyData+(curFrame+1-numTaps)*2, phaseData+(phase*numTaps*2), numTaps);
+        output += 2;
+        numOutputFrames++;
+
+        phase += downFactor;
+        curFrame += phase/upFactor;
+        phase %= upFactor;
+    }
+
+    //keep what the next output frame needs.  the filter is always much longer than the
+    //downsampling ratio, so that's never past the end of what we have.
+    UINT firstKeptFrame = curFrame+1-numTaps;
+    numHistoryFrames = totalFrames-firstKeptFrame;
+
+    memmove(history.Array(), history.Array()+(firstKeptFrame*2), numHistoryFrames*2*sizeof(float));
+
+    return numOutputFrames;
+}
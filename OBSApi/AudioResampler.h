@@ -0,0 +1,48 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+//fixed ratio polyphase resampler for interleaved stereo.  the ratio has to reduce to a fraction
+//with a reasonably small numerator (44.1k <-> 48k is 160/147), anything else should go through
+//libsamplerate.  after Init it doesn't allocate unless it's given bigger packets than before.
+class BASE_EXPORT PolyphaseResampler
+{
+    UINT upFactor, downFactor;
+    UINT numTaps;
+
+    //upFactor phases of numTaps coefficients, in input order, each one stored twice for stereo
+    List<float> coefficients;
+
+    //the last numTaps-1 input frames, followed by input that hasn't been used yet
+    List<float> history;
+    UINT numHistoryFrames;
+
+    UINT phase;
+
+public:
+    static bool CanResample(UINT inputRate, UINT outputRate);
+
+    void Init(UINT inputRate, UINT outputRate);
+
+    inline UINT MaxOutputFrames(UINT numInputFrames) const {return (numInputFrames*upFactor)/downFactor + 1;}
+
+    //returns the number of frames written, at most MaxOutputFrames(numFrames)
+    UINT Process(const float *input, UINT numFrames, float *output);
+};
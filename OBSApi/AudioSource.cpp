@@ -20,34 +20,140 @@
 #include "OBSApi.h"
 #include <Audioclient.h>
 #include "../libsamplerate/samplerate.h"
+#include "AudioResampler.h"
 
 #define KSAUDIO_SPEAKER_4POINT1     (KSAUDIO_SPEAKER_QUAD|SPEAKER_LOW_FREQUENCY)
 #define KSAUDIO_SPEAKER_3POINT1     (KSAUDIO_SPEAKER_STEREO|SPEAKER_FRONT_CENTER|SPEAKER_LOW_FREQUENCY)
 #define KSAUDIO_SPEAKER_2POINT1     (KSAUDIO_SPEAKER_STEREO|SPEAKER_LOW_FREQUENCY)
 
 
-void MultiplyAudioBuffer(float *buffer, int totalFloats, float mulVal)
+#define AUDIO_SEGMENT_RING_SIZE     64      //640ms of 10ms segments, doubles if a source queues more
+#define AUDIO_SEGMENT_PREALLOCATE   16
+
+//queued segments in a power of two ring, oldest first.  segments that have been used go to a
+//free list with their data still allocated and get refilled in place, so after the first few
+//the audio thread doesn't allocate.
+struct AudioSegmentRing
 {
-    float sum = 0.0f;
-    int totalFloatsStore = totalFloats;
+    List<AudioSegment*> slots;
+    UINT head, num;
+
+    List<AudioSegment*> freeSegments;
+
+    inline AudioSegmentRing() : head(0), num(0) {}
+
+    inline UINT Num() const                         {return num;}
+    inline AudioSegment* operator[](UINT i) const   {return slots[(head+i) & (slots.Num()-1)];}
+    inline AudioSegment* Last() const               {return (*this)[num-1];}
+
+    void Push(AudioSegment *segment)
+    {
+        if(num == slots.Num())
+        {
+            List<AudioSegment*> newSlots;
+            newSlots.SetSize(num ? num*2 : AUDIO_SEGMENT_RING_SIZE);
+            for(UINT i=0; i<num; i++)
+                newSlots[i] = (*this)[i];
+
+            slots.TransferFrom(newSlots);
+            head = 0;
+        }
+
+        slots[(head+num) & (slots.Num()-1)] = segment;
+        ++num;
+    }
+
+    //the segment has to be handed back with Recycle once it's no longer used
+    AudioSegment* PopFront()
+    {
+        AudioSegment *segment = (*this)[0];
+        head = (head+1) & (slots.Num()-1);
+        --num;
 
-    if((UPARAM(buffer) & 0xF) == 0)
+        return segment;
+    }
+
+    AudioSegment* GetFreeSegment(float *data, UINT numFloats, QWORD timestamp)
     {
-        UINT alignedFloats = totalFloats & 0xFFFFFFFC;
-        __m128 sseMulVal = _mm_set_ps1(mulVal);
+        if(!freeSegments.Num())
+            return new AudioSegment(data, numFloats, timestamp);
 
-        for(UINT i=0; i<alignedFloats; i += 4)
+        AudioSegment *segment = freeSegments.Last();
+        freeSegments.SetSize(freeSegments.Num()-1);
+
+        segment->SetData(data, numFloats, timestamp);
+        return segment;
+    }
+
+    inline void Recycle(AudioSegment *segment) {freeSegments << segment;}
+
+    void Preallocate(UINT count, UINT numFloats)
+    {
+        for(UINT i=freeSegments.Num(); i<count; i++)
         {
-            __m128 sseScaledVals = _mm_mul_ps(_mm_load_ps(buffer+i), sseMulVal);
-            _mm_store_ps(buffer+i, sseScaledVals);
+            AudioSegment *segment = new AudioSegment(NULL, 0, 0);
+            segment->audioData.Reserve(numFloats);
+            freeSegments << segment;
         }
+    }
 
-        buffer      += alignedFloats;
-        totalFloats -= alignedFloats;
+    void FreeData()
+    {
+        while(num)
+            delete PopFront();
+        for(UINT i=0; i<freeSegments.Num(); i++)
+            delete freeSegments[i];
+
+        freeSegments.Clear();
+        slots.Clear();
+        head = 0;
     }
+};
 
-    for(int i=0; i<totalFloats; i++)
-        buffer[i] *= mulVal;
+static HANDLE hAudioDataEvent = NULL;
+static std::atomic<QWORD> audioSignalTime;
+
+void STDCALL InitAudioDataEvent()
+{
+    //auto-reset, so a signal that comes in while the audio thread is busy mixing still wakes its next wait
+    if(!hAudioDataEvent)
+        hAudioDataEvent = OSCreateEvent();
+    audioSignalTime = 0;
+}
+
+void STDCALL FreeAudioDataEvent()
+{
+    if(hAudioDataEvent)
+    {
+        OSCloseEvent(hAudioDataEvent);
+        hAudioDataEvent = NULL;
+    }
+}
+
+void STDCALL SignalAudioData()
+{
+    if(!hAudioDataEvent)
+        return;
+
+    QWORD noSignal = 0;
+    audioSignalTime.compare_exchange_strong(noSignal, OSGetTimeMicroseconds());
+
+    OSSignalEvent(hAudioDataEvent);
+}
+
+bool STDCALL WaitForAudioData(DWORD timeoutMS, QWORD &signalTime)
+{
+    if(!hAudioDataEvent)
+    {
+        OSSleep(timeoutMS);
+        signalTime = 0;
+        return false;
+    }
+
+    bool bSignalled = OSWaitForEvent(hAudioDataEvent, timeoutMS) != FALSE;
+    signalTime = audioSignalTime.exchange(0);
+
+    return bSignalled;
 }
 
 /* astoundingly disgusting hack to get more variables into the class without breaking API */
@@ -55,10 +161,29 @@ struct NotAResampler
 {
     SRC_STATE *resampler;
     QWORD     jumpRange;
+    PolyphaseResampler *polyphase;      //used instead of resampler if set
+    AudioResamplerType resamplerType;
+    AudioSegmentRing segments;
+    AudioDownmixMatrix downmix;
+    AudioMeter meter;
 };
 
 #define MoreVariables static_cast<NotAResampler*>(resampler)
 
+static void FreeResampler(NotAResampler *data, bool &bResample)
+{
+    if(data->polyphase)
+    {
+        delete data->polyphase;
+        data->polyphase = NULL;
+    }
+    else if(bResample)
+        src_delete(data->resampler);
+
+    data->resampler = NULL;
+    bResample = false;
+}
+
 AudioSource::AudioSource()
 {
     sourceVolume = 1.0f;
@@ -68,26 +193,116 @@ AudioSource::AudioSource()
 
 AudioSource::~AudioSource()
 {
-    if(bResample)
-        src_delete(MoreVariables->resampler);
+    FreeResampler(MoreVariables, bResample);
 
-    for(UINT i=0; i<audioSegments.Num(); i++)
-        delete audioSegments[i];
+    MoreVariables->segments.FreeData();
 
     delete (NotAResampler*)resampler;
 }
 
 
-union TripleToLong
+const float dbMinus3    = 0.7071067811865476f;
+const float dbMinus6    = 0.5f;
+const float dbMinus9    = 0.3535533905932738f;
+
+//not entirely sure if these are the correct coefficients for downmixing,
+//I'm fairly new to the whole multi speaker thing
+const float surroundMix = dbMinus3;
+const float centerMix   = dbMinus6;
+const float lowFreqMix  = dbMinus3;
+
+const float surroundMix4 = dbMinus6;
+
+const float attn5dot1 = 1.0f / (1.0f + centerMix + surroundMix);
+const float attn4dotX = 1.0f / (1.0f + surroundMix4);
+
+//the coefficients for each speaker setup, see the notes below
+static void BuildDownmixMatrix(DWORD channelMask, UINT channels, AudioDownmixMatrix &matrix)
 {
-    LONG val;
-    struct 
+    zero(&matrix, sizeof(matrix));
+
+    switch(channelMask)
     {
-        WORD wVal;
-        BYTE tripleVal;
-        BYTE lastByte;
-    };
-};
+        //L, R, RL, RR
+        //when in doubt, use only left and right .... and rear left and rear right :)
+        case KSAUDIO_SPEAKER_QUAD:
+            matrix.left[0]  = attn4dotX;
+            matrix.left[2]  = surroundMix4*attn4dotX;
+            matrix.right[1] = attn4dotX;
+            matrix.right[3] = surroundMix4*attn4dotX;
+            break;
+
+        //L, R, LFE, RL, RR.  same as quad, skip the LFE
+        case KSAUDIO_SPEAKER_4POINT1:
+            matrix.left[0]  = attn4dotX;
+            matrix.left[3]  = surroundMix4*attn4dotX;
+            matrix.right[1] = attn4dotX;
+            matrix.right[4] = surroundMix4*attn4dotX;
+            break;
+
+        //L, R, LFE / L, R, C, LFE / L, R, C, RC
+        //when in doubt, use only left and right :)  seriously.  THIS NEEDS TO BE PROPERLY IMPLEMENTED!
+        case KSAUDIO_SPEAKER_2POINT1:
+        case KSAUDIO_SPEAKER_3POINT1:
+        case KSAUDIO_SPEAKER_SURROUND:
+            matrix.left[0]  = 1.0f;
+            matrix.right[1] = 1.0f;
+            break;
+
+        // L, R, C, LFE, RL, RR
+        // Both speakers configs share the same format, the difference is in rear speakers position 
+        // See: http://msdn.microsoft.com/en-us/library/windows/hardware/ff537083(v=vs.85).aspx
+        // Probably for KSAUDIO_SPEAKER_5POINT1_SURROUND we will need a different coefficient for rear left/right
+        //
+        // According to ITU-R  BS.775-1 recommendation, the downmix from a 3/2 source to stereo
+        // is the following:
+        // L = FL + k0*C + k1*RL
+        // R = FR + k0*C + k1*RR
+        // k0 = centerMix   = dbMinus3 = 0.7071067811865476 [for k0 we can use dbMinus6 = 0.5 too, probably it's better]
+        // k1 = surroundMix = dbMinus3 = 0.7071067811865476
+        //
+        // The output (L,R) can be out of (-1,1) domain so we attenuate it [ attn5dot1 = 1/(1 + centerMix + surroundMix) ]
+        // Note: this method of downmixing is far from "perfect" (pretty sure it's not the correct way) but the resulting downmix is "okayish", at least no more bleeding ears.
+        // (maybe have a look at http://forum.doom9.org/archive/index.php/t-148228.html too [ 5.1 -> stereo ] the approach seems almost the same [but different coefficients])
+        // http://acousticsfreq.com/blog/wp-content/uploads/2012/01/ITU-R-BS775-1.pdf
+        // http://ir.lib.nctu.edu.tw/bitstream/987654321/22934/1/030104001.pdf
+        //
+        // KSAUDIO_SPEAKER_7POINT1 is obsolete and no longer supported in Windows Vista and later versions of Windows
+        // Not sure what to do about it, meh , drop front left of center/front right of center -> 5.1 -> stereo; 
+        case KSAUDIO_SPEAKER_5POINT1:
+        case KSAUDIO_SPEAKER_5POINT1_SURROUND:
+        case KSAUDIO_SPEAKER_7POINT1:
+            matrix.left[0]  = attn5dot1;
+            matrix.left[2]  = centerMix*attn5dot1;
+            matrix.left[4]  = surroundMix*attn5dot1;
+            matrix.right[1] = attn5dot1;
+            matrix.right[2] = centerMix*attn5dot1;
+            matrix.right[5] = surroundMix*attn5dot1;
+            break;
+
+        // L, R, C, LFE, RL, RR, SL, SR
+        // Downmix to 5.1 (easy stuff) by averaging the rear and side channels, then downmix to stereo as done in KSAUDIO_SPEAKER_5POINT1
+        case KSAUDIO_SPEAKER_7POINT1_SURROUND:
+            matrix.left[0]  = attn5dot1;
+            matrix.left[2]  = centerMix*attn5dot1;
+            matrix.left[4]  = 0.5f*surroundMix*attn5dot1;
+            matrix.left[6]  = 0.5f*surroundMix*attn5dot1;
+            matrix.right[1] = attn5dot1;
+            matrix.right[2] = centerMix*attn5dot1;
+            matrix.right[5] = 0.5f*surroundMix*attn5dot1;
+            matrix.right[7] = 0.5f*surroundMix*attn5dot1;
+            break;
+
+        //todo: support for other speaker configurations than ones I can merely "think" of.  ugh.
+        default:
+            if(channels >= 2)
+            {
+                matrix.left[0]  = 1.0f;
+                matrix.right[1] = 1.0f;
+            }
+            break;
+    }
+}
 
 void AudioSource::InitAudioData(bool bFloat, UINT channels, UINT samplesPerSec, UINT bitsPerSample, UINT blockSize, DWORD channelMask)
 {
@@ -102,7 +317,22 @@ void AudioSource::InitAudioData(bool bFloat, UINT channels, UINT samplesPerSec,
 
     UINT sampleRateHz = OBSGetSampleRateHz();
 
-    if(inputSamplesPerSec != sampleRateHz)
+    //a few frames of slack for the resampler
+    MoreVariables->segments.Preallocate(AUDIO_SEGMENT_PREALLOCATE, (sampleRateHz/100+4)*2);
+    MoreVariables->meter.Init(sampleRateHz);
+
+    FreeResampler(MoreVariables, bResample);
+
+    if(inputSamplesPerSec != sampleRateHz && MoreVariables->resamplerType == AudioResampler_Auto &&
+       PolyphaseResampler::CanResample(inputSamplesPerSec, sampleRateHz))
+    {
+        MoreVariables->polyphase = new PolyphaseResampler;
+        MoreVariables->polyphase->Init(inputSamplesPerSec, sampleRateHz);
+
+        resampleRatio = double(sampleRateHz) / double(inputSamplesPerSec);
+        bResample = true;
+    }
+    else if(inputSamplesPerSec != sampleRateHz)
     {
         int errVal;
 
@@ -175,29 +405,19 @@ void AudioSource::InitAudioData(bool bFloat, UINT channels, UINT samplesPerSec,
                     CrashError(TEXT("Unknown speaker setup, no downmixer available."));
             }
         }
-    }
-}
 
+        if(inputChannels > AUDIO_DOWNMIX_MAX_CHANNELS)
+            CrashError(TEXT("Unknown speaker setup, no downmixer available."));
 
-const float dbMinus3    = 0.7071067811865476f;
-const float dbMinus6    = 0.5f;
-const float dbMinus9    = 0.3535533905932738f;
-
-//not entirely sure if these are the correct coefficients for downmixing,
-//I'm fairly new to the whole multi speaker thing
-const float surroundMix = dbMinus3;
-const float centerMix   = dbMinus6;
-const float lowFreqMix  = dbMinus3;
-
-const float surroundMix4 = dbMinus6;
+        BuildDownmixMatrix(inputChannelMask, inputChannels, MoreVariables->downmix);
+    }
+}
 
-const float attn5dot1 = 1.0f / (1.0f + centerMix + surroundMix);
-const float attn4dotX = 1.0f / (1.0f + surroundMix4);
 
 void AudioSource::AddAudioSegment(AudioSegment *newSegment, float curVolume)
 {
     if (newSegment)
-        MultiplyAudioBuffer(newSegment->audioData.Array(), newSegment->audioData.Num(), curVolume*sourceVolume);
+        MultiplyAudio(newSegment->audioData.Array(), newSegment->audioData.Num(), curVolume*sourceVolume);
 
     for (UINT i=0; i<audioFilters.Num(); i++)
     {
@@ -206,23 +426,36 @@ void AudioSource::AddAudioSegment(AudioSegment *newSegment, float curVolume)
     }
 
     if (newSegment)
-        audioSegments << newSegment;
+    {
+        //block filters that delay the audio report it, so pull the segment back by that much the
+        //same way the sync offset moves it
+        UINT latencyFrames = GetAudioFilterLatency();
+        if (latencyFrames)
+        {
+            QWORD latencyMS = QWORD(latencyFrames)*1000/OBSGetSampleRateHz();
+            newSegment->timestamp = (newSegment->timestamp > latencyMS) ? newSegment->timestamp-latencyMS : 0;
+        }
+
+        MoreVariables->meter.Process(newSegment->audioData.Array(), newSegment->audioData.Num()/2, AudioLoudnessRequested());
+        MoreVariables->segments.Push(newSegment);
+    }
 }
 
 //  Used to sort sort audio in case from back->front in case of burst (this shouldn't be
 //necessary but a necessary thing for the current audio system)
 void AudioSource::SortAudio(QWORD timestamp)
 {
+    AudioSegmentRing &segments = MoreVariables->segments;
     QWORD jumpAmount = 0;
 
-    if (audioSegments.Num() <= 1)
+    if (segments.Num() <= 1)
         return;
 
-    lastUsedTimestamp = lastSentTimestamp = audioSegments.Last()->timestamp = timestamp;
+    lastUsedTimestamp = lastSentTimestamp = segments.Last()->timestamp = timestamp;
 
-    for (UINT i = audioSegments.Num()-1; i > 0; i--)
+    for (UINT i = segments.Num()-1; i > 0; i--)
     {
-        AudioSegment *segment = audioSegments[i-1];
+        AudioSegment *segment = segments[i-1];
         UINT frames = segment->audioData.Num()/2;
         double totalTime = double(frames)/double(OBSGetSampleRateHz())*1000.0;
         QWORD newTime = timestamp - QWORD(totalTime);
@@ -262,6 +495,13 @@ UINT AudioSource::QueryAudio2(float curVolume, bool bCanBurstHack)
 
     if(GetNextBuffer((void**)&buffer, &numAudioFrames, &newTimestamp))
     {
+        //sources can be queried from several threads at once, and vs2013 doesn't make local static
+        //initialization thread safe.  racing here is harmless, everyone gets the same histogram.
+        static MetricHistogram *queryAudioTime = NULL;
+        if(!queryAudioTime)
+            queryAudioTime = GetMetricHistogram(TEXT("audio.queryAudio"));
+        MetricTimer queryTimer(queryAudioTime);
+
         //------------------------------------------------------------
         // convert to float
 
@@ -273,55 +513,7 @@ UINT AudioSource::QueryAudio2(float curVolume, bool bCanBurstHack)
             if(convertBuffer.Num() < totalSamples)
                 convertBuffer.SetSize(totalSamples);
 
-            if(inputBitsPerSample == 8)
-            {
-                float *tempConvert = convertBuffer.Array();
-                char *tempSByte = (char*)buffer;
-
-                while(totalSamples--)
-                {
-                    *(tempConvert++) = float(*(tempSByte++))/127.0f;
-                }
-            }
-            else if(inputBitsPerSample == 16)
-            {
-                float *tempConvert = convertBuffer.Array();
-                short *tempShort = (short*)buffer;
-
-                while(totalSamples--)
-                {
-                    *(tempConvert++) = float(*(tempShort++))/32767.0f;
-                }
-            }
-            else if(inputBitsPerSample == 24)
-            {
-                float *tempConvert = convertBuffer.Array();
-                BYTE *tempTriple = (BYTE*)buffer;
-                TripleToLong valOut;
-
-                while(totalSamples--)
-                {
-                    TripleToLong &valIn  = (TripleToLong&)tempTriple;
-
-                    valOut.wVal = valIn.wVal;
-                    valOut.tripleVal = valIn.tripleVal;
-                    if(valOut.tripleVal > 0x7F)
-                        valOut.lastByte = 0xFF;
-
-                    *(tempConvert++) = float(double(valOut.val)/8388607.0);
-                    tempTriple += 3;
-                }
-            }
-            else if(inputBitsPerSample == 32)
-            {
-                float *tempConvert = convertBuffer.Array();
-                long *tempShort = (long*)buffer;
-
-                while(totalSamples--)
-                {
-                    *(tempConvert++) = float(double(*(tempShort++))/2147483647.0);
-                }
-            }
+            ConvertAudioToFloat(convertBuffer.Array(), buffer, totalSamples, inputBitsPerSample);
 
             captureBuffer = convertBuffer.Array();
         }
@@ -334,276 +526,24 @@ UINT AudioSource::QueryAudio2(float curVolume, bool bCanBurstHack)
         if(tempBuffer.Num() < numAudioFrames*2)
             tempBuffer.SetSize(numAudioFrames*2);
 
-        float *dataOutputBuffer = tempBuffer.Array();
-        float *tempOut = dataOutputBuffer;
-
-        if(inputChannels == 1)
-        {
-            UINT  numFloats   = numAudioFrames;
-            float *inputTemp  = (float*)captureBuffer;
-            float *outputTemp = dataOutputBuffer;
-
-            if((UPARAM(inputTemp) & 0xF) == 0 && (UPARAM(outputTemp) & 0xF) == 0)
-            {
-                UINT alignedFloats = numFloats & 0xFFFFFFFC;
-                for(UINT i=0; i<alignedFloats; i += 4)
-                {
-                    __m128 inVal   = _mm_load_ps(inputTemp+i);
-
-                    __m128 outVal1 = _mm_unpacklo_ps(inVal, inVal);
-                    __m128 outVal2 = _mm_unpackhi_ps(inVal, inVal);
-
-                    _mm_store_ps(outputTemp+(i*2),   outVal1);
-                    _mm_store_ps(outputTemp+(i*2)+4, outVal2);
-                }
+        DownmixAudio(tempBuffer.Array(), captureBuffer, numAudioFrames, inputChannels, MoreVariables->downmix);
 
-                numFloats  -= alignedFloats;
-                inputTemp  += alignedFloats;
-                outputTemp += alignedFloats*2;
-            }
+        ReleaseBuffer();
 
-            while(numFloats--)
-            {
-                float inputVal = *inputTemp;
-                *(outputTemp++) = inputVal;
-                *(outputTemp++) = inputVal;
+        //------------------------------------------------------------
+        // resample
 
-                inputTemp++;
-            }
-        }
-        else if(inputChannels == 2) //straight up copy
+        if(bResample && MoreVariables->polyphase)
         {
-            memcpy(dataOutputBuffer, captureBuffer, numAudioFrames*2*sizeof(float));
-        }
-        else
-        {
-            //todo: downmix optimization, also support for other speaker configurations than ones I can merely "think" of.  ugh.
-            float *inputTemp  = (float*)captureBuffer;
-            float *outputTemp = dataOutputBuffer;
-
-            if(inputChannelMask == KSAUDIO_SPEAKER_QUAD)
-            {
-                UINT numFloats = numAudioFrames*4;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-                    float rearLeft  = inputTemp[2]*surroundMix4;
-                    float rearRight = inputTemp[3]*surroundMix4;
-
-                    // When in doubt, use only left and right .... and rear left and rear right :) 
-                    // Same idea as with 5.1 downmix
-
-                    *(outputTemp++) = (left  + rearLeft)  * attn4dotX;
-                    *(outputTemp++) = (right + rearRight) * attn4dotX;
-
-                    inputTemp  += 4;
-                }
-            }
-            else if(inputChannelMask == KSAUDIO_SPEAKER_2POINT1)
-            {
-                UINT numFloats = numAudioFrames*3;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-                   
-                    // Drop LFE since we don't need it
-                    //float lfe       = inputTemp[2]*lowFreqMix;
-
-                    *(outputTemp++) = left;
-                    *(outputTemp++) = right;
-
-                    inputTemp  += 3;
-                }
-            }
-            else if(inputChannelMask == KSAUDIO_SPEAKER_3POINT1)
-            {
-                UINT numFloats = numAudioFrames*4;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left          = inputTemp[0];
-                    float right         = inputTemp[1];
-                    float frontCenter   = inputTemp[2];
-                    float lowFreq       = inputTemp[3];
-
-                    *(outputTemp++) = left;
-                    *(outputTemp++) = right;
-
-                    inputTemp  += 4;
-                }
-            }
-            else if(inputChannelMask == KSAUDIO_SPEAKER_4POINT1)
-            {
-                UINT numFloats = numAudioFrames*5;
-                float *endTemp = inputTemp+numFloats;
+            PolyphaseResampler *polyphase = MoreVariables->polyphase;
 
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-
-                    // Skip LFE , we don't really need it.
-                    //float lfe       = inputTemp[2];
-
-                    float rearLeft  = inputTemp[3]*surroundMix4;
-                    float rearRight = inputTemp[4]*surroundMix4;
-
-                    // Same idea as with 5.1 downmix
-
-                    *(outputTemp++) = (left  + rearLeft)  * attn4dotX;
-                    *(outputTemp++) = (right + rearRight) * attn4dotX;
-
-                    inputTemp  += 5;
-                }
-            }
-            else if(inputChannelMask == KSAUDIO_SPEAKER_SURROUND)
-            {
-                UINT numFloats = numAudioFrames*4;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-                    float frontCenter    = inputTemp[2];
-                    float rearCenter     = inputTemp[3];
-                    
-                    // When in doubt, use only left and right :) Seriously.
-                    // THIS NEEDS TO BE PROPERLY IMPLEMENTED!
-
-                    *(outputTemp++) = left;
-                    *(outputTemp++) = right;
-
-                    inputTemp  += 4;
-                }
-            }
-            // Both speakers configs share the same format, the difference is in rear speakers position 
-            // See: http://msdn.microsoft.com/en-us/library/windows/hardware/ff537083(v=vs.85).aspx
-            // Probably for KSAUDIO_SPEAKER_5POINT1_SURROUND we will need a different coefficient for rear left/right
-            else if(inputChannelMask == KSAUDIO_SPEAKER_5POINT1 || inputChannelMask == KSAUDIO_SPEAKER_5POINT1_SURROUND)
-            {
-                UINT numFloats = numAudioFrames*6;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-                    float center    = inputTemp[2]*centerMix;
-                    
-                    //We don't need LFE channel so skip it (see below)
-                    //float lowFreq   = inputTemp[3]*lowFreqMix;
-                    
-                    float rearLeft  = inputTemp[4]*surroundMix;
-                    float rearRight = inputTemp[5]*surroundMix;
-                    
-                    // According to ITU-R  BS.775-1 recommendation, the downmix from a 3/2 source to stereo
-                    // is the following:
-                    // L = FL + k0*C + k1*RL
-                    // R = FR + k0*C + k1*RR
-                    // FL = front left
-                    // FR = front right
-                    // C  = center
-                    // RL = rear left
-                    // RR = rear right
-                    // k0 = centerMix   = dbMinus3 = 0.7071067811865476 [for k0 we can use dbMinus6 = 0.5 too, probably it's better]
-                    // k1 = surroundMix = dbMinus3 = 0.7071067811865476
-
-                    // The output (L,R) can be out of (-1,1) domain so we attenuate it [ attn5dot1 = 1/(1 + centerMix + surroundMix) ]
-                    // Note: this method of downmixing is far from "perfect" (pretty sure it's not the correct way) but the resulting downmix is "okayish", at least no more bleeding ears.
-                    // (maybe have a look at http://forum.doom9.org/archive/index.php/t-148228.html too [ 5.1 -> stereo ] the approach seems almost the same [but different coefficients])
-
-                    
-                    // http://acousticsfreq.com/blog/wp-content/uploads/2012/01/ITU-R-BS775-1.pdf
-                    // http://ir.lib.nctu.edu.tw/bitstream/987654321/22934/1/030104001.pdf
-
-                    *(outputTemp++) = (left  + center  + rearLeft) * attn5dot1;
-                    *(outputTemp++) = (right + center  + rearRight) * attn5dot1;
-
-                    inputTemp  += 6;
-                }
-            }
-
-            // According to http://msdn.microsoft.com/en-us/library/windows/hardware/ff537083(v=vs.85).aspx
-            // KSAUDIO_SPEAKER_7POINT1 is obsolete and no longer supported in Windows Vista and later versions of Windows
-            // Not sure what to do about it, meh , drop front left of center/front right of center -> 5.1 -> stereo; 
-
-            else if(inputChannelMask == KSAUDIO_SPEAKER_7POINT1)
-            {
-                UINT numFloats = numAudioFrames*8;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left          = inputTemp[0];
-                    float right         = inputTemp[1];
-                    
-                    float center        = inputTemp[2] * centerMix;
-                    
-                    // Drop LFE since we don't need it
-                    //float lowFreq       = inputTemp[3]*lowFreqMix;
-                    
-                    float rearLeft      = inputTemp[4] * surroundMix;
-                    float rearRight     = inputTemp[5] * surroundMix;
-
-                    // Drop SPEAKER_FRONT_LEFT_OF_CENTER , SPEAKER_FRONT_RIGHT_OF_CENTER
-                    //float centerLeft    = inputTemp[6];
-                    //float centerRight   = inputTemp[7];
-                    
-                    // Downmix from 5.1 to stereo
-                    *(outputTemp++) = (left  + center  + rearLeft)  * attn5dot1;
-                    *(outputTemp++) = (right + center  + rearRight) * attn5dot1;
-
-                    inputTemp  += 8;
-                }
-            }
-
-            // Downmix to 5.1 (easy stuff) then downmix to stereo as done in KSAUDIO_SPEAKER_5POINT1
-            else if(inputChannelMask == KSAUDIO_SPEAKER_7POINT1_SURROUND)
-            {
-                UINT numFloats = numAudioFrames*8;
-                float *endTemp = inputTemp+numFloats;
-
-                while(inputTemp < endTemp)
-                {
-                    float left      = inputTemp[0];
-                    float right     = inputTemp[1];
-                    float center    = inputTemp[2] * centerMix;
-
-                    // Skip LFE we don't need it
-                    //float lowFreq   = inputTemp[3]*lowFreqMix;
-
-                    float rearLeft  = inputTemp[4];
-                    float rearRight = inputTemp[5];
-                    float sideLeft  = inputTemp[6];
-                    float sideRight = inputTemp[7];
-
-                    // combine the rear/side channels first , baaam! 5.1
-                    rearLeft  = (rearLeft  + sideLeft)  * 0.5f;
-                    rearRight = (rearRight + sideRight) * 0.5f;
-
-                    // downmix to stereo as in 5.1 case
-                    *(outputTemp++) = (left  + center + rearLeft  * surroundMix) * attn5dot1;
-                    *(outputTemp++) = (right + center + rearRight * surroundMix) * attn5dot1;
+            UINT newFrameSize = polyphase->MaxOutputFrames(numAudioFrames)*2;
+            if(tempResampleBuffer.Num() < newFrameSize)
+                tempResampleBuffer.SetSize(newFrameSize);
 
-                    inputTemp  += 8;
-                }
-            }
+            numAudioFrames = polyphase->Process(tempBuffer.Array(), numAudioFrames, tempResampleBuffer.Array());
         }
-
-        ReleaseBuffer();
-
-        //------------------------------------------------------------
-        // resample
-
-        if(bResample)
+        else if(bResample)
         {
             UINT frameAdjust = UINT((double(numAudioFrames) * resampleRatio) + 1.0);
             UINT newFrameSize = frameAdjust*2;
@@ -673,7 +613,7 @@ UINT AudioSource::QueryAudio2(float curVolume, bool bCanBurstHack)
         bool overshotAudio = (lastUsedTimestamp < lastSentTimestamp+10);
         if (bCanBurstHack || !overshotAudio)
         {
-            AudioSegment *newSegment = new AudioSegment(newBuffer, numAudioFrames*2, lastUsedTimestamp);
+            AudioSegment *newSegment = MoreVariables->segments.GetFreeSegment(newBuffer, numAudioFrames*2, lastUsedTimestamp);
             AddAudioSegment(newSegment, curVolume*sourceVolume);
             lastSentTimestamp = lastUsedTimestamp;
         }
@@ -688,9 +628,11 @@ UINT AudioSource::QueryAudio2(float curVolume, bool bCanBurstHack)
 
 bool AudioSource::GetEarliestTimestamp(QWORD &timestamp)
 {
-    if(audioSegments.Num())
+    AudioSegmentRing &segments = MoreVariables->segments;
+
+    if(segments.Num())
     {
-        timestamp = audioSegments[0]->timestamp;
+        timestamp = segments[0]->timestamp;
         return true;
     }
 
@@ -699,9 +641,11 @@ bool AudioSource::GetEarliestTimestamp(QWORD &timestamp)
 
 bool AudioSource::GetLatestTimestamp(QWORD &timestamp)
 {
-    if(audioSegments.Num())
+    AudioSegmentRing &segments = MoreVariables->segments;
+
+    if(segments.Num())
     {
-        timestamp = audioSegments.Last()->timestamp;
+        timestamp = segments.Last()->timestamp;
         return true;
     }
 
@@ -710,18 +654,20 @@ bool AudioSource::GetLatestTimestamp(QWORD &timestamp)
 
 bool AudioSource::GetBuffer(float **buffer, QWORD targetTimestamp)
 {
+    AudioSegmentRing &segments = MoreVariables->segments;
+    UINT outputFloats = OBSGetSampleRateHz()/100*2;
+
     bool bSuccess = false;
     bool bDeleted = false;
-    outputBuffer.Clear();
 
     bool bReportedOnce = false;
 
-    while(audioSegments.Num())
+    while(segments.Num())
     {
-        if(audioSegments[0]->timestamp < targetTimestamp)
+        if(segments[0]->timestamp < targetTimestamp)
         {
-            QWORD diff = targetTimestamp-audioSegments[0]->timestamp;
-            //OSDebugOut(TEXT("Off by %llu\n"), targetTimestamp-audioSegments[0]->timestamp);
+            QWORD diff = targetTimestamp-segments[0]->timestamp;
+            //OSDebugOut(TEXT("Off by %llu\n"), targetTimestamp-segments[0]->timestamp);
             if (!bReportedOnce) {
                 Log(TEXT("Audio timestamp for device '%s' was behind target timestamp by %llu"),
                         GetDeviceName(), diff);
@@ -730,20 +676,19 @@ bool AudioSource::GetBuffer(float **buffer, QWORD targetTimestamp)
             }
 
             /*if (!bReportedOnce && diff > 150) {
-                for (UINT i = 0; i < audioSegments.Num(); i++)
-                    Log(L"    %llu", audioSegments[i]->timestamp);
+                for (UINT i = 0; i < segments.Num(); i++)
+                    Log(L"    %llu", segments[i]->timestamp);
 
                 bReportedOnce = true;
             }*/
 
             /*OSDebugOut(L"targetTimestamp: %llu\n", targetTimestamp);
-            for (UINT i = 0; i < audioSegments.Num(); i++)
+            for (UINT i = 0; i < segments.Num(); i++)
             {
-                OSDebugOut(L"%llu\n", audioSegments[i]->timestamp);
+                OSDebugOut(L"%llu\n", segments[i]->timestamp);
             }*/
 
-            delete audioSegments[0];
-            audioSegments.Remove(0);
+            segments.Recycle(segments.PopFront());
 
             bDeleted = true;
         }
@@ -751,26 +696,28 @@ bool AudioSource::GetBuffer(float **buffer, QWORD targetTimestamp)
             break;
     }
 
-    if(audioSegments.Num())
+    if(segments.Num())
     {
         bool bUseSegment = false;
 
-        AudioSegment *segment = audioSegments[0];
+        AudioSegment *segment = segments[0];
 
         QWORD difference = (segment->timestamp-targetTimestamp);
         if(bDeleted || difference <= 11)
         {
             //Log(TEXT("segment.timestamp: %llu, targetTimestamp: %llu"), segment.timestamp, targetTimestamp);
-            outputBuffer.TransferFrom(segment->audioData);
+            //copied rather than transferred so the segment keeps its memory for reuse
+            outputBuffer.CopyArray(segment->audioData.Array(), segment->audioData.Num());
 
-            delete segment;
-            audioSegments.Remove(0);
+            segments.Recycle(segments.PopFront());
 
             bSuccess = true;
         }
     }
 
-    outputBuffer.SetSize(OBSGetSampleRateHz()/100*2);
+    outputBuffer.SetSize(outputFloats);
+    if(!bSuccess)
+        zero(outputBuffer.Array(), outputFloats*sizeof(float));
 
     *buffer = outputBuffer.Array();
 
@@ -779,11 +726,13 @@ bool AudioSource::GetBuffer(float **buffer, QWORD targetTimestamp)
 
 bool AudioSource::GetNewestFrame(float **buffer)
 {
+    AudioSegmentRing &segments = MoreVariables->segments;
+
     if(buffer)
     {
-        if(audioSegments.Num())
+        if(segments.Num())
         {
-            List<float> &data = audioSegments.Last()->audioData;
+            List<float> &data = segments.Last()->audioData;
             *buffer = data.Array();
             return true;
         }
@@ -794,8 +743,10 @@ bool AudioSource::GetNewestFrame(float **buffer)
 
 QWORD AudioSource::GetBufferedTime()
 {
-    if(audioSegments.Num())
-        return audioSegments.Last()->timestamp - audioSegments[0]->timestamp;
+    AudioSegmentRing &segments = MoreVariables->segments;
+
+    if(segments.Num())
+        return segments.Last()->timestamp - segments[0]->timestamp;
 
     return 0;
 }
@@ -812,6 +763,8 @@ void AudioSource::SetTimeOffset(int newOffset) {timeOffset = newOffset;}
 void AudioSource::SetVolume(float fVal) {sourceVolume = fabsf(fVal);}
 float AudioSource::GetVolume() const {return sourceVolume;}
 
+void AudioSource::SetResamplerType(AudioResamplerType type) {MoreVariables->resamplerType = type;}
+
 UINT AudioSource::NumAudioFilters() const {return audioFilters.Num();}
 AudioFilter* AudioSource::GetAudioFilter(UINT id) {if(audioFilters.Num() > id) return audioFilters[id]; return NULL;}
 
@@ -819,3 +772,34 @@ void AudioSource::AddAudioFilter(AudioFilter *filter) {audioFilters << filter;}
 void AudioSource::InsertAudioFilter(UINT pos, AudioFilter *filter) {audioFilters.Insert(pos, filter);}
 void AudioSource::RemoveAudioFilter(AudioFilter *filter) {audioFilters.RemoveItem(filter);}
 void AudioSource::RemoveAudioFilter(UINT id) {if(audioFilters.Num() > id) audioFilters.Remove(id);}
+
+UINT AudioSource::GetAudioFilterLatency() const
+{
+    UINT latency = 0;
+
+    for(UINT i=0; i<audioFilters.Num(); i++)
+    {
+        BlockAudioFilter *blockFilter = dynamic_cast<BlockAudioFilter*>(audioFilters[i]);
+        if(blockFilter)
+            latency += blockFilter->GetLatencyFrames();
+    }
+
+    return latency;
+}
+
+bool AudioSource::GetMeterStats(AudioMeterStats &stats) const
+{
+    if(!MoreVariables->segments.Num())
+        return false;
+
+    stats = MoreVariables->meter.GetStats();
+    return true;
+}
+
+//-----------------------------------------
+
+AudioSegment* BlockAudioFilter::Process(AudioSegment *segment)
+{
+    ProcessBlock(segment->audioData.Array(), segment->audioData.Num()/2, segment->timestamp);
+    return segment;
+}
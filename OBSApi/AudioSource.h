@@ -26,6 +26,13 @@ enum
     AudioAvailable,
 };
 
+//which resampler a source uses if its sample rate isn't the output rate
+enum AudioResamplerType
+{
+    AudioResampler_Auto,        //the polyphase resampler if the ratio allows it, otherwise libsamplerate
+    AudioResampler_Sinc,        //always libsamplerate
+};
+
 struct AudioSegment
 {
     List<float> audioData;
@@ -36,6 +43,13 @@ struct AudioSegment
         audioData.CopyArray(data, numFloats);
     }
 
+    //refills the segment without giving back its memory
+    inline void SetData(float *data, UINT numFloats, QWORD timestamp)
+    {
+        audioData.CopyArray(data, numFloats);
+        this->timestamp = timestamp;
+    }
+
     inline void ClearData()
     {
         audioData.Clear();
@@ -55,7 +69,7 @@ class BASE_EXPORT AudioSource
 
     //-----------------------------------------
 
-    List<AudioSegment*> audioSegments;
+    List<AudioSegment*> audioSegments;     //unused, queued segments are kept in a ring in the resampler data (see AudioSource.cpp)
 
     QWORD lastUsedTimestamp;
     QWORD lastSentTimestamp;
@@ -129,6 +143,9 @@ public:
     void SetVolume(float fVal);
     float GetVolume() const;
 
+    //has to be called before InitAudioData to have any effect
+    void SetResamplerType(AudioResamplerType type);
+
     UINT NumAudioFilters() const;
     AudioFilter* GetAudioFilter(UINT id);
 
@@ -137,6 +154,14 @@ public:
     void RemoveAudioFilter(AudioFilter *filter);
     void RemoveAudioFilter(UINT id);
 
+    //total latency of the block filters in the chain, in frames.  filtered segments are moved back
+    //by this much.
+    UINT GetAudioFilterLatency() const;
+
+    //levels and loudness of the audio as it's buffered (after volume and filters).  returns false
+    //if there's nothing buffered.
+    bool GetMeterStats(AudioMeterStats &stats) const;
+
     virtual bool GetLatestTimestamp(QWORD &timestamp);
 
     void SortAudio(QWORD timestamp);
@@ -145,3 +170,18 @@ public:
     CTSTR GetDeviceName2() const {return GetDeviceName();}
 };
 
+//-----------------------------------------
+// the audio thread sleeps on this between mixes.  sources that are handed data by another thread
+// (rather than reading it from a device in GetNextBuffer) should signal it once a new segment's
+// worth has come in, so it's picked up right away instead of at the next deadline.
+
+//OBS::Start creates the event before any audio source exists and frees it once the last one is
+//gone.  outside of that SignalAudioData does nothing and WaitForAudioData just sleeps
+BASE_EXPORT void STDCALL InitAudioDataEvent();
+BASE_EXPORT void STDCALL FreeAudioDataEvent();
+
+BASE_EXPORT void STDCALL SignalAudioData();
+
+//returns true if woken by SignalAudioData.  signalTime is when the first signal since the
+//previous wait came in (OSGetTimeMicroseconds), or 0 if there wasn't one
+BASE_EXPORT bool STDCALL WaitForAudioData(DWORD timeoutMS, QWORD &signalTime);
@@ -359,73 +359,6 @@ QWORD GetQPCTimeMS()
     return timeVal;
 }
 
-void MixAudio(float *bufferDest, float *bufferSrc, UINT totalFloats, bool bForceMono)
-{
-    UINT floatsLeft = totalFloats;
-    float *destTemp = bufferDest;
-    float *srcTemp  = bufferSrc;
-
-    if((UPARAM(destTemp) & 0xF) == 0 && (UPARAM(srcTemp) & 0xF) == 0)
-    {
-        UINT alignedFloats = floatsLeft & 0xFFFFFFFC;
-
-        if(bForceMono)
-        {
-            __m128 halfVal = _mm_set_ps1(0.5f);
-            for(UINT i=0; i<alignedFloats; i += 4)
-            {
-                float *micInput = srcTemp+i;
-                __m128 val = _mm_load_ps(micInput);
-                __m128 shufVal = _mm_shuffle_ps(val, val, _MM_SHUFFLE(2, 3, 0, 1));
-
-                _mm_store_ps(micInput, _mm_mul_ps(_mm_add_ps(val, shufVal), halfVal));
-            }
-        }
-
-        __m128 maxVal = _mm_set_ps1(1.0f);
-        __m128 minVal = _mm_set_ps1(-1.0f);
-
-        for(UINT i=0; i<alignedFloats; i += 4)
-        {
-            float *pos = destTemp+i;
-
-            __m128 mix;
-            mix = _mm_add_ps(_mm_load_ps(pos), _mm_load_ps(srcTemp+i));
-            mix = _mm_min_ps(mix, maxVal);
-            mix = _mm_max_ps(mix, minVal);
-
-            _mm_store_ps(pos, mix);
-        }
-
-        floatsLeft  &= 0x3;
-        destTemp    += alignedFloats;
-        srcTemp     += alignedFloats;
-    }
-
-    if(floatsLeft)
-    {
-        if(bForceMono)
-        {
-            for(UINT i=0; i<floatsLeft; i += 2)
-            {
-                srcTemp[i] += srcTemp[i+1];
-                srcTemp[i] *= 0.5f;
-                srcTemp[i+1] = srcTemp[i];
-            }
-        }
-
-        for(UINT i=0; i<floatsLeft; i++)
-        {
-            float val = destTemp[i]+srcTemp[i];
-
-            if(val < -1.0f)     val = -1.0f;
-            else if(val > 1.0f) val = 1.0f;
-
-            destTemp[i] = val;
-        }
-    }
-}
-
 BOOL CALLBACK DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
     if (fdwReason == DLL_PROCESS_ATTACH)
@@ -434,6 +367,8 @@ BOOL CALLBACK DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
         //workaround AVX2 bug in VS2013, http://connect.microsoft.com/VisualStudio/feedback/details/811093
         _set_FMA3_enable(0);
 #endif
+
+        InitAudioKernels();
     }
 
     return TRUE;
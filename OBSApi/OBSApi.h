@@ -82,7 +82,6 @@ inline QWORD GetQWDif(QWORD val1, QWORD val2)
 BASE_EXPORT QWORD GetQPCTimeNS();
 BASE_EXPORT QWORD GetQPCTime100NS();
 BASE_EXPORT QWORD GetQPCTimeMS();
-BASE_EXPORT void MixAudio(float *bufferDest, float *bufferSrc, UINT totalFloats, bool bForceMono);
 
 //-------------------------------------------
 
@@ -90,6 +89,8 @@ BASE_EXPORT void MixAudio(float *bufferDest, float *bufferSrc, UINT totalFloats,
 #include "Scene.h"
 #include "SettingsPane.h"
 #include "APIInterface.h"
+#include "AudioKernels.h"
+#include "AudioMeter.h"
 #include "AudioFilter.h"
 #include "AudioSource.h"
 #include "HotkeyControlEx.h"
@@ -28,12 +28,100 @@
 // ...yes, I really need to rewrite this file, I know.
 
 
+//changes are written out by a shared thread this long after the first of them, so a burst of
+//Set calls ends up as a single save
+#define CONFIG_SAVE_DELAY 250
+
+HANDLE hConfigSaveMutex = NULL;
+
+static HANDLE hConfigSaveThread = NULL;
+static HANDLE hConfigSaveEvent = NULL, hConfigSaveStop = NULL;
+static BOOL bConfigSaveShutdown = FALSE;
+static List<ConfigFile*> dirtyConfigs;
+
+static inline void LockConfigSave()     {if(hConfigSaveMutex) OSEnterMutex(hConfigSaveMutex);}
+static inline void UnlockConfigSave()   {if(hConfigSaveMutex) OSLeaveMutex(hConfigSaveMutex);}
+
+static DWORD STDCALL ConfigSaveThread(LPVOID param)
+{
+    while(true)
+    {
+        OSWaitForEvent(hConfigSaveEvent);
+
+        if(OSWaitForEvent(hConfigSaveStop, CONFIG_SAVE_DELAY))
+            break;
+
+        LockConfigSave();
+        while(dirtyConfigs.Num())
+            dirtyConfigs[0]->Flush();
+        UnlockConfigSave();
+    }
+
+    return 0;
+}
+
+//stops the save thread and writes whatever is still pending, configs are saved right away after this
+void STDCALL ShutdownConfigSaving()
+{
+    LockConfigSave();
+    bConfigSaveShutdown = TRUE;
+    UnlockConfigSave();
+
+    if(hConfigSaveThread)
+    {
+        OSSignalEvent(hConfigSaveStop);
+        OSSignalEvent(hConfigSaveEvent);
+        OSWaitForThread(hConfigSaveThread, NULL);
+        OSCloseThread(hConfigSaveThread);
+        OSCloseEvent(hConfigSaveEvent);
+        OSCloseEvent(hConfigSaveStop);
+        hConfigSaveThread = hConfigSaveEvent = hConfigSaveStop = NULL;
+    }
+
+    LockConfigSave();
+    while(dirtyConfigs.Num())
+        dirtyConfigs[0]->Flush();
+    dirtyConfigs.Clear();
+    UnlockConfigSave();
+}
+
+//FNV-1a over the lower case characters, the same folding scmpi uses
+static inline UINT HashConfigName(UINT hash, CTSTR lpName)
+{
+    while(*lpName)
+    {
+        TCHAR ch = *(lpName++);
+        if(ch >= 'A' && ch <= 'Z')
+            ch += 'a'-'A';
+
+        hash = (hash ^ UINT(ch)) * 16777619;
+    }
+
+    return hash;
+}
+
+static inline UINT HashConfigKey(CTSTR lpSection, CTSTR lpKey)
+{
+    UINT hash = HashConfigName(2166136261, lpSection);
+    hash = (hash ^ UINT(']')) * 16777619;
+    return HashConfigName(hash, lpKey);
+}
+
+static inline void AppendText(String &str, CTSTR lpText, UINT len)
+{
+    if(len)
+        str.AppendString(lpText, len);
+}
+
+
 /*=========================================================
     Config
 ===========================================================*/
 
 BOOL ConfigFile::Create(CTSTR lpConfigFile)
 {
+    Flush();
+
     strFileName = lpConfigFile;
 
     if(LoadFile(XFILE_CREATEALWAYS))
@@ -46,6 +134,8 @@ BOOL ConfigFile::Create(CTSTR lpConfigFile)
 
 BOOL ConfigFile::Open(CTSTR lpConfigFile, BOOL bOpenAlways)
 {
+    Flush();
+
     strFileName = lpConfigFile;
 
     if(LoadFile(bOpenAlways ? XFILE_OPENALWAYS : XFILE_OPENEXISTING))
@@ -66,7 +156,7 @@ BOOL ConfigFile::LoadFile(DWORD dwOpenMode)
     }
 
     if(bOpen)
-        Close();
+        FreeData();
 
     dwLength = (DWORD)file.GetFileSize();
 
@@ -156,9 +246,182 @@ void ConfigFile::LoadData()
 
         *lpNextLine = '\r';
     }
+
+    BuildIndex();
 }
 
-void ConfigFile::Close()
+//hashes every key by section and key name, and parses the first value of each key up front so
+//the typed getters don't have to
+void ConfigFile::BuildIndex()
+{
+    UINT numKeys = 0;
+    for(UINT i=0; i<Sections.Num(); i++)
+        numKeys += Sections[i].Keys.Num();
+
+    KeyIndex.SetSize(RoundUpPow2(MAX(numKeys*2, 16)));
+    zero(KeyIndex.Array(), KeyIndex.Num()*sizeof(ConfigKeyIndex));
+
+    UINT mask = KeyIndex.Num()-1;
+
+    for(UINT i=0; i<Sections.Num(); i++)
+    {
+        ConfigSection &section = Sections[i];
+
+        for(UINT j=0; j<section.Keys.Num(); j++)
+        {
+            ConfigKey &key = section.Keys[j];
+            CTSTR lpValue = key.ValueList[0];
+
+            if(scmpi(lpValue, TEXT("true")) == 0)
+            {
+                key.bValidInt = TRUE;
+                key.intValue = 1;
+            }
+            else if(scmpi(lpValue, TEXT("false")) == 0)
+            {
+                key.bValidInt = TRUE;
+                key.intValue = 0;
+            }
+            else
+            {
+                key.bValidInt = ValidIntString(lpValue);
+                key.intValue = key.bValidInt ? tstring_base_to_int(lpValue, NULL, 0) : 0;
+            }
+
+            key.hexValue = (DWORD)tstring_base_to_int(lpValue, NULL, 0);
+            key.floatValue = (float)tstof(lpValue);
+
+            //a section can show up more than once, the first key with the name wins like it always has
+            UINT hash = HashConfigKey(section.name, key.name);
+            UINT slot = hash & mask;
+
+            while(KeyIndex[slot].key)
+            {
+                ConfigKeyIndex &entry = KeyIndex[slot];
+                if(entry.hash == hash && scmpi(entry.section->name, section.name) == 0 && scmpi(entry.key->name, key.name) == 0)
+                    break;
+
+                slot = (slot+1) & mask;
+            }
+
+            if(!KeyIndex[slot].key)
+            {
+                ConfigKeyIndex &entry = KeyIndex[slot];
+                entry.hash = hash;
+                entry.section = &section;
+                entry.key = &key;
+            }
+        }
+    }
+}
+
+ConfigKey* ConfigFile::FindKey(CTSTR lpSection, CTSTR lpKey)
+{
+    if(!KeyIndex.Num())
+        return NULL;
+
+    UINT hash = HashConfigKey(lpSection, lpKey);
+    UINT mask = KeyIndex.Num()-1;
+    UINT slot = hash & mask;
+
+    while(KeyIndex[slot].key)
+    {
+        ConfigKeyIndex &entry = KeyIndex[slot];
+        if(entry.hash == hash && scmpi(entry.section->name, lpSection) == 0 && scmpi(entry.key->name, lpKey) == 0)
+            return entry.key;
+
+        slot = (slot+1) & mask;
+    }
+
+    return NULL;
+}
+
+//replaces the file contents (without the BOM) and queues a save
+void ConfigFile::SetData(const String &strNewData)
+{
+    UINT len = strNewData.Length();
+
+    TSTR lpNewData = (TSTR)Allocate((len+5)*sizeof(TCHAR));
+    lpNewData[0] = lpNewData[len+2] = 13;
+    lpNewData[1] = lpNewData[len+3] = 10;
+    lpNewData[len+4] = 0;
+    if(len)
+        mcpy(lpNewData+2, strNewData.Array(), len*sizeof(TCHAR));
+
+    LockConfigSave();
+
+    FreeData();
+
+    lpFileData = lpNewData;
+    dwLength = len+4;
+    bOpen = 1;
+
+    LoadData();
+
+    if(!bDirty)
+    {
+        bDirty = TRUE;
+        dirtyConfigs << this;
+    }
+
+    if(bConfigSaveShutdown || !hConfigSaveMutex)
+        Flush();
+    else
+    {
+        if(!hConfigSaveThread)
+        {
+            hConfigSaveEvent = OSCreateEvent();
+            hConfigSaveStop = OSCreateEvent(TRUE);
+            hConfigSaveThread = OSCreateThread((XTHREAD)ConfigSaveThread, NULL);
+        }
+
+        OSSignalEvent(hConfigSaveEvent);
+    }
+
+    UnlockConfigSave();
+}
+
+BOOL ConfigFile::WriteData(CTSTR lpPath)
+{
+    String tmpPath = lpPath;
+    tmpPath.AppendString(TEXT(".tmp"));
+
+    XFile file;
+    if (!file.Open(tmpPath, XFILE_WRITE, XFILE_CREATEALWAYS))
+        return FALSE;
+
+    if (file.Write("\xEF\xBB\xBF", 3) != 3)
+        return FALSE;
+    if (dwLength > 4 && !file.WriteAsUTF8(&lpFileData[2], dwLength-4))
+        return FALSE;
+
+    file.Close();
+    if (!OSRenameFile(tmpPath, lpPath))
+    {
+        Log(TEXT("ConfigFile::WriteData: Unable to move new config file %s to %s"), tmpPath.Array(), lpPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void ConfigFile::Flush()
+{
+    LockConfigSave();
+
+    if(bDirty)
+    {
+        if(!WriteData(strFileName))
+            Log(TEXT("ConfigFile::Flush: Unable to save config file %s"), strFileName.Array());
+
+        bDirty = FALSE;
+        dirtyConfigs.RemoveItem(this);
+    }
+
+    UnlockConfigSave();
+}
+
+void ConfigFile::FreeData()
 {
     DWORD i,j,k;
 
@@ -180,6 +443,7 @@ void ConfigFile::Close()
         section.Keys.Clear();
     }
     Sections.Clear();
+    KeyIndex.Clear();
 
     if(lpFileData)
     {
@@ -190,34 +454,37 @@ void ConfigFile::Close()
     bOpen = 0;
 }
 
-BOOL ConfigFile::SaveAs(CTSTR lpPath)
+void ConfigFile::Close()
 {
-    XFile newFile;
-    
-    String tmpPath = lpPath;
-    tmpPath.AppendString(TEXT(".tmp"));
+    Flush();
 
-    if (newFile.Open(tmpPath, XFILE_WRITE, XFILE_CREATEALWAYS))
-    {
-        if (newFile.Write("\xEF\xBB\xBF", 3) != 3)
-            return FALSE;
-        if (!newFile.WriteAsUTF8(lpFileData))
-            return FALSE;
+    LockConfigSave();
+    FreeData();
+    UnlockConfigSave();
+}
+
+BOOL ConfigFile::SaveAs(CTSTR lpPath)
+{
+    Flush();
 
-        newFile.Close();
-        if (!OSRenameFile(tmpPath, lpPath))
-            Log(TEXT("ConfigFile::SaveAs: Unable to move new config file %s to %s"), tmpPath.Array(), lpPath);
+    LockConfigSave();
 
+    BOOL bSuccess = WriteData(lpPath);
+    if(bSuccess)
         strFileName = lpPath;
-        return TRUE;
-    }
 
-    return FALSE;
+    UnlockConfigSave();
+
+    return bSuccess;
 }
 
 void ConfigFile::SetFilePath(CTSTR lpPath)
 {
+    Flush();
+
+    LockConfigSave();
     strFileName = lpPath;
+    UnlockConfigSave();
 }
 
 String ConfigFile::GetString(CTSTR lpSection, CTSTR lpKey, CTSTR def)
@@ -225,21 +492,9 @@ String ConfigFile::GetString(CTSTR lpSection, CTSTR lpKey, CTSTR def)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
-        {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                    return String(key.ValueList[0]);
-            }
-        }
-    }
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key)
+        return String(key->ValueList[0]);
 
     if(def)
         return String(def);
@@ -252,21 +507,9 @@ CTSTR ConfigFile::GetStringPtr(CTSTR lpSection, CTSTR lpKey, CTSTR def)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
-        {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                    return key.ValueList[0];
-            }
-        }
-    }
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key)
+        return key->ValueList[0];
 
     if(def)
         return def;
@@ -279,31 +522,9 @@ int ConfigFile::GetInt(CTSTR lpSection, CTSTR lpKey, int def)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
-        {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                {
-                    if(scmpi(key.ValueList[0], TEXT("true")) == 0)
-                        return 1;
-                    else if(scmpi(key.ValueList[0], TEXT("false")) == 0)
-                        return 0;
-                    else
-                    {
-                        if(ValidIntString(key.ValueList[0]))
-                            return tstring_base_to_int(key.ValueList[0], NULL, 0);
-                    }
-                }
-            }
-        }
-    }
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key && key->bValidInt)
+        return key->intValue;
 
     return def;
 }
@@ -313,21 +534,9 @@ DWORD ConfigFile::GetHex(CTSTR lpSection, CTSTR lpKey, DWORD def)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
-        {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                    return tstring_base_to_int(key.ValueList[0], NULL, 0);
-            }
-        }
-    }
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key)
+        return key->hexValue;
 
     return def;
 }
@@ -337,21 +546,9 @@ float ConfigFile::GetFloat(CTSTR lpSection, CTSTR lpKey, float def)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
-        {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                    return (float)tstof(key.ValueList[0]);
-            }
-        }
-    }
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key)
+        return key->floatValue;
 
     return def;
 }
@@ -361,72 +558,60 @@ Color4 ConfigFile::GetColor(CTSTR lpSection, CTSTR lpKey)
     assert(lpSection);
     assert(lpKey);
 
-    DWORD i,j;
-
-    for(i=0; i<Sections.Num(); i++)
+    ConfigKey *key = FindKey(lpSection, lpKey);
+    if(key)
     {
-        ConfigSection &section = Sections[i];
-        if(scmpi(lpSection, section.name) == 0)
+        TSTR strValue = key->ValueList[0];
+        if(*strValue == '{')
         {
-            for(j=0; j<section.Keys.Num(); j++)
-            {
-                ConfigKey &key = section.Keys[j];
-                if(scmpi(lpKey, key.name) == 0)
-                {
-                    TSTR strValue = key.ValueList[0];
-                    if(*strValue == '{')
-                    {
-                        Color4 ret;
-
-                        ret.x = float(tstof(++strValue));
+            Color4 ret;
 
-                        if(!(strValue = schr(strValue, ',')))
-                            break;
-                        ret.y = float(tstof(++strValue));
+            ret.x = float(tstof(++strValue));
 
-                        if(!(strValue = schr(strValue, ',')))
-                            break;
-                        ret.z = float(tstof(++strValue));
+            if(!(strValue = schr(strValue, ',')))
+                return Color4(0.0f, 0.0f, 0.0f, 0.0f);
+            ret.y = float(tstof(++strValue));
 
-                        if(!(strValue = schr(strValue, ',')))
-                        {
-                            ret.w = 1.0f;
-                            return ret;
-                        }
-                        ret.w = float(tstof(++strValue));
+            if(!(strValue = schr(strValue, ',')))
+                return Color4(0.0f, 0.0f, 0.0f, 0.0f);
+            ret.z = float(tstof(++strValue));
 
-                        return ret;
-                    }
-                    else if(*strValue == '[')
-                    {
-                        Color4 ret;
+            if(!(strValue = schr(strValue, ',')))
+            {
+                ret.w = 1.0f;
+                return ret;
+            }
+            ret.w = float(tstof(++strValue));
 
-                        ret.x = (float(tstoi(++strValue))/255.0f)+0.001f;
+            return ret;
+        }
+        else if(*strValue == '[')
+        {
+            Color4 ret;
 
-                        if(!(strValue = schr(strValue, ',')))
-                            break;
-                        ret.y = (float(tstoi(++strValue))/255.0f)+0.001f;
+            ret.x = (float(tstoi(++strValue))/255.0f)+0.001f;
 
-                        if(!(strValue = schr(strValue, ',')))
-                            break;
-                        ret.z = (float(tstoi(++strValue))/255.0f)+0.001f;
+            if(!(strValue = schr(strValue, ',')))
+                return Color4(0.0f, 0.0f, 0.0f, 0.0f);
+            ret.y = (float(tstoi(++strValue))/255.0f)+0.001f;
 
-                        if(!(strValue = schr(strValue, ',')))
-                        {
-                            ret.w = 1.0f;
-                            return ret;
-                        }
-                        ret.w = (float(tstoi(++strValue))/255.0f)+0.001f;
+            if(!(strValue = schr(strValue, ',')))
+                return Color4(0.0f, 0.0f, 0.0f, 0.0f);
+            ret.z = (float(tstoi(++strValue))/255.0f)+0.001f;
 
-                        return ret;
-                    }
-                    else if( (*LPWORD(strValue) == 'x0') ||
-                        (*LPWORD(strValue) == 'X0') )
-                    {
-                        return RGBA_to_Vect4(tstring_base_to_int(strValue+2, NULL, 16));
-                    }
-                }
+            if(!(strValue = schr(strValue, ',')))
+            {
+                ret.w = 1.0f;
+                return ret;
             }
+            ret.w = (float(tstoi(++strValue))/255.0f)+0.001f;
+
+            return ret;
+        }
+        else if( (*LPWORD(strValue) == 'x0') ||
+            (*LPWORD(strValue) == 'X0') )
+        {
+            return RGBA_to_Vect4(tstring_base_to_int(strValue+2, NULL, 16));
         }
     }
 
@@ -751,20 +936,7 @@ void ConfigFile::SetColorList(CTSTR lpSection, CTSTR lpKey, List<Color4> &ColorL
 
 BOOL  ConfigFile::HasKey(CTSTR lpSection, CTSTR lpKey)
 {
-    for(unsigned int i=0; i<Sections.Num(); i++)
-    {
-        ConfigSection &section = Sections[i];
-        if(scmpi(section.name, lpSection) == 0)
-        {
-            for(unsigned int j=0; j<section.Keys.Num(); j++)
-            {
-                if(scmpi(section.Keys[j].name, lpKey) == 0)
-                    return TRUE;
-            }
-        }
-    }
-
-    return FALSE;
+    return FindKey(lpSection, lpKey) != NULL;
 }
 
 
@@ -796,20 +968,16 @@ void  ConfigFile::SetKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
     {
         lpTemp -= 2;
 
-        XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-        file.Write("\xEF\xBB\xBF", 3);
-        file.WriteAsUTF8(&lpFileData[2], dwLength-4);
-        file.Write("\r\n[", 3);
-        file.WriteAsUTF8(lpSection, dwSectionNameSize);
-        file.Write("]\r\n", 3);
-        file.WriteAsUTF8(lpKey, dwKeyNameSize);
-        file.Write("=", 1);
-        file.WriteAsUTF8(newvalue, slen(newvalue));
-        file.Write("\r\n", 2);
-        file.Close();
-
-        if(LoadFile(XFILE_OPENEXISTING))
-            LoadData();
+        String strNewData;
+        AppendText(strNewData, &lpFileData[2], dwLength-4);
+        strNewData << TEXT("\r\n[");
+        AppendText(strNewData, lpSection, dwSectionNameSize);
+        strNewData << TEXT("]\r\n");
+        AppendText(strNewData, lpKey, dwKeyNameSize);
+        strNewData << TEXT("=");
+        AppendText(strNewData, newvalue, slen(newvalue));
+        strNewData << TEXT("\r\n");
+        SetData(strNewData);
         return;
     }
 
@@ -817,18 +985,14 @@ void  ConfigFile::SetKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
     {
         if(*lpTemp == '[')
         {
-            XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-            file.Write("\xEF\xBB\xBF", 3);
-            file.WriteAsUTF8(&lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
-            file.WriteAsUTF8(lpKey, dwKeyNameSize);
-            file.Write("=", 1);
-            file.WriteAsUTF8(newvalue, slen(newvalue));
-            file.Write("\r\n", 2);
-            file.WriteAsUTF8(lpSectionStart, slen(lpSectionStart)-2);
-            file.Close();
-
-            if(LoadFile(XFILE_OPENEXISTING))
-                LoadData();
+            String strNewData;
+            AppendText(strNewData, &lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
+            AppendText(strNewData, lpKey, dwKeyNameSize);
+            strNewData << TEXT("=");
+            AppendText(strNewData, newvalue, slen(newvalue));
+            strNewData << TEXT("\r\n");
+            AppendText(strNewData, lpSectionStart, slen(lpSectionStart)-2);
+            SetData(strNewData);
             return;
         }
         else if(*(LPWORD)lpTemp == '//')
@@ -848,28 +1012,12 @@ void  ConfigFile::SetKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
                 if ((*lpTemp == '\r' && *newvalue == '\0') || (lpNextLine - lpTemp == newlen && !scmp_n(lpTemp, newvalue, newlen)))
                     return;
 
-                String tmpFileName = strFileName;
-                tmpFileName += TEXT(".tmp");
+                String strNewData;
+                AppendText(strNewData, &lpFileData[2], DWORD(lpTemp - lpFileData - 2));
+                AppendText(strNewData, newvalue, newlen);
+                AppendText(strNewData, lpNextLine, slen(lpNextLine) - 2);
 
-                XFile file;
-                if (file.Open(tmpFileName, XFILE_WRITE, XFILE_CREATEALWAYS))
-                {
-                    if (file.Write("\xEF\xBB\xBF", 3) != 3)
-                        return;
-                    if (!file.WriteAsUTF8(&lpFileData[2], DWORD(lpTemp - lpFileData - 2)))
-                        return;
-                    if (!file.WriteAsUTF8(newvalue, slen(newvalue)))
-                        return;
-                    if (!file.WriteAsUTF8(lpNextLine, slen(lpNextLine) - 2))
-                        return;
-
-                    file.Close();
-                    if (!OSRenameFile(tmpFileName, strFileName))
-                        Log(TEXT("ConfigFile::SetKey: Unable to move new config file %s to %s"), tmpFileName.Array(), strFileName.Array());
-                }
-
-                if(LoadFile(XFILE_OPENEXISTING))
-                    LoadData();
+                SetData(strNewData);
                 return;
             }
         }
@@ -877,18 +1025,14 @@ void  ConfigFile::SetKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
         lpTemp = schr(lpTemp, '\n')+1;
     }while(lpTemp < lpEnd);
 
-    XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-    file.Write("\xEF\xBB\xBF", 3);
-    file.WriteAsUTF8(&lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
-    file.WriteAsUTF8(lpKey, dwKeyNameSize);
-    file.Write("=", 1);
-    file.WriteAsUTF8(newvalue, slen(newvalue));
-    file.Write("\r\n", 2);
-    file.WriteAsUTF8(lpSectionStart, slen(lpSectionStart)-2);
-    file.Close();
-
-    if(LoadFile(XFILE_OPENEXISTING))
-        LoadData();
+    String strNewData;
+    AppendText(strNewData, &lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
+    AppendText(strNewData, lpKey, dwKeyNameSize);
+    strNewData << TEXT("=");
+    AppendText(strNewData, newvalue, slen(newvalue));
+    strNewData << TEXT("\r\n");
+    AppendText(strNewData, lpSectionStart, slen(lpSectionStart)-2);
+    SetData(strNewData);
 }
 
 void  ConfigFile::Remove(CTSTR lpSection, CTSTR lpKey)
@@ -926,14 +1070,10 @@ void  ConfigFile::Remove(CTSTR lpSection, CTSTR lpKey)
             if((scmpi_n(lpTemp, lpKey, dwKeyNameSize) == 0) && (lpTemp[dwKeyNameSize] == '='))
             {
                 TSTR lpNextLine = schr(lpTemp, '\n')+1;
-                XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-                file.Write("\xEF\xBB\xBF", 3);
-                file.WriteAsUTF8(&lpFileData[2], DWORD(lpTemp-lpFileData-2));
-                file.WriteAsUTF8(lpNextLine, slen(lpNextLine)-2);
-                file.Close();
-
-                if(LoadFile(XFILE_OPENEXISTING))
-                    LoadData();
+                String strNewData;
+                AppendText(strNewData, &lpFileData[2], DWORD(lpTemp-lpFileData-2));
+                AppendText(strNewData, lpNextLine, slen(lpNextLine)-2);
+                SetData(strNewData);
                 return;
             }
         }
@@ -967,20 +1107,16 @@ void  ConfigFile::AddKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
 
     if(!bInSection)
     {
-        XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-        file.Write("\xEF\xBB\xBF", 3);
-        file.WriteAsUTF8(&lpFileData[2], dwLength-4);
-        file.Write("\r\n[", 3);
-        file.WriteAsUTF8(lpSection, dwSectionNameSize);
-        file.Write("]\r\n", 3);
-        file.WriteAsUTF8(lpKey, dwKeyNameSize);
-        file.Write("=", 1);
-        file.WriteAsUTF8(newvalue, slen(newvalue));
-        file.Write("\r\n", 2);
-        file.Close();
-
-        if(LoadFile(XFILE_OPENEXISTING))
-            LoadData();
+        String strNewData;
+        AppendText(strNewData, &lpFileData[2], dwLength-4);
+        strNewData << TEXT("\r\n[");
+        AppendText(strNewData, lpSection, dwSectionNameSize);
+        strNewData << TEXT("]\r\n");
+        AppendText(strNewData, lpKey, dwKeyNameSize);
+        strNewData << TEXT("=");
+        AppendText(strNewData, newvalue, slen(newvalue));
+        strNewData << TEXT("\r\n");
+        SetData(strNewData);
         return;
     }
 
@@ -990,18 +1126,14 @@ void  ConfigFile::AddKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
     {
         if(*lpTemp == '[')
         {
-            XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-            file.Write("\xEF\xBB\xBF", 3);
-            file.WriteAsUTF8(&lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
-            file.WriteAsUTF8(lpKey, dwKeyNameSize);
-            file.Write("=", 1);
-            file.WriteAsUTF8(newvalue, slen(newvalue));
-            file.Write("\r\n", 2);
-            file.WriteAsUTF8(lpSectionStart, slen(lpSectionStart)-2);
-            file.Close();
-
-            if(LoadFile(XFILE_OPENEXISTING))
-                LoadData();
+            String strNewData;
+            AppendText(strNewData, &lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
+            AppendText(strNewData, lpKey, dwKeyNameSize);
+            strNewData << TEXT("=");
+            AppendText(strNewData, newvalue, slen(newvalue));
+            strNewData << TEXT("\r\n");
+            AppendText(strNewData, lpSectionStart, slen(lpSectionStart)-2);
+            SetData(strNewData);
             return;
         }
         else if(*(LPWORD)lpTemp == '//')
@@ -1018,18 +1150,14 @@ void  ConfigFile::AddKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
             else if(lpLastItem)
             {
                 lpTemp = lpLastItem;
-                XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-                file.Write("\xEF\xBB\xBF", 3);
-                file.WriteAsUTF8(&lpFileData[2], DWORD(lpTemp-lpFileData-2));
-                file.WriteAsUTF8(lpKey, dwKeyNameSize);
-                file.Write("=", 1);
-                file.WriteAsUTF8(newvalue, slen(newvalue));
-                file.Write("\r\n", 2);
-                file.WriteAsUTF8(lpTemp, slen(lpTemp)-2);
-                file.Close();
-
-                if(LoadFile(XFILE_OPENEXISTING))
-                    LoadData();
+                String strNewData;
+                AppendText(strNewData, &lpFileData[2], DWORD(lpTemp-lpFileData-2));
+                AppendText(strNewData, lpKey, dwKeyNameSize);
+                strNewData << TEXT("=");
+                AppendText(strNewData, newvalue, slen(newvalue));
+                strNewData << TEXT("\r\n");
+                AppendText(strNewData, lpTemp, slen(lpTemp)-2);
+                SetData(strNewData);
                 return;
             }
         }
@@ -1037,16 +1165,12 @@ void  ConfigFile::AddKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue)
         lpTemp = schr(lpTemp, '\n')+1;
     }while(lpTemp < lpEnd);
 
-    XFile file(strFileName, XFILE_WRITE, XFILE_CREATEALWAYS);
-    file.Write("\xEF\xBB\xBF", 3);
-    file.WriteAsUTF8(&lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
-    file.WriteAsUTF8(lpKey, dwKeyNameSize);
-    file.Write("=", 1);
-    file.WriteAsUTF8(newvalue, slen(newvalue));
-    file.Write("\r\n", 2);
-    file.WriteAsUTF8(lpSectionStart, slen(lpSectionStart)-2);
-    file.Close();
-
-    if(LoadFile(XFILE_OPENEXISTING))
-        LoadData();
+    String strNewData;
+    AppendText(strNewData, &lpFileData[2], DWORD(lpSectionStart-lpFileData-2));
+    AppendText(strNewData, lpKey, dwKeyNameSize);
+    strNewData << TEXT("=");
+    AppendText(strNewData, newvalue, slen(newvalue));
+    strNewData << TEXT("\r\n");
+    AppendText(strNewData, lpSectionStart, slen(lpSectionStart)-2);
+    SetData(strNewData);
 }
@@ -27,6 +27,12 @@ struct ConfigKey
 {
     TSTR name;
     List<TSTR> ValueList;
+
+    //first value, parsed when the file is loaded
+    BOOL bValidInt;
+    int intValue;
+    DWORD hexValue;
+    float floatValue;
 };
 
 struct ConfigSection
@@ -35,17 +41,28 @@ struct ConfigSection
     List<ConfigKey> Keys;
 };
 
+struct ConfigKeyIndex
+{
+    UINT hash;
+    ConfigSection *section;
+    ConfigKey *key;
+};
+
 
 class BASE_EXPORT ConfigFile
 {
 public:
-    ConfigFile() : bOpen(0), strFileName(), lpFileData(NULL), dwLength(0) {}
+    ConfigFile() : bOpen(0), bDirty(0), strFileName(), lpFileData(NULL), dwLength(0) {}
     ~ConfigFile() {Close();}
 
     BOOL  Create(CTSTR lpConfigFile);
     BOOL  Open(CTSTR lpConfigFile, BOOL bOpenAlways=FALSE);
     void  Close();
 
+    //changes are saved in the background shortly after they're made, this writes them out now.
+    //call it before copying or moving the file.
+    void  Flush();
+
     BOOL  SaveAs(CTSTR lpPath);
     inline CTSTR GetFilePath() const {return strFileName;}
     void  SetFilePath(CTSTR lpPath);
@@ -96,12 +113,19 @@ public:
 private:
     BOOL  LoadFile(DWORD dwOpenMode);
     void  LoadData();
+    void  FreeData();
+    void  BuildIndex();
+    ConfigKey* FindKey(CTSTR lpSection, CTSTR lpKey);
+    void  SetData(const String &strNewData);
+    BOOL  WriteData(CTSTR lpPath);
     void  SetKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue);
     void  AddKey(CTSTR lpSection, CTSTR lpKey, CTSTR newvalue);
 
     List<ConfigSection> Sections;
+    List<ConfigKeyIndex> KeyIndex;
 
     BOOL  bOpen;
+    BOOL  bDirty;
     String strFileName;
     TSTR lpFileData;
     DWORD dwLength;
@@ -0,0 +1,283 @@
+/********************************************************************************
+ Copyright (C) 2001-2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "XT.h"
+#include <intrin.h>
+
+
+#define METRIC_SUB_BUCKETS  (1<<METRIC_HISTOGRAM_SUB_BITS)
+
+HANDLE hMetricsMutex = NULL;
+
+struct MetricEntry
+{
+    String strName;
+    MetricType type;
+    void *metric;
+};
+
+static List<MetricEntry*> metricList;
+
+//-----------------------------------------
+//histogram buckets: values below METRIC_SUB_BUCKETS get a bucket each, after that every
+//power of two is split into METRIC_SUB_BUCKETS equal parts
+
+static inline UINT GetBucketIndex(DWORD val)
+{
+    if(val < METRIC_SUB_BUCKETS)
+        return val;
+
+    DWORD msb;
+    _BitScanReverse(&msb, val);
+
+    UINT shift = msb-METRIC_HISTOGRAM_SUB_BITS;
+    return ((shift+1)<<METRIC_HISTOGRAM_SUB_BITS) + ((val>>shift) & (METRIC_SUB_BUCKETS-1));
+}
+
+static inline DWORD GetBucketHighestValue(UINT index)
+{
+    if(index < METRIC_SUB_BUCKETS)
+        return index;
+
+    UINT shift = (index>>METRIC_HISTOGRAM_SUB_BITS)-1;
+    QWORD lowest = QWORD(METRIC_SUB_BUCKETS + (index & (METRIC_SUB_BUCKETS-1))) << shift;
+    return DWORD(lowest + (QWORD(1)<<shift) - 1);
+}
+
+void MetricHistogram::Record(DWORD val)
+{
+    buckets[GetBucketIndex(val)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(val, std::memory_order_relaxed);
+
+    DWORD curMax = maxValue.load(std::memory_order_relaxed);
+    while(val > curMax && !maxValue.compare_exchange_weak(curMax, val, std::memory_order_relaxed));
+}
+
+double MetricHistogram::Mean() const
+{
+    QWORD num = count.load(std::memory_order_relaxed);
+    return num ? double(total.load(std::memory_order_relaxed))/double(num) : 0.0;
+}
+
+DWORD MetricHistogram::ValueAtPercentile(double percentile) const
+{
+    QWORD num = count.load(std::memory_order_relaxed);
+    if(!num)
+        return 0;
+
+    QWORD target = QWORD(ceil(double(num)*percentile*0.01));
+    if(target < 1)
+        target = 1;
+
+    DWORD curMax = maxValue.load(std::memory_order_relaxed);
+
+    QWORD cumulative = 0;
+    for(UINT i=0; i<METRIC_HISTOGRAM_BUCKETS; i++)
+    {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        if(cumulative >= target)
+            return MIN(GetBucketHighestValue(i), curMax);
+    }
+
+    return curMax;
+}
+
+void MetricHistogram::Reset()
+{
+    for(UINT i=0; i<METRIC_HISTOGRAM_BUCKETS; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+//-----------------------------------------
+
+static void* GetMetric(CTSTR lpName, MetricType type)
+{
+    void *metric = NULL;
+
+    OSEnterMutex(hMetricsMutex);
+
+    for(UINT i=0; i<metricList.Num(); i++)
+    {
+        MetricEntry *entry = metricList[i];
+        if(entry->type == type && entry->strName.Compare(lpName))
+        {
+            metric = entry->metric;
+            break;
+        }
+    }
+
+    if(!metric)
+    {
+        switch(type)
+        {
+            case MetricType_Counter:    metric = new MetricCounter; break;
+            case MetricType_Gauge:      metric = new MetricGauge; break;
+            case MetricType_Histogram:  metric = new MetricHistogram; break;
+        }
+
+        MetricEntry *entry = new MetricEntry;
+        entry->strName = lpName;
+        entry->type = type;
+        entry->metric = metric;
+        metricList << entry;
+    }
+
+    OSLeaveMutex(hMetricsMutex);
+
+    return metric;
+}
+
+MetricCounter* STDCALL GetMetricCounter(CTSTR lpName)
+{
+    return (MetricCounter*)GetMetric(lpName, MetricType_Counter);
+}
+
+MetricGauge* STDCALL GetMetricGauge(CTSTR lpName)
+{
+    return (MetricGauge*)GetMetric(lpName, MetricType_Gauge);
+}
+
+MetricHistogram* STDCALL GetMetricHistogram(CTSTR lpName)
+{
+    return (MetricHistogram*)GetMetric(lpName, MetricType_Histogram);
+}
+
+void STDCALL GetMetricStats(List<MetricStats> &stats)
+{
+    OSEnterMutex(hMetricsMutex);
+
+    stats.SetSize(metricList.Num());
+
+    for(UINT i=0; i<metricList.Num(); i++)
+    {
+        MetricEntry *entry = metricList[i];
+        MetricStats &stat = stats[i];
+
+        zero(&stat, sizeof(stat));
+        stat.lpName = entry->strName;
+        stat.type = entry->type;
+
+        switch(entry->type)
+        {
+            case MetricType_Counter:
+                stat.value = ((MetricCounter*)entry->metric)->Value();
+                break;
+
+            case MetricType_Gauge:
+                {
+                    MetricGauge *gauge = (MetricGauge*)entry->metric;
+                    stat.value = gauge->Value();
+                    stat.maxValue = gauge->MaxValue();
+                    break;
+                }
+
+            case MetricType_Histogram:
+                {
+                    MetricHistogram *histogram = (MetricHistogram*)entry->metric;
+                    stat.value = histogram->Count();
+                    stat.maxValue = histogram->MaxValue();
+                    stat.p50 = histogram->ValueAtPercentile(50.0);
+                    stat.p99 = histogram->ValueAtPercentile(99.0);
+                    stat.mean = histogram->Mean();
+                    break;
+                }
+        }
+    }
+
+    OSLeaveMutex(hMetricsMutex);
+}
+
+void STDCALL LogMetricStats()
+{
+    List<MetricStats> stats;
+    GetMetricStats(stats);
+
+    if(!stats.Num())
+        return;
+
+    Log(TEXT("\r\nPipeline stats:"));
+    Log(TEXT("=============================================================="));
+    for(UINT i=0; i<stats.Num(); i++)
+    {
+        MetricStats &stat = stats[i];
+
+        switch(stat.type)
+        {
+            case MetricType_Counter:
+                Log(TEXT("%s - [total: %llu]"), stat.lpName, stat.value);
+                break;
+
+            case MetricType_Gauge:
+                Log(TEXT("%s - [current: %llu] [max: %llu]"), stat.lpName, stat.value, stat.maxValue);
+                break;
+
+            case MetricType_Histogram:
+                if(stat.value)
+                    Log(TEXT("%s - [samples: %llu] [p50: %g ms] [p99: %g ms] [max: %g ms] [avg: %g ms]"), stat.lpName, stat.value,
+                        double(stat.p50)*0.001, double(stat.p99)*0.001, double(stat.maxValue)*0.001, stat.mean*0.001);
+                break;
+        }
+    }
+    Log(TEXT("==============================================================\r\n"));
+}
+
+void STDCALL ResetMetrics()
+{
+    OSEnterMutex(hMetricsMutex);
+
+    for(UINT i=0; i<metricList.Num(); i++)
+    {
+        MetricEntry *entry = metricList[i];
+
+        switch(entry->type)
+        {
+            case MetricType_Counter:    ((MetricCounter*)entry->metric)->Reset(); break;
+            case MetricType_Gauge:      ((MetricGauge*)entry->metric)->Reset(); break;
+            case MetricType_Histogram:  ((MetricHistogram*)entry->metric)->Reset(); break;
+        }
+    }
+
+    OSLeaveMutex(hMetricsMutex);
+}
+
+void STDCALL FreeMetrics()
+{
+    OSEnterMutex(hMetricsMutex);
+
+    for(UINT i=0; i<metricList.Num(); i++)
+    {
+        MetricEntry *entry = metricList[i];
+
+        switch(entry->type)
+        {
+            case MetricType_Counter:    delete (MetricCounter*)entry->metric; break;
+            case MetricType_Gauge:      delete (MetricGauge*)entry->metric; break;
+            case MetricType_Histogram:  delete (MetricHistogram*)entry->metric; break;
+        }
+
+        delete entry;
+    }
+    metricList.Clear();
+
+    OSLeaveMutex(hMetricsMutex);
+}
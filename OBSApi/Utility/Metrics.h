@@ -0,0 +1,110 @@
+/********************************************************************************
+ Copyright (C) 2001-2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+//16 linear sub-buckets per power of two, so any recorded value is within about 6% of its bucket
+#define METRIC_HISTOGRAM_SUB_BITS   4
+#define METRIC_HISTOGRAM_BUCKETS    ((32-METRIC_HISTOGRAM_SUB_BITS+1)<<METRIC_HISTOGRAM_SUB_BITS)
+
+enum MetricType
+{
+    MetricType_Counter,
+    MetricType_Gauge,
+    MetricType_Histogram
+};
+
+struct MetricStats
+{
+    CTSTR lpName;
+    MetricType type;
+    QWORD value;        //counter total, current gauge value, or number of histogram samples
+    QWORD maxValue;     //gauge high-water mark or largest histogram sample
+    QWORD p50, p99;     //histograms only
+    double mean;        //histograms only
+};
+
+//all metrics are safe to update from any thread without locking
+
+class BASE_EXPORT MetricCounter
+{
+    std::atomic<QWORD> value;
+
+public:
+    inline void Add(QWORD num=1)    {value.fetch_add(num, std::memory_order_relaxed);}
+    inline QWORD Value() const      {return value.load(std::memory_order_relaxed);}
+    inline void Reset()             {value.store(0, std::memory_order_relaxed);}
+};
+
+class BASE_EXPORT MetricGauge
+{
+    std::atomic<QWORD> value, maxValue;
+
+public:
+    inline void Set(QWORD val)
+    {
+        value.store(val, std::memory_order_relaxed);
+
+        QWORD curMax = maxValue.load(std::memory_order_relaxed);
+        while(val > curMax && !maxValue.compare_exchange_weak(curMax, val, std::memory_order_relaxed));
+    }
+
+    inline QWORD Value() const      {return value.load(std::memory_order_relaxed);}
+    inline QWORD MaxValue() const   {return maxValue.load(std::memory_order_relaxed);}
+    inline void Reset()             {value.store(0, std::memory_order_relaxed); maxValue.store(0, std::memory_order_relaxed);}
+};
+
+//log-linear (hdr style) histogram of 32bit values, normally microseconds
+class BASE_EXPORT MetricHistogram
+{
+    std::atomic<DWORD> buckets[METRIC_HISTOGRAM_BUCKETS];
+    std::atomic<QWORD> count, total;
+    std::atomic<DWORD> maxValue;
+
+public:
+    void Record(DWORD val);
+
+    inline QWORD Count() const      {return count.load(std::memory_order_relaxed);}
+    inline DWORD MaxValue() const   {return maxValue.load(std::memory_order_relaxed);}
+    double Mean() const;
+    DWORD ValueAtPercentile(double percentile) const;
+
+    void Reset();
+};
+
+//records the microseconds between construction and destruction
+class MetricTimer
+{
+    MetricHistogram *histogram;
+    QWORD startTime;
+
+public:
+    inline MetricTimer(MetricHistogram *histogram) : histogram(histogram), startTime(OSGetTimeMicroseconds()) {}
+    inline ~MetricTimer() {histogram->Record(DWORD(OSGetTimeMicroseconds()-startTime));}
+};
+
+//metrics live until the program exits, so the returned pointers can be kept.  asking for an
+//existing name returns the same metric.
+BASE_EXPORT MetricCounter*   STDCALL GetMetricCounter(CTSTR lpName);
+BASE_EXPORT MetricGauge*     STDCALL GetMetricGauge(CTSTR lpName);
+BASE_EXPORT MetricHistogram* STDCALL GetMetricHistogram(CTSTR lpName);
+
+BASE_EXPORT void STDCALL GetMetricStats(List<MetricStats> &stats);
+BASE_EXPORT void STDCALL LogMetricStats();
+BASE_EXPORT void STDCALL ResetMetrics();
@@ -17,12 +17,25 @@
 ********************************************************************************/
 
 
+#define WINVER         0x0600
+#define _WIN32_WINDOWS 0x0600
+#define _WIN32_WINNT   0x0600
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #include "XT.h"
 
 
 // This is loosely based on the hierarchical profiling method from Game Programming Gems 3 by Greg Hjelstrom & Byon Garrabrant.
 
+//profiled threads never lock: each scope is pushed to a buffer owned by its thread when it ends,
+//and the collector thread drains the buffers every PROFILE_COLLECT_INTERVAL ms into the profile
+//tree (and the trace file if one is open).  hProfilerMutex is only taken by the collector, the
+//dump functions, and by a thread the first time it records anything.
 
+#define PROFILE_EVENT_BUFFER_SIZE   16384   //events per thread, 512k
+#define PROFILE_COLLECT_INTERVAL    100
+#define PROFILE_MAX_DEPTH           64
+#define PROFILE_CALIBRATION_SCOPES  4096
 
 
 inline double MicroToMS(DWORD microseconds)
@@ -33,6 +46,75 @@ inline double MicroToMS(DWORD microseconds)
 float minPercentage, minTime;
 HANDLE hProfilerMutex = NULL;
 
+//-----------------------------------------
+//per-thread data, only ever modified by the owning thread
+
+struct ProfilePathNode
+{
+    CTSTR lpName;
+    ProfilePathNode *parent;
+    bool bSingular;
+
+    List<ProfilePathNode*> Children;
+
+    void FreeData()
+    {
+        for(UINT i=0; i<Children.Num(); i++)
+        {
+            Children[i]->FreeData();
+            delete Children[i];
+        }
+        Children.Clear();
+    }
+
+    ProfilePathNode* GetSubPath(CTSTR lpName, bool bSingular)
+    {
+        for(UINT i=0; i<Children.Num(); i++)
+        {
+            if(Children[i]->lpName == lpName)
+                return Children[i];
+        }
+
+        ProfilePathNode *node = new ProfilePathNode;
+        node->lpName = lpName;
+        node->parent = this;
+        node->bSingular = bSingular;
+        Children << node;
+
+        return node;
+    }
+};
+
+struct ProfileEvent
+{
+    ProfilePathNode *path;
+    QWORD startTime;
+    DWORD timeElapsed;
+    DWORD cpuTimeElapsed;
+    DWORD parallelCalls;
+    bool bHasCpuTime;
+};
+
+struct ProfileThreadData
+{
+    SPSCQueue<ProfileEvent> events;
+    ProfilePathNode rootPath;           //children are this thread's root scopes
+    DWORD threadID;
+    DWORD numDropped;                   //owning thread only
+    DWORD numDroppedLogged;             //collector only
+    std::atomic<bool> bExited;
+    bool bTraceNamed;
+    ProfileThreadData *next;
+
+    void FreeData()
+    {
+        rootPath.FreeData();
+        events.Clear();
+        numDropped = numDroppedLogged = 0;
+        bTraceNamed = false;
+    }
+};
+
 
 struct BASE_EXPORT ProfileNodeInfo
 {
@@ -199,65 +281,329 @@ struct BASE_EXPORT ProfileNodeInfo
         return NULL;
     }
 
-    static void MergeProfileInfo(ProfileNodeInfo &info)
+    static List<ProfileNodeInfo> profilerData;
+};
+
+
+static __declspec(thread) ProfilerNode *__curProfilerNode = NULL;
+static __declspec(thread) ProfileThreadData *curThreadData = NULL;
+static __declspec(thread) DWORD curThreadGeneration = 0;
+BOOL bProfilingEnabled = FALSE;
+List<ProfileNodeInfo> ProfileNodeInfo::profilerData;
+
+static ProfileThreadData *profileThreads = NULL;
+static ProfileThreadData *idleProfileThreads = NULL;
+static DWORD profilerGeneration = 1;
+static DWORD profilerFlsIndex = FLS_OUT_OF_INDEXES;
+static HANDLE hCollectorThread = NULL;
+static HANDLE hCollectorStop = NULL;
+static double scopeOverhead = 0.0;
+
+static XFile traceFile;
+static bool bTraceHasEvents = false;
+
+//-----------------------------------------
+//thread registration
+
+static void WINAPI ProfilerThreadExit(void *param)
+{
+    ProfileThreadData *data = (ProfileThreadData*)param;
+    if(data)
+        data->bExited.store(true, std::memory_order_release);
+}
+
+static ProfileThreadData* GetProfileThreadData()
+{
+    if(curThreadData && curThreadGeneration == profilerGeneration)
+        return curThreadData;
+
+    OSEnterMutex(hProfilerMutex);
+
+    ProfileThreadData *data = idleProfileThreads;
+    if(data)
+        idleProfileThreads = data->next;
+    else
     {
-        OSEnterMutex(hProfilerMutex);
-        ProfileNodeInfo *sum = FindProfile(info.lpName);
-        if(!sum)
+        data = new ProfileThreadData;
+        data->events.SetCapacity(PROFILE_EVENT_BUFFER_SIZE);
+    }
+
+    data->threadID = GetCurrentThreadId();
+    data->bExited.store(false, std::memory_order_relaxed);
+    data->next = profileThreads;
+    profileThreads = data;
+
+    curThreadGeneration = profilerGeneration;
+
+    OSLeaveMutex(hProfilerMutex);
+
+    if(profilerFlsIndex != FLS_OUT_OF_INDEXES)
+        FlsSetValue(profilerFlsIndex, data);
+
+    curThreadData = data;
+    return data;
+}
+
+static void FreeProfileThreadList(ProfileThreadData *&list)
+{
+    while(list)
+    {
+        ProfileThreadData *next = list->next;
+        list->rootPath.FreeData();
+        delete list;
+        list = next;
+    }
+}
+
+//-----------------------------------------
+//collection, always called with hProfilerMutex held
+
+static ProfileNodeInfo* GetProfileInfo(ProfilePathNode *path, ProfileNodeInfo *&rootInfo)
+{
+    ProfilePathNode *chain[PROFILE_MAX_DEPTH];
+    UINT depth = 0;
+
+    for(; path->parent; path = path->parent)
+    {
+        if(depth == PROFILE_MAX_DEPTH)
+            return NULL;
+        chain[depth++] = path;
+    }
+
+    ProfilePathNode *rootPath = chain[depth-1];
+
+    ProfileNodeInfo *info = ProfileNodeInfo::FindProfile(rootPath->lpName);
+    if(!info)
+    {
+        info = ProfileNodeInfo::profilerData.CreateNew();
+        info->lpName = rootPath->lpName;
+    }
+
+    rootInfo = info;
+
+    for(int i=int(depth)-2; i>=0; i--)
+    {
+        ProfileNodeInfo *child = info->FindSubProfile(chain[i]->lpName);
+        if(!child)
         {
-            sum = profilerData.CreateNew();
-            sum->lpName = info.lpName;
+            child = info->Children.CreateNew();
+            child->lpName = chain[i]->lpName;
+            child->bSingular = chain[i]->bSingular;
         }
-        sum->MergeProfileInfo(&info, info.lastCall, sum->lastCall + info.lastCall);
-        OSLeaveMutex(hProfilerMutex);
+
+        info = child;
     }
 
-    void MergeProfileInfo(ProfileNodeInfo *info, DWORD rootLastCall, DWORD updatedLastCall)
+    return info;
+}
+
+static void MergeProfileEvent(const ProfileEvent &event)
+{
+    ProfileNodeInfo *rootInfo;
+    ProfileNodeInfo *info = GetProfileInfo(event.path, rootInfo);
+    if(!info)
+        return;
+
+    //scopes end before their root does, so the root's count for this call hasn't been added yet
+    ++info->numCalls;
+    info->lastCall = (info == rootInfo) ? info->numCalls : rootInfo->numCalls+1;
+
+    info->totalTimeElapsed += event.timeElapsed;
+    info->lastTimeElapsed = event.timeElapsed;
+    if(event.bHasCpuTime)
+    {
+        info->cpuTimeElapsed += event.cpuTimeElapsed;
+        info->lastCpuTimeElapsed = event.cpuTimeElapsed;
+    }
+    info->numParallelCalls = event.parallelCalls;
+}
+
+static void AppendTraceName(String &strTrace, CTSTR lpName)
+{
+    for(; *lpName; lpName++)
+    {
+        if(*lpName == '"' || *lpName == '\\')
+            strTrace << TCHAR('\\');
+        strTrace << *lpName;
+    }
+}
+
+static void AppendTraceEvent(String &strTrace, ProfileThreadData *data, const ProfileEvent &event)
+{
+    if(!data->bTraceNamed && event.path->parent == &data->rootPath)
+    {
+        strTrace << (bTraceHasEvents ? TEXT(",\r\n") : TEXT("")) << TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":") << UIntString(data->threadID) << TEXT(",\"args\":{\"name\":\"");
+        AppendTraceName(strTrace, event.path->lpName);
+        strTrace << TEXT("\"}}");
+
+        data->bTraceNamed = true;
+        bTraceHasEvents = true;
+    }
+
+    strTrace << (bTraceHasEvents ? TEXT(",\r\n") : TEXT("")) << TEXT("{\"name\":\"");
+    AppendTraceName(strTrace, event.path->lpName);
+    strTrace << FormattedString(TEXT("\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":0,\"tid\":%u"), event.startTime, event.timeElapsed, data->threadID);
+    if(event.bHasCpuTime)
+        strTrace << FormattedString(TEXT(",\"args\":{\"cpu\":%u}"), event.cpuTimeElapsed);
+    strTrace << TEXT("}");
+
+    bTraceHasEvents = true;
+}
+
+static void CollectProfileEvents()
+{
+    String strTrace;
+    bool bTracing = traceFile.IsOpen() != 0;
+
+    ProfileThreadData **prev = &profileThreads;
+    while(ProfileThreadData *data = *prev)
     {
-        bSingular = info->bSingular;
-        numCalls += info->numCalls;
-        if(lastCall == rootLastCall) lastCall = updatedLastCall;
-        totalTimeElapsed += info->totalTimeElapsed;
-        lastTimeElapsed = info->lastTimeElapsed;
-        cpuTimeElapsed += info->cpuTimeElapsed;
-        lastCpuTimeElapsed = info->lastCpuTimeElapsed;
-        numParallelCalls = info->numParallelCalls;
-        for(UINT i = 0; i < info->Children.Num(); i++)
+        //read before draining so nothing the thread pushed on its way out is missed
+        bool bExited = data->bExited.load(std::memory_order_acquire);
+
+        while(ProfileEvent *event = data->events.Peek())
         {
-            ProfileNodeInfo &child = info->Children[i];
-            ProfileNodeInfo *sumChild = FindSubProfile(child.lpName);
-            if(!sumChild)
-            {
-                sumChild = Children.CreateNew();
-                sumChild->lpName = child.lpName;
-            }
-            sumChild->MergeProfileInfo(&child, rootLastCall, updatedLastCall);
+            MergeProfileEvent(*event);
+            if(bTracing)
+                AppendTraceEvent(strTrace, data, *event);
+            data->events.Pop();
+        }
+
+        DWORD numDropped = data->numDropped;
+        if(numDropped != data->numDroppedLogged)
+        {
+            Log(TEXT("Profiler: %u events dropped on thread %u, its buffer was full"), numDropped-data->numDroppedLogged, data->threadID);
+            data->numDroppedLogged = numDropped;
         }
+
+        if(bExited)
+        {
+            *prev = data->next;
+
+            data->FreeData();
+            data->next = idleProfileThreads;
+            idleProfileThreads = data;
+        }
+        else
+            prev = &data->next;
     }
 
-    static List<ProfileNodeInfo> profilerData;
-};
+    if(strTrace.IsValid())
+        traceFile.WriteAsUTF8(strTrace, strTrace.Length());
+}
 
+static DWORD STDCALL ProfileCollectorThread(LPVOID param)
+{
+    while(!OSWaitForEvent(hCollectorStop, PROFILE_COLLECT_INTERVAL))
+    {
+        OSEnterMutex(hProfilerMutex);
+        CollectProfileEvents();
+        OSLeaveMutex(hProfilerMutex);
+    }
 
-static __declspec(thread) ProfilerNode *__curProfilerNode = NULL;
-BOOL bProfilingEnabled = FALSE;
-List<ProfileNodeInfo> ProfileNodeInfo::profilerData;
+    return 0;
+}
+
+//times empty scopes on this thread with a private buffer, so the results never reach the profile data
+static void MeasureScopeOverhead()
+{
+    ProfileThreadData *scratch = new ProfileThreadData;
+    scratch->events.SetCapacity(PROFILE_CALIBRATION_SCOPES);
 
+    ProfileThreadData *prevData = curThreadData;
+    DWORD prevGeneration = curThreadGeneration;
+    ProfilerNode *prevNode = __curProfilerNode;
+
+    curThreadData = scratch;
+    curThreadGeneration = profilerGeneration;
+    __curProfilerNode = NULL;
+
+    QWORD startTime = OSGetTimeMicroseconds();
+    for(UINT i=0; i<PROFILE_CALIBRATION_SCOPES; i++)
+    {
+        profileSegment("Profiler calibration");
+    }
+    QWORD totalTime = OSGetTimeMicroseconds()-startTime;
+
+    curThreadData = prevData;
+    curThreadGeneration = prevGeneration;
+    __curProfilerNode = prevNode;
+
+    scratch->rootPath.FreeData();
+    delete scratch;
+
+    scopeOverhead = double(totalTime)/double(PROFILE_CALIBRATION_SCOPES);
+}
+
+//-----------------------------------------
 
 void STDCALL EnableProfiling(BOOL bEnable, float pminPercentage, float pminTime)
 {
-    //if(engine && !engine->InEditor())
-    bProfilingEnabled = bEnable;
-
     minPercentage = pminPercentage;
     minTime = pminTime;
+
+    if(bEnable && !hCollectorThread)
+    {
+        if(profilerFlsIndex == FLS_OUT_OF_INDEXES)
+        {
+            profilerFlsIndex = FlsAlloc(ProfilerThreadExit);
+            if(profilerFlsIndex == FLS_OUT_OF_INDEXES)
+                CrashError(TEXT("EnableProfiling: Could not allocate a fiber local storage index"));
+        }
+
+        hCollectorStop = OSCreateEvent(TRUE);
+        hCollectorThread = OSCreateThread((XTHREAD)ProfileCollectorThread, NULL);
+
+        bProfilingEnabled = TRUE;
+        MeasureScopeOverhead();
+    }
+    else if(!bEnable && hCollectorThread)
+    {
+        bProfilingEnabled = FALSE;
+
+        OSSignalEvent(hCollectorStop);
+        OSWaitForThread(hCollectorThread, NULL);
+        OSCloseThread(hCollectorThread);
+        OSCloseEvent(hCollectorStop);
+        hCollectorThread = hCollectorStop = NULL;
+
+        OSEnterMutex(hProfilerMutex);
+        CollectProfileEvents();
+        OSLeaveMutex(hProfilerMutex);
+    }
+
+    bProfilingEnabled = bEnable;
+}
+
+void STDCALL ShutdownProfiler()
+{
+    EnableProfiling(FALSE);
+    StopProfileTrace();
+
+    //calls ProfilerThreadExit for every thread still holding data
+    if(profilerFlsIndex != FLS_OUT_OF_INDEXES)
+    {
+        FlsFree(profilerFlsIndex);
+        profilerFlsIndex = FLS_OUT_OF_INDEXES;
+    }
+
+    OSEnterMutex(hProfilerMutex);
+    FreeProfileThreadList(profileThreads);
+    FreeProfileThreadList(idleProfileThreads);
+    ++profilerGeneration;
+    OSLeaveMutex(hProfilerMutex);
 }
 
 void STDCALL DumpProfileData()
 {
+    OSEnterMutex(hProfilerMutex);
+    CollectProfileEvents();
+
     if(ProfileNodeInfo::profilerData.Num())
     {
-        Log(TEXT("\r\nProfiler time results:\r\n"));
+        Log(TEXT("\r\nProfiler time results (profiler overhead: %g ms per scope):\r\n"), scopeOverhead*0.001);
+        if(scopeOverhead > PROFILE_SCOPE_BUDGET)
+            Log(TEXT("Profiler: scope overhead is above the %g ms budget, short scopes will read high"), PROFILE_SCOPE_BUDGET*0.001);
         Log(TEXT("=============================================================="));
         for(unsigned int i=0; i<ProfileNodeInfo::profilerData.Num(); i++)
             ProfileNodeInfo::profilerData[i].dumpData(ProfileNodeInfo::profilerData[i].numCalls);
@@ -268,10 +614,15 @@ void STDCALL DumpProfileData()
             ProfileNodeInfo::profilerData[i].dumpCPUData(ProfileNodeInfo::profilerData[i].numCalls);
         Log(TEXT("==============================================================\r\n"));
     }
+
+    OSLeaveMutex(hProfilerMutex);
 }
 
 void STDCALL DumpLastProfileData()
 {
+    OSEnterMutex(hProfilerMutex);
+    CollectProfileEvents();
+
     if(ProfileNodeInfo::profilerData.Num())
     {
         Log(TEXT("\r\nProfiler result for the last frame:"));
@@ -280,16 +631,70 @@ void STDCALL DumpLastProfileData()
             ProfileNodeInfo::profilerData[i].dumpLastData(ProfileNodeInfo::profilerData[i].lastCall);
         Log(TEXT("==============================================================\r\n"));
     }
+
+    OSLeaveMutex(hProfilerMutex);
 }
 
 void STDCALL FreeProfileData()
 {
+    OSEnterMutex(hProfilerMutex);
+
+    //drain first so scopes from before the free don't show up afterward
+    CollectProfileEvents();
+
     for(unsigned int i=0; i<ProfileNodeInfo::profilerData.Num(); i++)
         ProfileNodeInfo::profilerData[i].FreeData();
     ProfileNodeInfo::profilerData.Clear();
+
+    OSLeaveMutex(hProfilerMutex);
+}
+
+BOOL STDCALL StartProfileTrace(CTSTR lpFile)
+{
+    OSEnterMutex(hProfilerMutex);
+
+    //anything recorded before the trace started stays out of it
+    CollectProfileEvents();
+
+    if(traceFile.IsOpen())
+    {
+        traceFile.WriteAsUTF8(TEXT("\r\n]}\r\n"));
+        traceFile.Close();
+    }
+
+    BOOL bSuccess = traceFile.Open(lpFile, XFILE_WRITE, XFILE_CREATEALWAYS);
+    if(bSuccess)
+    {
+        traceFile.WriteAsUTF8(TEXT("{\"traceEvents\":[\r\n"));
+        bTraceHasEvents = false;
+
+        for(ProfileThreadData *data = profileThreads; data; data = data->next)
+            data->bTraceNamed = false;
+    }
+    else
+        AppWarning(TEXT("StartProfileTrace: Could not open '%s' for writing"), lpFile);
+
+    OSLeaveMutex(hProfilerMutex);
+
+    return bSuccess;
 }
 
-ProfilerNode::ProfilerNode(CTSTR lpName, bool bSingularize) : lpName(nullptr), parent(nullptr), info(nullptr)
+void STDCALL StopProfileTrace()
+{
+    OSEnterMutex(hProfilerMutex);
+
+    if(traceFile.IsOpen())
+    {
+        CollectProfileEvents();
+
+        traceFile.WriteAsUTF8(TEXT("\r\n]}\r\n"));
+        traceFile.Close();
+    }
+
+    OSLeaveMutex(hProfilerMutex);
+}
+
+ProfilerNode::ProfilerNode(CTSTR lpName, bool bSingularize) : lpName(nullptr), parent(nullptr), path(nullptr), threadData(nullptr)
 {
     parent = __curProfilerNode;
 
@@ -307,39 +712,22 @@ ProfilerNode::ProfilerNode(CTSTR lpName, bool bSingularize) : lpName(nullptr), p
     if(parent)
     {
         if(!parent->lpName) return; //profiling was disabled when parent was created, so exit to avoid inconsistent results
-        ProfileNodeInfo *parentInfo = parent->info;
-        if(parentInfo)
-        {
-            info = parentInfo->FindSubProfile(lpName);
-            if(!info)
-            {
-                info = parentInfo->Children.CreateNew();
-                info->lpName = lpName;
-                info->bSingular = bSingularNode;
-            }
-        }
+        threadData = parent->threadData;
+        path = parent->path->GetSubPath(lpName, bSingularNode);
     }
     else if(bProfilingEnabled)
     {
-        info = new ProfileNodeInfo;
-        info->lpName = lpName;
+        threadData = GetProfileThreadData();
+        path = threadData->rootPath.GetSubPath(lpName, false);
     }
     else
         return;
 
-    if (info)
-    {
-        ++info->numCalls;
-        if(!parent)
-            info->lastCall = info->numCalls;
-        else
-            info->lastCall = parent->info->numCalls;
-    }
-
     this->lpName = lpName;
 
     startTime = OSGetTimeMicroseconds();
 
+    thread = NULL;
     MonitorThread(OSGetCurrentThread());
 
     parallelCalls = 1;
@@ -352,26 +740,24 @@ ProfilerNode::~ProfilerNode()
     {
         QWORD newTime = OSGetTimeMicroseconds();
 
-        DWORD curTime = (DWORD)(newTime-startTime);
-        info->totalTimeElapsed += curTime;
-        info->lastTimeElapsed = curTime;
-        if(thread)
+        ProfileEvent *event = threadData->events.BeginPush();
+        if(event)
         {
-            DWORD cpuTime = DWORD(OSGetThreadTime(thread) - cpuStartTime);
-            info->cpuTimeElapsed += cpuTime;
-            info->lastCpuTimeElapsed = cpuTime;
+            event->path = path;
+            event->startTime = startTime;
+            event->timeElapsed = (DWORD)(newTime-startTime);
+            event->bHasCpuTime = (thread != NULL);
+            event->cpuTimeElapsed = thread ? DWORD(OSGetThreadTime(thread) - cpuStartTime) : 0;
+            event->parallelCalls = parallelCalls;
+
+            threadData->events.EndPush();
         }
-        info->numParallelCalls = parallelCalls;
+        else
+            ++threadData->numDropped;
     }
 
     if(!bSingularNode)
         __curProfilerNode = parent;
-
-    if(!parent && info)
-    {
-        ProfileNodeInfo::MergeProfileInfo(*info);
-        delete info;
-    }
 }
 
 void ProfilerNode::MonitorThread(HANDLE thread_)
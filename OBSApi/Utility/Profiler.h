@@ -21,8 +21,11 @@
 
 #pragma once
 
-struct ProfileNodeInfo;
+struct ProfilePathNode;
+struct ProfileThreadData;
 
+//scopes are written to a lock-free buffer owned by the thread that ran them, and a
+//collector thread merges those into the profile tree off the profiled threads
 class BASE_EXPORT ProfilerNode
 {
     CTSTR lpName;
@@ -32,7 +35,8 @@ class BASE_EXPORT ProfilerNode
     HANDLE thread;
     ProfilerNode *parent;
     bool bSingularNode;
-    ProfileNodeInfo *info;
+    ProfilePathNode *path;
+    ProfileThreadData *threadData;
 
 public:
     ProfilerNode(CTSTR name, bool bSingularize=false);
@@ -44,6 +48,10 @@ public:
 //BASE_EXPORT extern ProfilerNode *__curProfilerNode;
 BASE_EXPORT extern BOOL bProfilingEnabled;
 
+//microseconds a scope may cost.  DumpProfileData warns when the measured overhead is above it,
+//and ApiBench's profiler bench fails
+#define PROFILE_SCOPE_BUDGET 1.0
+
 #define ENABLE_PROFILING 1
 
 #ifdef ENABLE_PROFILING
@@ -66,3 +74,7 @@ BASE_EXPORT void STDCALL EnableProfiling(BOOL bEnable, float minPercentage=0.0f,
 BASE_EXPORT void STDCALL DumpProfileData();
 BASE_EXPORT void STDCALL DumpLastProfileData();
 BASE_EXPORT void STDCALL FreeProfileData();
+
+//writes every recorded scope to a chrome trace-event json file (chrome://tracing) until stopped
+BASE_EXPORT BOOL STDCALL StartProfileTrace(CTSTR lpFile);
+BASE_EXPORT void STDCALL StopProfileTrace();
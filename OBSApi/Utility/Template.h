@@ -19,6 +19,16 @@
 
 #pragma once
 
+//===================================================================
+// List
+//   keeps a separate capacity that grows geometrically, so appending
+//   is amortized O(1).  removing items never shrinks the buffer
+//   (except for large lists that drop well below their capacity),
+//   use ShrinkToFit or Clear to actually release memory.
+//===================================================================
+
+#define LIST_MIN_CAPACITY 4
+
 template<typename T> class List
 {
 private:
@@ -29,23 +39,86 @@ private:
 protected:
     T *array;
     unsigned int num;
+    unsigned int capacity;
+
+    inline void SetCapacity(unsigned int newCapacity)
+    {
+        if(newCapacity == capacity)
+            return;
+
+        if(!newCapacity)
+        {
+            Free(array);
+            array = NULL;
+        }
+        else
+            array = (T*)ReAllocate(array, sizeof(T)*newCapacity);
+
+        capacity = newCapacity;
+    }
+
+    inline void Grow(unsigned int minCapacity)
+    {
+        if(minCapacity <= capacity)
+            return;
+
+        unsigned int newCapacity = capacity + (capacity>>1);
+        if(newCapacity < LIST_MIN_CAPACITY)
+            newCapacity = LIST_MIN_CAPACITY;
+        if(newCapacity < minCapacity)
+            newCapacity = minCapacity;
+
+        SetCapacity(newCapacity);
+    }
+
+    //only large lists that have dropped far below their capacity give memory back
+    inline void CheckShrink()
+    {
+        if(capacity > 256 && num < (capacity>>2))
+            SetCapacity(capacity>>1);
+    }
 
 public:
 
-    inline List() : array(NULL), num(0) {}
+    inline List() : array(NULL), num(0), capacity(0) {}
     inline ~List()
     {
         Clear();
     }
 
-    inline T* Array() const             {return array;}
-    inline unsigned int Num() const     {return num;}
+    inline T* Array() const                 {return array;}
+    inline unsigned int Num() const         {return num;}
+    inline unsigned int Capacity() const    {return capacity;}
+
+    inline void Reserve(unsigned int n)
+    {
+        if(n > capacity)
+            SetCapacity(n);
+    }
+
+    inline void ShrinkToFit()
+    {
+        SetCapacity(num);
+    }
 
     inline unsigned int Add(const T& val)
     {
-        array = (T*)ReAllocate(array, sizeof(T)*++num);
-        mcpy(&array[(num-1)], (void*)&val, sizeof(T));
-        return num-1;
+        if(num == capacity)
+        {
+            //val may point into our own array
+            if(&val >= array && &val < array+num)
+            {
+                unsigned int index = (unsigned int)(&val-array);
+                Grow(num+1);
+                mcpy(&array[num], &array[index], sizeof(T));
+                return num++;
+            }
+
+            Grow(num+1);
+        }
+
+        mcpy(&array[num], (void*)&val, sizeof(T));
+        return num++;
     }
 
     inline unsigned int SafeAdd(const T& val)
@@ -65,23 +138,27 @@ public:
         assert(index <= num);
         if(index > num) return;
 
-        if(!num && !index)
+        if(index == num)
         {
             Add(val);
             return;
         }
 
         //this makes it safe to insert an item already in the list
-        T *temp = (T*)Allocate(sizeof(T));
-        mcpy(temp, &val, sizeof(T));
+        T *temp = NULL;
+        if(&val >= array && &val < array+num)
+        {
+            temp = (T*)Allocate(sizeof(T));
+            mcpy(temp, &val, sizeof(T));
+        }
 
-        UINT moveCount = num-index;
-        array = (T*)ReAllocate(array, sizeof(T)*++num);
-        if(moveCount)
-            mcpyrev(array+(index+1), array+index, moveCount*sizeof(T));
-        mcpy(&array[index], temp, sizeof(T));
+        Grow(num+1);
+        mcpyrev(array+(index+1), array+index, (num-index)*sizeof(T));
+        mcpy(&array[index], temp ? temp : &val, sizeof(T));
+        ++num;
 
-        Free(temp);
+        if(temp)
+            Free(temp);
     }
 
     inline void Remove(unsigned int index)
@@ -89,11 +166,11 @@ public:
         assert(index < num);
         if(index >= num) return;
 
-        if(!--num) {Free(array); array=NULL; return;}
-
-        mcpy(&array[index], &array[index+1], sizeof(T)*(num-index));
+        --num;
+        if(index < num)
+            mcpy(&array[index], &array[index+1], sizeof(T)*(num-index));
 
-        array = (T*)ReAllocate(array, sizeof(T)*num);
+        CheckShrink();
     }
 
     inline void RemoveItem(const T& obj)
@@ -122,18 +199,14 @@ public:
             Remove(start);
             return;
         }
-        else if(count == num)
-        {
-            Clear();
-            return;
-        }
 
         num -= count;
 
         UINT cutoffCount = num-start;
         if(cutoffCount)
             mcpy(array+start, array+end, cutoffCount*sizeof(T));
-        array = (T*)ReAllocate(array, num*sizeof(T));
+
+        CheckShrink();
     }
 
     inline void CopyArray(const T *new_array, unsigned int n)
@@ -146,7 +219,7 @@ public:
 
         SetSize(n);
 
-        if(!num) {array=NULL; return;}
+        if(!num) return;
 
         mcpy(array, (void*)new_array, sizeof(T)*num);
     }
@@ -167,16 +240,11 @@ public:
         if(!n)
             return;
 
-        int oldnum = num;
+        Grow(num+n);
 
-        SetSize(n+num);
-
-        assert(num);
-
-        if(!num) {array=NULL; return;}
-
-        mcpyrev(array+index+n, array+index, sizeof(T)*(oldnum-index));
+        mcpyrev(array+index+n, array+index, sizeof(T)*(num-index));
         mcpy(array+index, new_array, sizeof(T)*n);
+        num += n;
     }
 
     inline void AppendArray(const T *new_array, unsigned int n)
@@ -190,35 +258,36 @@ public:
         if(!n)
             return;
 
-        int oldnum = num;
-
-        SetSize(n+num);
+        Grow(num+n);
 
-        assert(num);
-
-        if(!num) {array=NULL; return;}
+        mcpy(&array[num], (void*)new_array, sizeof(T)*n);
+        num += n;
+    }
 
-        mcpy(&array[oldnum], (void*)new_array, sizeof(T)*n);
+    //appends n zeroed items and returns a pointer to the first one
+    inline T* AppendNew(unsigned int n)
+    {
+        UINT oldNum = num;
+        SetSize(num+n);
+        return array+oldNum;
     }
 
     inline BOOL SetSize(unsigned int n)
     {
         if(num == n)
             return FALSE;
-        else if(!n)
+
+        if(n > num)
         {
-            Clear();
-            return TRUE;
+            Grow(n);
+            zero(&array[num], sizeof(T)*(n-num));
+            num = n;
+        }
+        else
+        {
+            num = n;
+            CheckShrink();
         }
-
-        BOOL bClear=(n>num);
-        UINT oldNum=num;
-
-        num = n;
-        array = (T*)ReAllocate(array, sizeof(T)*num);
-
-        if(bClear)
-            zero(&array[oldNum], sizeof(T)*(num-oldNum));
 
         return TRUE;
     }
@@ -306,16 +375,18 @@ public:
     inline void TransferFrom(List<T>& list)
     {
         if(array) Clear();
-        array = list.Array();
-        num   = list.Num();
+        array    = list.array;
+        num      = list.num;
+        capacity = list.capacity;
         zero(&list, sizeof(List<T>));
     }
 
     inline void TransferFrom(T *arrayIn, UINT numIn)
     {
         if(array) Clear();
-        array = arrayIn;
-        num   = numIn;
+        array    = arrayIn;
+        num      = numIn;
+        capacity = numIn;
     }
 
     inline void TransferTo(List<T>& list)
@@ -338,7 +409,7 @@ public:
                 CrashError(TEXT("what the.."));*/
             Free(array);
             array = NULL;
-            num = 0;
+            num = capacity = 0;
         }
     }
 
@@ -646,8 +717,8 @@ public:
     {
         if(AvailableItems.Num())
         {
-            UINT avail = *AvailableItems.Array();
-            AvailableItems.Remove(0);
+            UINT avail = AvailableItems.Last();
+            AvailableItems.Remove(AvailableItems.Num()-1);
             array[avail] = val;
             return avail;
         }
@@ -680,10 +751,7 @@ public:
             --num;
             while(CheckAndCleanAvail());
 
-            if(!num)
-                {Free(array); array = NULL;}
-            else
-                array = (T*)ReAllocate(array, sizeof(T)*num);
+            CheckShrink();
         }
         else
         {
@@ -694,21 +762,23 @@ public:
 
     inline void CopyList(const SafeList<T>& safelist)
     {
-        CopyArray(list.Array(), list.Num());
-        AvailableItems.CopyList(list.AvailableItems);
+        CopyArray(safelist.Array(), safelist.Num());
+        AvailableItems.CopyList(safelist.AvailableItems);
     }
 
     inline void AppendList(const SafeList<T>& safelist)
     {
-        AppendArray(list.Array(), list.Num());
-        AvailableItems.AppendList(list.AvailableItems);
+        UINT offset = num;
+        AppendArray(safelist.Array(), safelist.Num());
+        for(UINT i=0; i<safelist.AvailableItems.Num(); i++)
+            AvailableItems << (safelist.AvailableItems[i]+offset);
     }
 
+    //copies into our own buffer so capacity always describes the array we own
     inline void operator=(const SafeList<T>& list)
     {
-        array = list.Array();
-        num   = list.Num();
-        AvailableItems = list.AvailableItems;
+        if(&list != this)
+            CopyList(list);
     }
 
     inline T* CreateNew(UINT *pID=NULL)
@@ -716,10 +786,10 @@ public:
         T *value;
         if(AvailableItems.Num())
         {
-            UINT avail = *AvailableItems.Array();
+            UINT avail = AvailableItems.Last();
             if(pID) *pID = avail;
 
-            AvailableItems.Remove(0);
+            AvailableItems.Remove(AvailableItems.Num()-1);
             value = array+avail;
         }
         else
@@ -786,18 +856,16 @@ public:
     inline unsigned int Add(const T& val)
     {
         if (storedNum == num) {
-            if (startID == 0) {
-                List::Add(val);
+            //val may live in our own buffer, which is about to move
+            T temp;
+            mcpy(&temp, &val, sizeof(T));
 
-                if (storedNum != 0)
-                    ++endID;
-            } else {
-                List::SetSize(storedNum+1);
-                mcpyrev(array+startID+1, array+startID, (storedNum-startID)*sizeof(T));
-                mcpy(array+startID, &val, sizeof(T));
-                ++startID;
+            SetBaseSize(num ? num*2 : LIST_MIN_CAPACITY);
+
+            if (storedNum > 0)
                 ++endID;
-            }
+            mcpy(array+endID, &temp, sizeof(T));
+            zero(&temp, sizeof(T));
         } else {
             if (storedNum > 0)
                 endID = (endID == num-1) ? 0 : endID+1;
@@ -897,9 +965,11 @@ public:
 
             List::SetSize(newSize);
 
-            if (endID < startID) {
-                unsigned int count = (num-endPoint);
-                mcpyrev(array+startID+count, array+startID, count*sizeof(T));
+            //move the wrapped-around head segment to the new end of the buffer
+            if (storedNum && endID < startID) {
+                unsigned int offset = (num-endPoint);
+                mcpyrev(array+startID+offset, array+startID, (endPoint-startID)*sizeof(T));
+                startID += offset;
             }
         }
     }
@@ -984,6 +1054,565 @@ public:
     }
 };
 
+//===================================================================
+// lock-free queues
+//   bounded queues for handing data from one thread to another without
+//   a mutex.  capacities are rounded up to a power of two.
+//
+//   slots are zeroed when the queue is created and handed out in place
+//   through BeginPush/Peek, so anything a slot owns (a List for example)
+//   keeps its memory and can be refilled without reallocating.  Push and
+//   Pop(T&) move raw bytes in and out instead, like List::Add does.  use
+//   one style or the other on a given queue, not both.
+//
+//   the remaining slots are destroyed with the queue.
+//===================================================================
+
+#define CACHE_LINE_SIZE     64
+#define QUEUE_SPIN_COUNT    1000
+
+inline unsigned int RoundUpPow2(unsigned int val)
+{
+    unsigned int pow2 = 1;
+    while(pow2 < val)
+        pow2 <<= 1;
+    return pow2;
+}
+
+//spins for a short while, then parks the thread on an event until notified
+class QueueWaiter
+{
+    QueueWaiter(QueueWaiter const&) = delete;
+    QueueWaiter &operator=(QueueWaiter const&) = delete;
+
+    HANDLE hEvent;
+    std::atomic<int> numWaiters;
+
+public:
+    inline QueueWaiter() : numWaiters(0) {hEvent = OSCreateEvent();}
+    inline ~QueueWaiter()                {OSCloseEvent(hEvent);}
+
+    template<typename Pred> inline bool Wait(Pred ready, DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        for(int i=0; i<QUEUE_SPIN_COUNT; i++)
+        {
+            if(ready())
+                return true;
+            _mm_pause();
+        }
+
+        DWORD startTime = OSGetTime();
+
+        for(;;)
+        {
+            //register first, then check again, so a notify can't slip in between the check and the wait
+            numWaiters.fetch_add(1);
+            if(ready())
+            {
+                numWaiters.fetch_sub(1);
+                return true;
+            }
+
+            DWORD waitTime = WAIT_INFINITE;
+            if(dwMSeconds != WAIT_INFINITE)
+            {
+                DWORD elapsed = OSGetTime()-startTime;
+                waitTime = (elapsed < dwMSeconds) ? (dwMSeconds-elapsed) : 0;
+            }
+
+            OSWaitForEvent(hEvent, waitTime);
+            numWaiters.fetch_sub(1);
+
+            if(ready())
+                return true;
+            if(waitTime == 0)
+                return false;
+        }
+    }
+
+    inline void Notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(numWaiters.load())
+            OSSignalEvent(hEvent);
+    }
+};
+
+//-------------------------------------------------------------------
+// SPSCQueue
+//   one producer thread, one consumer thread
+
+template<typename T> class SPSCQueue
+{
+    SPSCQueue(SPSCQueue const&) = delete;
+    SPSCQueue &operator=(SPSCQueue const&) = delete;
+
+    T *array;
+    unsigned int capacity, mask;
+
+    char pad0[CACHE_LINE_SIZE];
+
+    std::atomic<unsigned int> writePos;
+    unsigned int cachedReadPos;
+
+    char pad1[CACHE_LINE_SIZE];
+
+    std::atomic<unsigned int> readPos;
+    unsigned int cachedWritePos;
+
+    char pad2[CACHE_LINE_SIZE];
+
+    QueueWaiter dataWaiter, spaceWaiter;
+
+    inline void DestroySlots()
+    {
+        for(unsigned int i=0; i<capacity; i++)
+            array[i].~T();
+        Free(array);
+        array = NULL;
+    }
+
+public:
+    inline SPSCQueue() : array(NULL), capacity(0), mask(0), writePos(0), cachedReadPos(0), readPos(0), cachedWritePos(0) {}
+    inline ~SPSCQueue() {if(array) DestroySlots();}
+
+    //only call while neither thread is using the queue
+    inline void SetCapacity(unsigned int n)
+    {
+        n = RoundUpPow2(n);
+        if(n == capacity)
+            return;
+
+        if(array) DestroySlots();
+
+        capacity = n;
+        mask = n-1;
+        array = (T*)Allocate(sizeof(T)*n);
+        zero(array, sizeof(T)*n);
+
+        Clear();
+    }
+
+    //only call while neither thread is using the queue
+    inline void Clear()
+    {
+        writePos = readPos = 0;
+        cachedReadPos = cachedWritePos = 0;
+    }
+
+    inline unsigned int Capacity() const {return capacity;}
+
+    //safe from either thread, but only a snapshot
+    inline unsigned int Num() const {return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);}
+
+    //-----------------------------------------
+    // producer
+
+    inline T* BeginPush()
+    {
+        unsigned int pos = writePos.load(std::memory_order_relaxed);
+        if((pos-cachedReadPos) >= capacity)
+        {
+            cachedReadPos = readPos.load(std::memory_order_acquire);
+            if((pos-cachedReadPos) >= capacity)
+                return NULL;
+        }
+
+        return array+(pos&mask);
+    }
+
+    inline void EndPush()
+    {
+        writePos.store(writePos.load(std::memory_order_relaxed)+1, std::memory_order_release);
+        dataWaiter.Notify();
+    }
+
+    inline bool Push(const T& val)
+    {
+        T *slot = BeginPush();
+        if(!slot)
+            return false;
+
+        mcpy(slot, &val, sizeof(T));
+        EndPush();
+        return true;
+    }
+
+    inline T* WaitBeginPush(DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        spaceWaiter.Wait([this]() {return BeginPush() != NULL;}, dwMSeconds);
+        return BeginPush();
+    }
+
+    //-----------------------------------------
+    // consumer
+
+    inline unsigned int NumAvailable()
+    {
+        cachedWritePos = writePos.load(std::memory_order_acquire);
+        return cachedWritePos - readPos.load(std::memory_order_relaxed);
+    }
+
+    inline T* Peek(unsigned int index=0)
+    {
+        unsigned int pos = readPos.load(std::memory_order_relaxed);
+        if((cachedWritePos-pos) <= index)
+        {
+            cachedWritePos = writePos.load(std::memory_order_acquire);
+            if((cachedWritePos-pos) <= index)
+                return NULL;
+        }
+
+        return array+((pos+index)&mask);
+    }
+
+    inline void Pop()
+    {
+        readPos.store(readPos.load(std::memory_order_relaxed)+1, std::memory_order_release);
+        spaceWaiter.Notify();
+    }
+
+    inline bool Pop(T& val)
+    {
+        T *slot = Peek();
+        if(!slot)
+            return false;
+
+        mcpy(&val, slot, sizeof(T));
+        zero(slot, sizeof(T));
+        Pop();
+        return true;
+    }
+
+    inline T* WaitPeek(DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        dataWaiter.Wait([this]() {return Peek() != NULL;}, dwMSeconds);
+        return Peek();
+    }
+};
+
+//-------------------------------------------------------------------
+// MPSCQueue
+//   any number of producer threads, one consumer thread.  each slot
+//   carries a sequence number that says whose turn it is.
+
+template<typename T> class MPSCQueue
+{
+    MPSCQueue(MPSCQueue const&) = delete;
+    MPSCQueue &operator=(MPSCQueue const&) = delete;
+
+    struct Slot
+    {
+        std::atomic<unsigned int> sequence;
+        T value;
+    };
+
+    Slot *slots;
+    unsigned int capacity, mask;
+
+    char pad0[CACHE_LINE_SIZE];
+
+    std::atomic<unsigned int> writePos;
+
+    char pad1[CACHE_LINE_SIZE];
+
+    unsigned int readPos;
+
+    char pad2[CACHE_LINE_SIZE];
+
+    QueueWaiter dataWaiter, spaceWaiter;
+
+    inline void DestroySlots()
+    {
+        for(unsigned int i=0; i<capacity; i++)
+            slots[i].value.~T();
+        Free(slots);
+        slots = NULL;
+    }
+
+public:
+    inline MPSCQueue() : slots(NULL), capacity(0), mask(0), writePos(0), readPos(0) {}
+    inline ~MPSCQueue() {if(slots) DestroySlots();}
+
+    //only call while no thread is using the queue
+    inline void SetCapacity(unsigned int n)
+    {
+        n = RoundUpPow2(n);
+        if(n == capacity)
+            return;
+
+        if(slots) DestroySlots();
+
+        capacity = n;
+        mask = n-1;
+        slots = (Slot*)Allocate(sizeof(Slot)*n);
+        zero(slots, sizeof(Slot)*n);
+
+        Clear();
+    }
+
+    //only call while no thread is using the queue
+    inline void Clear()
+    {
+        for(unsigned int i=0; i<capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        writePos = 0;
+        readPos = 0;
+    }
+
+    inline unsigned int Capacity() const {return capacity;}
+
+    //-----------------------------------------
+    // producers
+
+    //returns NULL when full.  ticket has to be handed back to EndPush.
+    inline T* BeginPush(unsigned int &ticket)
+    {
+        unsigned int pos = writePos.load(std::memory_order_relaxed);
+
+        for(;;)
+        {
+            Slot &slot = slots[pos&mask];
+            int diff = int(slot.sequence.load(std::memory_order_acquire) - pos);
+
+            if(diff == 0)
+            {
+                if(writePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                {
+                    ticket = pos;
+                    return &slot.value;
+                }
+            }
+            else if(diff < 0)
+                return NULL;
+            else
+                pos = writePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    inline void EndPush(unsigned int ticket)
+    {
+        slots[ticket&mask].sequence.store(ticket+1, std::memory_order_release);
+        dataWaiter.Notify();
+    }
+
+    inline bool Push(const T& val)
+    {
+        unsigned int ticket;
+        T *slot = BeginPush(ticket);
+        if(!slot)
+            return false;
+
+        mcpy(slot, &val, sizeof(T));
+        EndPush(ticket);
+        return true;
+    }
+
+    inline bool WaitPush(const T& val, DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        bool bPushed = false;
+        spaceWaiter.Wait([&]() {return (bPushed = Push(val));}, dwMSeconds);
+        return bPushed;
+    }
+
+    //-----------------------------------------
+    // consumer
+
+    inline T* Peek()
+    {
+        Slot &slot = slots[readPos&mask];
+        if(int(slot.sequence.load(std::memory_order_acquire) - (readPos+1)) < 0)
+            return NULL;
+
+        return &slot.value;
+    }
+
+    inline void Pop()
+    {
+        slots[readPos&mask].sequence.store(readPos+capacity, std::memory_order_release);
+        ++readPos;
+        spaceWaiter.Notify();
+    }
+
+    inline bool Pop(T& val)
+    {
+        T *slot = Peek();
+        if(!slot)
+            return false;
+
+        mcpy(&val, slot, sizeof(T));
+        zero(slot, sizeof(T));
+        Pop();
+        return true;
+    }
+
+    inline T* WaitPeek(DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        dataWaiter.Wait([this]() {return Peek() != NULL;}, dwMSeconds);
+        return Peek();
+    }
+};
+
+//-------------------------------------------------------------------
+// SPSCByteRing
+//   byte stream from one producer thread to one consumer thread.  the
+//   backing buffer is a power of two but never holds more than the
+//   requested capacity.  ReserveWrite/PeekRead hand out the largest
+//   contiguous piece, so data can be built or sent in place.
+
+class SPSCByteRing
+{
+    SPSCByteRing(SPSCByteRing const&) = delete;
+    SPSCByteRing &operator=(SPSCByteRing const&) = delete;
+
+    LPBYTE buffer;
+    unsigned int bufferSize, mask, capacity;
+
+    char pad0[CACHE_LINE_SIZE];
+
+    std::atomic<unsigned int> writePos;
+
+    char pad1[CACHE_LINE_SIZE];
+
+    std::atomic<unsigned int> readPos;
+
+    char pad2[CACHE_LINE_SIZE];
+
+    QueueWaiter dataWaiter, spaceWaiter;
+
+    inline void CopyIn(unsigned int pos, LPCVOID data, unsigned int len)
+    {
+        unsigned int offset = pos&mask;
+        unsigned int firstPart = MIN(len, bufferSize-offset);
+
+        mcpy(buffer+offset, data, firstPart);
+        if(firstPart < len)
+            mcpy(buffer, ((LPBYTE)data)+firstPart, len-firstPart);
+    }
+
+public:
+    inline SPSCByteRing() : buffer(NULL), bufferSize(0), mask(0), capacity(0), writePos(0), readPos(0) {}
+    inline ~SPSCByteRing() {Free(buffer);}
+
+    //only call while neither thread is using the ring
+    inline void SetCapacity(unsigned int n)
+    {
+        Free(buffer);
+
+        capacity = n;
+        bufferSize = RoundUpPow2(n);
+        mask = bufferSize-1;
+        buffer = (LPBYTE)Allocate(bufferSize);
+
+        writePos = readPos = 0;
+    }
+
+    inline unsigned int Capacity() const   {return capacity;}
+
+    //safe from either thread, but only a snapshot
+    inline unsigned int NumQueued() const  {return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);}
+    inline unsigned int FreeSpace() const  {return capacity - NumQueued();}
+
+    //-----------------------------------------
+    // producer
+
+    //returns the contiguous writable space in len, which may be less than FreeSpace() at the wrap point
+    inline LPBYTE ReserveWrite(unsigned int &len)
+    {
+        unsigned int pos = writePos.load(std::memory_order_relaxed);
+        unsigned int freeSpace = capacity - (pos - readPos.load(std::memory_order_acquire));
+        unsigned int offset = pos&mask;
+
+        len = MIN(freeSpace, bufferSize-offset);
+        return buffer+offset;
+    }
+
+    inline void CommitWrite(unsigned int len)
+    {
+        writePos.store(writePos.load(std::memory_order_relaxed)+len, std::memory_order_release);
+        dataWaiter.Notify();
+    }
+
+    //all or nothing
+    inline bool Write(LPCVOID data, unsigned int len)
+    {
+        if(len > FreeSpace())
+            return false;
+
+        CopyIn(writePos.load(std::memory_order_relaxed), data, len);
+        CommitWrite(len);
+        return true;
+    }
+
+    //writes both pieces as one, so the consumer never sees the first without the second
+    inline bool Write(LPCVOID data, unsigned int len, LPCVOID data2, unsigned int len2)
+    {
+        if((len+len2) > FreeSpace())
+            return false;
+
+        unsigned int pos = writePos.load(std::memory_order_relaxed);
+        CopyIn(pos, data, len);
+        CopyIn(pos+len, data2, len2);
+        CommitWrite(len+len2);
+        return true;
+    }
+
+    inline bool WaitForSpace(unsigned int len, DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        return spaceWaiter.Wait([&]() {return FreeSpace() >= len;}, dwMSeconds);
+    }
+
+    //-----------------------------------------
+    // consumer
+
+    //returns the contiguous readable data in len
+    inline LPBYTE PeekRead(unsigned int &len)
+    {
+        unsigned int pos = readPos.load(std::memory_order_relaxed);
+        unsigned int queued = writePos.load(std::memory_order_acquire) - pos;
+        unsigned int offset = pos&mask;
+
+        len = MIN(queued, bufferSize-offset);
+        return buffer+offset;
+    }
+
+    inline void CommitRead(unsigned int len)
+    {
+        readPos.store(readPos.load(std::memory_order_relaxed)+len, std::memory_order_release);
+        spaceWaiter.Notify();
+    }
+
+    inline unsigned int Read(LPVOID data, unsigned int maxLen)
+    {
+        unsigned int total = 0;
+        while(total < maxLen)
+        {
+            unsigned int len;
+            LPBYTE readData = PeekRead(len);
+            if(!len)
+                break;
+
+            len = MIN(len, maxLen-total);
+            mcpy(((LPBYTE)data)+total, readData, len);
+            CommitRead(len);
+            total += len;
+        }
+
+        return total;
+    }
+
+    inline void DiscardAll()
+    {
+        readPos.store(writePos.load(std::memory_order_acquire), std::memory_order_release);
+        spaceWaiter.Notify();
+    }
+
+    inline bool WaitForData(DWORD dwMSeconds=WAIT_INFINITE)
+    {
+        return dataWaiter.Wait([this]() {return NumQueued() != 0;}, dwMSeconds);
+    }
+};
+
 //===================================================================
 
 class BASE_EXPORT BufferInputSerializer : public Serializer
@@ -0,0 +1,534 @@
+/********************************************************************************
+ Copyright (C) 2001-2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#define WINVER         0x0600
+#define _WIN32_WINDOWS 0x0600
+#define _WIN32_WINNT   0x0600
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "XT.h"
+#include "malloc.h"
+
+
+//-----------------------------------------
+//size classes: 16 byte steps up to 128, then four steps per power of two up to 32k
+
+#define TCA_NUM_SIZE_CLASSES    48
+#define TCA_MAX_SMALL_SIZE      0x8000
+#define TCA_LARGE_CLASS         0xFFFF
+#define TCA_HEADER_MAGIC        0x54434121
+#define TCA_SPAN_SIZE           0x10000
+
+static size_t SizeClassSizes[TCA_NUM_SIZE_CLASSES];
+static BYTE   SizeToClass[(TCA_MAX_SMALL_SIZE>>4)+1];
+static UINT   numSizeClasses = 0;
+
+struct TCAFreeBlock
+{
+    TCAFreeBlock *next;
+};
+
+//every block is preceded by this.  16 bytes so that returned memory stays 16-byte aligned.
+__declspec(align(16)) struct TCABlockHeader
+{
+    union
+    {
+        TCAThreadCache *owner;
+        size_t         largeSize;
+    };
+    DWORD sizeClass;
+    DWORD magic;
+};
+
+struct TCAThreadCache
+{
+    ThreadCacheAlloc        *allocator;
+    TCAFreeBlock            *freeList[TCA_NUM_SIZE_CLASSES];
+    UINT                    numFree[TCA_NUM_SIZE_CLASSES];
+
+    //pushed to by other threads, only ever emptied as a whole by the owner
+    TCAFreeBlock * volatile remoteFreeList;
+
+    QWORD                   hits[TCA_NUM_SIZE_CLASSES];
+    QWORD                   misses[TCA_NUM_SIZE_CLASSES];
+    QWORD                   remoteFrees[TCA_NUM_SIZE_CLASSES];
+
+    TCAThreadCache          *nextCache;
+    TCAThreadCache          *nextIdle;
+};
+
+struct TCACentralPool
+{
+    HANDLE          hMutex;
+    TCAFreeBlock    *freeList;
+    UINT            numFree;
+    UINT            batchSize;
+
+    LPBYTE          spanCur, spanEnd;
+    LPVOID          spanList;       //first pointer of each span links to the previous span
+
+    volatile LONG   contentions;
+};
+
+inline TCABlockHeader* GetBlockHeader(LPVOID lpData)
+{
+    return ((TCABlockHeader*)lpData)-1;
+}
+
+inline size_t BlockStride(UINT sizeClass)
+{
+    return sizeof(TCABlockHeader)+SizeClassSizes[sizeClass];
+}
+
+static void InitSizeClasses()
+{
+    if(numSizeClasses)
+        return;
+
+    size_t size = 16;
+    UINT id = 0;
+
+    while(size <= TCA_MAX_SMALL_SIZE)
+    {
+        SizeClassSizes[id++] = size;
+
+        if(size < 128)
+            size += 16;
+        else
+        {
+            size_t step = 1;
+            while((step<<3) <= size) step <<= 1;  //step = pow2(size)/4
+            size += step;
+        }
+    }
+
+    assert(id <= TCA_NUM_SIZE_CLASSES);
+    numSizeClasses = id;
+
+    UINT curClass = 0;
+    for(UINT i=0; i<=(TCA_MAX_SMALL_SIZE>>4); i++)
+    {
+        while((size_t(i)<<4) > SizeClassSizes[curClass])
+            ++curClass;
+        SizeToClass[i] = (BYTE)curClass;
+    }
+}
+
+inline UINT GetSizeClass(size_t size)
+{
+    return SizeToClass[(size+15)>>4];
+}
+
+//-----------------------------------------
+
+VOID WINAPI TCAThreadExit(PVOID param)
+{
+    TCAThreadCache *cache = (TCAThreadCache*)param;
+    if(cache && !cache->allocator->bShuttingDown)
+        cache->allocator->ReleaseThreadCache(cache);
+}
+
+ThreadCacheAlloc::ThreadCacheAlloc()
+{
+    InitSizeClasses();
+
+    pools = (TCACentralPool*)malloc(sizeof(TCACentralPool)*numSizeClasses);
+    zero(pools, sizeof(TCACentralPool)*numSizeClasses);
+
+    for(UINT i=0; i<numSizeClasses; i++)
+    {
+        UINT batch = UINT(TCA_SPAN_SIZE/4 / BlockStride(i));
+        pools[i].batchSize = (batch < 4) ? 4 : ((batch > 64) ? 64 : batch);
+        pools[i].hMutex = OSCreateMutex();
+    }
+
+    cacheList = idleCaches = NULL;
+    bShuttingDown = false;
+
+    hCacheMutex = OSCreateMutex();
+    flsIndex = FlsAlloc(TCAThreadExit);
+    if(flsIndex == FLS_OUT_OF_INDEXES)
+        CrashError(TEXT("ThreadCacheAlloc: Could not allocate a fiber local storage index"));
+}
+
+ThreadCacheAlloc::~ThreadCacheAlloc()
+{
+    bShuttingDown = true;
+    FlsFree(flsIndex);
+
+    FreeAllMemory();
+
+    for(UINT i=0; i<numSizeClasses; i++)
+        OSCloseMutex(pools[i].hMutex);
+    OSCloseMutex(hCacheMutex);
+
+    free(pools);
+}
+
+void ThreadCacheAlloc::FreeAllMemory()
+{
+    for(UINT i=0; i<numSizeClasses; i++)
+    {
+        LPVOID span = pools[i].spanList;
+        while(span)
+        {
+            LPVOID prev = *(LPVOID*)span;
+            OSVirtualFree(span);
+            span = prev;
+        }
+
+        pools[i].spanList = NULL;
+        pools[i].freeList = NULL;
+        pools[i].spanCur = pools[i].spanEnd = NULL;
+        pools[i].numFree = 0;
+    }
+
+    TCAThreadCache *cache = cacheList;
+    while(cache)
+    {
+        TCAThreadCache *next = cache->nextCache;
+        free(cache);
+        cache = next;
+    }
+
+    cacheList = idleCaches = NULL;
+}
+
+void ThreadCacheAlloc::ErrorTermination()
+{
+    bShuttingDown = true;
+    FreeAllMemory();
+}
+
+TCAThreadCache* ThreadCacheAlloc::GetThreadCache()
+{
+    TCAThreadCache *cache = (TCAThreadCache*)FlsGetValue(flsIndex);
+    if(cache)
+        return cache;
+
+    OSEnterMutex(hCacheMutex);
+
+    if(idleCaches)
+    {
+        cache = idleCaches;
+        idleCaches = cache->nextIdle;
+        cache->nextIdle = NULL;
+    }
+    else
+    {
+        cache = (TCAThreadCache*)malloc(sizeof(TCAThreadCache));
+        if (!cache) DumpError(TEXT("Out of memory while trying to create a thread allocation cache"));
+        zero(cache, sizeof(TCAThreadCache));
+
+        cache->allocator = this;
+        cache->nextCache = cacheList;
+        cacheList = cache;
+    }
+
+    OSLeaveMutex(hCacheMutex);
+
+    FlsSetValue(flsIndex, cache);
+    return cache;
+}
+
+void ThreadCacheAlloc::ReleaseThreadCache(TCAThreadCache *cache)
+{
+    DrainRemoteFrees(cache);
+
+    for(UINT i=0; i<numSizeClasses; i++)
+    {
+        if(cache->numFree[i])
+            ReturnBatch(cache, i, cache->numFree[i]);
+    }
+
+    //anything freed remotely from here on waits in remoteFreeList until another thread picks this cache up
+    OSEnterMutex(hCacheMutex);
+    cache->nextIdle = idleCaches;
+    idleCaches = cache;
+    OSLeaveMutex(hCacheMutex);
+}
+
+inline void EnterPoolMutex(TCACentralPool &pool)
+{
+    if(!OSTryEnterMutex(pool.hMutex))
+    {
+        InterlockedIncrement(&pool.contentions);
+        OSEnterMutex(pool.hMutex);
+    }
+}
+
+void ThreadCacheAlloc::Refill(TCAThreadCache *cache, UINT sizeClass)
+{
+    TCACentralPool &pool = pools[sizeClass];
+    size_t stride = BlockStride(sizeClass);
+
+    EnterPoolMutex(pool);
+
+    for(UINT i=0; i<pool.batchSize; i++)
+    {
+        TCAFreeBlock *block;
+
+        if(pool.freeList)
+        {
+            block = pool.freeList;
+            pool.freeList = block->next;
+            --pool.numFree;
+        }
+        else
+        {
+            if(pool.spanCur+stride > pool.spanEnd)
+            {
+                size_t spanSize = TCA_SPAN_SIZE;
+                if(spanSize < stride*8+16)
+                    spanSize = stride*8+16;
+
+                LPBYTE span = (LPBYTE)OSVirtualAlloc(spanSize);
+                if (!span) DumpError(TEXT("Out of memory while trying to allocate %d bytes at %p"), spanSize, ReturnAddress());
+
+                *(LPVOID*)span = pool.spanList;
+                pool.spanList = span;
+                pool.spanCur = span+16;
+                pool.spanEnd = span+spanSize;
+            }
+
+            TCABlockHeader *header = (TCABlockHeader*)pool.spanCur;
+            header->sizeClass = sizeClass;
+            header->magic = TCA_HEADER_MAGIC;
+            pool.spanCur += stride;
+
+            block = (TCAFreeBlock*)(header+1);
+        }
+
+        block->next = cache->freeList[sizeClass];
+        cache->freeList[sizeClass] = block;
+        ++cache->numFree[sizeClass];
+    }
+
+    OSLeaveMutex(pool.hMutex);
+}
+
+void ThreadCacheAlloc::ReturnBatch(TCAThreadCache *cache, UINT sizeClass, UINT count)
+{
+    TCAFreeBlock *first = cache->freeList[sizeClass];
+    if(!first || !count)
+        return;
+
+    //unlink the batch from the cache first so the pool lock is only held for the splice
+    TCAFreeBlock *last = first;
+    UINT taken = 1;
+    while(taken < count && last->next)
+    {
+        last = last->next;
+        ++taken;
+    }
+
+    cache->freeList[sizeClass] = last->next;
+    cache->numFree[sizeClass] -= taken;
+
+    TCACentralPool &pool = pools[sizeClass];
+    EnterPoolMutex(pool);
+
+    last->next = pool.freeList;
+    pool.freeList = first;
+    pool.numFree += taken;
+
+    OSLeaveMutex(pool.hMutex);
+}
+
+void ThreadCacheAlloc::DrainRemoteFrees(TCAThreadCache *cache)
+{
+    if(!cache->remoteFreeList)
+        return;
+
+    TCAFreeBlock *block = (TCAFreeBlock*)InterlockedExchangePointer((PVOID volatile*)&cache->remoteFreeList, NULL);
+    while(block)
+    {
+        TCAFreeBlock *next = block->next;
+        UINT sizeClass = GetBlockHeader(block)->sizeClass;
+
+        block->next = cache->freeList[sizeClass];
+        cache->freeList[sizeClass] = block;
+        ++cache->numFree[sizeClass];
+
+        block = next;
+    }
+}
+
+void * __restrict ThreadCacheAlloc::_Allocate(size_t dwSize)
+{
+    if(!dwSize) dwSize = 1;
+
+    if(dwSize > TCA_MAX_SMALL_SIZE)
+    {
+        TCABlockHeader *header = (TCABlockHeader*)_aligned_malloc(dwSize+sizeof(TCABlockHeader), 16);
+        if (!header) DumpError(TEXT("Out of memory while trying to allocate %d bytes at %p"), dwSize, ReturnAddress());
+
+        header->largeSize = dwSize;
+        header->sizeClass = TCA_LARGE_CLASS;
+        header->magic = TCA_HEADER_MAGIC;
+        return header+1;
+    }
+
+    UINT sizeClass = GetSizeClass(dwSize);
+    TCAThreadCache *cache = GetThreadCache();
+
+    TCAFreeBlock *block = cache->freeList[sizeClass];
+    if(block)
+        ++cache->hits[sizeClass];
+    else
+    {
+        ++cache->misses[sizeClass];
+
+        DrainRemoteFrees(cache);
+        if(!cache->freeList[sizeClass])
+            Refill(cache, sizeClass);
+
+        block = cache->freeList[sizeClass];
+    }
+
+    cache->freeList[sizeClass] = block->next;
+    --cache->numFree[sizeClass];
+
+    GetBlockHeader(block)->owner = cache;
+    return block;
+}
+
+void * ThreadCacheAlloc::_ReAllocate(LPVOID lpData, size_t dwSize)
+{
+    if(!lpData)
+        return _Allocate(dwSize);
+
+    if(!dwSize)
+    {
+        _Free(lpData);
+        return NULL;
+    }
+
+    TCABlockHeader *header = GetBlockHeader(lpData);
+    assert(header->magic == TCA_HEADER_MAGIC);
+
+    size_t oldSize;
+    if(header->sizeClass == TCA_LARGE_CLASS)
+    {
+        if(dwSize > TCA_MAX_SMALL_SIZE)
+        {
+            header = (TCABlockHeader*)_aligned_realloc(header, dwSize+sizeof(TCABlockHeader), 16);
+            if (!header) DumpError(TEXT("Out of memory while trying to reallocate %d bytes at %p"), dwSize, ReturnAddress());
+
+            header->largeSize = dwSize;
+            return header+1;
+        }
+
+        oldSize = header->largeSize;
+    }
+    else
+    {
+        oldSize = SizeClassSizes[header->sizeClass];
+        if(dwSize <= oldSize && (header->sizeClass == 0 || dwSize > SizeClassSizes[header->sizeClass-1]))
+            return lpData;
+    }
+
+    LPVOID lpNew = _Allocate(dwSize);
+    mcpy(lpNew, lpData, MIN(dwSize, oldSize));
+    _Free(lpData);
+
+    return lpNew;
+}
+
+void ThreadCacheAlloc::_Free(LPVOID lpData)
+{
+    if(!lpData)
+        return;
+
+    TCABlockHeader *header = GetBlockHeader(lpData);
+    assert(header->magic == TCA_HEADER_MAGIC);
+
+    if(header->sizeClass == TCA_LARGE_CLASS)
+    {
+        _aligned_free(header);
+        return;
+    }
+
+    UINT sizeClass = header->sizeClass;
+    TCAThreadCache *cache = GetThreadCache();
+    TCAFreeBlock *block = (TCAFreeBlock*)lpData;
+
+    if(header->owner == cache)
+    {
+        block->next = cache->freeList[sizeClass];
+        cache->freeList[sizeClass] = block;
+
+        if(++cache->numFree[sizeClass] > pools[sizeClass].batchSize*2)
+            ReturnBatch(cache, sizeClass, pools[sizeClass].batchSize);
+    }
+    else
+    {
+        TCAThreadCache *owner = header->owner;
+        ++cache->remoteFrees[sizeClass];
+
+        TCAFreeBlock *head;
+        do
+        {
+            head = owner->remoteFreeList;
+            block->next = head;
+        } while(InterlockedCompareExchangePointer((PVOID volatile*)&owner->remoteFreeList, block, head) != head);
+    }
+}
+
+UINT ThreadCacheAlloc::NumSizeClasses() const
+{
+    return numSizeClasses;
+}
+
+void ThreadCacheAlloc::GetSizeClassStats(UINT sizeClass, AllocSizeClassStats &stats)
+{
+    zero(&stats, sizeof(stats));
+    if(sizeClass >= numSizeClasses)
+        return;
+
+    stats.blockSize = SizeClassSizes[sizeClass];
+    stats.contentions = (QWORD)pools[sizeClass].contentions;
+
+    //the per-thread counters are only ever written by their own thread, so this is a racy but harmless read
+    OSEnterMutex(hCacheMutex);
+    for(TCAThreadCache *cache = cacheList; cache; cache = cache->nextCache)
+    {
+        stats.hits        += cache->hits[sizeClass];
+        stats.misses      += cache->misses[sizeClass];
+        stats.remoteFrees += cache->remoteFrees[sizeClass];
+    }
+    OSLeaveMutex(hCacheMutex);
+}
+
+void ThreadCacheAlloc::LogStats()
+{
+    Log(TEXT("ThreadCacheAlloc size class stats:"));
+
+    for(UINT i=0; i<numSizeClasses; i++)
+    {
+        AllocSizeClassStats stats;
+        GetSizeClassStats(i, stats);
+
+        if(!stats.hits && !stats.misses)
+            continue;
+
+        Log(TEXT("    %6u bytes: hits %llu, misses %llu, contentions %llu, remote frees %llu"),
+            (UINT)stats.blockSize, stats.hits, stats.misses, stats.contentions, stats.remoteFrees);
+    }
+}
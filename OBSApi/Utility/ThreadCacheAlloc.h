@@ -0,0 +1,72 @@
+/********************************************************************************
+ Copyright (C) 2001-2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#pragma once
+
+struct TCAThreadCache;
+struct TCACentralPool;
+
+struct AllocSizeClassStats
+{
+    size_t blockSize;
+    QWORD  hits;         //allocations served straight from the thread cache
+    QWORD  misses;       //allocations that had to refill from the shared pool
+    QWORD  contentions;  //times the shared pool lock was already held
+    QWORD  remoteFrees;  //blocks freed on a thread other than the one that allocated them
+};
+
+//size-class allocator with a cache per thread.  allocations and frees on the
+//owning thread never take a lock; caches refill from and return to the shared
+//pools in batches, and blocks freed from another thread go through a lock-free
+//queue on the owning cache.  anything above the largest size class goes to
+//_aligned_malloc.
+class BASE_EXPORT ThreadCacheAlloc : public Alloc
+{
+    friend void __stdcall TCAThreadExit(void *param);
+
+    TCACentralPool  *pools;
+    TCAThreadCache  *cacheList;     //every cache ever created, for stats and cleanup
+    TCAThreadCache  *idleCaches;    //caches of exited threads, waiting to be reused
+    HANDLE          hCacheMutex;
+    DWORD           flsIndex;
+    bool            bShuttingDown;
+
+    TCAThreadCache* GetThreadCache();
+    void Refill(TCAThreadCache *cache, UINT sizeClass);
+    void ReturnBatch(TCAThreadCache *cache, UINT sizeClass, UINT count);
+    void DrainRemoteFrees(TCAThreadCache *cache);
+    void ReleaseThreadCache(TCAThreadCache *cache);
+    void FreeAllMemory();
+
+public:
+    ThreadCacheAlloc();
+    virtual ~ThreadCacheAlloc();
+
+    virtual void * __restrict _Allocate(size_t dwSize);
+
+    virtual void * _ReAllocate(LPVOID lpData, size_t dwSize);
+
+    virtual void   _Free(LPVOID lpData);
+
+    virtual void   ErrorTermination();
+
+    UINT NumSizeClasses() const;
+    void GetSizeClassStats(UINT sizeClass, AllocSizeClassStats &stats);
+    void LogStats();
+};
@@ -21,6 +21,161 @@
 
 
 
+/*========================================================
+  XConfigArena
+=========================================================*/
+
+//items of a config are carved out of large blocks instead of going through the main allocator one
+//at a time.  every allocation is preceded by a header pointing back to the arena, and freed items
+//go on a free list for their size so that editing a config doesn't keep growing the arena.
+
+#define XCONFIG_ARENA_BLOCK_SIZE    0x10000
+#define XCONFIG_ARENA_ALIGN         16
+#define XCONFIG_ARENA_FREE_LISTS    16
+
+struct XArenaHeader
+{
+    XConfigArena *arena;    //NULL if it was too big for the arena
+    UINT sizeClass;
+};
+
+#define XCONFIG_ARENA_HEADER_SIZE   ((sizeof(XArenaHeader)+XCONFIG_ARENA_ALIGN-1) & ~(XCONFIG_ARENA_ALIGN-1))
+
+struct XConfigArena
+{
+    List<LPBYTE> blocks;
+    LPBYTE curPos;
+    UPARAM remaining;
+
+    void *freeLists[XCONFIG_ARENA_FREE_LISTS];
+
+    inline XConfigArena() : curPos(NULL), remaining(0)
+    {
+        zero(freeLists, sizeof(freeLists));
+    }
+
+    ~XConfigArena()
+    {
+        for(UINT i=0; i<blocks.Num(); i++)
+            Free(blocks[i]);
+    }
+
+    void* AllocItem(size_t size)
+    {
+        UPARAM totalSize = (size+XCONFIG_ARENA_HEADER_SIZE+XCONFIG_ARENA_ALIGN-1) & ~(XCONFIG_ARENA_ALIGN-1);
+        UINT sizeClass = UINT(totalSize/XCONFIG_ARENA_ALIGN)-1;
+
+        LPBYTE lpData;
+        XArenaHeader *header;
+
+        if(sizeClass >= XCONFIG_ARENA_FREE_LISTS)
+        {
+            lpData = (LPBYTE)Allocate(totalSize);
+            header = (XArenaHeader*)lpData;
+            header->arena = NULL;
+        }
+        else
+        {
+            if(freeLists[sizeClass])
+            {
+                lpData = (LPBYTE)freeLists[sizeClass];
+                freeLists[sizeClass] = *(void**)lpData;
+            }
+            else
+            {
+                if(remaining < totalSize)
+                {
+                    curPos = (LPBYTE)Allocate(XCONFIG_ARENA_BLOCK_SIZE);
+                    remaining = XCONFIG_ARENA_BLOCK_SIZE;
+                    blocks << curPos;
+                }
+
+                lpData = curPos;
+                curPos += totalSize;
+                remaining -= totalSize;
+            }
+
+            header = (XArenaHeader*)lpData;
+            header->arena = this;
+        }
+
+        header->sizeClass = sizeClass;
+
+        lpData += XCONFIG_ARENA_HEADER_SIZE;
+        zero(lpData, totalSize-XCONFIG_ARENA_HEADER_SIZE);
+        return lpData;
+    }
+
+    static void FreeItem(void *lpItem)
+    {
+        LPBYTE lpData = ((LPBYTE)lpItem)-XCONFIG_ARENA_HEADER_SIZE;
+        XArenaHeader *header = (XArenaHeader*)lpData;
+        XConfigArena *arena = header->arena;
+
+        if(!arena)
+        {
+            Free(lpData);
+            return;
+        }
+
+        *(void**)lpData = arena->freeLists[header->sizeClass];
+        arena->freeLists[header->sizeClass] = lpData;
+    }
+};
+
+
+/*========================================================
+  XBaseItem
+=========================================================*/
+
+void* XBaseItem::operator new(size_t size, XConfig *config)
+{
+    if(!config->arena)
+        config->arena = new XConfigArena;
+
+    return config->arena->AllocItem(size);
+}
+
+void XBaseItem::operator delete(void *lpData, XConfig *config)
+{
+    if(lpData) XConfigArena::FreeItem(lpData);
+}
+
+void XBaseItem::operator delete(void *lpData)
+{
+    if(lpData) XConfigArena::FreeItem(lpData);
+}
+
+//FNV-1a over the characters folded to lower case the same way scmpi does it, so names that
+//compare equal always hash equal
+UINT XBaseItem::HashName(CTSTR lpName)
+{
+    UINT hash = 2166136261;
+
+    if(lpName)
+    {
+        while(*lpName)
+        {
+            TCHAR ch = *(lpName++);
+            if(ch >= 'A' && ch <= 'Z')
+                ch += 'a'-'A';
+
+            hash = (hash ^ UINT(ch)) * 16777619;
+        }
+    }
+
+    return hash;
+}
+
+void XBaseItem::SetName(CTSTR lpName)
+{
+    strName = lpName;
+    nameHash = HashName(lpName);
+
+    if(parent)
+        parent->RebuildIndex();
+}
+
 
 /*========================================================
   XElement
@@ -35,6 +190,121 @@ XElement::~XElement()
     SubItems.Clear();
 }
 
+//---------------------------
+
+static inline UINT GetIndexSlotHash(UINT nameHash, int type)
+{
+    return nameHash ^ (UINT(type)*0x9E3779B9);
+}
+
+void XElement::AppendItem(XBaseItem *item)
+{
+    item->parent = this;
+    SubItems << item;
+
+    if(nameIndex.Num())
+        AddToIndex(SubItems.Num()-1);
+    else if(SubItems.Num() >= XCONFIG_INDEX_MIN_ITEMS)
+        RebuildIndex();
+}
+
+void XElement::RebuildIndex()
+{
+    if(SubItems.Num() < XCONFIG_INDEX_MIN_ITEMS)
+    {
+        nameIndex.Clear();
+        nextSameName.Clear();
+        numIndexedNames = 0;
+        return;
+    }
+
+    //keep the table at most half full
+    nameIndex.SetSize(RoundUpPow2(SubItems.Num()*2));
+    zero(nameIndex.Array(), nameIndex.Num()*sizeof(XNameIndexEntry));
+    nextSameName.SetSize(0);
+    numIndexedNames = 0;
+
+    for(UINT i=0; i<SubItems.Num(); i++)
+        AddToIndex(i);
+}
+
+void XElement::AddToIndex(UINT id)
+{
+    if((numIndexedNames+1)*2 > nameIndex.Num())
+    {
+        RebuildIndex();
+        return;
+    }
+
+    XBaseItem *item = SubItems[id];
+    UINT mask = nameIndex.Num()-1;
+    UINT slot = GetIndexSlotHash(item->nameHash, item->type) & mask;
+
+    if(nextSameName.Num() <= id)
+        nextSameName.SetSize(id+1);
+    nextSameName[id] = 0;
+
+    while(true)
+    {
+        XNameIndexEntry &entry = nameIndex[slot];
+        if(!entry.first)
+        {
+            entry.first = entry.last = id+1;
+            ++numIndexedNames;
+            break;
+        }
+
+        XBaseItem *indexedItem = SubItems[entry.first-1];
+        if(indexedItem->type == item->type && indexedItem->nameHash == item->nameHash && indexedItem->strName.CompareI(item->strName))
+        {
+            nextSameName[entry.last-1] = id+1;
+            entry.last = id+1;
+            break;
+        }
+
+        slot = (slot+1) & mask;
+    }
+}
+
+//returns the SubItems index+1 of the first item with the name and type, or 0 if there isn't one.
+//follow nextSameName for the rest.
+UINT XElement::FindFirstItem(CTSTR lpName, int type) const
+{
+    UINT nameHash = HashName(lpName);
+    UINT mask = nameIndex.Num()-1;
+    UINT slot = GetIndexSlotHash(nameHash, type) & mask;
+
+    while(true)
+    {
+        const XNameIndexEntry &entry = nameIndex[slot];
+        if(!entry.first)
+            return 0;
+
+        XBaseItem *item = SubItems[entry.first-1];
+        if(item->type == type && item->nameHash == nameHash && item->strName.CompareI(lpName))
+            return entry.first;
+
+        slot = (slot+1) & mask;
+    }
+}
+
+//---------------------------
+
+static int ParseIntValue(CTSTR lpValue)
+{
+    if( (*LPWORD(lpValue) == 'x0') ||
+        (*LPWORD(lpValue) == 'X0') )
+    {
+        return tstring_base_to_uint(lpValue+2, NULL, 16);
+    }
+    else if(scmpi(lpValue, TEXT("true")) == 0)
+        return 1;
+    else if(scmpi(lpValue, TEXT("false")) == 0)
+        return 0;
+    else
+        return tstring_base_to_uint(lpValue, NULL, 0);
+}
+
 CTSTR XElement::GetString(CTSTR lpName, TSTR def) const
 {
     assert(lpName);
@@ -51,21 +321,7 @@ int   XElement::GetInt(CTSTR lpName, int def) const
 
     XDataItem *item = GetDataItem(lpName);
     if(item)
-    {
-        CTSTR lpValue = item->strData;
-
-        if( (*LPWORD(lpValue) == 'x0') ||
-            (*LPWORD(lpValue) == 'X0') )
-        {
-            return tstring_base_to_uint(lpValue+2, NULL, 16);
-        }
-        else if(scmpi(lpValue, TEXT("true")) == 0)
-            return 1;
-        else if(scmpi(lpValue, TEXT("false")) == 0)
-            return 0;
-        else
-            return tstring_base_to_uint(lpValue, NULL, 0);
-    }
+        return ParseIntValue(item->strData);
 
     return def;
 }
@@ -88,6 +344,13 @@ void  XElement::GetStringList(CTSTR lpName, StringList &stringList) const
 
     stringList.Clear();
 
+    if(nameIndex.Num())
+    {
+        for(UINT id=FindFirstItem(lpName, XConfig_Data); id; id=nextSameName[id-1])
+            stringList << static_cast<XDataItem*>(SubItems[id-1])->strData;
+        return;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(!SubItems[i]->IsData()) continue;
@@ -104,27 +367,20 @@ void  XElement::GetIntList(CTSTR lpName, List<int> &IntList) const
 
     IntList.Clear();
 
+    if(nameIndex.Num())
+    {
+        for(UINT id=FindFirstItem(lpName, XConfig_Data); id; id=nextSameName[id-1])
+            IntList << ParseIntValue(static_cast<XDataItem*>(SubItems[id-1])->strData);
+        return;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(!SubItems[i]->IsData()) continue;
 
         XDataItem *item = static_cast<XDataItem*>(SubItems[i]);
         if(item->strName.CompareI(lpName))
-        {
-            CTSTR lpValue = item->strData;
-
-            if( (*LPWORD(lpValue) == 'x0') ||
-                (*LPWORD(lpValue) == 'X0') )
-            {
-                IntList << tstring_base_to_uint(lpValue+2, NULL, 16);
-            }
-            else if(scmpi(lpValue, TEXT("true")) == 0)
-                IntList << 1;
-            else if(scmpi(lpValue, TEXT("false")) == 0)
-                IntList << 0;
-            else
-                IntList << tstring_base_to_uint(lpValue, NULL, 0);
-        }
+            IntList << ParseIntValue(item->strData);
     }
 }
 
@@ -142,7 +398,7 @@ void  XElement::SetString(CTSTR lpName, CTSTR lpString)
         return;
     }
 
-    SubItems << new XDataItem(lpName, lpString);
+    AppendItem(new(file) XDataItem(lpName, lpString));
 }
 
 void  XElement::SetInt(CTSTR lpName, int number)
@@ -158,7 +414,7 @@ void  XElement::SetInt(CTSTR lpName, int number)
         return;
     }
 
-    SubItems << new XDataItem(lpName, intStr);
+    AppendItem(new(file) XDataItem(lpName, intStr));
 }
 
 void  XElement::SetFloat(CTSTR lpName, float number)
@@ -174,7 +430,7 @@ void  XElement::SetFloat(CTSTR lpName, float number)
         return;
     }
 
-    SubItems << new XDataItem(lpName, floatStr);
+    AppendItem(new(file) XDataItem(lpName, floatStr));
 }
 
 void  XElement::SetHex(CTSTR lpName, DWORD hex)
@@ -191,7 +447,7 @@ void  XElement::SetHex(CTSTR lpName, DWORD hex)
         return;
     }
 
-    SubItems << new XDataItem(lpName, hexStr);
+    AppendItem(new(file) XDataItem(lpName, hexStr));
 }
 
 
@@ -232,21 +488,21 @@ void  XElement::AddString(CTSTR lpName, TSTR lpString)
 
     if(!lpString) lpString = TEXT("");
 
-    SubItems << new XDataItem(lpName, lpString);
+    AppendItem(new(file) XDataItem(lpName, lpString));
 }
 
 void  XElement::AddInt(CTSTR lpName, int number)
 {
     assert(lpName);
 
-    SubItems << new XDataItem(lpName, IntString(number));
+    AppendItem(new(file) XDataItem(lpName, IntString(number)));
 }
 
 void  XElement::AddFloat(CTSTR lpName, float number)
 {
     assert(lpName);
 
-    SubItems << new XDataItem(lpName, FloatString(number));
+    AppendItem(new(file) XDataItem(lpName, FloatString(number)));
 }
 
 void  XElement::AddHex(CTSTR lpName, DWORD hex)
@@ -256,7 +512,7 @@ void  XElement::AddHex(CTSTR lpName, DWORD hex)
     String hexStr;
     hexStr << TEXT("0x") << IntString(hex, 16);
 
-    SubItems << new XDataItem(lpName, hexStr);
+    AppendItem(new(file) XDataItem(lpName, hexStr));
 }
 
 
@@ -336,6 +592,8 @@ void  XElement::RemoveItem(CTSTR lpName)
             SubItems.Remove(i--);
         }
     }
+
+    RebuildIndex();
 }
 
 //---------------------------
@@ -345,6 +603,12 @@ XElement* XElement::GetElement(CTSTR lpName) const
     if (!lpName)
         return NULL;
 
+    if(nameIndex.Num())
+    {
+        UINT id = FindFirstItem(lpName, XConfig_Element);
+        return id ? static_cast<XElement*>(SubItems[id-1]) : NULL;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(!SubItems[i]->IsElement()) continue;
@@ -378,7 +642,16 @@ XElement* XElement::GetElementByItem(CTSTR lpName, CTSTR lpItemName, CTSTR lpIte
     assert(lpItemName);
     assert(lpItemValue);
 
-    if(lpName)
+    if(lpName && nameIndex.Num())
+    {
+        for(UINT id=FindFirstItem(lpName, XConfig_Element); id; id=nextSameName[id-1])
+        {
+            XElement *element = static_cast<XElement*>(SubItems[id-1]);
+            if(scmpi(element->GetString(lpItemName), lpItemValue) == 0)
+                return element;
+        }
+    }
+    else if(lpName)
     {
         for(DWORD i=0; i<SubItems.Num(); i++)
         {
@@ -411,9 +684,9 @@ XElement* XElement::CreateElement(CTSTR lpName)
 {
     assert(lpName);
 
-    XElement *newElement = new XElement(file, this, lpName);
+    XElement *newElement = new(file) XElement(file, this, lpName);
 
-    SubItems << newElement;
+    AppendItem(newElement);
 
     return newElement;
 }
@@ -425,7 +698,7 @@ XElement* XElement::NewElementCopy(XElement* element, bool bSelfAsRoot)
    if (bSelfAsRoot) {
         newElement = this;
    } else {
-        newElement = new XElement(this->file, this, element->strName);
+        newElement = new(file) XElement(this->file, this, element->strName);
    }
 
    for(DWORD i=0; i < element->SubItems.Num(); i++)
@@ -433,9 +706,9 @@ XElement* XElement::NewElementCopy(XElement* element, bool bSelfAsRoot)
         XBaseItem *sub = element->SubItems[i];
         if (sub->GetType() == XConfig_Data) {
            XDataItem *subdata = static_cast<XDataItem *>(sub);
-           newElement->SubItems << new XDataItem(subdata->strName, subdata->strData);
+           newElement->AppendItem(new(file) XDataItem(subdata->strName, subdata->strData));
         } else {
-           newElement->SubItems << newElement->NewElementCopy( static_cast<XElement *>(sub), false );
+           newElement->AppendItem(newElement->NewElementCopy( static_cast<XElement *>(sub), false ));
         }
    }
 
@@ -447,11 +720,11 @@ XElement* XElement::CopyElement(XElement* element, CTSTR lpNewName)
    assert(lpNewName);
    assert(element);
 
-   XElement *newElement = new XElement(file, this, lpNewName);
+   XElement *newElement = new(file) XElement(file, this, lpNewName);
 
    newElement->NewElementCopy(element, true);
 
-   SubItems << newElement;
+   AppendItem(newElement);
 
    return newElement;
 }
@@ -460,12 +733,13 @@ XElement* XElement::InsertElement(UINT pos, CTSTR lpName)
 {
     assert(lpName);
 
-    XElement *newElement = new XElement(file, this, lpName);
+    XElement *newElement = new(file) XElement(file, this, lpName);
 
     if(pos > SubItems.Num())
         pos = SubItems.Num();
 
     SubItems.Insert(pos, newElement);
+    RebuildIndex();
 
     return newElement;
 }
@@ -474,6 +748,13 @@ void  XElement::GetElementList(CTSTR lpName, List<XElement*> &Elements) const
 {
     Elements.Clear();
 
+    if(lpName && nameIndex.Num())
+    {
+        for(UINT id=FindFirstItem(lpName, XConfig_Element); id; id=nextSameName[id-1])
+            Elements << static_cast<XElement*>(SubItems[id-1]);
+        return;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(!SubItems[i]->IsElement()) continue;
@@ -494,6 +775,7 @@ void  XElement::RemoveElement(XElement *element)
         {
             SubItems.Remove(i);
             delete element;
+            RebuildIndex();
             break;
         }
     }
@@ -514,11 +796,19 @@ void  XElement::RemoveElement(CTSTR lpName)
             SubItems.Remove(i--);
         }
     }
+
+    RebuildIndex();
 }
 
 
 XDataItem* XElement::GetDataItem(CTSTR lpName) const
 {
+    if(nameIndex.Num())
+    {
+        UINT id = FindFirstItem(lpName, XConfig_Data);
+        return id ? static_cast<XDataItem*>(SubItems[id-1]) : NULL;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(!SubItems[i]->IsData()) continue;
@@ -550,6 +840,17 @@ XDataItem* XElement::GetDataItemByID(DWORD itemID) const
 
 XBaseItem* XElement::GetBaseItem(CTSTR lpName) const
 {
+    if(nameIndex.Num())
+    {
+        UINT dataID = FindFirstItem(lpName, XConfig_Data);
+        UINT elementID = FindFirstItem(lpName, XConfig_Element);
+
+        if(dataID && (!elementID || dataID < elementID))
+            return SubItems[dataID-1];
+
+        return elementID ? SubItems[elementID-1] : NULL;
+    }
+
     for(DWORD i=0; i<SubItems.Num(); i++)
     {
         if(SubItems[i]->strName.CompareI(lpName))
@@ -626,7 +927,10 @@ void XElement::MoveUp()
             if(baseItem == this)
             {
                 if(lastElement != INVALID)
+                {
                     parent->SubItems.SwapValues(lastElement, i);
+                    parent->RebuildIndex();
+                }
 
                 break;
             }
@@ -647,7 +951,10 @@ void XElement::MoveDown()
             if(baseItem == this)
             {
                 if(lastElement != INVALID)
+                {
                     parent->SubItems.SwapValues(lastElement, (UINT)i);
+                    parent->RebuildIndex();
+                }
 
                 break;
             }
@@ -662,6 +969,7 @@ void XElement::MoveToTop()
     XElement *thisItem = this;
     parent->SubItems.RemoveItem(thisItem);
     parent->SubItems.Insert(0, thisItem);
+    parent->RebuildIndex();
 }
 
 void XElement::MoveToBottom()
@@ -669,6 +977,7 @@ void XElement::MoveToBottom()
     XElement *thisItem = this;
     parent->SubItems.RemoveItem(thisItem);
     parent->SubItems.Add(thisItem);
+    parent->RebuildIndex();
 }
 
 bool XElement::Import(CTSTR lpFile)
@@ -893,7 +1202,7 @@ bool  XConfig::ReadFileData2(XElement *curElement, int level, TSTR &lpTemp, bool
                 if (*lpTemp == '}')
                     lpTemp--;
 
-                curElement->SubItems << new XDataItem(strName, data);
+                curElement->AppendItem(new(this) XDataItem(strName, data));
             }
         }
 
@@ -1025,7 +1334,7 @@ bool  XConfig::ParseString(const String& config)
     String safe_copy = config;
     TSTR lpTemp = safe_copy;
 
-    RootElement = new XElement(this, NULL, TEXT("Root"));
+    RootElement = new(this) XElement(this, NULL, TEXT("Root"));
 
     if(!ReadFileData2(RootElement, 0, lpTemp, true))
     {
@@ -1057,7 +1366,7 @@ bool  XConfig::Open(CTSTR lpFile)
     if(!file.Open(lpFile, XFILE_READ, XFILE_OPENALWAYS))
         return false;
 
-    RootElement = new XElement(this, NULL, TEXT("Root"));
+    RootElement = new(this) XElement(this, NULL, TEXT("Root"));
     strFileName = lpFile;
 
     DWORD dwFileSize = (DWORD)file.GetFileSize();
@@ -1125,6 +1434,9 @@ void  XConfig::Close(bool bSave)
     delete RootElement;
     RootElement = NULL;
 
+    delete arena;
+    arena = NULL;
+
     strFileName.Clear();
 }
 
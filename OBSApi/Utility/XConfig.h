@@ -23,32 +23,49 @@
 //A compact JSON implementation
 
 
+//elements with at least this many sub-items keep a hash index of their names
+#define XCONFIG_INDEX_MIN_ITEMS 8
+
 enum
 {
     XConfig_Data,
     XConfig_Element
 };
 
+class XConfig;
+class XElement;
+
 class BASE_EXPORT XBaseItem
 {
     friend class XElement;
     friend class XConfig;
 
 protected:
-    inline XBaseItem(int type, CTSTR lpName) : type(type), strName(lpName) {}
+    inline XBaseItem(int type, CTSTR lpName) : type(type), strName(lpName), nameHash(HashName(lpName)), parent(NULL) {}
 
     virtual ~XBaseItem() {}
 
     String strName;
     int type;
+    UINT nameHash;
+
+    XElement *parent;
 
 public:
+    //items are allocated from the arena of the config that owns them
+    static void* operator new(size_t size, XConfig *config);
+    static void  operator delete(void *lpData, XConfig *config);
+    static void  operator delete(void *lpData);
+
+    //case-insensitive, matches String::CompareI
+    static UINT HashName(CTSTR lpName);
+
     inline int GetType() const     {return type;}
     inline bool IsData() const     {return type == XConfig_Data;}
     inline bool IsElement() const  {return type == XConfig_Element;}
 
     inline CTSTR GetName() const        {return strName;}
-    inline void  SetName(CTSTR lpName)  {strName = lpName;}
+    void  SetName(CTSTR lpName);
 };
 
 
@@ -70,18 +87,36 @@ public:
 };
 
 
+struct XNameIndexEntry
+{
+    UINT first, last;   //SubItems index+1 of the first and last item with this name and type, 0 if unused
+};
+
 class BASE_EXPORT XElement : public XBaseItem
 {
+    friend class XBaseItem;
     friend class XConfig;
 
     XConfig *file;
 
-    XElement *parent;
     List<XBaseItem*> SubItems;
 
+    //name index over SubItems, empty while there are fewer than XCONFIG_INDEX_MIN_ITEMS.  it is
+    //only changed along with SubItems, so lookups never write to the element.
+    List<XNameIndexEntry> nameIndex;
+    List<UINT> nextSameName;    //per sub-item, index+1 of the next sub-item with the same name and type
+    UINT numIndexedNames;
+
     inline XElement(XConfig *XConfig, XElement *parentElement, CTSTR lpName)
-        : XBaseItem(XConfig_Element, lpName), parent(parentElement), file(XConfig)
-    {}
+        : XBaseItem(XConfig_Element, lpName), file(XConfig), numIndexedNames(0)
+    {
+        parent = parentElement;
+    }
+
+    void AppendItem(XBaseItem *item);
+    void RebuildIndex();
+    void AddToIndex(UINT id);
+    UINT FindFirstItem(CTSTR lpName, int type) const;
 
 protected:
     ~XElement();
@@ -95,16 +130,13 @@ public:
         UINT count = SubItems.Num()/2;
         for(UINT i=0; i<count; i++)
             SubItems.SwapValues(i, SubItems.Num()-1-i);
+
+        RebuildIndex();
     }
 
     inline bool HasItem(CTSTR lpName) const
     {
-        for (UINT i=0; i<SubItems.Num(); i++) {
-            if (SubItems[i]->strName.CompareI(lpName))
-                return true;
-        }
-
-        return false;
+        return GetBaseItem(lpName) != NULL;
     }
 
     CTSTR GetString(CTSTR lpName, TSTR def=NULL) const;
@@ -205,10 +237,14 @@ public:
 };
 
 
+struct XConfigArena;
+
 class BASE_EXPORT XConfig
 {
+    friend class XBaseItem;
     friend class XElement;
 
+    XConfigArena *arena;
     XElement *RootElement;
     String strFileName;
 
@@ -222,8 +258,8 @@ class BASE_EXPORT XConfig
     bool ReadFileData2(XElement *curElement, int level, TSTR &lpFileData, bool isJSON);
 
 public:
-    inline XConfig() : RootElement(NULL) {}
-    inline XConfig(TSTR lpFile) : RootElement(NULL) {Open(lpFile);}
+    inline XConfig() : RootElement(NULL), arena(NULL) {}
+    inline XConfig(TSTR lpFile) : RootElement(NULL), arena(NULL) {Open(lpFile);}
 
     inline ~XConfig() {Close();}
 
@@ -48,7 +48,7 @@
 
 String::String()
 {
-    curLength = 0;
+    curLength = capacity = 0;
     lpString = NULL;
 }
 
@@ -57,7 +57,7 @@ String::String(LPCSTR str)
 #ifdef UNICODE
     if(!str)
     {
-        curLength = 0;
+        curLength = capacity = 0;
         lpString = NULL;
         return;
     }
@@ -67,15 +67,19 @@ String::String(LPCSTR str)
 
     if(curLength)
     {
-        lpString = (TSTR)Allocate((curLength+1)*sizeof(wchar_t));
+        capacity = curLength+1;
+        lpString = (TSTR)Allocate(capacity*sizeof(wchar_t));
         utf8_to_wchar(str, utf8Len+1, lpString, curLength+1, 0);
     }
     else
+    {
+        capacity = 0;
         lpString = NULL;
+    }
 #else
     if(!str)
     {
-        curLength = 0;
+        curLength = capacity = 0;
         lpString = NULL;
         return;
     }
@@ -84,11 +88,15 @@ String::String(LPCSTR str)
 
     if(curLength)
     {
-        lpString = (TSTR)Allocate(curLength+1);
+        capacity = curLength+1;
+        lpString = (TSTR)Allocate(capacity);
         scpy(lpString, str);
     }
     else
+    {
+        capacity = 0;
         lpString = NULL;
+    }
 #endif
 }
 
@@ -97,7 +105,7 @@ String::String(CWSTR str)
 #ifdef UNICODE
     if(!str)
     {
-        curLength = 0;
+        curLength = capacity = 0;
         lpString = NULL;
         return;
     }
@@ -106,15 +114,19 @@ String::String(CWSTR str)
 
     if(curLength)
     {
-        lpString = (TSTR)Allocate((curLength+1)*sizeof(TCHAR));
+        capacity = curLength+1;
+        lpString = (TSTR)Allocate(capacity*sizeof(TCHAR));
         scpy(lpString, str);
     }
     else
+    {
+        capacity = 0;
         lpString = NULL;
+    }
 #else
     if(!str)
     {
-        curLength = 0;
+        curLength = capacity = 0;
         lpString = NULL;
         return;
     }
@@ -124,11 +136,15 @@ String::String(CWSTR str)
 
     if(curLength)
     {
-        lpString = (TSTR)Allocate(curLength+1);
+        capacity = curLength+1;
+        lpString = (TSTR)Allocate(capacity);
         wchar_to_utf8(str, wideLen+1, lpString, curLength+1, 0);
     }
     else
+    {
+        capacity = 0;
         lpString = NULL;
+    }
 #endif
 }
 
@@ -137,11 +153,15 @@ String::String(const String &str)
     curLength = str.curLength;
     if(curLength)
     {
-        lpString = (TSTR)Allocate((curLength+1)*sizeof(TCHAR));
-        scpy(lpString, str.lpString);
+        capacity = curLength+1;
+        lpString = (TSTR)Allocate(capacity*sizeof(TCHAR));
+        mcpy(lpString, str.lpString, capacity*sizeof(TCHAR));
     }
     else
+    {
+        capacity = 0;
         lpString = NULL;
+    }
 }
 
 
@@ -152,24 +172,67 @@ String::~String()
 }
 
 
-String& String::operator=(CTSTR str)
+//grows by at least half the current size, so building a string up a piece at a time doesn't
+//reallocate on every append.  the buffer is only given back by Clear or SetLength(0).
+void String::GrowCapacity(UINT length)
 {
-    if(!str)
-        curLength = 0;
-    else
-        curLength = slen(str);
+    if(length+1 <= capacity)
+        return;
 
-    if(curLength)
+    capacity = MAX(length+1, capacity+(capacity>>1));
+    lpString = (TSTR)ReAllocate(lpString, capacity*sizeof(TCHAR));
+}
+
+void String::AppendData(CTSTR str, UINT length)
+{
+    if(!length)
+        return;
+
+    //appending part of ourselves
+    if(lpString && str >= lpString && str < lpString+capacity)
     {
-        lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
-        scpy(lpString, str);
+        UPARAM offset = UPARAM(str-lpString);
+        GrowCapacity(curLength+length);
+        str = lpString+offset;
     }
     else
+        GrowCapacity(curLength+length);
+
+    mcpy(lpString+curLength, str, length*sizeof(TCHAR));
+    curLength += length;
+    lpString[curLength] = 0;
+}
+
+String& String::Reserve(UINT length)
+{
+    GrowCapacity(length);
+    if(!curLength)
+        *lpString = 0;
+
+    return *this;
+}
+
+
+String& String::operator=(CTSTR str)
+{
+    UINT length = str ? slen(str) : 0;
+
+    if(length)
     {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
+        //assigning part of ourselves, no need to grow
+        if(lpString && str >= lpString && str < lpString+capacity)
+        {
+            memmove(lpString, str, (length+1)*sizeof(TCHAR));
+            curLength = length;
+            return *this;
+        }
+
+        curLength = length;
+        GrowCapacity(curLength);
+        mcpy(lpString, str, (curLength+1)*sizeof(TCHAR));
     }
+    else
+        Clear();
 
     return *this;
 }
@@ -183,30 +246,7 @@ String& String::operator+=(CTSTR str)
     else
         strLength = slen(str);
 
-    if(!strLength)
-        return *this;
-
-    curLength += strLength;
-
-    if(curLength)
-    {
-        if(lpString)
-        {
-            lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
-            scat(lpString, str);
-        }
-        else
-        {
-            lpString = (TSTR)Allocate((curLength+1)*sizeof(TCHAR));
-            scpy(lpString, str);
-        }
-    }
-    else
-    {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
-    }
+    AppendData(str, strLength);
 
     return *this;
 }
@@ -220,7 +260,7 @@ String  String::operator+(CTSTR str) const
 String& String::operator=(TCHAR ch)
 {
     curLength = 1;
-    lpString = (TSTR)ReAllocate(lpString, 2);
+    GrowCapacity(1);
     *lpString = ch;
     lpString[1] = 0;
 
@@ -229,8 +269,7 @@ String& String::operator=(TCHAR ch)
 
 String& String::operator+=(TCHAR ch)
 {
-    ++curLength;
-    lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
+    GrowCapacity(++curLength);
     lpString[curLength-1] = ch;
     lpString[curLength]   = 0;
 
@@ -294,49 +333,25 @@ String  String::operator+(unsigned int unumber) const
 
 String& String::operator=(const String &str)
 {
+    if(&str == this)
+        return *this;
+
     curLength = str.curLength;
 
     if(curLength)
     {
-        lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
-        scpy(lpString, str.lpString);
+        GrowCapacity(curLength);
+        mcpy(lpString, str.lpString, (curLength+1)*sizeof(TCHAR));
     }
     else
-    {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
-    }
+        Clear();
 
     return *this;
 }
 
 String& String::operator+=(const String &str)
 {
-    if(!str.curLength)
-        return *this;
-
-    curLength += str.curLength;
-
-    if(curLength)
-    {
-        if(lpString)
-        {
-            lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
-            scat(lpString, str.lpString);
-        }
-        else
-        {
-            lpString = (TSTR)Allocate((curLength+1)*sizeof(TCHAR));
-            scpy(lpString, str.lpString);
-        }
-    }
-    else
-    {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
-    }
+    AppendData(str.lpString, str.curLength);
 
     return *this;
 }
@@ -476,7 +491,8 @@ String& String::FindReplace(CTSTR strFind, CTSTR strReplace)
         {
             curLength += (replaceLen-findLen)*nOccurences;
 
-            lpTemp = lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
+            GrowCapacity(curLength);
+            lpTemp = lpString;
 
             while(lpTemp = sstr(lpTemp, strFind))
             {
@@ -516,7 +532,7 @@ void String::InsertString(UINT dwPos, CTSTR str)
 
     if(strLength)
     {
-        lpString = (TSTR)ReAllocate(lpString, (curLength+strLength+1)*sizeof(TCHAR));
+        GrowCapacity(curLength+strLength);
 
         TSTR lpPos = lpString+dwPos;
         mcpyrev(lpPos+strLength, lpPos, ((curLength+1)-dwPos)*sizeof(TCHAR));
@@ -537,24 +553,7 @@ String& String::AppendString(CTSTR str, UINT count)
     else
         strLength = slen(str);
 
-    if(!strLength)
-        return *this;
-
-    UINT oldLen = curLength;
-
-    curLength += strLength;
-
-    if(curLength)
-    {
-        lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
-        scpy_n(lpString+oldLen, str, strLength);
-    }
-    else
-    {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
-    }
+    AppendData(str, strLength);
 
     return *this;
 }
@@ -587,7 +586,7 @@ String& String::Clear()
     if(lpString)
         Free(lpString);
     lpString = NULL;
-    curLength = 0;
+    curLength = capacity = 0;
 
     return *this;
 }
@@ -734,10 +733,10 @@ String& String::SetLength(UINT length)
 {
     UINT oldLength = curLength;
 
-    curLength = length;
-    if(curLength)
+    if(length)
     {
-        lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
+        GrowCapacity(length);
+        curLength = length;
 
         if(oldLength < curLength)
             zero(&lpString[oldLength], ((curLength+1)-oldLength)*sizeof(TCHAR));
@@ -745,11 +744,7 @@ String& String::SetLength(UINT length)
             lpString[length] = 0;
     }
     else
-    {
-        if(lpString)
-            Free(lpString);
-        lpString = NULL;
-    }
+        Clear();
 
     return *this;
 }
@@ -771,7 +766,6 @@ void String::RemoveRange(unsigned int from, unsigned int to)
     unsigned int remainderLength = (curLength+1)-to;
     curLength -= delLength;
     mcpy(lpString+from, lpString+to, remainderLength*sizeof(TCHAR));
-    lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
 }
 
 
@@ -788,8 +782,7 @@ String& String::InsertChar(UINT pos, TCHAR chr)
         return *this;
     }
     
-    ++curLength;
-    lpString = (TSTR)ReAllocate(lpString, (curLength+1)*sizeof(TCHAR));
+    GrowCapacity(++curLength);
     if(curLength > 1)
         mcpyrev(lpString+pos+1, lpString+pos, (curLength-pos)*sizeof(TCHAR));
 
@@ -813,7 +806,6 @@ String& String::RemoveChar(UINT pos)
     {
         if(pos < curLength)
             mcpy(lpString+pos, lpString+pos+1, (curLength-pos)*sizeof(TCHAR));
-        lpString = (TSTR)ReAllocate(lpString, (curLength)*sizeof(TCHAR));
         --curLength;
     }
 
@@ -853,6 +845,113 @@ String String::StringToRepresentation(String &string)
     return stringOut;
 }
 
+//-----------------------------------------
+
+StringBuilder::~StringBuilder()
+{
+    if(lpBuffer)
+        Free(lpBuffer);
+}
+
+void StringBuilder::Grow(UINT length)
+{
+    if(length+1 <= capacity)
+        return;
+
+    capacity = MAX(length+1, capacity+(capacity>>1));
+    if(capacity < 64)
+        capacity = 64;
+
+    lpBuffer = (TSTR)ReAllocate(lpBuffer, capacity*sizeof(TCHAR));
+}
+
+StringBuilder& StringBuilder::Reserve(UINT length)
+{
+    Grow(length);
+    lpBuffer[curLength] = 0;
+
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(CTSTR str, UINT length)
+{
+    if(!str || !length)
+        return *this;
+
+    if(lpBuffer && str >= lpBuffer && str < lpBuffer+capacity)
+    {
+        UPARAM offset = UPARAM(str-lpBuffer);
+        Grow(curLength+length);
+        str = lpBuffer+offset;
+    }
+    else
+        Grow(curLength+length);
+
+    mcpy(lpBuffer+curLength, str, length*sizeof(TCHAR));
+    curLength += length;
+    lpBuffer[curLength] = 0;
+
+    return *this;
+}
+
+StringBuilder& StringBuilder::Append(TCHAR ch)
+{
+    Grow(curLength+1);
+    lpBuffer[curLength++] = ch;
+    lpBuffer[curLength] = 0;
+
+    return *this;
+}
+
+StringBuilder& StringBuilder::AppendInt(INT64 val, int radix)
+{
+    TCHAR strNum[72];
+    i64tots_s(val, strNum, 72, radix);
+
+    return Append(strNum);
+}
+
+StringBuilder& StringBuilder::AppendUInt(UINT64 val, int radix)
+{
+    TCHAR strNum[72];
+    ui64tots_s(val, strNum, 72, radix);
+
+    return Append(strNum);
+}
+
+StringBuilder& StringBuilder::AppendFloat(double val, int precision)
+{
+    return AppendFormat(TEXT("%.*f"), precision, val);
+}
+
+StringBuilder& StringBuilder::AppendFormat(CTSTR lpFormat, ...)
+{
+    va_list args;
+    va_start(args, lpFormat);
+    AppendFormatva(lpFormat, args);
+    va_end(args);
+
+    return *this;
+}
+
+StringBuilder& StringBuilder::AppendFormatva(CTSTR lpFormat, va_list arglist)
+{
+    int iSize = vtscprintf(lpFormat, arglist);
+    if(iSize <= 0)
+        return *this;
+
+    Grow(curLength+iSize);
+
+    int retVal = vtsprintf_s(lpBuffer+curLength, iSize+1, lpFormat, arglist);
+    if(retVal > 0)
+        curLength += retVal;
+    lpBuffer[curLength] = 0;
+
+    return *this;
+}
+
+//-----------------------------------------
+
 String FormattedStringva(CTSTR lpFormat, va_list arglist)
 {
     int iSize = vtscprintf(lpFormat, arglist);
@@ -78,6 +78,10 @@ class BASE_EXPORT String
 {
     TSTR lpString;
     unsigned int curLength;
+    unsigned int capacity;      //characters lpString has room for, including the terminator
+
+    void GrowCapacity(UINT length);
+    void AppendData(CTSTR str, UINT length);
 
 public:
     String();
@@ -177,6 +181,7 @@ public:
     inline operator TSTR() const                {return lpString;}
 
     String& SetLength(UINT length);
+    String& Reserve(UINT length);
 
     inline UINT    Length() const               {return curLength;}
     inline UINT    DataLength() const           {return curLength ? ssize(lpString) : 0;}
@@ -192,6 +197,57 @@ public:
     BASE_EXPORT friend Serializer& operator<<(Serializer &s, String &str);
 };
 
+//builds text in a buffer that is kept between uses, so once it has grown to fit, formatting a log
+//line or a config key doesn't allocate.  numbers are formatted straight into the buffer.
+class BASE_EXPORT StringBuilder
+{
+    TSTR lpBuffer;
+    UINT curLength;
+    UINT capacity;
+
+    void Grow(UINT length);
+
+    StringBuilder(const StringBuilder&);
+    StringBuilder& operator=(const StringBuilder&);
+
+public:
+    inline StringBuilder() : lpBuffer(NULL), curLength(0), capacity(0) {}
+    ~StringBuilder();
+
+    StringBuilder& Append(CTSTR str, UINT length);
+    inline StringBuilder& Append(CTSTR str)             {return str ? Append(str, slen(str)) : *this;}
+    inline StringBuilder& Append(const String &str)     {return Append(str.Array(), str.Length());}
+    StringBuilder& Append(TCHAR ch);
+
+    StringBuilder& AppendInt(INT64 val, int radix=10);
+    StringBuilder& AppendUInt(UINT64 val, int radix=10);
+    StringBuilder& AppendFloat(double val, int precision=2);
+    StringBuilder& AppendFormat(CTSTR lpFormat, ...);
+    StringBuilder& AppendFormatva(CTSTR lpFormat, va_list arglist);
+
+    inline StringBuilder& operator<<(CTSTR str)         {return Append(str);}
+    inline StringBuilder& operator<<(const String &str) {return Append(str);}
+    inline StringBuilder& operator<<(TCHAR ch)          {return Append(ch);}
+    inline StringBuilder& operator<<(int val)           {return AppendInt(val);}
+    inline StringBuilder& operator<<(unsigned int val)  {return AppendUInt(val);}
+    inline StringBuilder& operator<<(long val)          {return AppendInt(val);}
+    inline StringBuilder& operator<<(unsigned long val) {return AppendUInt(val);}
+    inline StringBuilder& operator<<(INT64 val)         {return AppendInt(val);}
+    inline StringBuilder& operator<<(UINT64 val)        {return AppendUInt(val);}
+    inline StringBuilder& operator<<(double val)        {return AppendFloat(val);}
+
+    //empties the text but keeps the buffer
+    inline StringBuilder& Clear()                       {curLength = 0; if(lpBuffer) *lpBuffer = 0; return *this;}
+    StringBuilder& Reserve(UINT length);
+
+    inline CTSTR Array() const                          {return lpBuffer ? lpBuffer : TEXT("");}
+    inline operator CTSTR() const                       {return Array();}
+    inline UINT  Length() const                         {return curLength;}
+    inline BOOL  IsEmpty() const                        {return curLength == 0;}
+
+    inline String ToString() const                      {return String(Array());}
+};
+
 BASE_EXPORT String FormattedStringva(CTSTR lpFormat, va_list arglist);
 BASE_EXPORT String FormattedString(CTSTR lpFormat, ...);
 WORD StringCRC16(CTSTR lpData);
@@ -17,9 +17,11 @@
 ********************************************************************************/
 
 
+#include <windows.h>
 #include "XT.h"
 
 #include <memory>
+#include <algorithm>
 
 namespace
 {
@@ -58,6 +60,7 @@ XFile                   LogFile;
 XStringLog              StringLog;
 LogUpdateCallback       LogUpdateProc;
 StringList              TraceFuncList;
+HANDLE                  hLogMutex       = NULL;
 
 
 BOOL bLogStarted = FALSE;
@@ -69,6 +72,15 @@ void STDCALL CloseLogFile();
 void STDCALL OSInit();
 void STDCALL OSExit();
 
+void STDCALL ShutdownProfiler();
+void STDCALL FreeMetrics();
+void STDCALL ShutdownConfigSaving();
+
+static void StartLogWriter();
+static void StopLogWriter();
+static void FreeRetiredLogBuffers();
+static void FlushLogForCrash();
+
 BOOL STDCALL InitXT(CTSTR logFile, CTSTR allocatorName)
 {
     if(!bBaseLoaded)
@@ -88,12 +100,22 @@ BOOL STDCALL InitXT(CTSTR logFile, CTSTR allocatorName)
 
 void STDCALL InitXTLog(CTSTR logFile)
 {
-    if(logFile)
-        scpy(lpLogFileName, logFile);
+    if(!logFile)
+        return;
+
+    //the writer thread may be opening the file
+    if(hLogMutex) OSEnterMutex(hLogMutex);
+    scpy(lpLogFileName, logFile);
+    if(hLogMutex) OSLeaveMutex(hLogMutex);
 }
 
 void STDCALL ResetXTAllocator(CTSTR lpAllocator)
 {
+    //the thread log buffers come from the old allocator.  this only happens during startup before
+    //any other thread logs, and everything from the old allocator goes away with it anyway
+    StopLogWriter();
+    FreeRetiredLogBuffers();
+
     StringLog.Stop();
     StringLog.Clear();
 
@@ -106,6 +128,8 @@ void STDCALL ResetXTAllocator(CTSTR lpAllocator)
         MainAllocator = new DefaultAlloc;
     else if (scmpi(lpAllocator, TEXT("SeriousMemoryDebuggingAlloc")) == 0)
         MainAllocator = new SeriousMemoryDebuggingAlloc;
+    else if (scmpi(lpAllocator, TEXT("ThreadCacheAlloc")) == 0)
+        MainAllocator = new ThreadCacheAlloc;
     else
 #if defined(_M_X64) || defined(__amd64__)
         MainAllocator = new DefaultAlloc;
@@ -116,15 +140,22 @@ void STDCALL ResetXTAllocator(CTSTR lpAllocator)
     locale = new LocaleStringLookup;
 
     StringLog.Reset();
+
+    StartLogWriter();
 }
 
 void STDCALL TerminateXT()
 {
     if(bBaseLoaded)
     {
+        StopLogWriter();
+        FreeRetiredLogBuffers();
         StringLog.Stop();
 
+        ShutdownConfigSaving();
+        ShutdownProfiler();
         FreeProfileData();
+        FreeMetrics();
 
         delete locale;
         locale = NULL;
@@ -190,6 +221,8 @@ void STDCALL TraceCrashEnd()
 
     String strOut = FormattedString(TEXT("%s\r\n"), strStackTrace.Array());
 
+    FlushLogForCrash();
+
     OpenLogFile();
     LogFile.WriteAsUTF8(strOut, strOut.Length());
     LogFile.WriteAsUTF8(TEXT("\r\n"));
@@ -227,6 +260,428 @@ void STDCALL CloseLogFile()
 
 
 
+//-----------------------------------------
+//log writer
+//
+//lines are formatted on the calling thread and pushed to a ring owned by that thread.  the
+//writer thread drains every ring each LOG_WRITE_INTERVAL ms (sooner if one is getting full),
+//puts the lines back in order, and writes them to the file and the log window in one go, so
+//the update callback runs once per batch.  if a thread's ring is full the line is dropped and
+//counted.  when the writer isn't running (before InitXT, while the allocator is being reset,
+//after TerminateXT) or the thread is already exiting, lines are written right away under the
+//log mutex, and crashes flush whatever is queued.
+//
+//other threads can hold on to their buffer pointer for a moment after the writer stops, so the
+//buffers are only retired then and freed once everything is shut down.
+
+#define LOG_THREAD_BUFFER_SIZE  (64*1024)
+#define LOG_WRITE_INTERVAL      20
+#define LOG_WAKE_THRESHOLD      (LOG_THREAD_BUFFER_SIZE/2)
+#define LOG_CRASH_FLUSH_WAIT    500
+
+struct LogRecordHeader
+{
+    UINT sequence;
+    UINT length;            //characters, without the line break
+    BOOL bWarning;          //only goes to the file if something else has already started it
+};
+
+struct LogPendingLine
+{
+    UINT sequence;
+    UINT offset, length;
+    BOOL bWarning;
+};
+
+struct LogThreadBuffer
+{
+    SPSCByteRing ring;
+    StringBuilder line;                 //owning thread only
+    String strTime;                     //owning thread only, "hh:mm:ss: " for lastTime
+    time_t lastTime;
+    std::atomic<DWORD> numDropped;
+    DWORD numDroppedLogged;             //writer only
+    DWORD threadID;
+    std::atomic<bool> bExited;
+    LogThreadBuffer *next;
+};
+
+static __declspec(thread) LogThreadBuffer *curLogBuffer = NULL;
+static __declspec(thread) DWORD curLogGeneration = 0;
+static __declspec(thread) bool bCurLogThreadExited = false;
+static __declspec(thread) bool bFreeingLogFls = false;   //FlsFree runs every thread's callback on this one
+
+static LogThreadBuffer *logBuffers = NULL;
+static LogThreadBuffer *idleLogBuffers = NULL;
+static LogThreadBuffer *retiredLogBuffers = NULL;
+static std::atomic<DWORD> logGeneration(1);         //bumped whenever the buffers are retired
+static DWORD logFlsIndex = FLS_OUT_OF_INDEXES;
+static std::atomic<UINT> logSequence(0);
+static HANDLE hLogWriterThread = NULL;
+static HANDLE hLogWriterEvent = NULL;
+static std::atomic<bool> bStopLogWriter(false);
+
+static void WINAPI LogThreadExit(void *param)
+{
+    LogThreadBuffer *buffer = (LogThreadBuffer*)param;
+    if(!buffer)
+        return;
+
+    //on thread exit this runs on the exiting thread.  its buffer is handed to the next new thread
+    //once drained, so anything it logs from here on has to take the locked path instead
+    if(!bFreeingLogFls && buffer->threadID == GetCurrentThreadId())
+    {
+        curLogBuffer = NULL;
+        bCurLogThreadExited = true;
+    }
+
+    buffer->bExited.store(true, std::memory_order_release);
+}
+
+static LogThreadBuffer* GetLogThreadBuffer()
+{
+    if(bCurLogThreadExited)
+        return NULL;
+
+    if(curLogBuffer && curLogGeneration == logGeneration.load(std::memory_order_acquire))
+        return curLogBuffer;
+
+    if(!hLogWriterThread)
+        return NULL;
+
+    OSEnterMutex(hLogMutex);
+
+    if(!hLogWriterThread)
+    {
+        OSLeaveMutex(hLogMutex);
+        return NULL;
+    }
+
+    LogThreadBuffer *buffer = idleLogBuffers;
+    if(buffer)
+        idleLogBuffers = buffer->next;
+    else
+    {
+        buffer = new LogThreadBuffer;
+        buffer->ring.SetCapacity(LOG_THREAD_BUFFER_SIZE);
+    }
+
+    buffer->threadID = GetCurrentThreadId();
+    buffer->bExited.store(false, std::memory_order_relaxed);
+    buffer->next = logBuffers;
+    logBuffers = buffer;
+
+    curLogGeneration = logGeneration.load(std::memory_order_relaxed);
+
+    OSLeaveMutex(hLogMutex);
+
+    FlsSetValue(logFlsIndex, buffer);
+
+    curLogBuffer = buffer;
+    return buffer;
+}
+
+static void MoveLogBufferList(LogThreadBuffer *&from, LogThreadBuffer *&to)
+{
+    while(from)
+    {
+        LogThreadBuffer *next = from->next;
+        from->next = to;
+        to = from;
+        from = next;
+    }
+}
+
+static void FreeLogBufferList(LogThreadBuffer *&list)
+{
+    while(list)
+    {
+        LogThreadBuffer *next = list->next;
+        delete list;
+        list = next;
+    }
+}
+
+//always called with hLogMutex held
+static void WriteLogText(CTSTR lpFile, UINT fileLen, const String &strWindow)
+{
+    if(fileLen)
+    {
+        OpenLogFile();
+        LogFile.WriteAsUTF8(lpFile, fileLen);
+        CloseLogFile();
+    }
+
+    if(strWindow.IsValid())
+        StringLog.Append(strWindow, false);
+}
+
+//always called with hLogMutex held
+static void DrainLogBuffers()
+{
+    List<LogPendingLine> lines;
+    List<TCHAR> text;
+    StringList droppedLines;
+
+    LogThreadBuffer **prev = &logBuffers;
+    while(LogThreadBuffer *buffer = *prev)
+    {
+        //a record is always committed whole, so a header means the text is there too
+        LogRecordHeader header;
+        while(buffer->ring.NumQueued() >= sizeof(header))
+        {
+            buffer->ring.Read(&header, sizeof(header));
+
+            LogPendingLine &line = *lines.CreateNew();
+            line.sequence = header.sequence;
+            line.offset = text.Num();
+            line.length = header.length;
+            line.bWarning = header.bWarning;
+
+            text.SetSize(text.Num()+header.length);
+            buffer->ring.Read(text.Array()+line.offset, header.length*sizeof(TCHAR));
+        }
+
+        DWORD numDropped = buffer->numDropped.load(std::memory_order_relaxed);
+        if(numDropped != buffer->numDroppedLogged)
+        {
+            droppedLines << FormattedString(TEXT("%s: Log: dropped %u lines from thread %u, its log buffer was full"),
+                CurrentTimeString().Array(), numDropped-buffer->numDroppedLogged, buffer->threadID);
+            buffer->numDroppedLogged = numDropped;
+        }
+
+        //the thread is gone, its buffer can go to the next new thread
+        if(buffer->bExited.load(std::memory_order_acquire) && !buffer->ring.NumQueued())
+        {
+            *prev = buffer->next;
+
+            buffer->line.Clear();
+            buffer->strTime.Clear();
+            buffer->lastTime = 0;
+            buffer->numDropped.store(0, std::memory_order_relaxed);
+            buffer->numDroppedLogged = 0;
+            buffer->next = idleLogBuffers;
+            idleLogBuffers = buffer;
+        }
+        else
+            prev = &buffer->next;
+    }
+
+    if(!lines.Num() && !droppedLines.Num())
+        return;
+
+    std::sort(lines.Array(), lines.Array()+lines.Num(), [](const LogPendingLine &a, const LogPendingLine &b)
+    {
+        return int(a.sequence-b.sequence) < 0;
+    });
+
+    String strFile, strWindow;
+    BOOL bStartLog = bLogStarted;
+
+    for(UINT i=0; i<lines.Num(); i++)
+    {
+        LogPendingLine &line = lines[i];
+        CTSTR lpLine = text.Array()+line.offset;
+
+        if(!line.bWarning)
+            bStartLog = TRUE;
+
+        if(bStartLog)
+            strFile.AppendString(lpLine, line.length).AppendString(TEXT("\r\n"));
+        strWindow.AppendString(lpLine, line.length).AppendString(TEXT("\r\n"));
+    }
+
+    for(UINT i=0; i<droppedLines.Num(); i++)
+    {
+        strFile << droppedLines[i] << TEXT("\r\n");
+        strWindow << droppedLines[i] << TEXT("\r\n");
+    }
+
+    WriteLogText(strFile, strFile.Length(), strWindow);
+}
+
+static DWORD STDCALL LogWriterThread(LPVOID param)
+{
+    while(!bStopLogWriter.load())
+    {
+        OSWaitForEvent(hLogWriterEvent, LOG_WRITE_INTERVAL);
+
+        OSEnterMutex(hLogMutex);
+        DrainLogBuffers();
+        OSLeaveMutex(hLogMutex);
+    }
+
+    return 0;
+}
+
+static void StartLogWriter()
+{
+    if(hLogWriterThread)
+        return;
+
+    if(logFlsIndex == FLS_OUT_OF_INDEXES)
+    {
+        logFlsIndex = FlsAlloc(LogThreadExit);
+        if(logFlsIndex == FLS_OUT_OF_INDEXES)
+            return; //just write synchronously
+    }
+
+    bStopLogWriter = false;
+    hLogWriterEvent = OSCreateEvent();
+    hLogWriterThread = OSCreateThread((XTHREAD)LogWriterThread, NULL);
+}
+
+static void StopLogWriter()
+{
+    if(hLogWriterThread)
+    {
+        bStopLogWriter = true;
+        OSSignalEvent(hLogWriterEvent);
+        OSWaitForThread(hLogWriterThread, NULL);
+        OSCloseThread(hLogWriterThread);
+        OSCloseEvent(hLogWriterEvent);
+    }
+
+    if(!hLogMutex)
+        return;
+
+    OSEnterMutex(hLogMutex);
+
+    if(hLogWriterThread)
+    {
+        DrainLogBuffers();
+        hLogWriterThread = hLogWriterEvent = NULL;
+    }
+
+    //threads that already got past the generation check in GetLogThreadBuffer may still write to
+    //their old buffer, so nothing is freed here
+    logGeneration.fetch_add(1, std::memory_order_release);
+
+    //calls LogThreadExit for every thread still holding a buffer
+    if(logFlsIndex != FLS_OUT_OF_INDEXES)
+    {
+        bFreeingLogFls = true;
+        FlsFree(logFlsIndex);
+        bFreeingLogFls = false;
+        logFlsIndex = FLS_OUT_OF_INDEXES;
+    }
+
+    MoveLogBufferList(logBuffers, retiredLogBuffers);
+    MoveLogBufferList(idleLogBuffers, retiredLogBuffers);
+
+    OSLeaveMutex(hLogMutex);
+}
+
+//only once the writer is stopped.  anything written to a retired buffer late still gets out
+static void FreeRetiredLogBuffers()
+{
+    if(!hLogMutex)
+        return;
+
+    OSEnterMutex(hLogMutex);
+
+    logBuffers = retiredLogBuffers;
+    retiredLogBuffers = NULL;
+    DrainLogBuffers();
+
+    FreeLogBufferList(logBuffers);
+    FreeLogBufferList(idleLogBuffers);
+
+    OSLeaveMutex(hLogMutex);
+}
+
+//the writer might be the thread that crashed, so don't wait on it forever
+static void FlushLogForCrash()
+{
+    if(!hLogMutex || !hLogWriterThread)
+        return;
+
+    DWORD startTime = OSGetTime();
+    while(!OSTryEnterMutex(hLogMutex))
+    {
+        if((OSGetTime()-startTime) > LOG_CRASH_FLUSH_WAIT)
+            return;
+        OSSleep(1);
+    }
+
+    DrainLogBuffers();
+    OSLeaveMutex(hLogMutex);
+}
+
+//writes a line right away, after anything already queued
+static void WriteLogLineNow(CTSTR text, UINT len, BOOL bWarning)
+{
+    if(hLogMutex) OSEnterMutex(hLogMutex);
+
+    if(hLogWriterThread)
+        DrainLogBuffers();
+
+    if(!bWarning || bLogStarted)
+    {
+        OpenLogFile();
+        LogFile.WriteAsUTF8(text, len);
+        LogFile.WriteAsUTF8(TEXT("\r\n"));
+        CloseLogFile();
+    }
+
+    StringLog.Append(text, len);
+
+    if(hLogMutex) OSLeaveMutex(hLogMutex);
+}
+
+static void QueueLogLine(LogThreadBuffer *buffer, CTSTR text, UINT len, BOOL bWarning)
+{
+    LogRecordHeader header;
+    UINT textSize = len*sizeof(TCHAR);
+
+    if(!buffer || (sizeof(header)+textSize) > LOG_THREAD_BUFFER_SIZE)
+    {
+        WriteLogLineNow(text, len, bWarning);
+        return;
+    }
+
+    header.sequence = logSequence.fetch_add(1, std::memory_order_relaxed);
+    header.length = len;
+    header.bWarning = bWarning;
+
+    if(!buffer->ring.Write(&header, sizeof(header), text, textSize))
+    {
+        buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+        OSSignalEvent(hLogWriterEvent);
+        return;
+    }
+
+    if(buffer->ring.NumQueued() > LOG_WAKE_THRESHOLD)
+        OSSignalEvent(hLogWriterEvent);
+}
+
+//"hh:mm:ss: ", only reformatted when the second changes
+static const String& GetLogTimePrefix(LogThreadBuffer *buffer)
+{
+    time_t now = time(0);
+    if(now != buffer->lastTime || buffer->strTime.IsEmpty())
+    {
+        buffer->strTime = CurrentTimeString();
+        buffer->strTime << TEXT(": ");
+        buffer->lastTime = now;
+    }
+
+    return buffer->strTime;
+}
+
+void STDCALL FlushLog()
+{
+    if(!hLogMutex || !hLogWriterThread)
+        return;
+
+    OSEnterMutex(hLogMutex);
+    if(hLogWriterThread)
+        DrainLogBuffers();
+    OSLeaveMutex(hLogMutex);
+}
+
+//-----------------------------------------
+
 void __cdecl LogRaw(const TCHAR *text, UINT len)
 {
     if(!text) return;
@@ -234,12 +689,7 @@ void __cdecl LogRaw(const TCHAR *text, UINT len)
     if (!len)
         len = slen(text);
 
-    OpenLogFile();
-    LogFile.WriteAsUTF8(text, len);
-    LogFile.WriteAsUTF8(TEXT("\r\n"));
-    CloseLogFile();
-
-    StringLog.Append(text, len);
+    QueueLogLine(GetLogThreadBuffer(), text, len, FALSE);
 }
 
 void __cdecl Logva(const TCHAR *format, va_list argptr)
@@ -251,19 +701,35 @@ void __cdecl Logva(const TCHAR *format, va_list argptr)
     OSDebugOut(L"\n");
 #endif
 
-    String strCurTime = CurrentTimeString();
-    strCurTime << TEXT(": ");
-    String strOut = strCurTime;
-    strOut << FormattedStringva(format, argptr);
+    LogThreadBuffer *buffer = GetLogThreadBuffer();
+    if(!buffer)
+    {
+        String strCurTime = CurrentTimeString();
+        strCurTime << TEXT(": ");
+        String strOut = strCurTime;
+        strOut << FormattedStringva(format, argptr);
 
-    strOut.FindReplace(TEXT("\n"), String() << TEXT("\n") << strCurTime);
+        strOut.FindReplace(TEXT("\n"), String() << TEXT("\n") << strCurTime);
 
-    OpenLogFile();
-    LogFile.WriteAsUTF8(strOut, strOut.Length());
-    LogFile.WriteAsUTF8(TEXT("\r\n"));
-    CloseLogFile();
+        WriteLogLineNow(strOut, strOut.Length(), FALSE);
+        return;
+    }
+
+    const String &strCurTime = GetLogTimePrefix(buffer);
 
-    StringLog.Append(strOut);
+    StringBuilder &line = buffer->line;
+    line.Clear() << strCurTime;
+    line.AppendFormatva(format, argptr);
+
+    //every line of a multi-line message gets the time
+    if(schr(line.Array()+strCurTime.Length(), '\n'))
+    {
+        String strOut = line.Array();
+        strOut.FindReplace(TEXT("\n"), String() << TEXT("\n") << strCurTime);
+        QueueLogLine(buffer, strOut, strOut.Length(), FALSE);
+    }
+    else
+        QueueLogLine(buffer, line.Array(), line.Length(), FALSE);
 }
 
 void __cdecl Log(const TCHAR *format, ...)
@@ -286,15 +752,21 @@ void __cdecl AppWarning(const TCHAR *format, ...)
 
     va_start(arglist, format);
 
-    String strOut(L"Warning -- ");
-    strOut << FormattedStringva(format, arglist);
+    LogThreadBuffer *buffer = GetLogThreadBuffer();
+    if(buffer)
+    {
+        StringBuilder &line = buffer->line;
+        line.Clear() << TEXT("Warning -- ");
+        line.AppendFormatva(format, arglist);
 
-    if(bLogStarted)
+        QueueLogLine(buffer, line.Array(), line.Length(), TRUE);
+    }
+    else
     {
-        OpenLogFile();
-        LogFile.WriteAsUTF8(strOut, strOut.Length());
-        LogFile.WriteAsUTF8(TEXT("\r\n"));
-        CloseLogFile();
+        String strOut(L"Warning -- ");
+        strOut << FormattedStringva(format, arglist);
+
+        WriteLogLineNow(strOut, strOut.Length(), TRUE);
     }
 
     OSDebugOut(TEXT("Warning -- "));
@@ -314,8 +786,6 @@ void __cdecl AppWarning(const TCHAR *format, ...)
         ProgramBreak();
     }
 #endif
-
-    StringLog.Append(strOut);
 }
 
 
@@ -329,6 +799,8 @@ __declspec(noreturn) void __cdecl CrashError(const TCHAR *format, ...)
     String strOut(L"\r\nError: ");
     strOut << FormattedStringva(format, arglist);
 
+    FlushLogForCrash();
+
     OpenLogFile();
     LogFile.WriteAsUTF8(strOut);
     LogFile.WriteStr(TEXT("\r\n"));
@@ -353,6 +825,8 @@ __declspec(noreturn) void __cdecl DumpError(const TCHAR *format, ...)
     String strOut(L"\r\nError: ");
     strOut << FormattedStringva(format, arglist);
 
+    FlushLogForCrash();
+
     OpenLogFile();
     LogFile.WriteAsUTF8(strOut);
     LogFile.WriteStr(TEXT("\r\n"));
@@ -390,6 +864,7 @@ String CurrentLogFilename()
 
 void ReadLog(String &data)
 {
+    FlushLog();
     StringLog.Read(data);
 }
 
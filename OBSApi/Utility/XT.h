@@ -27,6 +27,7 @@
 #include <string.h>
 #include <crtdbg.h>
 #include <new>
+#include <atomic>
 
 #include <math.h>
 #include <float.h>
@@ -162,6 +163,10 @@ BASE_EXPORT BOOL   STDCALL OSTryEnterMutex(HANDLE hMutex);
 BASE_EXPORT void   STDCALL OSLeaveMutex(HANDLE hMutex);
 BASE_EXPORT void   STDCALL OSCloseMutex(HANDLE hMutex);
 
+BASE_EXPORT HANDLE STDCALL OSCreateEvent(BOOL bManualReset=FALSE);
+BASE_EXPORT void   STDCALL OSSignalEvent(HANDLE hEvent);
+BASE_EXPORT void   STDCALL OSResetEvent(HANDLE hEvent);
+BASE_EXPORT BOOL   STDCALL OSWaitForEvent(HANDLE hEvent, DWORD dwMSeconds=WAIT_INFINITE);
 BASE_EXPORT void           OSCloseEvent(HANDLE event);
 
 BASE_EXPORT void   STDCALL OSSetMainAppWindow(HANDLE window);
@@ -207,6 +212,7 @@ BASE_EXPORT String CurrentLogFilename();
 BASE_EXPORT void ReadLog(String &data); // do not call this while other threads use any logging functions
 BASE_EXPORT void ReadLogPartial(String &data, unsigned &start, unsigned maxLength=UINT_MAX);
 BASE_EXPORT void ResetLogUpdateCallback(LogUpdateCallback = nullptr);
+BASE_EXPORT void STDCALL FlushLog(); //waits until everything logged so far has been written
 
 //-----------------------------------------
 //Base functions
@@ -311,12 +317,14 @@ BASE_EXPORT extern BOOL bDebugBreak;
 #include "Alloc.h"
 #include "FastAlloc.h"
 #include "DebugAlloc.h"
+#include "ThreadCacheAlloc.h"
 #include "Template.h"
 #include "XString.h"
 #include "XMath.h"
 #include "ConfigFile.h"
 #include "XFile.h"
 #include "Profiler.h"
+#include "Metrics.h"
 #include "XTLocalization.h"
 #include "XConfig.h"
 
@@ -22,209 +22,236 @@
 
 
 
-struct StringLookupNode
+//compiled string tables are written to the per-user cache directory and are used instead of parsing
+//the text file they come from as long as that file hasn't changed since.  the install directory is
+//usually read-only, so they don't go next to the text file
+#define LOCALE_COMPILED_SIGNATURE   0x424C434C  //'LCLB'
+#define LOCALE_COMPILED_VERSION     1
+
+struct LocaleCompiledHeader
 {
-    String str;
-    List<StringLookupNode*> subNodes;
-    LocaleStringItem *leaf;
+    DWORD signature;
+    DWORD version;
+    DWORD charSize;
+    DWORD numStrings;
+    QWORD sourceTime;
+};
 
-    inline ~StringLookupNode()
-    {
-        for(unsigned int i=0; i<subNodes.Num(); i++)
-            delete subNodes[i];
-    }
+//FNV-1a with the same case folding scmpi uses
+static inline UINT HashLookupName(CTSTR lookupVal)
+{
+    UINT hash = 2166136261;
 
-    inline StringLookupNode* FindSubNodeByChar(TCHAR ch)
+    while(*lookupVal)
     {
-        for(unsigned int i=0; i<subNodes.Num(); i++)
-        {
-            StringLookupNode *node = subNodes[i];
-            if(node->str.IsValid() && node->str[0] == ch)
-                return subNodes[i];
-        }
+        TCHAR ch = *(lookupVal++);
+        if((ch >= 'A') && (ch <= 'Z'))
+            ch += 0x20;
 
-        return NULL;
+        hash = (hash ^ UINT(ch)) * 16777619;
     }
 
-    inline UINT FindSubNodeID(CTSTR lpLookup)
-    {
-        for(unsigned int i=0; i<subNodes.Num(); i++)
-        {
-            StringLookupNode *node = subNodes[i];
-            if(scmpi_n(node->str, lpLookup, node->str.Length()) == 0)
-                return i;
-        }
+    return hash;
+}
 
-        return INVALID;
-    }
 
-    inline StringLookupNode* FindSubNode(CTSTR lpLookup)
-    {
-        for(unsigned int i=0; i<subNodes.Num(); i++)
-        {
-            StringLookupNode *node = subNodes[i];
-            if(scmpi_n(node->str, lpLookup, node->str.Length()) == 0)
-                return subNodes[i];
-        }
+LocaleStringLookup *locale=NULL;
 
-        return NULL;
-    }
-};
+//not a String, this is set before the allocator gets swapped out at startup
+static TCHAR lpLocaleCacheDir[260] = TEXT("");
 
 
-LocaleStringLookup *locale=NULL;
+void STDCALL SetLocaleCacheDirectory(CTSTR lpDirectory)
+{
+    scpy_n(lpLocaleCacheDir, lpDirectory ? lpDirectory : TEXT(""), 259);
+}
+
+//locale/en.txt -> <cache dir>\locale_en.txt.bin, so files with the same name from different
+//directories (plugin locales are all en.txt etc) don't overwrite each other
+static BOOL GetCompiledFilePath(CTSTR lpFile, String &strCompiledFile)
+{
+    if(!*lpLocaleCacheDir)
+        return FALSE;
+
+    String strName = lpFile;
+    for(UINT i=0; i<strName.Length(); i++)
+    {
+        TCHAR ch = strName[i];
+        if(ch == '/' || ch == '\\' || ch == ':')
+            strName[i] = '_';
+    }
+
+    strCompiledFile.Clear() << lpLocaleCacheDir << TEXT("\\") << strName << TEXT(".bin");
+    return TRUE;
+}
 
 
 
 LocaleStringLookup::LocaleStringLookup()
 {
-    top = new StringLookupNode;
 }
 
 LocaleStringLookup::~LocaleStringLookup()
 {
     cache.Clear();
-    delete top;
 }
 
 
-void LocaleStringLookup::AddLookup(CTSTR lookupVal, LocaleStringItem *item, StringLookupNode *node)
+void LocaleStringLookup::AddToTable(LocaleStringItem *item)
 {
-    if(!node) node = top;
-
-    if(!lookupVal)
-        return;
-
-    if(!*lookupVal)
+    //keep the table at most half full
+    if(cache.Num()*2 > lookupTable.Num())
     {
-        delete node->leaf;
-        node->leaf = item;
+        RebuildTable();
         return;
     }
 
-    StringLookupNode *child = node->FindSubNodeByChar(*lookupVal);
+    UINT mask = lookupTable.Num()-1;
+    UINT slot = item->hash & mask;
 
-    if(child)
-    {
-        UINT len;
+    while(lookupTable[slot])
+        slot = (slot+1) & mask;
 
-        for(len=0; len<child->str.Length(); len++)
-        {
-            TCHAR val1 = child->str[len],
-                  val2 = lookupVal[len];
+    lookupTable[slot] = item;
+}
 
-            if((val1 >= 'A') && (val1 <= 'Z'))
-                val1 += 0x20;
-            if((val2 >= 'A') && (val2 <= 'Z'))
-                val2 += 0x20;
+void LocaleStringLookup::RebuildTable()
+{
+    lookupTable.SetSize(RoundUpPow2(MAX(cache.Num()*2, 64)));
+    zero(lookupTable.Array(), lookupTable.Num()*sizeof(LocaleStringItem*));
 
-            if(val1 != val2)
-                break;
-        }
+    UINT mask = lookupTable.Num()-1;
 
-        if(len == child->str.Length())
-            return AddLookup(lookupVal+len, item, child);
-        else
-        {
-            StringLookupNode *childSplit = new StringLookupNode;
-            childSplit->str = child->str.Array()+len;
-            childSplit->leaf = child->leaf;
-            childSplit->subNodes.TransferFrom(child->subNodes);
+    for(UINT i=0; i<cache.Num(); i++)
+    {
+        LocaleStringItem *item = cache[i];
+        UINT slot = item->hash & mask;
 
-            child->leaf = NULL;
-            child->str.SetLength(len);
+        while(lookupTable[slot])
+            slot = (slot+1) & mask;
 
-            child->subNodes << childSplit;
+        lookupTable[slot] = item;
+    }
+}
 
-            if(lookupVal[len] != 0)
-            {
-                StringLookupNode *newNode = new StringLookupNode;
-                newNode->leaf = item;
-                newNode->str  = lookupVal+len;
+LocaleStringItem* LocaleStringLookup::FindItem(CTSTR lookupVal) const
+{
+    if(!lookupVal || !lookupTable.Num())
+        return NULL;
 
-                child->subNodes << newNode;
-            }
-            else
-                child->leaf = item;
-        }
-    }
-    else
+    UINT hash = HashLookupName(lookupVal);
+    UINT mask = lookupTable.Num()-1;
+    UINT slot = hash & mask;
+
+    while(LocaleStringItem *item = lookupTable[slot])
     {
-        StringLookupNode *newNode = new StringLookupNode;
-        newNode->leaf = item;
-        newNode->str  = lookupVal;
+        if(item->hash == hash && item->lookup.CompareI(lookupVal))
+            return item;
 
-        node->subNodes << newNode;
+        slot = (slot+1) & mask;
     }
+
+    return NULL;
 }
 
-void LocaleStringLookup::RemoveLookup(CTSTR lookupVal, StringLookupNode *node)
+BOOL LocaleStringLookup::LoadCompiledFile(CTSTR lpFile, QWORD sourceTime)
 {
-    if(!node) node = top;
+    XFile file;
+    if(!file.Open(lpFile, XFILE_READ, XFILE_OPENEXISTING))
+        return FALSE;
 
-    UINT childID = node->FindSubNodeID(lookupVal);
-    if(childID == INVALID)
-        return;
+    DWORD fileSize = (DWORD)file.GetFileSize();
+    if(fileSize < sizeof(LocaleCompiledHeader))
+        return FALSE;
+
+    LPBYTE lpData = (LPBYTE)Allocate(fileSize);
+    BOOL bSuccess = (file.Read(lpData, fileSize) == fileSize);
+    file.Close();
 
-    StringLookupNode *child = node->subNodes[childID];
+    LocaleCompiledHeader *header = (LocaleCompiledHeader*)lpData;
 
-    lookupVal += child->str.Length();
-    TCHAR ch = *lookupVal;
-    if(ch)
-        RemoveLookup(lookupVal, child);
+    bSuccess = bSuccess &&
+               header->signature  == LOCALE_COMPILED_SIGNATURE &&
+               header->version    == LOCALE_COMPILED_VERSION &&
+               header->charSize   == sizeof(TCHAR) &&
+               header->sourceTime == sourceTime;
 
-    if(!ch)
+    //every string pair is stored as the two lengths followed by both strings with their terminators
+    if(bSuccess)
     {
-        if(!child->subNodes.Num())
+        LPBYTE lpCur = lpData+sizeof(LocaleCompiledHeader), lpEnd = lpData+fileSize;
+
+        for(DWORD i=0; i<header->numStrings; i++)
         {
-            if(child->leaf)
+            if(UPARAM(lpEnd-lpCur) < sizeof(DWORD)*2)
             {
-                cache.RemoveItem(child->leaf);
-                delete child->leaf;
+                bSuccess = FALSE;
+                break;
             }
 
-            node->subNodes.Remove(childID);
-            delete child;
-        }
-        else
-        {
-            if(child->leaf)
+            DWORD lookupLen = ((DWORD*)lpCur)[0];
+            DWORD valueLen  = ((DWORD*)lpCur)[1];
+            lpCur += sizeof(DWORD)*2;
+
+            UPARAM stringsSize = (UPARAM(lookupLen)+UPARAM(valueLen)+2)*sizeof(TCHAR);
+            if(UPARAM(lpEnd-lpCur) < stringsSize)
             {
-                cache.RemoveItem(child->leaf);
-                delete child->leaf;
+                bSuccess = FALSE;
+                break;
             }
 
-            child->leaf = NULL;
+            CTSTR lpLookup = (CTSTR)lpCur;
+            CTSTR lpValue  = lpLookup+lookupLen+1;
+            lpCur += stringsSize;
 
-            if(child->subNodes.Num() == 1)
+            if(lpLookup[lookupLen] || lpValue[valueLen])
             {
-                StringLookupNode *subNode = child->subNodes[0];
-
-                child->str += subNode->str;
-                child->leaf = subNode->leaf;
-                child->subNodes.CopyList(subNode->subNodes);
-                subNode->subNodes.Clear();
-                delete subNode;
+                bSuccess = FALSE;
+                break;
             }
+
+            AddLookupString(lpLookup, lpValue);
         }
     }
-    else if(!child->subNodes.Num() && !child->leaf)
+
+    Free(lpData);
+    return bSuccess;
+}
+
+void LocaleStringLookup::WriteCompiledFile(CTSTR lpFile, QWORD sourceTime, StringList &strings)
+{
+    String tmpPath = lpFile;
+    tmpPath.AppendString(TEXT(".tmp"));
+
+    XFileOutputSerializer file;
+    if(!file.Open(tmpPath, XFILE_CREATEALWAYS))
+        return;
+
+    LocaleCompiledHeader header;
+    header.signature  = LOCALE_COMPILED_SIGNATURE;
+    header.version    = LOCALE_COMPILED_VERSION;
+    header.charSize   = sizeof(TCHAR);
+    header.numStrings = strings.Num()/2;
+    header.sourceTime = sourceTime;
+    file.Serialize(&header, sizeof(header));
+
+    for(UINT i=0; i+1<strings.Num(); i+=2)
     {
-        node->subNodes.Remove(childID);
-        delete child;
+        String &strLookup = strings[i], &strValue = strings[i+1];
+        CTSTR lpLookup = strLookup.IsValid() ? strLookup.Array() : TEXT("");
+        CTSTR lpValue  = strValue.IsValid()  ? strValue.Array()  : TEXT("");
+
+        file.OutputDword(strLookup.Length());
+        file.OutputDword(strValue.Length());
+        file.Serialize(lpLookup, (strLookup.Length()+1)*sizeof(TCHAR));
+        file.Serialize(lpValue,  (strValue.Length()+1)*sizeof(TCHAR));
     }
 
-    //if not a leaf node and only have one child node, then merge with child node
-    if(!node->leaf && node->subNodes.Num() == 1 && node != top)
-    {
-        StringLookupNode *subNode = node->subNodes[0];
+    file.Close();
 
-        node->str += subNode->str;
-        node->leaf = subNode->leaf;
-        node->subNodes.CopyList(subNode->subNodes);
-        subNode->subNodes.Clear();
-        delete subNode;
-    }
+    //if the cache can't be written the text just gets parsed every time
+    if(!OSRenameFile(tmpPath, lpFile))
+        OSDeleteFile(tmpPath);
 }
 
 //ugh yet more string parsing, you think you escape it for one minute and then bam!  you discover yet more string parsing code needs to be written
@@ -233,11 +260,20 @@ BOOL LocaleStringLookup::LoadStringFile(CTSTR lpFile, bool bClear)
     if(bClear)
     {
         cache.Clear();
-        delete top;
-        top = new StringLookupNode;
+        lookupTable.Clear();
     }
-    else if(!top)
-        top = new StringLookupNode;
+
+    //------------------------
+
+    String strCompiledFile;
+    BOOL bUseCompiled = GetCompiledFilePath(lpFile, strCompiledFile);
+
+    QWORD sourceTime = OSGetFileModificationTime(lpFile);
+    if(sourceTime == QWORD(-1))
+        return FALSE;
+
+    if(bUseCompiled && LoadCompiledFile(strCompiledFile, sourceTime))
+        return TRUE;
 
     //------------------------
 
@@ -255,6 +291,8 @@ BOOL LocaleStringLookup::LoadStringFile(CTSTR lpFile, bool bClear)
 
     //------------------------
 
+    StringList compiledStrings;
+
     fileString.FindReplace(TEXT("\r"), TEXT(" "));
 
     TSTR lpTemp = fileString.Array()-1;
@@ -297,7 +335,10 @@ BOOL LocaleStringLookup::LoadStringFile(CTSTR lpFile, bool bClear)
             strVal = value;
 
         if(lookupVal.IsValid())
+        {
             AddLookupString(lookupVal, strVal);
+            compiledStrings << lookupVal << strVal;
+        }
 
         //----------
 
@@ -306,29 +347,13 @@ BOOL LocaleStringLookup::LoadStringFile(CTSTR lpFile, bool bClear)
 
     //------------------------
 
+    if(bUseCompiled)
+        WriteCompiledFile(strCompiledFile, sourceTime, compiledStrings);
+
     return TRUE;
 }
 
 
-StringLookupNode *LocaleStringLookup::FindNode(CTSTR lookupVal, StringLookupNode *node) const
-{
-    if(!node) node = top;
-
-    StringLookupNode *child = node->FindSubNode(lookupVal);
-    if(child)
-    {
-        lookupVal += child->str.Length();
-        TCHAR ch = *lookupVal;
-        if(ch)
-            return FindNode(lookupVal, child);
-
-        if(child->leaf)
-            return child;
-    }
-
-    return NULL;
-}
-
 void LocaleStringLookup::AddLookupString(CTSTR lookupVal, CTSTR lpVal)
 {
     assert(lookupVal && *lookupVal);
@@ -336,30 +361,40 @@ void LocaleStringLookup::AddLookupString(CTSTR lookupVal, CTSTR lpVal)
     if(!lookupVal || !*lookupVal)
         return;
 
-    StringLookupNode *child = FindNode(lookupVal);
-    if(child)
-        child->leaf->strValue = lpVal;
+    LocaleStringItem *item = FindItem(lookupVal);
+    if(item)
+        item->strValue = lpVal;
     else
     {
-        LocaleStringItem *item = new LocaleStringItem;
+        item = new LocaleStringItem;
         item->lookup = lookupVal;
         item->strValue = lpVal;
+        item->hash = HashLookupName(lookupVal);
         cache << item;
 
-        AddLookup(item->lookup, item);
+        AddToTable(item);
+    }
+}
+
+void LocaleStringLookup::RemoveLookupString(CTSTR lookupVal)
+{
+    LocaleStringItem *item = FindItem(lookupVal);
+    if(item)
+    {
+        cache.RemoveItem(item);
+        delete item;
+
+        RebuildTable();
     }
 }
 
 CTSTR LocaleStringLookup::LookupString(CTSTR lookupVal)
 {
-    StringLookupNode *child = FindNode(lookupVal);
-    if(!child)
+    LocaleStringItem *item = FindItem(lookupVal);
+    if(!item)
         return TEXT("(string not found)");
 
-    if(!child->leaf)
-        return TEXT("(lookup error)");
-
-    return child->leaf->strValue;
+    return item->strValue;
 }
 
 
@@ -28,6 +28,7 @@ struct LocaleStringItem
 {
     String      lookup;
     String      strValue;
+    UINT        hash;
 };
 
 struct LocaleStringCache : public List<LocaleStringItem*>
@@ -67,22 +68,22 @@ struct LocaleStringCache : public List<LocaleStringItem*>
 };
 
 
-struct StringLookupNode;
-
-
 //------------------------------------------------------------------
 // Localization String Lookup Class
 //------------------------------------------------------------------
 
 class BASE_EXPORT LocaleStringLookup
 {
-    StringLookupNode *top;
     LocaleStringCache cache;
+    List<LocaleStringItem*> lookupTable;    //open addressing on the case-folded lookup name
 
-    void AddLookup(CTSTR lookupVal, LocaleStringItem *item, StringLookupNode *node=NULL);
-    void RemoveLookup(CTSTR lookupVal, StringLookupNode *node=NULL);
+    void AddToTable(LocaleStringItem *item);
+    void RebuildTable();
 
-    StringLookupNode* FindNode(CTSTR lookupVal, StringLookupNode *node=NULL) const;
+    LocaleStringItem* FindItem(CTSTR lookupVal) const;
+
+    BOOL LoadCompiledFile(CTSTR lpFile, QWORD sourceTime);
+    void WriteCompiledFile(CTSTR lpFile, QWORD sourceTime, StringList &strings);
 
 public:
     LocaleStringLookup();
@@ -90,10 +91,10 @@ public:
 
     BOOL LoadStringFile(CTSTR lpFile, bool bClear=false);
 
-    inline BOOL HasLookup(CTSTR lookupVal) const {return (FindNode(lookupVal) != NULL);}
+    inline BOOL HasLookup(CTSTR lookupVal) const {return (FindItem(lookupVal) != NULL);}
 
     void AddLookupString(CTSTR lookupVal, CTSTR lpVal);
-    inline void RemoveLookupString(CTSTR lookupVal) {RemoveLookup(lookupVal);}
+    void RemoveLookupString(CTSTR lookupVal);
 
     CTSTR LookupString(CTSTR lookupVal);
 
@@ -107,6 +108,9 @@ BASE_EXPORT extern LocaleStringLookup *locale;
 
 inline BOOL  LoadStringFile(CTSTR lpResource)   {return locale->LoadStringFile(lpResource);}
 
+//where compiled string tables are kept.  until it's set string files are always parsed
+BASE_EXPORT void STDCALL SetLocaleCacheDirectory(CTSTR lpDirectory);
+
 #ifdef UNICODE
 struct LocaleNativeName
 {
@@ -35,6 +35,9 @@
 
 
 extern HANDLE hProfilerMutex;
+extern HANDLE hMetricsMutex;
+extern HANDLE hConfigSaveMutex;
+extern HANDLE hLogMutex;
 
 LARGE_INTEGER clockFreq, startTime;
 LONGLONG prevElapsedTime;
@@ -159,6 +162,9 @@ void   STDCALL OSInit()
     }
 
     hProfilerMutex = OSCreateMutex();
+    hMetricsMutex = OSCreateMutex();
+    hConfigSaveMutex = OSCreateMutex();
+    hLogMutex = OSCreateMutex();
 }
 
 void   STDCALL OSExit()
@@ -166,6 +172,14 @@ void   STDCALL OSExit()
     timeEndPeriod(1);
 
     OSCloseMutex(hProfilerMutex);
+    OSCloseMutex(hMetricsMutex);
+
+    //configs can still be closed by static destructors after this
+    OSCloseMutex(hConfigSaveMutex);
+    hConfigSaveMutex = NULL;
+
+    OSCloseMutex(hLogMutex);
+    hLogMutex = NULL;
 }
 
 
@@ -768,6 +782,33 @@ void OSRaiseException(DWORD code)
     RaiseException(code, EXCEPTION_NONCONTINUABLE, 0, NULL);
 }
 
+HANDLE STDCALL OSCreateEvent(BOOL bManualReset)
+{
+    HANDLE hEvent = CreateEvent(NULL, bManualReset, FALSE, NULL);
+    if (!hEvent)
+        CrashError(TEXT("CreateEvent failed: %d"), GetLastError());
+
+    return hEvent;
+}
+
+void   STDCALL OSSignalEvent(HANDLE hEvent)
+{
+    assert(hEvent);
+    SetEvent(hEvent);
+}
+
+void   STDCALL OSResetEvent(HANDLE hEvent)
+{
+    assert(hEvent);
+    ResetEvent(hEvent);
+}
+
+BOOL   STDCALL OSWaitForEvent(HANDLE hEvent, DWORD dwMSeconds)
+{
+    assert(hEvent);
+    return WaitForSingleObject(hEvent, (dwMSeconds == WAIT_INFINITE) ? INFINITE : dwMSeconds) == WAIT_OBJECT_0;
+}
+
 void OSCloseEvent(HANDLE event)
 {
     CloseHandle(event);
@@ -679,6 +679,26 @@ public:
     }
     virtual CTSTR GetSceneCollectionName() const { return App->GetCurrentSceneCollection(); }
     virtual void GetSceneCollectionNames(StringList &list) const { return App->GetSceneCollection(list); }
+
+    virtual void GetPipelineStats(List<MetricStats> &stats) const {GetMetricStats(stats);}
+
+    virtual void GetCurDesktopLoudness(float *momentary, float *shortTerm, float *truePeak) const
+    {
+        RequestAudioLoudness();
+
+        *momentary = App->desktopLoudness;
+        *shortTerm = App->desktopShortTermLoudness;
+        *truePeak = App->desktopTruePeak;
+    }
+
+    virtual void GetCurMicLoudness(float *momentary, float *shortTerm, float *truePeak) const
+    {
+        RequestAudioLoudness();
+
+        *momentary = App->micLoudness;
+        *shortTerm = App->micShortTermLoudness;
+        *truePeak = App->micTruePeak;
+    }
 };
 
 APIInterface* CreateOBSApiInterface()
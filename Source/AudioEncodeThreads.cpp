@@ -0,0 +1,187 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#include "Main.h"
+#include "AudioEncodeThreads.h"
+
+
+#define MIXED_AUDIO_PUSH_WAIT_MS    20  //how long the mixer waits on a full queue before logging a stall
+#define AUDIO_ENCODE_POLL_MS        50
+#define PENDING_AUDIO_PUSH_WAIT_MS  50  //how long the encoder backs off on a full pending audio queue
+
+static void EncodeMixedAudio(AudioEncodeThread *thread, MixedAudioBlock &block)
+{
+    //blocks come out of the queue in the order they went in, but anything that would still go
+    //backwards is dropped rather than handed to the muxers
+    if(thread->bEncodedAny && block.timestamp <= thread->lastTimestamp)
+    {
+        thread->outOfOrderBlocks->Add();
+        return;
+    }
+
+    thread->lastTimestamp = block.timestamp;
+    thread->bEncodedAny = true;
+
+    DataPacket packet;
+    bool bEncoded;
+
+    {
+        MetricTimer encodeTimer(thread->encodeTime);
+        bEncoded = thread->encoder->Encode(block.audioData.Array(), block.audioData.Num()/2, packet, block.timestamp);
+    }
+
+    if(bEncoded)
+    {
+        //slots keep their buffers, so this only allocates until the queue has cycled once
+        FrameAudio *frameAudio = thread->output->BeginPush();
+
+        //back off once when the video thread stops taking audio, a short stall costs nothing.  while
+        //it stays full every frame is dropped straight away so the encoder keeps up with the mixer
+        if(!frameAudio && !thread->bDroppingFrames)
+            frameAudio = thread->output->WaitBeginPush(PENDING_AUDIO_PUSH_WAIT_MS);
+
+        if(!frameAudio)
+        {
+            thread->droppedFrames->Add();
+            thread->numDroppedFrames++;
+
+            if(!thread->bDroppingFrames)
+            {
+                Log(TEXT("EncodeMixedAudio: pending audio queue is full (%u frames), video thread stalled?  dropping %s audio from %llu ms"),
+                    thread->output->Capacity(), thread->encoder->GetCodec(), block.timestamp);
+
+                thread->bDroppingFrames = true;
+                thread->dropRunFrames = 0;
+                thread->dropRunStart = block.timestamp;
+            }
+
+            thread->dropRunFrames++;
+            return;
+        }
+
+        if(thread->bDroppingFrames)
+        {
+            Log(TEXT("EncodeMixedAudio: dropped %u %s audio frames (%llu ms of audio), the recording/stream has a gap there"),
+                thread->dropRunFrames, thread->encoder->GetCodec(), block.timestamp-thread->dropRunStart);
+            thread->bDroppingFrames = false;
+        }
+
+        frameAudio->audioData.CopyArray(packet.lpPacket, packet.size);
+        frameAudio->timestamp = block.timestamp;
+
+        thread->output->EndPush();
+    }
+}
+
+static DWORD STDCALL AudioEncodeThreadProc(AudioEncodeThread *thread)
+{
+    CoInitialize(0);
+
+    while (true)
+    {
+        MixedAudioBlock *block = thread->input.WaitPeek(AUDIO_ENCODE_POLL_MS);
+        if (!block)
+        {
+            //only exits once everything that was mixed has been encoded
+            if (thread->bKillThread)
+                break;
+            continue;
+        }
+
+        EncodeMixedAudio(thread, *block);
+
+        //the slot keeps its buffer for the audio thread to refill
+        thread->input.Pop();
+    }
+
+    CoUninitialize();
+    return 0;
+}
+
+AudioEncodeThread* CreateAudioEncodeThread(AudioEncoder *encoder, SPSCQueue<FrameAudio> *output, CTSTR lpMetricPrefix)
+{
+    AudioEncodeThread *thread = new AudioEncodeThread;
+    thread->encoder = encoder;
+    thread->output = output;
+    thread->input.SetCapacity(MAX_MIXED_AUDIO_BLOCKS);
+
+    thread->bKillThread = false;
+    thread->lastTimestamp = 0;
+    thread->bEncodedAny = false;
+    thread->numMixerStalls = thread->numDroppedFrames = 0;
+    thread->bDroppingFrames = false;
+    thread->dropRunFrames = 0;
+    thread->dropRunStart = 0;
+
+    thread->encodeTime       = GetMetricHistogram(FormattedString(TEXT("%s.encode"), lpMetricPrefix));
+    thread->pushWaitTime     = GetMetricHistogram(FormattedString(TEXT("%s.encodeQueueWait"), lpMetricPrefix));
+    thread->queueDepth       = GetMetricGauge(FormattedString(TEXT("%s.encodeQueue"), lpMetricPrefix));
+    thread->mixerStalls      = GetMetricCounter(FormattedString(TEXT("%s.mixerStalls"), lpMetricPrefix));
+    thread->droppedFrames    = GetMetricCounter(FormattedString(TEXT("%s.droppedFrames"), lpMetricPrefix));
+    thread->outOfOrderBlocks = GetMetricCounter(FormattedString(TEXT("%s.outOfOrderBlocks"), lpMetricPrefix));
+
+    thread->hThread = OSCreateThread((XTHREAD)AudioEncodeThreadProc, thread);
+
+    return thread;
+}
+
+void DestroyAudioEncodeThread(AudioEncodeThread *thread)
+{
+    thread->bKillThread = true;
+    OSTerminateThread(thread->hThread, 10000);
+
+    if(thread->numMixerStalls)
+        Log(TEXT("the %s encoder fell behind and held up the mixer %u times"), thread->encoder->GetCodec(), thread->numMixerStalls);
+    if(thread->numDroppedFrames)
+        Log(TEXT("%u encoded audio frames were dropped because the video thread fell behind"), thread->numDroppedFrames);
+
+    delete thread;
+}
+
+void PushMixedAudio(AudioEncodeThread *thread, const float *buffer, UINT numFrames, QWORD timestamp)
+{
+    MixedAudioBlock *block = thread->input.BeginPush();
+    if(!block)
+    {
+        MetricTimer waitTimer(thread->pushWaitTime);
+
+        block = thread->input.WaitBeginPush(MIXED_AUDIO_PUSH_WAIT_MS);
+        if(!block)
+        {
+            //dropping the block would leave a gap the encoder input can't see, so the stream
+            //would jump.  log the stall once and keep waiting.
+            thread->mixerStalls->Add();
+            thread->numMixerStalls++;
+
+            QWORD stallStart = GetQPCTimeMS()-MIXED_AUDIO_PUSH_WAIT_MS;
+            Log(TEXT("PushMixedAudio: %s encoder queue is full, holding up the mixer at %llu ms"), thread->encoder->GetCodec(), timestamp);
+
+            block = thread->input.WaitBeginPush();
+
+            Log(TEXT("PushMixedAudio: the %s encoder held up the mixer for %llu ms"), thread->encoder->GetCodec(), GetQPCTimeMS()-stallStart);
+        }
+    }
+
+    block->audioData.CopyArray(buffer, numFrames*2);
+    block->timestamp = timestamp;
+
+    thread->input.EndPush();
+    thread->queueDepth->Set(thread->input.Num());
+}
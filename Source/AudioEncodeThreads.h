@@ -0,0 +1,67 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+
+#pragma once
+
+//-------------------------------------------------------------------
+// mixed blocks are encoded on their own thread, so a slow encoder frame doesn't hold up the next
+// mix.  each encoder has its own thread and queue of mixed blocks and writes its packets to its
+// own output queue, so more than one encoder can take the same mix without waiting on the
+// others.  a single queue per encoder keeps the packets in the order they were mixed.
+
+#define MAX_MIXED_AUDIO_BLOCKS      64  //640ms of mixed audio
+
+struct MixedAudioBlock
+{
+    List<float> audioData;
+    QWORD timestamp;
+};
+
+struct AudioEncodeThread
+{
+    AudioEncoder *encoder;
+    SPSCQueue<MixedAudioBlock> input;   //audio thread -> encode thread
+    SPSCQueue<FrameAudio> *output;      //encode thread -> video thread
+
+    HANDLE hThread;
+    std::atomic<bool> bKillThread;
+
+    QWORD lastTimestamp;
+    bool  bEncodedAny;
+    UINT  numMixerStalls, numDroppedFrames;
+
+    //current run of frames dropped on a full pending audio queue
+    bool  bDroppingFrames;
+    UINT  dropRunFrames;
+    QWORD dropRunStart;
+
+    MetricHistogram *encodeTime, *pushWaitTime;
+    MetricGauge     *queueDepth;
+    MetricCounter   *mixerStalls, *droppedFrames, *outOfOrderBlocks;
+};
+
+AudioEncodeThread* CreateAudioEncodeThread(AudioEncoder *encoder, SPSCQueue<FrameAudio> *output, CTSTR lpMetricPrefix);
+
+//waits (up to 10 seconds) for everything that was pushed to be encoded
+void DestroyAudioEncodeThread(AudioEncodeThread *thread);
+
+//queues a mixed block for the encoder.  when the queue is full the encoder is 640ms behind, and
+//this waits on it like the mixer did when it encoded inline, rather than losing the audio.
+void PushMixedAudio(AudioEncodeThread *thread, const float *buffer, UINT numFrames, QWORD timestamp);
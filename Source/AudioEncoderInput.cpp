@@ -0,0 +1,209 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "Main.h"
+#include "AudioEncoderInput.h"
+
+
+//frames of ring allocated up front, in codec frames.  the mixer hands out 10ms at a time so
+//the codec never has much more than one frame waiting
+const UINT initialRingFrames = 4;
+
+//block records allocated up front.  the codecs ask for a packet's timestamp a few frames after
+//its input came in, so this covers a few frames' worth of 10ms blocks
+const UINT initialRingBlocks = 32;
+
+
+static void ScaleStereo(float *out, const float *input, UINT numFrames, float scale)
+{
+    UINT numFloats = numFrames*2;
+    UINT alignedFloats = numFloats & 0xFFFFFFFC;
+
+    __m128 scaleVal = _mm_set_ps1(scale);
+    for(UINT i=0; i<alignedFloats; i += 4)
+        _mm_storeu_ps(out+i, _mm_mul_ps(_mm_loadu_ps(input+i), scaleVal));
+
+    for(UINT i=alignedFloats; i<numFloats; i++)
+        out[i] = input[i]*scale;
+}
+
+//(l+r)*0.5*scale, same result as averaging first and scaling after since 0.5 is exact
+static void DownmixMono(float *out, const float *input, UINT numFrames, float scale)
+{
+    UINT alignedFrames = numFrames & 0xFFFFFFFC;
+    float halfScale = scale*0.5f;
+
+    __m128 scaleVal = _mm_set_ps1(halfScale);
+    for(UINT i=0; i<alignedFrames; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(input+(i*2));
+        __m128 b = _mm_loadu_ps(input+(i*2)+4);
+
+        __m128 left  = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(out+i, _mm_mul_ps(_mm_add_ps(left, right), scaleVal));
+    }
+
+    for(UINT i=alignedFrames; i<numFrames; i++)
+        out[i] = (input[i*2]+input[i*2+1])*halfScale;
+}
+
+//-------------------------------------------------------------------
+
+AudioEncoderInput::AudioEncoderInput()
+{
+    numChannels = 2;
+    frameSize = 0;
+    sampleRate = 0;
+    scale = 1.0f;
+    ringSize = 0;
+    writeFrame = readFrame = 0;
+    writeBlock = readBlock = 0;
+}
+
+void AudioEncoderInput::Init(UINT numChannels, UINT frameSize, UINT sampleRate, float scale)
+{
+    this->numChannels = (numChannels == 1) ? 1 : 2;
+    this->frameSize   = frameSize;
+    this->sampleRate  = sampleRate;
+    this->scale       = scale;
+
+    ringSize = frameSize*initialRingFrames;
+    ring.SetSize((ringSize+frameSize)*this->numChannels);
+
+    writeFrame = readFrame = 0;
+
+    blocks.SetSize(initialRingBlocks);
+    writeBlock = readBlock = 0;
+}
+
+void AudioEncoderInput::Grow(UINT minFrames)
+{
+    UINT newSize = ringSize;
+    while(newSize < minFrames)
+        newSize *= 2;
+
+    List<float> newRing;
+    newRing.SetSize((newSize+frameSize)*numChannels);
+
+    //copy what's buffered to the same absolute positions in the new ring
+    QWORD pos = readFrame;
+    while(pos < writeFrame)
+    {
+        UINT from = UINT(pos%ringSize);
+        UINT to   = UINT(pos%newSize);
+        UINT num  = MIN(ringSize-from, newSize-to);
+        num = UINT(MIN(QWORD(num), writeFrame-pos));
+
+        mcpy(newRing.Array()+(to*numChannels), ring.Array()+(from*numChannels), num*numChannels*sizeof(float));
+        pos += num;
+    }
+
+    mcpy(newRing.Array()+(newSize*numChannels), newRing.Array(), frameSize*numChannels*sizeof(float));
+
+    ring.TransferFrom(newRing);
+    ringSize = newSize;
+}
+
+void AudioEncoderInput::GrowBlocks()
+{
+    UINT numBlocks = blocks.Num();
+
+    List<InputBlock> newBlocks;
+    newBlocks.SetSize(MAX(numBlocks*2, initialRingBlocks));
+
+    for(QWORD pos=readBlock; pos<writeBlock; pos++)
+        newBlocks[UINT(pos%newBlocks.Num())] = blocks[UINT(pos%numBlocks)];
+
+    blocks.TransferFrom(newBlocks);
+}
+
+void AudioEncoderInput::Write(const float *input, UINT numFrames)
+{
+    while(numFrames)
+    {
+        UINT pos = UINT(writeFrame%ringSize);
+        UINT num = MIN(numFrames, ringSize-pos);
+
+        float *out = ring.Array()+(pos*numChannels);
+        if(numChannels == 2)
+            ScaleStereo(out, input, num, scale);
+        else
+            DownmixMono(out, input, num, scale);
+
+        //keep the mirror past the end up to date
+        if(pos < frameSize)
+        {
+            UINT numMirrored = MIN(num, frameSize-pos);
+            mcpy(ring.Array()+((ringSize+pos)*numChannels), out, numMirrored*numChannels*sizeof(float));
+        }
+
+        input      += num*2;
+        numFrames  -= num;
+        writeFrame += num;
+    }
+}
+
+void AudioEncoderInput::Push(const float *input, UINT numInputFrames, QWORD timestamp)
+{
+    if(!numInputFrames)
+        return;
+
+    if(writeBlock-readBlock == blocks.Num())
+        GrowBlocks();
+
+    InputBlock &block = blocks[UINT(writeBlock%blocks.Num())];
+    block.firstFrame = writeFrame;
+    block.timestamp  = timestamp;
+    writeBlock++;
+
+    UINT numFrames = NumBufferedFrames()+numInputFrames;
+    if(numFrames > ringSize)
+        Grow(numFrames);
+
+    Write(input, numInputFrames);
+}
+
+float* AudioEncoderInput::PeekFrame() const
+{
+    if(NumBufferedFrames() < frameSize)
+        return NULL;
+
+    return ring.Array()+(UINT(readFrame%ringSize)*numChannels);
+}
+
+void AudioEncoderInput::PopFrame()
+{
+    if(NumBufferedFrames() >= frameSize)
+        readFrame += frameSize;
+}
+
+QWORD AudioEncoderInput::GetTimestamp(QWORD frame)
+{
+    if(writeBlock == readBlock)
+        return 0;
+
+    UINT numBlocks = blocks.Num();
+    while(writeBlock-readBlock > 1 && blocks[UINT((readBlock+1)%numBlocks)].firstFrame <= frame)
+        readBlock++;
+
+    InputBlock &block = blocks[UINT(readBlock%numBlocks)];
+    return block.timestamp + (frame-block.firstFrame)*1000/sampleRate;
+}
@@ -0,0 +1,76 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+#pragma once
+
+//-------------------------------------------------------------------
+// common front end for the audio encoders.
+//
+// mixed stereo audio comes in as 10ms blocks; codecs want fixed size frames.  input is converted
+// (scaled and optionally downmixed to mono) straight into a ring buffer, and whole frames are
+// handed out as contiguous views into that ring.  the start of the ring is mirrored past its end
+// so a frame that wraps around is still contiguous without copying it.
+//
+// timestamps are kept per input block by sample index, so any frame's timestamp is the timestamp
+// of the block its first sample came in with, plus that sample's offset into the block.  the block
+// records go in a ring of their own, found by frame position from the last one looked up.
+
+class AudioEncoderInput
+{
+    struct InputBlock
+    {
+        QWORD firstFrame;
+        QWORD timestamp;
+    };
+
+    UINT numChannels;               //channels handed to the codec, 1 or 2
+    UINT frameSize;                 //frames per codec frame
+    UINT sampleRate;
+    float scale;
+
+    List<float> ring;               //ringSize frames followed by a mirror of the first frameSize frames
+    UINT ringSize;
+
+    QWORD writeFrame, readFrame;    //absolute frame positions, never wrap
+
+    List<InputBlock> blocks;        //ring of block records, in push order
+    QWORD writeBlock, readBlock;    //absolute record positions, never wrap
+
+    void Grow(UINT minFrames);
+    void GrowBlocks();
+    void Write(const float *input, UINT numFrames);
+
+public:
+    AudioEncoderInput();
+
+    void Init(UINT numChannels, UINT frameSize, UINT sampleRate, float scale);
+
+    //input is always interleaved stereo, as it comes from the mixer
+    void Push(const float *input, UINT numInputFrames, QWORD timestamp);
+
+    inline UINT NumBufferedFrames() const {return UINT(writeFrame-readFrame);}
+    inline QWORD GetReadFrame() const {return readFrame;}
+
+    //returns NULL until a whole frame is buffered.  the view stays valid until the next Push
+    float* PeekFrame() const;
+    void PopFrame();
+
+    //timestamp of an absolute frame position.  positions have to be asked for in increasing order,
+    //the block records before the one that is used are dropped
+    QWORD GetTimestamp(QWORD frame);
+};
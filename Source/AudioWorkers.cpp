@@ -0,0 +1,203 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+
+#include "Main.h"
+#include <Avrt.h>
+#include "AudioWorkers.h"
+
+
+struct AudioSourceJob
+{
+    AudioSource *source;
+    float volume;
+    MetricHistogram *processTime;
+    bool bGotAudio;
+};
+
+struct AudioWorkerPool;
+
+struct AudioWorkerData
+{
+    AudioWorkerPool *pool;
+    HANDLE hThread;
+    HANDLE hSignalProcess, hSignalComplete;
+    bool bKillThread;
+};
+
+struct AudioWorkerPool
+{
+    AudioWorkerData workers[MAX_AUDIO_WORKERS];
+    UINT numWorkers;
+
+    List<AudioSourceJob> jobs;
+    AudioJobType jobType;
+    std::atomic<UINT> nextJob;
+    List<HANDLE> completeEvents;
+
+    //per-source timing, looked up again whenever the source list changes
+    List<AudioSource*> timedSources;
+    List<MetricHistogram*> sourceTimes;
+};
+
+static void RunAudioJob(AudioSourceJob &job, AudioJobType type)
+{
+    MetricTimer processTimer(job.processTime);
+
+    if (type == AudioJob_Query)
+    {
+        job.bGotAudio = job.source->QueryAudio2(job.volume, true) != NoAudioAvailable;
+    }
+    else
+    {
+        // drain until dry to prevent burst data
+        while (job.source->QueryAudio2(job.volume, true) != NoAudioAvailable)
+            job.bGotAudio = true;
+
+        QWORD timestamp;
+        if (job.source->GetLatestTimestamp(timestamp))
+            job.source->SortAudio(timestamp);
+    }
+}
+
+static void RunAudioJobs(AudioWorkerPool *pool)
+{
+    UINT jobID;
+    while ((jobID = pool->nextJob.fetch_add(1)) < pool->jobs.Num())
+        RunAudioJob(pool->jobs[jobID], pool->jobType);
+}
+
+DWORD STDCALL AudioWorkerThread(AudioWorkerData *data)
+{
+    CoInitialize(0);
+
+    DWORD taskID = 0;
+    HANDLE hTask = AvSetMmThreadCharacteristics(TEXT("Pro Audio"), &taskID);
+
+    while (true)
+    {
+        WaitForSingleObject(data->hSignalProcess, INFINITE);
+        if (data->bKillThread)
+            break;
+
+        RunAudioJobs(data->pool);
+        SetEvent(data->hSignalComplete);
+    }
+
+    AvRevertMmThreadCharacteristics(hTask);
+    CoUninitialize();
+    return 0;
+}
+
+AudioWorkerPool* CreateAudioWorkers(UINT numWorkers)
+{
+    AudioWorkerPool *pool = new AudioWorkerPool;
+    pool->numWorkers = numWorkers;
+
+    for (UINT i=0; i<numWorkers; i++)
+    {
+        AudioWorkerData &worker = pool->workers[i];
+        worker.pool = pool;
+        worker.bKillThread = false;
+        worker.hSignalProcess  = CreateEvent(NULL, FALSE, FALSE, NULL);
+        worker.hSignalComplete = CreateEvent(NULL, FALSE, FALSE, NULL);
+        worker.hThread = OSCreateThread((XTHREAD)AudioWorkerThread, &worker);
+    }
+
+    return pool;
+}
+
+void DestroyAudioWorkers(AudioWorkerPool *pool)
+{
+    for (UINT i=0; i<pool->numWorkers; i++)
+    {
+        AudioWorkerData &worker = pool->workers[i];
+
+        worker.bKillThread = true;
+        SetEvent(worker.hSignalProcess);
+        OSTerminateThread(worker.hThread, 10000);
+
+        CloseHandle(worker.hSignalProcess);
+        CloseHandle(worker.hSignalComplete);
+    }
+
+    delete pool;
+}
+
+static MetricHistogram* GetSourceProcessTime(AudioWorkerPool *pool, UINT jobID, AudioSource *source)
+{
+    if (jobID >= pool->timedSources.Num() || pool->timedSources[jobID] != source)
+    {
+        pool->timedSources.SetSize(jobID+1);
+        pool->sourceTimes.SetSize(jobID+1);
+
+        pool->timedSources[jobID] = source;
+        pool->sourceTimes[jobID] = GetMetricHistogram(FormattedString(TEXT("audio.source.%s"), source->GetDeviceName2()));
+    }
+
+    return pool->sourceTimes[jobID];
+}
+
+bool ProcessAudioSources(AudioWorkerPool *pool, AudioJobType type, AudioSource *micAudio, float micVol, List<AudioSource*> &auxAudioSources)
+{
+    pool->jobs.SetSize(0);
+    pool->jobType = type;
+
+    if (micAudio)
+    {
+        AudioSourceJob &job = *pool->jobs.CreateNew();
+        job.source = micAudio;
+        job.volume = micVol;
+    }
+
+    for (UINT i=0; i<auxAudioSources.Num(); i++)
+    {
+        AudioSourceJob &job = *pool->jobs.CreateNew();
+        job.source = auxAudioSources[i];
+        job.volume = auxAudioSources[i]->GetVolume();
+    }
+
+    for (UINT i=0; i<pool->jobs.Num(); i++)
+        pool->jobs[i].processTime = GetSourceProcessTime(pool, i, pool->jobs[i].source);
+
+    //only wake as many workers as there are jobs for besides the calling thread
+    UINT numWorkers = pool->jobs.Num() ? MIN(pool->numWorkers, pool->jobs.Num()-1) : 0;
+
+    pool->nextJob = 0;
+    pool->completeEvents.SetSize(0);
+
+    for (UINT i=0; i<numWorkers; i++)
+    {
+        pool->completeEvents << pool->workers[i].hSignalComplete;
+        SetEvent(pool->workers[i].hSignalProcess);
+    }
+
+    RunAudioJobs(pool);
+
+    if (numWorkers)
+        WaitForMultipleObjects(numWorkers, pool->completeEvents.Array(), TRUE, INFINITE);
+
+    bool bGotSomeAudio = false;
+    for (UINT i=0; i<pool->jobs.Num(); i++)
+    {
+        if (pool->jobs[i].bGotAudio)
+            bGotSomeAudio = true;
+    }
+
+    return bGotSomeAudio;
+}
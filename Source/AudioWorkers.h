@@ -0,0 +1,42 @@
+/********************************************************************************
+ Copyright (C) 2012 Hugh Bailey <obs.jim@gmail.com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+********************************************************************************/
+
+#pragma once
+
+//-------------------------------------------------------------------
+// aux and mic sources can be processed (read, converted, resampled, filtered) on a few worker
+// threads.  each job only touches its own source and they're all mixed afterward in source
+// order, so the output doesn't depend on how the jobs were scheduled.
+
+#define MAX_AUDIO_WORKERS 8
+
+enum AudioJobType
+{
+    AudioJob_Query,     //query one segment
+    AudioJob_Drain,     //query until there's nothing left, then sort
+};
+
+struct AudioWorkerPool;
+
+//0 workers is valid, everything then runs on the calling thread
+AudioWorkerPool* CreateAudioWorkers(UINT numWorkers);
+void DestroyAudioWorkers(AudioWorkerPool *pool);
+
+//mic first, then the aux sources in order.  runs the jobs on the calling thread as well as the
+//workers, and returns once all of them are done.
+bool ProcessAudioSources(AudioWorkerPool *pool, AudioJobType type, AudioSource *micAudio, float micVol, List<AudioSource*> &auxAudioSources);
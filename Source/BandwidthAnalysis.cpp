@@ -41,16 +41,16 @@ public:
     {
         QWORD bytesPerSec = totalBytesTransmitted/MAX(numSeconds, 1);
 
-        String strReport;
+        StringBuilder strReport;
         strReport << TEXT("Stream report:\r\n\r\n");
 
         /*strReport << App->GetVideoEncoder()->GetInfoString() << TEXT("\r\n\r\n");
         strReport << App->GetAudioEncoder()->GetInfoString() << TEXT("\r\n\r\n");*/
 
-        strReport << TEXT("Total Bytes transmitted: ") << UInt64String(totalBytesTransmitted, 10) <<
-                     TEXT("\r\nTotal time of stream in seconds: ") << UIntString(numSeconds) <<
-                     TEXT("\r\nAverage Bytes/Bits per second: ") << UInt64String(bytesPerSec, 10) << TEXT(", ") << UInt64String(bytesPerSec*8, 10) <<
-                     TEXT("\r\nHighest Bytes/Bits in a second: ") << UIntString(highestBytes) << TEXT(", ") << UIntString(highestBytes*8);
+        strReport << TEXT("Total Bytes transmitted: ") << UINT64(totalBytesTransmitted) <<
+                     TEXT("\r\nTotal time of stream in seconds: ") << numSeconds <<
+                     TEXT("\r\nAverage Bytes/Bits per second: ") << UINT64(bytesPerSec) << TEXT(", ") << UINT64(bytesPerSec*8) <<
+                     TEXT("\r\nHighest Bytes/Bits in a second: ") << highestBytes << TEXT(", ") << highestBytes*8;
 
         App->SetStreamReport(strReport);
     }
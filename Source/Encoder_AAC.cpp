@@ -17,6 +17,7 @@
 ********************************************************************************/
 
 #include "Main.h"
+#include "AudioEncoderInput.h"
 
 #include "../libfaac/include/faac.h"
 
@@ -25,6 +26,7 @@
 class AACEncoder : public AudioEncoder
 {
     UINT curBitRate;
+    UINT numThreads;
 
     bool bFirstPacket;
 
@@ -32,21 +34,20 @@ class AACEncoder : public AudioEncoder
     DWORD numReadSamples;
     DWORD outputSize;
 
-    List<float> inputBuffer;
+    AudioEncoderInput encoderInput;
 
     List<BYTE>  aacBuffer;
     List<BYTE>  header;
 
-    List<QWORD> bufferedTimestamps;
-    QWORD curEncodeTimestamp;
-    bool bFirstFrame;
+    QWORD numPacketsOut;
 
 public:
-    AACEncoder(UINT bitRate)
+    AACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads)
     {
         curBitRate = bitRate;
+        this->numThreads = numThreads;
 
-        faac = faacEncOpen(App->GetSampleRateHz(), App->NumAudioChannels(), &numReadSamples, &outputSize);
+        faac = faacEncOpen(sampleRateHz, channels, &numReadSamples, &outputSize);
 
         //Log(TEXT("numReadSamples: %d"), numReadSamples);
         aacBuffer.SetSize(outputSize+2);
@@ -54,13 +55,14 @@ public:
         aacBuffer[1] = 0x1;
 
         faacEncConfigurationPtr config = faacEncGetCurrentConfiguration(faac);
-        config->bitRate = (bitRate*1000)/App->NumAudioChannels();
+        config->bitRate = (bitRate*1000)/channels;
         config->quantqual = 100;
         config->inputFormat = FAAC_INPUT_FLOAT;
         config->mpegVersion = MPEG4;
         config->aacObjectType = LOW;
         config->useLfe = 0;
         config->outputFormat = 0;
+        config->numThreads = numThreads;   //more than 1 encodes the channels on a pool of threads, same output
 
         int ret = faacEncSetConfiguration(faac, config);
         if(!ret)
@@ -77,8 +79,11 @@ public:
         header.AppendArray(tempHeader, len);
         free(tempHeader);
 
+        //faac takes the samples scaled to 16bit range
+        encoderInput.Init(channels, GetFrameSize(), sampleRateHz, 32767.0f);
+
         bFirstPacket = true;
-        bFirstFrame  = true;
+        numPacketsOut = 0;
 
         Log(TEXT("------------------------------------------"));
         Log(TEXT("%s"), GetInfoString().Array());
@@ -91,60 +96,14 @@ public:
 
     bool Encode(float *input, UINT numInputFrames, DataPacket &packet, QWORD &timestamp)
     {
-        if(bFirstFrame)
-        {
-            curEncodeTimestamp = timestamp;
-            bFirstFrame = false;
-        }
-
-        //------------------------------------------------
-
-        QWORD curTimestamp = timestamp;
-
-        UINT lastSampleSize = inputBuffer.Num();
-        UINT numInputSamples = numInputFrames*App->NumAudioChannels();
-        if (App->NumAudioChannels() == 2)
-                inputBuffer.AppendArray(input, numInputSamples);
-        else
-        {
-            UINT inputBufferPos = inputBuffer.Num();
-            inputBuffer.SetSize(inputBufferPos + numInputSamples);
-
-            for (UINT i = 0; i < numInputSamples; i++)
-            {
-                UINT pos = i * 2;
-                inputBuffer[inputBufferPos + i] = (input[pos] + input[pos + 1]) * 0.5f;
-            }
-        }
+        encoderInput.Push(input, numInputFrames, timestamp);
 
         int ret = 0;
 
-        if(inputBuffer.Num() >= numReadSamples)
+        float *frame = encoderInput.PeekFrame();
+        if(frame)
         {
-            //now we have to upscale the floats.  fortunately we almost always have SSE
-            UINT floatsLeft  = numReadSamples;
-            float *inputTemp = inputBuffer.Array();
-            if((UPARAM(inputTemp) & 0xF) == 0)
-            {
-                UINT alignedFloats = floatsLeft & 0xFFFFFFFC;
-
-                for(UINT i=0; i<alignedFloats; i += 4)
-                {
-                    float *pos = inputTemp+i;
-                    _mm_store_ps(pos, _mm_mul_ps(_mm_load_ps(pos), _mm_set_ps1(32767.0f)));
-                }
-
-                floatsLeft &= 0x3;
-                inputTemp  += alignedFloats;
-            }
-
-            if(floatsLeft)
-            {
-                for(UINT i=0; i<floatsLeft; i++)
-                    inputTemp[i] *= 32767.0f;
-            }
-
-            ret = faacEncEncode(faac, (int32_t*)inputBuffer.Array(), numReadSamples, aacBuffer.Array()+2, outputSize);
+            ret = faacEncEncode(faac, (int32_t*)frame, numReadSamples, aacBuffer.Array()+2, outputSize);
             if(ret > 0)
             {
                 if(bFirstPacket)
@@ -157,17 +116,14 @@ public:
                     packet.lpPacket = aacBuffer.Array();
                     packet.size     = ret+2;
 
-                    timestamp = bufferedTimestamps[0];
-                    bufferedTimestamps.Remove(0);
+                    timestamp = encoderInput.GetTimestamp(numPacketsOut*GetFrameSize());
+                    numPacketsOut++;
                 }
             }
             else if(ret < 0)
                 AppWarning(TEXT("aac encode error"));
 
-            inputBuffer.RemoveRange(0, numReadSamples);
-
-            bufferedTimestamps << curEncodeTimestamp;
-            curEncodeTimestamp = curTimestamp + (((numReadSamples-lastSampleSize)/App->NumAudioChannels())*1000/App->GetSampleRateHz());
+            encoderInput.PopFrame();
         }
 
         return ret > 0;
@@ -193,12 +149,15 @@ public:
         strInfo << TEXT("Audio Encoding: AAC")  <<
                    TEXT("\r\n    bitrate: ") << IntString(curBitRate);
 
+        if(numThreads > 1)
+            strInfo << TEXT("\r\n    threads: ") << UIntString(numThreads);
+
         return strInfo;
     }
 };
 
 
-AudioEncoder* CreateAACEncoder(UINT bitRate)
+AudioEncoder* CreateAACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads)
 {
-    return new AACEncoder(bitRate);
+    return new AACEncoder(bitRate, sampleRateHz, channels, numThreads);
 }
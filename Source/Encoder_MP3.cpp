@@ -18,6 +18,7 @@
 
 
 #include "Main.h"
+#include "AudioEncoderInput.h"
 
 #include "../lame/include/lame.h"
 
@@ -45,13 +46,11 @@ class MP3Encoder : public AudioEncoder
     UINT outputFrameSize;
     UINT curBitRate;
 
-    List<QWORD> bufferedTimestamps;
-    QWORD curEncodeTimestamp;
-    DWORD frameCounter;
-    bool bFirstFrame;
+    AudioEncoderInput encoderInput;
+    QWORD numPacketsOut;
 
 public:
-    MP3Encoder(UINT bitRate)
+    MP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels)
     {
         curBitRate = bitRate;
 
@@ -59,9 +58,9 @@ public:
         if(!lgf)
             CrashError(TEXT("Unable to open mp3 encoder"));
 
-        lame_set_in_samplerate(lgf, App->GetSampleRateHz());
-        lame_set_out_samplerate(lgf, App->GetSampleRateHz());
-        lame_set_num_channels(lgf, App->NumAudioChannels());
+        lame_set_in_samplerate(lgf, sampleRateHz);
+        lame_set_out_samplerate(lgf, sampleRateHz);
+        lame_set_num_channels(lgf, channels);
         lame_set_disable_reservoir(lgf, TRUE); //bit reservoir has to be disabled for seamless streaming
         lame_set_quality(lgf, 2);
         lame_set_VBR(lgf, vbr_off);
@@ -73,7 +72,11 @@ public:
         MP3OutputBuffer.SetSize(dwMP3MaxSize+1);
         MP3OutputBuffer[0] = 0x2f;
 
+        //lame always reads interleaved stereo floats, so the ring stays stereo and unscaled
+        encoderInput.Init(2, outputFrameSize, sampleRateHz, 1.0f);
+
         bFirstPacket = true;
+        numPacketsOut = 0;
 
         Log(TEXT("------------------------------------------"));
         Log(TEXT("%s"), GetInfoString().Array());
@@ -86,26 +89,14 @@ public:
 
     bool Encode(float *input, UINT numInputFrames, DataPacket &packet, QWORD &timestamp)
     {
-        if(bFirstFrame)
-        {
-            curEncodeTimestamp = timestamp;
-            bFirstFrame = false;
-        }
-
-        //------------------------------------------------
-
-        UINT lastSampleSize = frameCounter;
+        encoderInput.Push(input, numInputFrames, timestamp);
 
-        frameCounter += numInputFrames;
-        if(frameCounter > outputFrameSize)
-        {
-            frameCounter -= outputFrameSize;
-
-            bufferedTimestamps << curEncodeTimestamp;
-            curEncodeTimestamp = timestamp + ((outputFrameSize-lastSampleSize)*1000/App->GetSampleRateHz());
-        }
+        float *frame = encoderInput.PeekFrame();
+        if(!frame)
+            return false;
 
-        int ret = lame_encode_buffer_interleaved_ieee_float(lgf, (float*)input, numInputFrames, MP3OutputBuffer.Array()+1, dwMP3MaxSize);
+        int ret = lame_encode_buffer_interleaved_ieee_float(lgf, frame, outputFrameSize, MP3OutputBuffer.Array()+1, dwMP3MaxSize);
+        encoderInput.PopFrame();
 
         if(ret < 0)
         {
@@ -126,8 +117,8 @@ public:
                 packet.lpPacket = MP3OutputBuffer.Array();
                 packet.size     = ret+1;
 
-                timestamp = bufferedTimestamps[0];
-                bufferedTimestamps.Remove(0);
+                timestamp = encoderInput.GetTimestamp(numPacketsOut*outputFrameSize);
+                numPacketsOut++;
             }
         }
 
@@ -159,7 +150,7 @@ public:
 };
 
 
-AudioEncoder* CreateMP3Encoder(UINT bitRate)
+AudioEncoder* CreateMP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels)
 {
-    return new MP3Encoder(bitRate);
+    return new MP3Encoder(bitRate, sampleRateHz, channels);
 }
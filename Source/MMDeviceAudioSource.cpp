@@ -109,6 +109,11 @@ public:
 AudioSource* CreateAudioSource(bool bMic, CTSTR lpID)
 {
     MMDeviceAudioSource *source = new MMDeviceAudioSource;
+
+    //libsamplerate can still be used for devices that don't run at the output rate
+    if(AppConfig->GetInt(TEXT("Audio"), TEXT("SincResampler"), 0))
+        source->SetResamplerType(AudioResampler_Sinc);
+
     if(source->Initialize(bMic, lpID))
         return source;
     else
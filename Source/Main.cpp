@@ -148,6 +148,7 @@ void LogSystemStats()
     BYTE cpuHTT         = (cpuInfo[3]>>28) & 1;
 
     Log(TEXT("stepping id: %u, model %u, family %u, type %u, extmodel %u, extfamily %u, HTT %u, logical cores %u, total cores %u"), cpuSteppingID, cpuModel, cpuFamily, cpuType, cpuExtModel, cpuExtFamily, cpuHTT, OSGetLogicalCores(), OSGetTotalCores());
+    Log(TEXT("audio kernels: %s"), GetAudioKernelName());
 
     for(UINT i=0; i<App->NumMonitors(); i++)
     {
@@ -592,6 +593,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
             if (!OSFileExists(servicesPath) && !OSCreateDirectory(servicesPath))
                 CrashError(TEXT("Couldn't create directory '%s'"), servicesPath.Array());
 
+            //compiled locale files are only a cache, the text files are parsed if this can't be created
+            String strLocaleCachePath = strAppDataPath + TEXT("\\localeCache");
+            if(OSFileExists(strLocaleCachePath) || OSCreateDirectory(strLocaleCachePath))
+                SetLocaleCacheDirectory(strLocaleCachePath);
+
             LoadGlobalIni();
 
             String strAllocator = GlobalConfig->GetString(TEXT("General"), TEXT("Allocator"));
@@ -134,6 +134,15 @@ OBS::OBS()
     hAuxAudioMutex = OSCreateMutex();
     hVideoEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 
+    processFrameTime    = GetMetricHistogram(TEXT("video.processFrame"));
+    videoEncodeTime     = GetMetricHistogram(TEXT("video.encode"));
+    sendFrameTime       = GetMetricHistogram(TEXT("video.sendFrame"));
+    bufferedVideoDepth  = GetMetricGauge(TEXT("video.bufferedSegments"));
+    pendingAudioDepth   = GetMetricGauge(TEXT("audio.pendingFrames"));
+    audioWakeups        = GetMetricCounter(TEXT("audio.mixerWakeups"));
+    idleAudioWakeups    = GetMetricCounter(TEXT("audio.mixerIdleWakeups"));
+    audioWakeLatency    = GetMetricHistogram(TEXT("audio.mixerWakeLatency"));
+
     monitors.Clear();
     EnumDisplayMonitors(NULL, NULL, (MONITORENUMPROC)MonitorInfoEnumProc, (LPARAM)&monitors);
 
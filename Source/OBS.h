@@ -26,6 +26,7 @@ class SettingsPane;
 struct EncoderPicture;
 
 #define NUM_RENDER_BUFFERS 2
+#define MAX_PENDING_AUDIO_FRAMES 1024 //about 20 seconds of AAC frames
 
 static const int minClientWidth  = 640;
 static const int minClientHeight = 275;
@@ -154,6 +155,7 @@ String GetExpandedRecordingDirectoryBase(String);
 class AudioEncoder
 {
     friend class OBS;
+    friend class AudioBench;
 
 protected:
     virtual bool    Encode(float *input, UINT numInputFrames, DataPacket &packet, QWORD &timestamp)=0;
@@ -835,6 +837,11 @@ private:
     bool bFirstConnect;
     double curStrain;
 
+    MetricHistogram *processFrameTime, *videoEncodeTime, *sendFrameTime;
+    MetricGauge     *bufferedVideoDepth, *pendingAudioDepth;
+    MetricCounter   *audioWakeups, *idleAudioWakeups;
+    MetricHistogram *audioWakeLatency;
+
     //---------------------------------------------------
     // main capture loop stuff
 
@@ -891,18 +898,22 @@ private:
 
     CircularList<QWORD> bufferedAudioTimes;
 
-    HANDLE  hSoundThread, hSoundDataMutex;//, hRequestAudioEvent;
+    HANDLE  hSoundThread;//, hRequestAudioEvent;
     QWORD   latestAudioTime;
 
     float   desktopVol, micVol, curMicVol, curDesktopVol;
     float   desktopPeak, micPeak;
     float   desktopMax, micMax;
     float   desktopMag, micMag;
-    List<FrameAudio> pendingAudioFrames;
+    float   desktopLoudness, desktopShortTermLoudness, desktopTruePeak;  //LUFS, LUFS, dBTP
+    float   micLoudness, micShortTermLoudness, micTruePeak;
+    SPSCQueue<FrameAudio> pendingAudioFrames; //audio encode thread -> video thread
+    List<struct AudioEncodeThread*> audioEncodeThreads; //the first one encodes into pendingAudioFrames
     bool    bForceMicMono;
     float   desktopBoost, micBoost;
 
     HANDLE hAuxAudioMutex;
+    struct AudioWorkerPool *audioWorkers;
 
     //---------------------------------------------------
     // hotkey stuff
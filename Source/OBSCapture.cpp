@@ -20,12 +20,14 @@
 #include "Main.h"
 #include <time.h>
 #include <Avrt.h>
+#include "AudioWorkers.h"
+#include "AudioEncodeThreads.h"
 
 VideoEncoder* CreateX264Encoder(int fps, int width, int height, int quality, CTSTR preset, bool bUse444, ColorDescription &colorDesc, int maxBitRate, int bufferSize, bool bUseCFR);
 VideoEncoder* CreateQSVEncoder(int fps, int width, int height, int quality, CTSTR preset, bool bUse444, ColorDescription &colorDesc, int maxBitRate, int bufferSize, bool bUseCFR, String &errors);
 VideoEncoder* CreateNVENCEncoder(int fps, int width, int height, int quality, CTSTR preset, bool bUse444, ColorDescription &colorDesc, int maxBitRate, int bufferSize, bool bUseCFR, String &errors);
-AudioEncoder* CreateMP3Encoder(UINT bitRate);
-AudioEncoder* CreateAACEncoder(UINT bitRate);
+AudioEncoder* CreateMP3Encoder(UINT bitRate, UINT sampleRateHz, UINT channels);
+AudioEncoder* CreateAACEncoder(UINT bitRate, UINT sampleRateHz, UINT channels, UINT numThreads);
 
 AudioSource* CreateAudioSource(bool bMic, CTSTR lpID);
 
@@ -492,6 +494,18 @@ retryHookTest:
 
     Log(TEXT("=====Stream Start: %s==============================================="), CurrentDateTimeString().Array());
 
+    ResetMetrics();
+
+    if(GlobalConfig->GetInt(TEXT("General"), TEXT("ProfileTrace"), 0))
+    {
+        SYSTEMTIME st;
+        GetLocalTime(&st);
+
+        String strTrace;
+        strTrace << lpAppDataPath << FormattedString(TEXT("\\logs\\%u-%02u-%02u-%02u%02u-%02u"), st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond) << TEXT("-trace.json");
+        StartProfileTrace(strTrace);
+    }
+
     //-------------------------------------------------------------
 
     bEnableProjectorCursor = GlobalConfig->GetInt(L"General", L"EnableProjectorCursor", 1) != 0;
@@ -687,6 +701,8 @@ retryHookTestV2:
     Log(TEXT("Playback device %s"), strPlaybackDevice.Array());
     playbackDevices.FreeData();
 
+    InitAudioDataEvent();
+
     desktopAudio = CreateAudioSource(false, strPlaybackDevice);
 
     if(!desktopAudio) {
@@ -748,16 +764,17 @@ retryHookTestV2:
     //-------------------------------------------------------------
 
     UINT bitRate = (UINT)AppConfig->GetInt(TEXT("Audio Encoding"), TEXT("Bitrate"), 96);
+    UINT aacThreads = (UINT)MAX(AppConfig->GetInt(TEXT("Audio"), TEXT("AACEncodeThreads"), 1), 1);
 
     if (bDisableEncoding)
         audioEncoder = CreateNullAudioEncoder();
     else
 #ifdef USE_AAC
     if(isAAC) // && OSGetVersion() >= 7)
-        audioEncoder = CreateAACEncoder(bitRate);
+        audioEncoder = CreateAACEncoder(bitRate, sampleRateHz, audioChannels, aacThreads);
     else
 #endif
-        audioEncoder = CreateMP3Encoder(bitRate);
+        audioEncoder = CreateMP3Encoder(bitRate, sampleRateHz, audioChannels);
 
     //-------------------------------------------------------------
 
@@ -828,7 +845,22 @@ retryHookTestV2:
     bRecievedFirstAudioFrame = false;
 
     //hRequestAudioEvent = CreateSemaphore(NULL, 0, 0x7FFFFFFFL, NULL);
-    hSoundDataMutex = OSCreateMutex();
+    pendingAudioFrames.SetCapacity(MAX_PENDING_AUDIO_FRAMES);
+    pendingAudioFrames.Clear();
+
+    audioEncodeThreads.Clear();
+    audioEncodeThreads << CreateAudioEncodeThread(audioEncoder, &pendingAudioFrames, TEXT("audio"));
+
+    //0 processes all the sources on the audio thread
+    int numAudioWorkers = AppConfig->GetInt(TEXT("Audio"), TEXT("ProcessingThreads"), 0);
+    if (!bUseMultithreadedOptimizations)
+        numAudioWorkers = 0;
+    numAudioWorkers = MAX(MIN(numAudioWorkers, MIN(MAX_AUDIO_WORKERS, int(OSGetTotalCores())-1)), 0);
+
+    if (numAudioWorkers)
+        Log(TEXT("Processing audio sources on %d worker threads"), numAudioWorkers);
+
+    audioWorkers = CreateAudioWorkers(numAudioWorkers);
     hSoundThread = OSCreateThread((XTHREAD)OBS::MainAudioThread, NULL);
 
     //-------------------------------------------------------------
@@ -1001,18 +1033,26 @@ void OBS::Stop(bool overrideKeepRecording, bool stopReplayBuffer)
 
     if(hSoundThread)
     {
-        //ReleaseSemaphore(hRequestAudioEvent, 1, NULL);
+        SignalAudioData();
         OSTerminateThread(hSoundThread, 20000);
     }
 
     //if(hRequestAudioEvent)
     //    CloseHandle(hRequestAudioEvent);
-    if(hSoundDataMutex)
-        OSCloseMutex(hSoundDataMutex);
 
     hSoundThread = NULL;
     //hRequestAudioEvent = NULL;
-    hSoundDataMutex = NULL;
+
+    if(audioWorkers)
+    {
+        DestroyAudioWorkers(audioWorkers);
+        audioWorkers = NULL;
+    }
+
+    //the encoders finish what's been mixed before their threads exit
+    for(UINT i=0; i<audioEncodeThreads.Num(); i++)
+        DestroyAudioEncodeThread(audioEncodeThreads[i]);
+    audioEncodeThreads.Clear();
 
     //-------------------------------------------------------------
 
@@ -1056,8 +1096,6 @@ void OBS::Stop(bool overrideKeepRecording, bool stopReplayBuffer)
 
     //-------------------------------------------------------------
 
-    for(UINT i=0; i<pendingAudioFrames.Num(); i++)
-        pendingAudioFrames[i].audioData.Clear();
     pendingAudioFrames.Clear();
 
     //-------------------------------------------------------------
@@ -1080,6 +1118,9 @@ void OBS::Stop(bool overrideKeepRecording, bool stopReplayBuffer)
         delete auxAudioSources[i];
     auxAudioSources.Clear();
 
+    //nothing is left that could signal it
+    FreeAudioDataEvent();
+
     //-------------------------------------------------------------
 
     for(UINT i=0; i<NUM_RENDER_BUFFERS; i++)
@@ -1151,6 +1192,8 @@ void OBS::Stop(bool overrideKeepRecording, bool stopReplayBuffer)
 
     audioWarningId = 0;
 
+    StopProfileTrace();
+    LogMetricStats();
     DumpProfileData();
     FreeProfileData();
     Log(TEXT("=====Stream End: %s================================================="), CurrentDateTimeString().Array());
@@ -1193,61 +1236,7 @@ DWORD STDCALL OBS::MainAudioThread(LPVOID lpUnused)
 
 #define INVALID_LL 0xFFFFFFFFFFFFFFFFLL
 
-inline void CalculateVolumeLevels(float *buffer, int totalFloats, float mulVal, float &RMS, float &MAX)
-{
-    float sum = 0.0f;
-    int totalFloatsStore = totalFloats;
-
-    float Max = 0.0f;
-
-    if((UPARAM(buffer) & 0xF) == 0)
-    {
-        UINT alignedFloats = totalFloats & 0xFFFFFFFC;
-        __m128 sseMulVal = _mm_set_ps1(mulVal);
-
-        for(UINT i=0; i<alignedFloats; i += 4)
-        {
-            __m128 sseScaledVals = _mm_mul_ps(_mm_load_ps(buffer+i), sseMulVal);
-
-            /*compute squares and add them to the sum*/
-            __m128 sseSquares = _mm_mul_ps(sseScaledVals, sseScaledVals);
-            sum += sseSquares.m128_f32[0] + sseSquares.m128_f32[1] + sseSquares.m128_f32[2] + sseSquares.m128_f32[3];
-
-            /* 
-                sse maximum of squared floats 
-                concept from: http://stackoverflow.com/questions/9795529/how-to-find-the-horizontal-maximum-in-a-256-bit-avx-vector
-            */
-            __m128 sseSquaresP = _mm_shuffle_ps(sseSquares, sseSquares, _MM_SHUFFLE(1, 0, 3, 2));
-            __m128 halfmax = _mm_max_ps(sseSquares, sseSquaresP);
-            __m128 halfmaxP = _mm_shuffle_ps(halfmax, halfmax, _MM_SHUFFLE(0,1,2,3));
-            __m128 maxs = _mm_max_ps(halfmax, halfmaxP);
-
-            Max = max(Max, maxs.m128_f32[0]);
-        }
-
-        buffer      += alignedFloats;
-        totalFloats -= alignedFloats;
-    }
-
-    for(int i=0; i<totalFloats; i++)
-    {
-        float val = buffer[i] * mulVal;
-        float pow2Val = val * val;
-        sum += pow2Val;
-        Max = max(Max, pow2Val);
-    }
-
-    RMS = sqrt(sum / totalFloatsStore);
-    MAX = sqrt(Max);
-}
-
-inline float toDB(float RMS)
-{
-    float db = 20.0f * log10(RMS);
-    if(!_finite(db))
-        return VOL_MIN;
-    return db;
-}
+#define AUDIO_LATE_POLL_MS 2
 
 bool OBS::QueryAudioBuffers(bool bQueriedDesktopDebugParam)
 {
@@ -1267,20 +1256,9 @@ bool OBS::QueryAudioBuffers(bool bQueriedDesktopDebugParam)
     bufferedAudioTimes << latestAudioTime;
 
     OSEnterMutex(hAuxAudioMutex);
-    for(UINT i=0; i<auxAudioSources.Num(); i++)
-    {
-        if (auxAudioSources[i]->QueryAudio2(auxAudioSources[i]->GetVolume(), true) != NoAudioAvailable)
-            bGotSomeAudio = true;
-    }
-
+    bGotSomeAudio = ProcessAudioSources(audioWorkers, AudioJob_Query, micAudio, curMicVol, auxAudioSources);
     OSLeaveMutex(hAuxAudioMutex);
 
-    if(micAudio != NULL)
-    {
-        if (micAudio->QueryAudio2(curMicVol, true) != NoAudioAvailable)
-            bGotSomeAudio = true;
-    }
-
     return bGotSomeAudio;
 }
 
@@ -1325,56 +1303,20 @@ bool OBS::QueryNewAudio()
     /* wait until buffers are completely filled before accounting for burst */
     if (!bAudioBufferFilled)
     {
-        QWORD timestamp;
-        int burst = 0;
-
         // No more desktop data, drain auxilary/mic buffers until they're dry to prevent burst data
         OSEnterMutex(hAuxAudioMutex);
-        for(UINT i=0; i<auxAudioSources.Num(); i++)
-        {
-            while (auxAudioSources[i]->QueryAudio2(auxAudioSources[i]->GetVolume(), true) != NoAudioAvailable)
-                burst++;
-
-            if (auxAudioSources[i]->GetLatestTimestamp(timestamp))
-                auxAudioSources[i]->SortAudio(timestamp);
-
-            /*if (burst > 10)
-                Log(L"Burst happened for %s", auxAudioSources[i]->GetDeviceName2());*/
-        }
-
+        ProcessAudioSources(audioWorkers, AudioJob_Drain, micAudio, curMicVol, auxAudioSources);
         OSLeaveMutex(hAuxAudioMutex);
-
-        burst = 0;
-
-        if (micAudio)
-        {
-            while (micAudio->QueryAudio2(curMicVol, true) != NoAudioAvailable)
-                burst++;
-
-            /*if (burst > 10)
-                Log(L"Burst happened for %s", micAudio->GetDeviceName2());*/
-
-            if (micAudio->GetLatestTimestamp(timestamp))
-                micAudio->SortAudio(timestamp);
-        }
     }
 
     return bAudioBufferFilled;
 }
 
+//hands the mixed block to every encoder
 void OBS::EncodeAudioSegment(float *buffer, UINT numFrames, QWORD timestamp)
 {
-    DataPacket packet;
-    if(audioEncoder->Encode(buffer, numFrames, packet, timestamp))
-    {
-        OSEnterMutex(hSoundDataMutex);
-
-        FrameAudio *frameAudio = pendingAudioFrames.CreateNew();
-        frameAudio->audioData.CopyArray(packet.lpPacket, packet.size);
-        frameAudio->timestamp = timestamp;
-
-        OSLeaveMutex(hSoundDataMutex);
-    }
+    for(UINT i=0; i<audioEncodeThreads.Num(); i++)
+        PushMixedAudio(audioEncodeThreads[i], buffer, numFrames, timestamp);
 }
 
 void OBS::MainAudioLoop()
@@ -1392,16 +1334,25 @@ void OBS::MainAudioLoop()
     micMax = desktopMax = VOL_MIN;
     micPeak = desktopPeak = VOL_MIN;
 
+    desktopLoudness = desktopShortTermLoudness = desktopTruePeak = VOL_MIN;
+    micLoudness = micShortTermLoudness = micTruePeak = VOL_MIN;
+
     UINT audioFramesSinceMeterUpdate = 0;
     UINT audioFramesSinceMicMaxUpdate = 0;
     UINT audioFramesSinceDesktopMaxUpdate = 0;
 
-    List<float> mixBuffer, levelsBuffer;
+    List<float> mixBuffer;
     mixBuffer.SetSize(audioSampleSize*2);
-    levelsBuffer.SetSize(audioSampleSize*2);
 
     latestAudioTime = 0;
 
+    //the desktop source is read from the device rather than handed its data, so nothing signals
+    //when it has a new 10ms block.  instead the thread sleeps until the block is due (10ms after
+    //the last one was mixed), then checks every couple of ms if it's late.  sources that are
+    //handed their data wake it early with SignalAudioData.
+    QWORD nextMixTime = 0, wakeTime = 0;
+    bool bWaited = false;
+
     //---------------------------------------------
     // the audio loop of doom
 
@@ -1427,24 +1378,33 @@ void OBS::MainAudioLoop()
         bool bMicEnabled   = (micAudio != NULL);
 
         if (QueryNewAudio()) {
+            QWORD mixTime = OSGetTimeMicroseconds();
+
+            //how long after the signal or deadline that woke it the thread actually got going
+            if (bWaited && mixTime > wakeTime)
+                audioWakeLatency->Record(DWORD(mixTime-wakeTime));
+
+            bWaited = false;
+            nextMixTime = mixTime+10000;
+
             QWORD timestamp = bufferedAudioTimes[0];
             bufferedAudioTimes.Remove(0);
 
-            zero(mixBuffer.Array(),    audioSampleSize*2*sizeof(float));
-            zero(levelsBuffer.Array(), audioSampleSize*2*sizeof(float));
+            zero(mixBuffer.Array(), audioSampleSize*2*sizeof(float));
 
             //----------------------------------------------------------------------------
-            // get latest sample for calculating the volume levels
+            // get the levels of the newest audio.  each source meters its segments as they come
+            // in, so the desktop level is just the desktop and aux meters combined rather than
+            // having to mix them again.
 
-            float *latestDesktopBuffer = NULL, *latestMicBuffer = NULL;
+            AudioMeterStats desktopStats, micStats, auxStats;
+            bool bDesktopLevels = desktopAudio->GetMeterStats(desktopStats);
+            bool bMicLevels = (micAudio != NULL) && micAudio->GetMeterStats(micStats);
 
             desktopAudio->GetBuffer(&desktopBuffer, timestamp);
-            desktopAudio->GetNewestFrame(&latestDesktopBuffer);
 
-            if (micAudio != NULL) {
+            if (micAudio != NULL)
                 micAudio->GetBuffer(&micBuffer, timestamp);
-                micAudio->GetNewestFrame(&latestMicBuffer);
-            }
 
             //----------------------------------------------------------------------------
             // mix desktop samples
@@ -1452,19 +1412,16 @@ void OBS::MainAudioLoop()
             if (desktopBuffer)
                 MixAudio(mixBuffer.Array(), desktopBuffer, audioSampleSize*2, false);
 
-            if (latestDesktopBuffer)
-                MixAudio(levelsBuffer.Array(), latestDesktopBuffer, audioSampleSize*2, false);
-
             //----------------------------------------------------------------------------
-            // get latest aux volume level samples and mix
+            // add the aux levels to the desktop levels
 
             OSEnterMutex(hAuxAudioMutex);
 
-            for (UINT i=0; i<auxAudioSources.Num(); i++) {
-                float *latestAuxBuffer;
-
-                if(auxAudioSources[i]->GetNewestFrame(&latestAuxBuffer))
-                    MixAudio(levelsBuffer.Array(), latestAuxBuffer, audioSampleSize*2, false);
+            if (bDesktopLevels) {
+                for (UINT i=0; i<auxAudioSources.Num(); i++) {
+                    if(auxAudioSources[i]->GetMeterStats(auxStats))
+                        CombineAudioMeterStats(desktopStats, auxStats);
+                }
             }
 
             //----------------------------------------------------------------------------
@@ -1480,22 +1437,36 @@ void OBS::MainAudioLoop()
             OSLeaveMutex(hAuxAudioMutex);
 
             //----------------------------------------------------------------------------
-            // multiply samples by volume and compute RMS and max of samples
-            // Use 1.0f instead of curDesktopVol, since aux audio sources already have their volume set, and shouldn't be boosted anyway.
+            // convert to dB.  the sources' volume has already been applied to what they meter.
 
-            float desktopRMS = 0, micRMS = 0, desktopMx = 0, micMx = 0;
-            if (latestDesktopBuffer)
-                CalculateVolumeLevels(levelsBuffer.Array(), audioSampleSize*2, 1.0f, desktopRMS, desktopMx);
-            if (bMicEnabled && latestMicBuffer)
-                CalculateVolumeLevels(latestMicBuffer, audioSampleSize*2, curMicVol, micRMS, micMx);
+            float desktopRMS = VOL_MIN, micRMS = VOL_MIN, desktopMx = VOL_MIN, micMx = VOL_MIN;
 
-            //----------------------------------------------------------------------------
-            // convert RMS and Max of samples to dB 
+            //the sources only measure loudness while something has asked for it recently
+            bool bLoudness = AudioLoudnessRequested();
+
+            if (bDesktopLevels) {
+                desktopRMS = AmplitudeToDB(desktopStats.rms);
+                desktopMx  = AmplitudeToDB(desktopStats.peak);
+            }
+
+            if (bDesktopLevels && bLoudness) {
+                desktopLoudness          = PowerToLUFS(desktopStats.momentaryPower);
+                desktopShortTermLoudness = PowerToLUFS(desktopStats.shortTermPower);
+                desktopTruePeak          = AmplitudeToDB(desktopStats.truePeak);
+            } else
+                desktopLoudness = desktopShortTermLoudness = desktopTruePeak = VOL_MIN;
 
-            desktopRMS = toDB(desktopRMS);
-            micRMS = toDB(micRMS);
-            desktopMx = toDB(desktopMx);
-            micMx = toDB(micMx);
+            if (bMicEnabled && bMicLevels) {
+                micRMS = AmplitudeToDB(micStats.rms);
+                micMx  = AmplitudeToDB(micStats.peak);
+            }
+
+            if (bMicEnabled && bMicLevels && bLoudness) {
+                micLoudness          = PowerToLUFS(micStats.momentaryPower);
+                micShortTermLoudness = PowerToLUFS(micStats.shortTermPower);
+                micTruePeak          = AmplitudeToDB(micStats.truePeak);
+            } else
+                micLoudness = micShortTermLoudness = micTruePeak = VOL_MIN;
 
             //----------------------------------------------------------------------------
             // update max if sample max is greater or after 1 second
@@ -1557,7 +1528,26 @@ void OBS::MainAudioLoop()
         }
         else
         {
-            OSSleep(5); //screw it, just run it every 5ms
+            if (bWaited)
+                idleAudioWakeups->Add();
+
+            QWORD curTime = OSGetTimeMicroseconds();
+            DWORD waitMS;
+
+            if (nextMixTime > curTime+AUDIO_LATE_POLL_MS*1000) {
+                wakeTime = nextMixTime;
+                waitMS = DWORD((nextMixTime-curTime)/1000);
+            } else {
+                wakeTime = curTime+AUDIO_LATE_POLL_MS*1000;
+                waitMS = AUDIO_LATE_POLL_MS;
+            }
+
+            QWORD signalTime;
+            if (WaitForAudioData(waitMS, signalTime) && signalTime)
+                wakeTime = signalTime;
+
+            audioWakeups->Add();
+            bWaited = true;
         }
 
         //-----------------------------------------------
@@ -1569,10 +1559,10 @@ void OBS::MainAudioLoop()
     desktopMag = desktopMax = desktopPeak = VOL_MIN;
     micMag = micMax = micPeak = VOL_MIN;
 
-    PostMessage(hwndMain, WM_COMMAND, MAKEWPARAM(ID_MICVOLUMEMETER, VOLN_METERED), 0);
+    desktopLoudness = desktopShortTermLoudness = desktopTruePeak = VOL_MIN;
+    micLoudness = micShortTermLoudness = micTruePeak = VOL_MIN;
 
-    for (UINT i=0; i<pendingAudioFrames.Num(); i++)
-        pendingAudioFrames[i].audioData.Clear();
+    PostMessage(hwndMain, WM_COMMAND, MAKEWPARAM(ID_MICVOLUMEMETER, VOLN_METERED), 0);
 
     AvRevertMmThreadCharacteristics(hTask);
 }
@@ -90,16 +90,16 @@ bool OBS::BufferVideoData(const List<DataPacket> &inputPackets, const List<Packe
 
     bool dataReady = false;
 
-    OSEnterMutex(hSoundDataMutex);
-    for (UINT i = 0; i < pendingAudioFrames.Num(); i++)
+    UINT numAudioFrames = pendingAudioFrames.NumAvailable();
+    for (UINT i = 0; i < numAudioFrames; i++)
     {
-        if (firstFrameTime < pendingAudioFrames[i].timestamp && pendingAudioFrames[i].timestamp - firstFrameTime >= bufferedVideo[0].timestamp)
+        QWORD audioTimestamp = pendingAudioFrames.Peek(i)->timestamp;
+        if (firstFrameTime < audioTimestamp && audioTimestamp - firstFrameTime >= bufferedVideo[0].timestamp)
         {
             dataReady = true;
             break;
         }
     }
-    OSLeaveMutex(hSoundDataMutex);
 
     if (dataReady)
     {
@@ -142,6 +142,10 @@ struct FrameProcessInfo
 
 void OBS::SendFrame(VideoSegment &curSegment, QWORD firstFrameTime)
 {
+    MetricTimer sendTimer(sendFrameTime);
+
+    pendingAudioDepth->Set(pendingAudioFrames.NumAvailable());
+
     if(!bSentHeaders)
     {
         if(network && curSegment.packets[0].data[0] == 0x17) {
@@ -150,54 +154,45 @@ void OBS::SendFrame(VideoSegment &curSegment, QWORD firstFrameTime)
         }
     }
 
-    OSEnterMutex(hSoundDataMutex);
-
-    if(pendingAudioFrames.Num())
+    while(FrameAudio *frameAudio = pendingAudioFrames.Peek())
     {
-        while(pendingAudioFrames.Num())
+        if(firstFrameTime < frameAudio->timestamp)
         {
-            if(firstFrameTime < pendingAudioFrames[0].timestamp)
-            {
-                UINT audioTimestamp = UINT(pendingAudioFrames[0].timestamp-firstFrameTime);
+            UINT audioTimestamp = UINT(frameAudio->timestamp-firstFrameTime);
 
-                //stop sending audio packets when we reach an audio timestamp greater than the video timestamp
-                if(audioTimestamp > curSegment.timestamp)
-                    break;
+            //stop sending audio packets when we reach an audio timestamp greater than the video timestamp
+            if(audioTimestamp > curSegment.timestamp)
+                break;
 
-                if(audioTimestamp == 0 || audioTimestamp > lastAudioTimestamp)
+            if(audioTimestamp == 0 || audioTimestamp > lastAudioTimestamp)
+            {
+                List<BYTE> &audioData = frameAudio->audioData;
+                if(audioData.Num())
                 {
-                    List<BYTE> &audioData = pendingAudioFrames[0].audioData;
-                    if(audioData.Num())
-                    {
-                        //Log(TEXT("a:%u, %llu"), audioTimestamp, frameInfo.firstFrameTime+audioTimestamp);
+                    //Log(TEXT("a:%u, %llu"), audioTimestamp, frameInfo.firstFrameTime+audioTimestamp);
 
-                        if(network)
-                            network->SendPacket(audioData.Array(), audioData.Num(), audioTimestamp, PacketType_Audio);
+                    if(network)
+                        network->SendPacket(audioData.Array(), audioData.Num(), audioTimestamp, PacketType_Audio);
 
-                        if (fileStream || replayBufferStream)
-                        {
-                            auto shared_data = std::make_shared<const std::vector<BYTE>>(audioData.Array(), audioData.Array() + audioData.Num());
-                            if (fileStream)
-                                fileStream->AddPacket(shared_data, audioTimestamp, audioTimestamp, PacketType_Audio);
-                            if (replayBufferStream)
-                                replayBufferStream->AddPacket(shared_data, audioTimestamp, audioTimestamp, PacketType_Audio);
-                        }
-
-                        audioData.Clear();
-
-                        lastAudioTimestamp = audioTimestamp;
+                    if (fileStream || replayBufferStream)
+                    {
+                        auto shared_data = std::make_shared<const std::vector<BYTE>>(audioData.Array(), audioData.Array() + audioData.Num());
+                        if (fileStream)
+                            fileStream->AddPacket(shared_data, audioTimestamp, audioTimestamp, PacketType_Audio);
+                        if (replayBufferStream)
+                            replayBufferStream->AddPacket(shared_data, audioTimestamp, audioTimestamp, PacketType_Audio);
                     }
+
+                    lastAudioTimestamp = audioTimestamp;
                 }
             }
-            else
-                nop();
-
-            pendingAudioFrames[0].audioData.Clear();
-            pendingAudioFrames.Remove(0);
         }
-    }
+        else
+            nop();
 
-    OSLeaveMutex(hSoundDataMutex);
+        //the slot keeps its buffer for the audio thread to refill
+        pendingAudioFrames.Pop();
+    }
 
     for(UINT i=0; i<curSegment.packets.Num(); i++)
     {
@@ -252,6 +247,8 @@ bool OBS::HandleStreamStopInfo(OBS::StopInfo &info, PacketType type, const Video
 
 bool OBS::ProcessFrame(FrameProcessInfo &frameInfo)
 {
+    MetricTimer processTimer(processFrameTime);
+
     List<DataPacket> videoPackets;
     List<PacketType> videoPacketTypes;
 
@@ -272,7 +269,11 @@ bool OBS::ProcessFrame(FrameProcessInfo &frameInfo)
         picIn = frameInfo.pic->picOut ? (LPVOID)frameInfo.pic->picOut : (LPVOID)frameInfo.pic->mfxOut;
 
     DWORD out_pts = 0;
-    videoEncoder->Encode(picIn, videoPackets, videoPacketTypes, bufferedTimes[0], out_pts);
+
+    {
+        MetricTimer encodeTimer(videoEncodeTime);
+        videoEncoder->Encode(picIn, videoPackets, videoPacketTypes, bufferedTimes[0], out_pts);
+    }
 
     bProcessedFrame = (videoPackets.Num() != 0);
 
@@ -281,6 +282,8 @@ bool OBS::ProcessFrame(FrameProcessInfo &frameInfo)
     {
         bSendFrame = BufferVideoData(videoPackets, videoPacketTypes, bufferedTimes[0], out_pts, frameInfo.firstFrameTime, curSegment);
         bufferedTimes.Remove(0);
+
+        bufferedVideoDepth->Set(bufferedVideo.Num());
     }
     else
         nop();
@@ -610,6 +613,8 @@ void OBS::MainCaptureLoop()
 
     bool bLogLongFramesProfile = GlobalConfig->GetInt(TEXT("General"), TEXT("LogLongFramesProfile"), LOGLONGFRAMESDEFAULT) != 0;
     float logLongFramesProfilePercentage = GlobalConfig->GetFloat(TEXT("General"), TEXT("LogLongFramesProfilePercentage"), 10.f);
+    UINT metricsLogInterval = GlobalConfig->GetInt(TEXT("General"), TEXT("MetricsLogInterval"), 60);
+    UINT metricsLogSeconds = 0;
 
     Vect2 baseSize    = Vect2(float(baseCX), float(baseCY));
     Vect2 outputSize  = Vect2(float(outputCX), float(outputCY));
@@ -889,6 +894,12 @@ void OBS::MainCaptureLoop()
             fpsCounter = 0;
 
             bUpdateBPS = true;
+
+            if(metricsLogInterval && ++metricsLogSeconds >= metricsLogInterval)
+            {
+                LogMetricStats();
+                metricsLogSeconds = 0;
+            }
         }
 
         fpsCounter++;
@@ -77,6 +77,7 @@ RTMPPublisher::RTMPPublisher()
     //bufferedPackets.SetBaseSize(MAX_BUFFERED_PACKETS);
 
     bFirstKeyframe = true;
+    bSocketDead = false;
 
     hSendSempahore = CreateSemaphore(NULL, 0, 0x7FFFFFFFL, NULL);
     if(!hSendSempahore)
@@ -88,6 +89,12 @@ RTMPPublisher::RTMPPublisher()
 
     hRTMPMutex = OSCreateMutex();
 
+    sendPacketTime      = GetMetricHistogram(TEXT("rtmp.sendPacket"));
+    bufferWaitTime      = GetMetricHistogram(TEXT("rtmp.bufferWait"));
+    queuedPacketDepth   = GetMetricGauge(TEXT("rtmp.queuedPackets"));
+    queuedPacketBytes   = GetMetricGauge(TEXT("rtmp.queuedBytes"));
+    socketBufferBytes   = GetMetricGauge(TEXT("rtmp.socketBufferBytes"));
+
     //------------------------------------------
 
     bframeDropThreshold = AppConfig->GetInt(TEXT("Publish"), TEXT("BFrameDropThreshold"), 400);
@@ -183,9 +190,7 @@ bool RTMPPublisher::Init(UINT tcpBufferSize)
     hSocketLoopExit = CreateEvent(NULL, TRUE, FALSE, NULL);
     hSendBacklogEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 
-    hDataBufferMutex = OSCreateMutex();
-
-    dataBuffer = (BYTE *)Allocate(dataBufferSize);
+    dataBuffer.SetCapacity(dataBufferSize);
 
     hSocketThread = OSCreateThread((XTHREAD)RTMPPublisher::SocketThread, this);
     if(!hSocketThread)
@@ -225,7 +230,7 @@ void RTMPPublisher::InitEncoderData()
 
 RTMPPublisher::~RTMPPublisher()
 {
-    //OSDebugOut (TEXT("*** ~RTMPPublisher (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), curDataBufferLen);
+    //OSDebugOut (TEXT("*** ~RTMPPublisher (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), dataBuffer.NumQueued());
     bStopping = true;
 
     //we're in the middle of connecting! wait for that to happen to avoid all manner of race conditions
@@ -270,7 +275,7 @@ RTMPPublisher::~RTMPPublisher()
         //wait 50 sec for all data to finish sending
         if (WaitForSingleObject(hSendThread, 50000) == WAIT_TIMEOUT)
         {
-            Log(TEXT("~RTMPPublisher: Network appears stalled with %d / %d buffered, dropping connection!"), curDataBufferLen, dataBufferSize);
+            Log(TEXT("~RTMPPublisher: Network appears stalled with %d / %d buffered, dropping connection!"), dataBuffer.NumQueued(), dataBufferSize);
             FatalSocketShutdown();
 
             //this will wake up and flush the sendloop if it's still trying to send out stuff
@@ -286,7 +291,7 @@ RTMPPublisher::~RTMPPublisher()
     if(hSendSempahore)
         CloseHandle(hSendSempahore);
 
-    //OSDebugOut (TEXT("*** ~RTMPPublisher hSendThread terminated (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), curDataBufferLen);
+    //OSDebugOut (TEXT("*** ~RTMPPublisher hSendThread terminated (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), dataBuffer.NumQueued());
 
     if (hSocketThread)
     {
@@ -304,7 +309,7 @@ RTMPPublisher::~RTMPPublisher()
         Log(TEXT("~RTMPPublisher: Socket thread terminated in %d ms"), OSGetTime() - startTime);
     }
 
-    //OSDebugOut (TEXT("*** ~RTMPPublisher hSocketThread terminated (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), curDataBufferLen);
+    //OSDebugOut (TEXT("*** ~RTMPPublisher hSocketThread terminated (%d queued, %d buffered, %d data)\n"), queuedPackets.Num(), bufferedPackets.Num(), dataBuffer.NumQueued());
 
     if(rtmp)
     {
@@ -358,12 +363,6 @@ RTMPPublisher::~RTMPPublisher()
         bufferedPackets.Remove(0);
     }
 
-    if (dataBuffer)
-        Free(dataBuffer);
-
-    if (hDataBufferMutex)
-        OSCloseMutex(hDataBufferMutex);
-
     if (hBufferEvent)
         CloseHandle(hBufferEvent);
 
@@ -1126,7 +1125,7 @@ end:
 
 double RTMPPublisher::GetPacketStrain() const
 {
-    return (curDataBufferLen / (double)dataBufferSize) * 100.0;
+    return (dataBuffer.NumQueued() / (double)dataBufferSize) * 100.0;
     /*if(packetWaitType >= PacketType_VideoHigh)
         return min(100.0, dNetworkStrain*100.0);
     else if(bNetworkStrain)
@@ -1149,16 +1148,28 @@ int RTMPPublisher::FlushDataBuffer()
 {
     unsigned long zero = 0;
 
-    //OSDebugOut (TEXT("*** ~RTMPPublisher FlushDataBuffer (%d)\n"), curDataBufferLen);
+    //OSDebugOut (TEXT("*** ~RTMPPublisher FlushDataBuffer (%d)\n"), dataBuffer.NumQueued());
     
+    //only called once the socket thread has exited, so this thread is now the one reading dataBuffer
+
     //make it blocking again
     WSAEventSelect(rtmp->m_sb.sb_socket, NULL, 0);
     ioctlsocket(rtmp->m_sb.sb_socket, FIONBIO, &zero);
 
-    OSEnterMutex(hDataBufferMutex);
-    int ret = send(rtmp->m_sb.sb_socket, (const char *)dataBuffer, curDataBufferLen, 0);
-    curDataBufferLen = 0;
-    OSLeaveMutex(hDataBufferMutex);
+    int ret = 0;
+    unsigned int len;
+    LPBYTE data;
+
+    while ((data = dataBuffer.PeekRead(len)), len)
+    {
+        ret = send(rtmp->m_sb.sb_socket, (const char *)data, len, 0);
+        if (ret <= 0)
+            break;
+
+        dataBuffer.CommitRead(ret);
+    }
+
+    dataBuffer.DiscardAll();
 
     return ret;
 }
@@ -1180,8 +1191,10 @@ void RTMPPublisher::FatalSocketShutdown()
     closesocket(rtmp->m_sb.sb_socket);
     rtmp->m_sb.sb_socket = -1;
 
-    //anything buffered is invalid now
-    curDataBufferLen = 0;
+    //anything buffered is invalid now.  only the socket thread reads the ring, so it does the discarding
+    //itself the next time it looks at it (it may be stuck inside a send() on the old data right now)
+    bSocketDead = true;
+    SetEvent(hBufferEvent);
 
     if (!bStopping)
     {
@@ -1245,18 +1258,21 @@ void RTMPPublisher::SocketLoop()
 
     for (;;)
     {
+        if (bSocketDead)
+        {
+            Log(TEXT("RTMPPublisher::SocketLoop: Socket was shut down, dropping %d buffered bytes"), dataBuffer.NumQueued());
+            return;
+        }
+
         if (bStopping && WaitForSingleObject(hSocketLoopExit, 0) != WAIT_TIMEOUT)
         {
-            OSEnterMutex(hDataBufferMutex);
-            if (curDataBufferLen == 0)
+            if (dataBuffer.NumQueued() == 0)
             {
                 //OSDebugOut (TEXT("Exiting on empty buffer.\n"));
-                OSLeaveMutex(hDataBufferMutex);
                 break;
             }
 
-            //OSDebugOut (TEXT("Want to exit, but %d bytes remain.\n"), curDataBufferLen);
-            OSLeaveMutex(hDataBufferMutex);
+            //OSDebugOut (TEXT("Want to exit, but %d bytes remain.\n"), dataBuffer.NumQueued());
         }
 
         int status = WaitForMultipleObjects (3, hObjects, FALSE, INFINITE);
@@ -1285,11 +1301,11 @@ void RTMPPublisher::SocketLoop()
                 if (lastSendTime)
                 {
                     DWORD diff = OSGetTime() - lastSendTime;
-                    Log(TEXT("RTMPPublisher::SocketLoop: Received FD_CLOSE, %u ms since last send (buffer: %d / %d)"), diff, curDataBufferLen, dataBufferSize);
+                    Log(TEXT("RTMPPublisher::SocketLoop: Received FD_CLOSE, %u ms since last send (buffer: %d / %d)"), diff, dataBuffer.NumQueued(), dataBufferSize);
                 }
 
                 if (bStopping)
-                    Log(TEXT("RTMPPublisher::SocketLoop: Aborting due to FD_CLOSE during shutdown, %d bytes lost, error %d"), curDataBufferLen, networkEvents.iErrorCode[FD_CLOSE_BIT]);
+                    Log(TEXT("RTMPPublisher::SocketLoop: Aborting due to FD_CLOSE during shutdown, %d bytes lost, error %d"), dataBuffer.NumQueued(), networkEvents.iErrorCode[FD_CLOSE_BIT]);
                 else
                     Log(TEXT("RTMPPublisher::SocketLoop: Aborting due to FD_CLOSE, error %d"), networkEvents.iErrorCode[FD_CLOSE_BIT]);
                 FatalSocketShutdown ();
@@ -1343,7 +1359,7 @@ void RTMPPublisher::SocketLoop()
                     {
                         int bufferSize = (int)idealSendBacklog;
                         setsockopt(rtmp->m_sb.sb_socket, SOL_SOCKET, SO_SNDBUF, (const char *)&bufferSize, sizeof(bufferSize));
-                        Log(TEXT("RTMPPublisher::SocketLoop: Increasing send buffer to ISB %d (buffer: %d / %d)"), idealSendBacklog, curDataBufferLen, dataBufferSize);
+                        Log(TEXT("RTMPPublisher::SocketLoop: Increasing send buffer to ISB %d (buffer: %d / %d)"), idealSendBacklog, dataBuffer.NumQueued(), dataBufferSize);
                     }
                 }
                 else
@@ -1361,13 +1377,14 @@ void RTMPPublisher::SocketLoop()
             bool exitLoop = false;
             do
             {
-                OSEnterMutex(hDataBufferMutex);
+                //only the part up to the wrap point of the ring is contiguous, the rest goes out on the next pass
+                unsigned int sendDataLen;
+                LPBYTE sendData = dataBuffer.PeekRead(sendDataLen);
 
-                if (!curDataBufferLen)
+                if (!sendDataLen)
                 {
                     //this is now an expected occasional condition due to use of auto-reset events, we could end up emptying the buffer
                     //as it's filled in a previous loop cycle, especially if using low latency mode.
-                    OSLeaveMutex(hDataBufferMutex);
                     //Log(TEXT("RTMPPublisher::SocketLoop: Trying to send, but no data available?!"));
                     break;
                 }
@@ -1375,19 +1392,17 @@ void RTMPPublisher::SocketLoop()
                 int ret;
                 if (lowLatencyMode != LL_MODE_NONE)
                 {
-                    int sendLength = min (latencyPacketSize, curDataBufferLen);
-                    ret = send(rtmp->m_sb.sb_socket, (const char *)dataBuffer, sendLength, 0);
+                    int sendLength = min (latencyPacketSize, (int)sendDataLen);
+                    ret = send(rtmp->m_sb.sb_socket, (const char *)sendData, sendLength, 0);
                 }
                 else
                 {
-                    ret = send(rtmp->m_sb.sb_socket, (const char *)dataBuffer, curDataBufferLen, 0);
+                    ret = send(rtmp->m_sb.sb_socket, (const char *)sendData, sendDataLen, 0);
                 }
 
                 if (ret > 0)
                 {
-                    if (curDataBufferLen - ret)
-                        memmove(dataBuffer, dataBuffer + ret, curDataBufferLen - ret);
-                    curDataBufferLen -= ret;
+                    dataBuffer.CommitRead(ret);
 
                     bytesSent += ret;
 
@@ -1396,7 +1411,7 @@ void RTMPPublisher::SocketLoop()
                         DWORD diff = OSGetTime() - lastSendTime;
 
                         if (diff >= 1500)
-                            Log(TEXT("RTMPPublisher::SocketLoop: Stalled for %u ms to write %d bytes (buffer: %d / %d), unstable connection?"), diff, ret, curDataBufferLen, dataBufferSize);
+                            Log(TEXT("RTMPPublisher::SocketLoop: Stalled for %u ms to write %d bytes (buffer: %d / %d), unstable connection?"), diff, ret, dataBuffer.NumQueued(), dataBufferSize);
 
                         totalSendPeriod += diff;
                         totalSendBytes += ret;
@@ -1419,7 +1434,6 @@ void RTMPPublisher::SocketLoop()
                         if (errorCode == WSAEWOULDBLOCK)
                         {
                             canWrite = false;
-                            OSLeaveMutex(hDataBufferMutex);
                             break;
                         }
 
@@ -1435,18 +1449,15 @@ void RTMPPublisher::SocketLoop()
                     {
                         //connection closed, or connection was aborted / socket closed / etc, that's a fatal error for us.
                         Log(TEXT("RTMPPublisher::SocketLoop: Socket error, send() returned %d, GetLastError() %d"), ret, errorCode);
-                        OSLeaveMutex(hDataBufferMutex);
                         FatalSocketShutdown ();
                         return;
                     }
                 }
 
                 //finish writing for now
-                if (curDataBufferLen <= 1000)
+                if (dataBuffer.NumQueued() <= 1000)
                     exitLoop = true;
 
-                OSLeaveMutex(hDataBufferMutex);
-
                 if (delayTime)
                     Sleep (delayTime);
             } while (!exitLoop);
@@ -1479,6 +1490,9 @@ void RTMPPublisher::SendLoop()
 
             queuedPackets.Remove(0);
 
+            queuedPacketDepth->Set(queuedPackets.Num());
+            queuedPacketBytes->Set(currentBufferSize);
+
             OSLeaveMutex(hDataMutex);
 
             //--------------------------------------------
@@ -1494,8 +1508,11 @@ void RTMPPublisher::SendLoop()
             packet.m_nBodySize = packetData.Num()-RTMP_MAX_HEADER_SIZE;
             packet.m_body = (char*)packetData.Array()+RTMP_MAX_HEADER_SIZE;
 
-            //QWORD sendTimeStart = OSGetTimeMicroseconds();
-            if(!RTMP_SendPacket(rtmp, &packet, FALSE))
+            QWORD sendTimeStart = OSGetTimeMicroseconds();
+            BOOL bSent = RTMP_SendPacket(rtmp, &packet, FALSE);
+            sendPacketTime->Record(DWORD(OSGetTimeMicroseconds()-sendTimeStart));
+
+            if(!bSent)
             {
                 //should never reach here with the new shutdown sequence.
                 RUNONCE Log(TEXT("RTMP_SendPacket failure, should not happen!"));
@@ -1542,6 +1559,11 @@ DWORD RTMPPublisher::SendThread(RTMPPublisher *publisher)
 DWORD RTMPPublisher::SocketThread(RTMPPublisher *publisher)
 {
     publisher->SocketLoop();
+
+    //this thread is the only reader of dataBuffer, so a dead connection's leftovers are dropped here
+    if (publisher->bSocketDead)
+        publisher->dataBuffer.DiscardAll();
+
     return 0;
 }
 
@@ -1703,26 +1725,23 @@ retrySend:
     if (!RTMP_IsConnected(network->rtmp))
         return len;
 
-    OSEnterMutex(network->hDataBufferMutex);
-
-    if (network->curDataBufferLen + len >= network->dataBufferSize)
+    if (network->dataBuffer.FreeSpace() <= (unsigned int)len)
     {
-        //Log(TEXT("RTMPPublisher::BufferedSend: Socket buffer is full (%d / %d bytes), waiting to send %d bytes"), network->curDataBufferLen, network->dataBufferSize, len);
+        //Log(TEXT("RTMPPublisher::BufferedSend: Socket buffer is full (%d / %d bytes), waiting to send %d bytes"), network->dataBuffer.NumQueued(), network->dataBufferSize, len);
         ++network->totalTimesWaited;
         network->totalBytesWaited += len;
 
-        OSLeaveMutex(network->hDataBufferMutex);
-
+        QWORD waitStart = OSGetTimeMicroseconds();
         int status = WaitForSingleObject(network->hBufferSpaceAvailableEvent, INFINITE);
+        network->bufferWaitTime->Record(DWORD(OSGetTimeMicroseconds()-waitStart));
+
         if (status == WAIT_ABANDONED || status == WAIT_FAILED)
             return 0;
         goto retrySend;
     }
 
-    mcpy(network->dataBuffer + network->curDataBufferLen, buf, len);
-    network->curDataBufferLen += len;
-
-    OSLeaveMutex(network->hDataBufferMutex);
+    network->dataBuffer.Write(buf, len);
+    network->socketBufferBytes->Set(network->dataBuffer.NumQueued());
 
     SetEvent (network->hBufferEvent);
 
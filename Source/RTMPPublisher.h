@@ -111,7 +111,6 @@ protected:
     HANDLE hWriteEvent;
     HANDLE hBufferEvent;
     HANDLE hBufferSpaceAvailableEvent;
-    HANDLE hDataBufferMutex;
     HANDLE hRTMPMutex;
     HANDLE hConnectionThread;
 
@@ -122,6 +121,7 @@ protected:
     OVERLAPPED sendBacklogOverlapped;
 
     bool bStopping;
+    volatile bool bSocketDead;      //set by FatalSocketShutdown, the socket thread discards dataBuffer when it sees it
 
     int packetWaitType;
 
@@ -132,11 +132,9 @@ protected:
     UINT numPFramesDumped;
     UINT numBFramesDumped;
 
-    BYTE *dataBuffer;
+    SPSCByteRing dataBuffer; //send thread -> socket thread
     int dataBufferSize;
 
-    int curDataBufferLen;
-
     latencymode_t lowLatencyMode;
     int latencyFactor;
     int totalTimesWaited;
@@ -148,6 +146,9 @@ protected:
 
     bool bFastInitialKeyframe;
 
+    MetricHistogram *sendPacketTime, *bufferWaitTime;
+    MetricGauge     *queuedPacketDepth, *queuedPacketBytes, *socketBufferBytes;
+
     void SendLoop();
     void SocketLoop();
     int FlushDataBuffer();
@@ -319,6 +319,7 @@ INT_PTR SettingsGeneral::ProcMessage(UINT message, WPARAM wParam, LPARAM lParam)
                         {
                             if(bRenaming)
                             {
+                                AppConfig->Flush();
                                 if(!MoveFile(strCurProfilePath, strProfilePath))
                                     break;
 
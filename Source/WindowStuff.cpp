@@ -2946,6 +2946,8 @@ void OBS::AddProfile(ProfileAction action)
     {
         bool success = true;
 
+        AppConfig->Flush();
+
         if (action == ProfileAction::Rename)
         {
             if (!MoveFile(strCurProfilePath, strProfilePath))
@@ -3021,6 +3023,7 @@ void OBS::RemoveProfile()
     {
         String strCurProfilePath;
         strCurProfilePath << strCurProfileDir << strCurProfile << TEXT(".ini");
+        AppConfig->Flush();
         OSDeleteFile(strCurProfilePath);
 
         GlobalConfig->SetString(L"General", L"Profile", GetPathWithoutExtension(nextFile));
@@ -3067,6 +3070,7 @@ void OBS::ImportProfile()
     String strCurProfileFile;
     strCurProfileFile << lpAppDataPath << TEXT("\\profiles\\") << strCurProfile << L".ini";
 
+    AppConfig->Flush();
     CopyFile(lpFile, strCurProfileFile, false);
 
     if(!AppConfig->Open(strCurProfileFile))
@@ -3112,6 +3116,7 @@ void OBS::ExportProfile()
 
     GlobalConfig->SetString(L"General", L"LastImportExportPath", GetPathDirectory(lpFile));
 
+    AppConfig->Flush();
     CopyFile(strCurProfileFile, lpFile,  false);
 }
 
@@ -43,6 +43,7 @@
 #include "set_get.h"
 #include "quantize.h"
 #include "psymodel.h"
+#include "newmdct.h"
 #include "version.h"
 #include "VbrTag.h"
 #include "tables.h"
@@ -572,10 +573,12 @@ lame_init_params(lame_global_flags * gfp)
     if (gfp->asm_optimizations.sse) {
         gfc->CPU_features.SSE = has_SSE();
         gfc->CPU_features.SSE2 = has_SSE2();
+        gfc->CPU_features.AVX2 = has_AVX2();
     }
     else {
         gfc->CPU_features.SSE = 0;
         gfc->CPU_features.SSE2 = 0;
+        gfc->CPU_features.AVX2 = 0;
     }
 
 
@@ -1298,6 +1301,7 @@ lame_init_params(lame_global_flags * gfp)
     (void) lame_init_bitstream(gfp);
 
     iteration_init(gfc);
+    init_mdct(gfc);
     (void) psymodel_init(gfp);
 
     cfg->buffer_constraint = get_max_frame_buffer_size_by_constraint(cfg, gfp->strict_ISO);
@@ -1371,6 +1375,9 @@ lame_print_config(const lame_global_flags * gfp)
         if (gfc->CPU_features.SSE2) {
             concatSep(text, ", ", (fft_asm_used == 3) ? "SSE2 (ASM used)" : "SSE2");
         }
+        if (gfc->CPU_features.AVX2) {
+            concatSep(text, ", ", "AVX2");
+        }
         MSGF(gfc, "CPU features: %s\n", text);
     }
 
@@ -35,6 +35,7 @@
 #include "encoder.h"
 #include "util.h"
 #include "newmdct.h"
+#include "vector/lame_intrin.h"
 
 
 
@@ -426,9 +427,10 @@ static const int order[] = {
 };
 
 
-/* returns sum_j=0^31 a[j]*cos(PI*j*(k+1/2)/32), 0<=k<32 */
-inline static void
-window_subband(const sample_t * x1, FLOAT a[SBLIMIT])
+/* first part of window_subband: a[0..29] from 15 independent 16 tap sums.
+ * the SSE2/AVX2 versions in vector/ run one sum per lane */
+static void
+window_subband_pairs(const sample_t * x1, FLOAT a[SBLIMIT])
 {
     int     i;
     FLOAT const *wp = enwindow + 10;
@@ -501,6 +503,17 @@ window_subband(const sample_t * x1, FLOAT a[SBLIMIT])
         x1--;
         x2++;
     }
+}
+
+
+/* returns sum_j=0^31 a[j]*cos(PI*j*(k+1/2)/32), 0<=k<32 */
+inline static void
+window_subband(lame_internal_flags const *gfc, const sample_t * x1, FLOAT a[SBLIMIT])
+{
+    FLOAT const *wp = enwindow + 10 + 15 * 18;
+
+    gfc->window_subband_pairs(x1, a);
+    x1 -= 15;
     {
         FLOAT   s, t, u, v;
         t = x1[-16] * wp[-10];
@@ -941,6 +954,23 @@ mdct_long(FLOAT * out, FLOAT const *in)
 }
 
 
+void
+init_mdct(lame_internal_flags * const gfc)
+{
+    gfc->window_subband_pairs = window_subband_pairs;
+#ifdef HAVE_XMM_SUBBAND
+    if (gfc->CPU_features.SSE2) {
+        init_window_subband_xmm(enwindow);
+        gfc->window_subband_pairs = window_subband_pairs_sse2;
+#ifdef HAVE_AVX2_INTRINSICS
+        if (gfc->CPU_features.AVX2)
+            gfc->window_subband_pairs = window_subband_pairs_avx2;
+#endif
+    }
+#endif
+}
+
+
 void
 mdct_sub48(lame_internal_flags * gfc, const sample_t * w0, const sample_t * w1)
 {
@@ -959,8 +989,8 @@ mdct_sub48(lame_internal_flags * gfc, const sample_t * w0, const sample_t * w1)
             FLOAT  *samp = esv->sb_sample[ch][1 - gr][0];
 
             for (k = 0; k < 18 / 2; k++) {
-                window_subband(wk, samp);
-                window_subband(wk + 32, samp + 32);
+                window_subband(gfc, wk, samp);
+                window_subband(gfc, wk + 32, samp + 32);
                 samp += 64;
                 wk += 64;
                 /*
@@ -22,6 +22,7 @@
 #ifndef LAME_NEWMDCT_H
 #define LAME_NEWMDCT_H
 
+void    init_mdct(lame_internal_flags * const gfc);
 void    mdct_sub48(lame_internal_flags * gfc, const sample_t * w0, const sample_t * w1);
 
 #endif /* LAME_NEWMDCT_H */
@@ -0,0 +1,423 @@
+/*
+ *      make check for the SIMD routines in vector/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Encodes a small corpus (testcase.wav plus three generated inputs) in
+ * several CBR/ABR/VBR modes, once with the CPU's SSE2/AVX2 routines and
+ * once with them switched off (lame_set_asm_optimizations(gfp, SSE, 0)).
+ *
+ * - both encodes have to give the same bytes
+ * - the bytes have to hash to what lame gave before the SSE2/AVX2
+ *   filterbank and Huffman table selection went in
+ * - prints the encode speed of each, best of CHECK_RUNS
+ *
+ * The generated inputs are built from integers only, so they are the
+ * same everywhere.  lame's own float math isn't: the reference hashes are
+ * for x86-64 gcc builds, where C float math uses SSE.  Other compilers and
+ * x87 builds can give different hashes without anything being wrong, the
+ * SIMD on/off comparison still has to hold there.
+ *
+ * With -ffast-math the compiler may reorder the C filterbank sums, so the
+ * SSE2/AVX2 filterbank is left out of those builds (see lame_intrin.h) and
+ * only the AVX2 Huffman table selection is compared.
+ *
+ *   simd_check [testcase.wav]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lame.h"
+
+
+#define CHECK_SECONDS 10 /* length of each generated input */
+#define CHECK_RUNS    3  /* encodes timed per mode, the best one is shown */
+#define CHECK_CHUNK   4096
+
+typedef struct {
+    const char *name;
+    int     samplerate;
+    int     channels;
+    int     frames;
+    short  *left;
+    short  *right;              /* same as left for mono */
+} check_input;
+
+typedef struct {
+    const char *name;
+    vbr_mode vbr;
+    int     brate;              /* kbps for CBR, mean kbps for ABR */
+    int     vbr_q;
+    int     quality;
+    int     nores;
+} check_mode;
+
+/* the first is what OBS's Encoder_MP3.cpp uses */
+static const check_mode modes[] = {
+    {"cbr 128 q2 nores", vbr_off, 128, 0, 2, 1},
+    {"cbr 320 q0", vbr_off, 320, 0, 0, 0},
+    {"abr 160 q5", vbr_abr, 160, 0, 5, 0},
+    {"vbr v4 q3", vbr_mtrh, 0, 4, 3, 0}
+};
+
+#define NUM_MODES  (sizeof(modes) / sizeof(modes[0]))
+#define NUM_INPUTS 4
+
+/* fnv-1a of the whole stream, input by input then mode by mode, recorded
+ * with lame before the SSE2/AVX2 filterbank and Huffman table selection,
+ * built by gcc 12 for x86-64.  -ffast-math (configure's default for gcc)
+ * changes the C float math, so it gets its own set */
+static const unsigned int reference_hashes[NUM_INPUTS][NUM_MODES] = {
+#ifdef __FAST_MATH__
+    {0xfa5cfa6a, 0x08e8099a, 0x21a295ee, 0xd73ae54e}, /* testcase.wav */
+    {0x2c229757, 0xabefcbde, 0x995abf1d, 0x1e815b62}, /* tones */
+    {0xd8f20c62, 0x77c37567, 0x22af0b9e, 0x04c3d383}, /* bursts */
+    {0x1afe5492, 0x5fca4092, 0x9cbeede1, 0x6d88a9cb}  /* square */
+#else
+    {0xfa5cfa6a, 0x08e8099a, 0xd5a556cb, 0xd73ae54e}, /* testcase.wav */
+    {0x5fab3b3b, 0xe9783dac, 0xd82d5948, 0x581608a1}, /* tones */
+    {0xa7500d26, 0x0320bbb3, 0xedd8fb90, 0x04c3d383}, /* bursts */
+    {0x737231ee, 0x75183a35, 0xbf9aacbc, 0x372a7d7f}  /* square */
+#endif
+};
+
+
+static unsigned int
+check_random(unsigned int *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+static int
+alloc_input(check_input * input, const char *name, int samplerate, int channels, int frames)
+{
+    input->name = name;
+    input->samplerate = samplerate;
+    input->channels = channels;
+    input->frames = frames;
+    input->left = calloc(frames, sizeof(short));
+    input->right = (channels == 2) ? calloc(frames, sizeof(short)) : input->left;
+    return input->left != NULL && input->right != NULL;
+}
+
+static void
+free_input(check_input * input)
+{
+    if (input->right != input->left)
+        free(input->right);
+    free(input->left);
+    input->left = input->right = NULL;
+}
+
+static unsigned int
+read_le(const unsigned char *p, int bytes)
+{
+    unsigned int v = 0;
+    while (bytes--)
+        v = (v << 8) | p[bytes];
+    return v;
+}
+
+/* 16 bit PCM only, which is what testcase.wav is */
+static int
+read_wav(check_input * input, const char *path)
+{
+    FILE   *fp = fopen(path, "rb");
+    unsigned char header[12], chunk[8], fmt[16];
+    unsigned char *data;
+    unsigned int size;
+    int     i, channels = 0, samplerate = 0, bits = 0;
+
+    if (fp == NULL)
+        return 0;
+
+    memset(fmt, 0, sizeof(fmt));
+    if (fread(header, 1, 12, fp) != 12 || memcmp(header, "RIFF", 4) != 0
+        || memcmp(header + 8, "WAVE", 4) != 0) {
+        fclose(fp);
+        return 0;
+    }
+
+    while (fread(chunk, 1, 8, fp) == 8) {
+        size = read_le(chunk + 4, 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            if (fread(fmt, 1, 16, fp) != 16)
+                break;
+            channels = read_le(fmt + 2, 2);
+            samplerate = read_le(fmt + 4, 4);
+            bits = read_le(fmt + 14, 2);
+            fseek(fp, (long) (size - 16 + (size & 1)), SEEK_CUR);
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            if (read_le(fmt, 2) != 1 || bits != 16 || channels < 1 || channels > 2)
+                break;
+            if (!alloc_input(input, "testcase.wav", samplerate, channels,
+                             size / (2 * channels)))
+                break;
+
+            data = malloc(size);
+            if (data == NULL || fread(data, 1, size, fp) != size) {
+                free(data);
+                free_input(input);
+                break;
+            }
+            for (i = 0; i < input->frames; i++) {
+                input->left[i] = (short) read_le(data + i * 2 * channels, 2);
+                if (channels == 2)
+                    input->right[i] = (short) read_le(data + i * 4 + 2, 2);
+            }
+            free(data);
+            fclose(fp);
+            return 1;
+        }
+        else
+            fseek(fp, (long) (size + (size & 1)), SEEK_CUR);
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/* triangle waves whose pitch and level change every quarter second, with
+ * noise on top, a different phase on each channel */
+static int
+make_tones(check_input * input)
+{
+    unsigned int seed = 0x7654321;
+    int     i, ch;
+
+    if (!alloc_input(input, "tones", 44100, 2, 44100 * CHECK_SECONDS))
+        return 0;
+
+    for (i = 0; i < input->frames; i++) {
+        int     section = i / 11025;
+        int     period = 40 + (section % 7) * 23;
+        int     level = 1000 + (section % 5) * 1500;
+
+        for (ch = 0; ch < 2; ch++) {
+            int     phase = (i + ch * period / 4) % period;
+            int     tri = (phase < period / 2) ? phase : period - phase;
+            int     noise = (int) (check_random(&seed) >> 13) - 1024;
+            short   s = (short) ((tri * 4 - period) * level / period + noise);
+
+            if (ch == 0)
+                input->left[i] = s;
+            else
+                input->right[i] = s;
+        }
+    }
+    return 1;
+}
+
+/* mono: 20ms noise bursts every 300ms over a quiet hum, for the short
+ * blocks */
+static int
+make_bursts(check_input * input)
+{
+    unsigned int seed = 0x1234567;
+    int     i;
+
+    if (!alloc_input(input, "bursts", 48000, 1, 48000 * CHECK_SECONDS))
+        return 0;
+
+    for (i = 0; i < input->frames; i++) {
+        int     hum = ((i % 480) < 240) ? 200 : -200;
+        int     noise = (int) (check_random(&seed) >> 9) - 16384;
+
+        input->left[i] = (short) (((i % 14400) < 960) ? noise + hum : hum);
+    }
+    return 1;
+}
+
+/* a square wave that is mostly out of phase between the channels, for the
+ * mid/side decisions */
+static int
+make_square(check_input * input)
+{
+    unsigned int seed = 0x2345678;
+    int     i;
+
+    if (!alloc_input(input, "square", 32000, 2, 32000 * CHECK_SECONDS))
+        return 0;
+
+    for (i = 0; i < input->frames; i++) {
+        int     period = 64 + (i / 16000) % 9 * 17;
+        int     sq = ((i % period) < period / 2) ? 6000 : -6000;
+        int     noise = (int) (check_random(&seed) >> 14) - 512;
+
+        input->left[i] = (short) (sq + noise);
+        input->right[i] = (short) (-sq / 2 + noise);
+    }
+    return 1;
+}
+
+/* encodes the whole input, hashing the stream.  returns the seconds the
+ * encode took, or a negative number on an error */
+static double
+encode(const check_input * input, const check_mode * mode, int simd, unsigned int *hash)
+{
+    lame_global_flags *gfp;
+    unsigned char *mp3buf;
+    int     mp3buf_size = (int) (1.25 * CHECK_CHUNK) + 7200;
+    int     i, pos, ret = 0;
+    clock_t start;
+
+    gfp = lame_init();
+    if (gfp == NULL)
+        return -1;
+
+    lame_set_in_samplerate(gfp, input->samplerate);
+    lame_set_out_samplerate(gfp, input->samplerate);
+    lame_set_num_channels(gfp, input->channels);
+    lame_set_mode(gfp, (input->channels == 2) ? JOINT_STEREO : MONO);
+    lame_set_quality(gfp, mode->quality);
+    lame_set_VBR(gfp, mode->vbr);
+    if (mode->vbr == vbr_off)
+        lame_set_brate(gfp, mode->brate);
+    else if (mode->vbr == vbr_abr)
+        lame_set_VBR_mean_bitrate_kbps(gfp, mode->brate);
+    else
+        lame_set_VBR_q(gfp, mode->vbr_q);
+    lame_set_disable_reservoir(gfp, mode->nores);
+    lame_set_asm_optimizations(gfp, SSE, simd);
+
+    mp3buf = malloc(mp3buf_size);
+    if (mp3buf == NULL || lame_init_params(gfp) < 0) {
+        free(mp3buf);
+        lame_close(gfp);
+        return -1;
+    }
+
+    *hash = 2166136261u;
+    start = clock();
+
+    for (pos = 0; pos < input->frames && ret >= 0; pos += CHECK_CHUNK) {
+        int     n = input->frames - pos;
+        if (n > CHECK_CHUNK)
+            n = CHECK_CHUNK;
+
+        ret = lame_encode_buffer(gfp, input->left + pos, input->right + pos, n,
+                                 mp3buf, mp3buf_size);
+        for (i = 0; i < ret; i++)
+            *hash = (*hash ^ mp3buf[i]) * 16777619u;
+    }
+
+    if (ret >= 0) {
+        ret = lame_encode_flush(gfp, mp3buf, mp3buf_size);
+        for (i = 0; i < ret; i++)
+            *hash = (*hash ^ mp3buf[i]) * 16777619u;
+    }
+
+    free(mp3buf);
+    lame_close(gfp);
+
+    if (ret < 0)
+        return -1;
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* best time of CHECK_RUNS encodes, all of which have to hash the same */
+static double
+encode_runs(const check_input * input, const check_mode * mode, int simd, unsigned int *hash)
+{
+    double  best = -1;
+    int     run;
+
+    for (run = 0; run < CHECK_RUNS; run++) {
+        unsigned int run_hash;
+        double  t = encode(input, mode, simd, &run_hash);
+
+        if (t < 0 || (run > 0 && run_hash != *hash))
+            return -1;
+        *hash = run_hash;
+        if (best < 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+int
+main(int argc, char **argv)
+{
+    check_input inputs[NUM_INPUTS];
+    const char *wav = (argc > 1) ? argv[1] : "testcase.wav";
+    int     i, m, failed = 0, differs = 0;
+
+    memset(inputs, 0, sizeof(inputs));
+    if (!read_wav(&inputs[0], wav)) {
+        fprintf(stderr, "can't read %s\n", wav);
+        return 1;
+    }
+    if (!make_tones(&inputs[1]) || !make_bursts(&inputs[2]) || !make_square(&inputs[3])) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("LAME %s, each mode with and without SSE2/AVX2, x real time best of %d\n\n",
+           get_lame_version(), CHECK_RUNS);
+    printf("%-14s %-18s %8s  %-9s %8s %8s\n", "input", "mode", "hash", "", "simd", "c");
+
+    for (i = 0; i < NUM_INPUTS; i++) {
+        const check_input *input = &inputs[i];
+        double  seconds = (double) input->frames / input->samplerate;
+
+        for (m = 0; m < (int) NUM_MODES; m++) {
+            unsigned int simd_hash = 0, c_hash = 0;
+            double  simd_time = encode_runs(input, &modes[m], 1, &simd_hash);
+            double  c_time = encode_runs(input, &modes[m], 0, &c_hash);
+            const char *result = "ok";
+
+            if (simd_time < 0 || c_time < 0) {
+                result = "FAILED";
+                failed = 1;
+            }
+            else if (simd_hash != c_hash) {
+                result = "SIMD!=C";
+                failed = 1;
+            }
+            else if (simd_hash != reference_hashes[i][m]) {
+                result = "DIFFERS";
+                differs = 1;
+            }
+
+            printf("%-14s %-18s %08x  %-9s %7.1fx %7.1fx\n", input->name, modes[m].name,
+                   simd_hash, result, seconds / (simd_time > 0 ? simd_time : 1e-6),
+                   seconds / (c_time > 0 ? c_time : 1e-6));
+        }
+    }
+
+    for (i = 0; i < NUM_INPUTS; i++)
+        free_input(&inputs[i]);
+
+    if (failed)
+        printf("\nan encode failed, or the SSE2/AVX2 routines changed the output\n");
+    if (differs)
+        printf("\nthe output differs from the reference hashes, which were recorded on\n"
+               "x86-64 with gcc; other compilers and x87 builds can differ\n");
+
+    return (failed || differs) ? 1 : 0;
+}
@@ -33,6 +33,7 @@
 #include "util.h"
 #include "quantize_pvt.h"
 #include "tables.h"
+#include "vector/lame_intrin.h"
 
 
 static const struct {
@@ -1343,6 +1344,12 @@ huffman_init(lame_internal_flags * const gfc)
         gfc->choose_table = choose_table_MMX;
     }
 #endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (gfc->CPU_features.AVX2) {
+        init_choose_table_avx2();
+        gfc->choose_table = choose_table_avx2;
+    }
+#endif
 
     for (i = 2; i <= 576; i += 2) {
         int     scfb_anz = 0, bv_index;
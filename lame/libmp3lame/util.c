@@ -773,6 +773,43 @@ extern int has_SSE_nasm(void);
 extern int has_SSE2_nasm(void);
 #endif
 
+/* without nasm, gcc and clang builds on x86 ask the CPU for SSE2 and AVX2.
+ * SSE stays as it was: it switches init_xrpow_core to the SSE version,
+ * which doesn't give the same output as the C one */
+#if defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <cpuid.h>
+#define HAVE_CPUID 1
+
+static int
+cpuid_leaf1(unsigned int *ecx, unsigned int *edx)
+{
+    unsigned int eax, ebx;
+    if (!__get_cpuid(1, &eax, &ebx, ecx, edx))
+        return 0;
+    return 1;
+}
+
+/* AVX state has to be enabled by the OS, not just supported by the CPU */
+static int
+cpuid_avx2(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_lo, xcr0_hi;
+
+    if (!cpuid_leaf1(&ecx, &edx))
+        return 0;
+    if ((ecx & (1u << 27)) == 0 || (ecx & (1u << 28)) == 0) /* OSXSAVE, AVX */
+        return 0;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6u) != 6u) /* XMM and YMM state */
+        return 0;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return 0;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
 int
 has_MMX(void)
 {
@@ -812,6 +849,11 @@ has_SSE2(void)
 {
 #ifdef HAVE_NASM
     return has_SSE2_nasm();
+#elif defined( HAVE_CPUID )
+    unsigned int ecx, edx;
+    if (!cpuid_leaf1(&ecx, &edx))
+        return 0;
+    return (edx >> 26) & 1;
 #else
 #if defined( _M_X64 ) || defined( MIN_ARCH_SSE )
     return 1;
@@ -821,6 +863,16 @@ has_SSE2(void)
 #endif
 }
 
+int
+has_AVX2(void)
+{
+#if defined( HAVE_CPUID )
+    return cpuid_avx2();
+#else
+    return 0;           /* don't know, assume not */
+#endif
+}
+
 void
 disable_FPE(void)
 {
@@ -520,7 +520,8 @@ extern  "C" {
             unsigned int AMD_3DNow:1; /* K6-2, K6-III, Athlon      */
             unsigned int SSE:1; /* Pentium III, Pentium 4    */
             unsigned int SSE2:1; /* Pentium 4, K8             */
-            unsigned int _unused:28;
+            unsigned int AVX2:1; /* Haswell, Excavator        */
+            unsigned int _unused:27;
         } CPU_features;
 
 
@@ -539,6 +540,7 @@ extern  "C" {
         /* functions to replace with CPU feature optimized versions in takehiro.c */
         int     (*choose_table) (const int *ix, const int *const end, int *const s);
         void    (*fft_fht) (FLOAT *, int);
+        void    (*window_subband_pairs) (const sample_t * x1, FLOAT a[SBLIMIT]);
         void    (*init_xrpow_core) (gr_info * const cod_info, FLOAT xrpow[576], int upper,
                                     FLOAT * sum);
 
@@ -592,6 +594,7 @@ extern  "C" {
     extern int has_3DNow(void);
     extern int has_SSE(void);
     extern int has_SSE2(void);
+    extern int has_AVX2(void);
 
 
 
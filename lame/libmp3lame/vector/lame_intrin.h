@@ -30,4 +30,39 @@ init_xrpow_core_sse(gr_info * const cod_info, FLOAT xrpow[576], int upper, FLOAT
 void
 fht_SSE2(FLOAT* , int);
 
+/* the filterbank routines give the same output as the C code only when
+ * that does its float math in SSE registers too, not on the x87 stack,
+ * and in the order it is written.  -ffast-math and /fp:fast let the
+ * compiler reorder the C sums, so those builds keep the C code */
+#if defined( HAVE_XMMINTRIN_H ) && \
+    ( defined( __x86_64__ ) || defined( _M_X64 ) || defined( __SSE2_MATH__ ) ) && \
+    !defined( __FAST_MATH__ ) && !defined( _M_FP_FAST )
+#define HAVE_XMM_SUBBAND 1
+#endif
+
+/* AVX2 code is built with a per function target attribute, so the rest
+ * of the library can still run on CPUs without it */
+#if defined( HAVE_XMMINTRIN_H ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) && \
+    ( defined( __clang__ ) || __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define HAVE_AVX2_INTRINSICS 1
+#define LAME_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+void
+init_window_subband_xmm(FLOAT const *enwindow);
+
+void
+window_subband_pairs_sse2(const sample_t * x1, FLOAT a[32]);
+
+#ifdef HAVE_AVX2_INTRINSICS
+void
+window_subband_pairs_avx2(const sample_t * x1, FLOAT a[32]);
+
+void
+init_choose_table_avx2(void);
+
+int
+choose_table_avx2(const int *ix, const int *const end, int *const s);
+#endif
+
 #endif
@@ -0,0 +1,172 @@
+/*
+ * MP3 window subband, intrinsics functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.     See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "lame.h"
+#include "machine.h"
+#include "encoder.h"
+#include "util.h"
+#include "lame_intrin.h"
+
+
+
+#ifdef HAVE_XMM_SUBBAND
+
+#include <xmmintrin.h>
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+#endif
+
+/*
+ * window_subband_pairs in newmdct.c computes 15 sums of 16 taps each,
+ * output pair j using window row j (enwindow + 18 * j), x1 - j and x2 + j.
+ * Here every lane runs one of those sums with exactly the same multiplies
+ * and adds in the same order, so the results are bit for bit the same.
+ *
+ * enwindow_lanes[m][j] is enwindow[18 * j + m]: taps 0..15, then the two
+ * output multipliers.  Lane 15 doesn't exist and is padded with zeros.
+ */
+static __m128 enwindow_lanes[18][4];
+
+void
+init_window_subband_xmm(FLOAT const *enwindow)
+{
+    float  *lanes = (float *) enwindow_lanes;
+    int     m, j;
+
+    for (m = 0; m < 18; m++) {
+        for (j = 0; j < 16; j++)
+            lanes[m * 16 + j] = (j < 15) ? enwindow[18 * j + m] : 0;
+    }
+}
+
+
+/* x2 + j ascends with the lane, x1 - j descends */
+#define LOAD_UP(p)      _mm_loadu_ps(p)
+#define LOAD_DOWN(p)    reverse4(_mm_loadu_ps((p) - 3))
+
+static __m128
+reverse4(__m128 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+void
+window_subband_pairs_sse2(const sample_t * x1, FLOAT a[32])
+{
+    const sample_t *const x2 = &x1[238 - 14 - 286];
+    float const *const lanes = (float const *) enwindow_lanes;
+    int     j, k;
+
+    for (j = 0; j < 16; j += 4) {
+        const sample_t *const u = x1 - j;
+        const sample_t *const d = x2 + j;
+        __m128  w, s, t, lo, hi;
+
+        w = _mm_load_ps(lanes + j);
+        s = _mm_mul_ps(LOAD_UP(d - 224), w);
+        t = _mm_mul_ps(LOAD_DOWN(u + 224), w);
+        for (k = 1; k < 8; k++) {
+            int const o = 64 * k - 224;
+            w = _mm_load_ps(lanes + k * 16 + j);
+            s = _mm_add_ps(s, _mm_mul_ps(LOAD_UP(d + o), w));
+            t = _mm_add_ps(t, _mm_mul_ps(LOAD_DOWN(u - o), w));
+        }
+        for (k = 8; k < 16; k++) {
+            int const o = 64 * k - 768;
+            w = _mm_load_ps(lanes + k * 16 + j);
+            s = _mm_add_ps(s, _mm_mul_ps(LOAD_DOWN(u + o), w));
+            t = _mm_sub_ps(t, _mm_mul_ps(LOAD_UP(d - o), w));
+        }
+
+        s = _mm_mul_ps(s, _mm_load_ps(lanes + 16 * 16 + j));
+        w = _mm_mul_ps(_mm_sub_ps(t, s), _mm_load_ps(lanes + 17 * 16 + j));
+        s = _mm_add_ps(t, s);
+
+        /* a[2j] = t + s, a[2j + 1] = wp[7] * (t - s); the padding lane is dropped */
+        lo = _mm_unpacklo_ps(s, w);
+        hi = _mm_unpackhi_ps(s, w);
+        _mm_storeu_ps(a + 2 * j, lo);
+        if (j < 12)
+            _mm_storeu_ps(a + 2 * j + 4, hi);
+        else
+            _mm_storel_pi((__m64 *) (a + 2 * j + 4), hi);
+    }
+}
+
+
+#ifdef HAVE_AVX2_INTRINSICS
+
+#define LOAD_UP8(p)     _mm256_loadu_ps(p)
+#define LOAD_DOWN8(p)   _mm256_permutevar8x32_ps(_mm256_loadu_ps((p) - 7), reverse)
+
+LAME_TARGET_AVX2 void
+window_subband_pairs_avx2(const sample_t * x1, FLOAT a[32])
+{
+    const sample_t *const x2 = &x1[238 - 14 - 286];
+    float const *const lanes = (float const *) enwindow_lanes;
+    __m256i const reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int     j, k;
+
+    for (j = 0; j < 16; j += 8) {
+        const sample_t *const u = x1 - j;
+        const sample_t *const d = x2 + j;
+        __m256  w, s, t, lo, hi;
+
+        w = _mm256_loadu_ps(lanes + j);
+        s = _mm256_mul_ps(LOAD_UP8(d - 224), w);
+        t = _mm256_mul_ps(LOAD_DOWN8(u + 224), w);
+        for (k = 1; k < 8; k++) {
+            int const o = 64 * k - 224;
+            w = _mm256_loadu_ps(lanes + k * 16 + j);
+            s = _mm256_add_ps(s, _mm256_mul_ps(LOAD_UP8(d + o), w));
+            t = _mm256_add_ps(t, _mm256_mul_ps(LOAD_DOWN8(u - o), w));
+        }
+        for (k = 8; k < 16; k++) {
+            int const o = 64 * k - 768;
+            w = _mm256_loadu_ps(lanes + k * 16 + j);
+            s = _mm256_add_ps(s, _mm256_mul_ps(LOAD_DOWN8(u + o), w));
+            t = _mm256_sub_ps(t, _mm256_mul_ps(LOAD_UP8(d - o), w));
+        }
+
+        s = _mm256_mul_ps(s, _mm256_loadu_ps(lanes + 16 * 16 + j));
+        w = _mm256_mul_ps(_mm256_sub_ps(t, s), _mm256_loadu_ps(lanes + 17 * 16 + j));
+        s = _mm256_add_ps(t, s);
+
+        /* unpack works within 128 bit halves, so put the halves back in order */
+        lo = _mm256_unpacklo_ps(s, w);
+        hi = _mm256_unpackhi_ps(s, w);
+        _mm256_storeu_ps(a + 2 * j, _mm256_permute2f128_ps(lo, hi, 0x20));
+        hi = _mm256_permute2f128_ps(lo, hi, 0x31);
+        if (j == 0)
+            _mm256_storeu_ps(a + 2 * j + 8, hi);
+        else {
+            _mm_storeu_ps(a + 2 * j + 8, _mm256_castps256_ps128(hi));
+            _mm_storel_pi((__m64 *) (a + 2 * j + 12), _mm256_extractf128_ps(hi, 1));
+        }
+    }
+}
+
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#endif /* HAVE_XMM_SUBBAND */
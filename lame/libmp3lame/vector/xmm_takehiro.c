@@ -0,0 +1,318 @@
+/*
+ * MP3 huffman table selection, intrinsics functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.     See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "lame.h"
+#include "machine.h"
+#include "encoder.h"
+#include "util.h"
+#include "quantize_pvt.h"
+#include "tables.h"
+#include "lame_intrin.h"
+
+
+
+#ifdef HAVE_AVX2_INTRINSICS
+
+#include <immintrin.h>
+
+/*
+ * Same results as choose_table_nonMMX in takehiro.c.  The bit counts are
+ * table lookups, done 8 pairs at a time with AVX2 gathers; everything is
+ * integer, so summing per lane first doesn't change the totals.
+ */
+
+static const int huf_tbl_noESC[] = {
+    1, 2, 5, 7, 7, 10, 10, 13, 13, 13, 13, 13, 13, 13, 13
+};
+
+/*
+ * tables t, t+1 and t+2 for t = 7, 10, 13, one 10 bit field each.  a
+ * region has at most 288 pairs, so a lane sums at most 36 entries of at
+ * most 21 bits and a field can't overflow into the next one.
+ */
+#define HLEN3_BITS 10
+#define HLEN3_MASK ((1 << HLEN3_BITS) - 1)
+
+static uint32_t hlen3_packed[3][16 * 16];
+
+void
+init_choose_table_avx2(void)
+{
+    int     i, k;
+
+    for (k = 0; k < 3; k++) {
+        int const t1 = 7 + 3 * k;
+        int const n = ht[t1].xlen * ht[t1].xlen;
+
+        for (i = 0; i < n; i++) {
+            hlen3_packed[k][i] = ht[t1].hlen[i]
+                | (ht[t1 + 1].hlen[i] << HLEN3_BITS)
+                | (ht[t1 + 2].hlen[i] << (2 * HLEN3_BITS));
+        }
+    }
+}
+
+
+LAME_TARGET_AVX2 static unsigned int
+hsum(__m256i v)
+{
+    __m128i h = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned int) _mm_cvtsi128_si32(h);
+}
+
+/* 8 pairs from ix[0..15]; lane order doesn't matter, only that x0 and x1 stay paired */
+LAME_TARGET_AVX2 static void
+load_pairs(const int *ix, __m256i * x0, __m256i * x1)
+{
+    __m256  a = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) ix));
+    __m256  b = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (ix + 8)));
+
+    *x0 = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    *x1 = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+
+LAME_TARGET_AVX2 static int
+ix_max_avx2(const int *ix, const int *end)
+{
+    __m256i vmax = _mm256_setzero_si256();
+    __m128i h;
+    int     max;
+
+    for (; end - ix >= 8; ix += 8)
+        vmax = _mm256_max_epi32(vmax, _mm256_loadu_si256((const __m256i *) ix));
+
+    h = _mm_max_epi32(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+    h = _mm_max_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_max_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    max = _mm_cvtsi128_si32(h);
+
+    for (; ix < end; ix++) {
+        if (max < *ix)
+            max = *ix;
+    }
+    return max;
+}
+
+
+LAME_TARGET_AVX2 static int
+count_bit_ESC_avx2(const int *ix, const int *const end, int t1, const int t2, unsigned int *const s)
+{
+    /* ESC-table is used */
+    unsigned int const linbits = ht[t1].xlen * 65536u + ht[t2].xlen;
+    __m256i const vlinbits = _mm256_set1_epi32((int) linbits);
+    __m256i const v14 = _mm256_set1_epi32(14);
+    __m256i const v15 = _mm256_set1_epi32(15);
+    __m256i vsum = _mm256_setzero_si256();
+    unsigned int sum, sum2;
+
+    for (; end - ix >= 16; ix += 16) {
+        __m256i x, y;
+        load_pairs(ix, &x, &y);
+
+        vsum = _mm256_add_epi32(vsum, _mm256_and_si256(_mm256_cmpgt_epi32(x, v14), vlinbits));
+        vsum = _mm256_add_epi32(vsum, _mm256_and_si256(_mm256_cmpgt_epi32(y, v14), vlinbits));
+        x = _mm256_min_epi32(x, v15);
+        y = _mm256_min_epi32(y, v15);
+        x = _mm256_add_epi32(_mm256_slli_epi32(x, 4), y);
+        vsum = _mm256_add_epi32(vsum, _mm256_i32gather_epi32((const int *) largetbl, x, 4));
+    }
+    sum = hsum(vsum);
+
+    for (; ix < end; ix += 2) {
+        unsigned int x = ix[0];
+        unsigned int y = ix[1];
+
+        if (x >= 15u) {
+            x = 15u;
+            sum += linbits;
+        }
+        if (y >= 15u) {
+            y = 15u;
+            sum += linbits;
+        }
+        sum += largetbl[(x << 4u) + y];
+    }
+
+    sum2 = sum & 0xffffu;
+    sum >>= 16u;
+
+    if (sum > sum2) {
+        sum = sum2;
+        t1 = t2;
+    }
+
+    *s += sum;
+    return t1;
+}
+
+
+LAME_TARGET_AVX2 static int
+count_bit_noESC_avx2(const int *ix, const int *end, unsigned int *s)
+{
+    /* No ESC-words; all values are 0 or 1, so the table fits a register */
+    const uint8_t *const hlen1 = ht[1].hlen;
+    __m256i const lut = _mm256_setr_epi32(hlen1[0], hlen1[1], hlen1[2], hlen1[3], 0, 0, 0, 0);
+    __m256i vsum = _mm256_setzero_si256();
+    unsigned int sum1;
+
+    for (; end - ix >= 16; ix += 16) {
+        __m256i x0, x1;
+        load_pairs(ix, &x0, &x1);
+        x0 = _mm256_add_epi32(_mm256_add_epi32(x0, x0), x1);
+        vsum = _mm256_add_epi32(vsum, _mm256_permutevar8x32_epi32(lut, x0));
+    }
+    sum1 = hsum(vsum);
+
+    for (; ix < end; ix += 2)
+        sum1 += hlen1[ix[0] + ix[0] + ix[1]];
+
+    *s += sum1;
+    return 1;
+}
+
+
+LAME_TARGET_AVX2 static int
+count_bit_noESC_from2_avx2(const int *ix, const int *end, int max, unsigned int *s)
+{
+    int     t1 = huf_tbl_noESC[max - 1];
+    /* No ESC-words */
+    const unsigned int xlen = ht[t1].xlen;
+    uint32_t const *table = (t1 == 2) ? &table23[0] : &table56[0];
+    __m256i const vxlen = _mm256_set1_epi32((int) xlen);
+    __m256i vsum = _mm256_setzero_si256();
+    unsigned int sum, sum2;
+
+    for (; end - ix >= 16; ix += 16) {
+        __m256i x0, x1;
+        load_pairs(ix, &x0, &x1);
+        x0 = _mm256_add_epi32(_mm256_mullo_epi32(x0, vxlen), x1);
+        vsum = _mm256_add_epi32(vsum, _mm256_i32gather_epi32((const int *) table, x0, 4));
+    }
+    sum = hsum(vsum);
+
+    for (; ix < end; ix += 2)
+        sum += table[ix[0] * xlen + ix[1]];
+
+    sum2 = sum & 0xffffu;
+    sum >>= 16u;
+
+    if (sum > sum2) {
+        sum = sum2;
+        t1++;
+    }
+
+    *s += sum;
+    return t1;
+}
+
+
+LAME_TARGET_AVX2 static int
+count_bit_noESC_from3_avx2(const int *ix, const int *end, int max, unsigned int *s)
+{
+    int     t1 = huf_tbl_noESC[max - 1];
+    /* No ESC-words */
+    unsigned int sum1, sum2, sum3;
+    const unsigned int xlen = ht[t1].xlen;
+    const uint8_t *const hlen1 = ht[t1].hlen;
+    const uint8_t *const hlen2 = ht[t1 + 1].hlen;
+    const uint8_t *const hlen3 = ht[t1 + 2].hlen;
+    uint32_t const *const packed = hlen3_packed[(t1 - 7) / 3];
+    __m256i const vxlen = _mm256_set1_epi32((int) xlen);
+    __m256i const vmask = _mm256_set1_epi32(HLEN3_MASK);
+    __m256i vsum = _mm256_setzero_si256();
+    int     t;
+
+    for (; end - ix >= 16; ix += 16) {
+        __m256i x0, x1;
+        load_pairs(ix, &x0, &x1);
+        x0 = _mm256_add_epi32(_mm256_mullo_epi32(x0, vxlen), x1);
+        vsum = _mm256_add_epi32(vsum, _mm256_i32gather_epi32((const int *) packed, x0, 4));
+    }
+    sum1 = hsum(_mm256_and_si256(vsum, vmask));
+    sum2 = hsum(_mm256_and_si256(_mm256_srli_epi32(vsum, HLEN3_BITS), vmask));
+    sum3 = hsum(_mm256_srli_epi32(vsum, 2 * HLEN3_BITS));
+
+    for (; ix < end; ix += 2) {
+        unsigned int x = ix[0] * xlen + ix[1];
+        sum1 += hlen1[x];
+        sum2 += hlen2[x];
+        sum3 += hlen3[x];
+    }
+
+    t = t1;
+    if (sum1 > sum2) {
+        sum1 = sum2;
+        t++;
+    }
+    if (sum1 > sum3) {
+        sum1 = sum3;
+        t = t1 + 2;
+    }
+    *s += sum1;
+
+    return t;
+}
+
+
+LAME_TARGET_AVX2 int
+choose_table_avx2(const int *ix, const int *const end, int *const _s)
+{
+    unsigned int *s = (unsigned int *) _s;
+    unsigned int max;
+    int     choice, choice2;
+    max = ix_max_avx2(ix, end);
+
+    if (max <= 15) {
+        if (max == 0)
+            return 0;
+        if (max == 1)
+            return count_bit_noESC_avx2(ix, end, s);
+        if (max <= 3)
+            return count_bit_noESC_from2_avx2(ix, end, max, s);
+        return count_bit_noESC_from3_avx2(ix, end, max, s);
+    }
+    /* try tables with linbits */
+    if (max > IXMAX_VAL) {
+        *s = LARGE_BITS;
+        return -1;
+    }
+    max -= 15u;
+    for (choice2 = 24; choice2 < 32; choice2++) {
+        if (ht[choice2].linmax >= max) {
+            break;
+        }
+    }
+
+    for (choice = choice2 - 8; choice < 24; choice++) {
+        if (ht[choice].linmax >= max) {
+            break;
+        }
+    }
+    return count_bit_ESC_avx2(ix, end, choice, choice2, s);
+}
+
+#endif /* HAVE_AVX2_INTRINSICS */
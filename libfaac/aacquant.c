@@ -30,6 +30,10 @@
 #include "psych.h"
 #include "util.h"
 
+#if FAAC_SIMD_QUANT
+#include <emmintrin.h>
+#endif
+
 #define TAKEHIRO_IEEE754_HACK 1
 
 #define XRPOW_FTOI(src,dest) ((dest) = (int)(src))
@@ -188,11 +192,26 @@ int AACQuantize(CoderInfo *coderInfo,
         scale_factor[sb] = 0;
 
     /* Compute xr_pow */
+#if FAAC_SIMD_QUANT
+    {
+        const __m128d signmask = _mm_set1_pd(-0.0);
+        const __m128d nonzero = _mm_set1_pd(1E-20);
+        __m128i count = _mm_setzero_si128();
+
+        for (i = 0; i < FRAME_LEN; i += 2) {
+            __m128d temp = _mm_andnot_pd(signmask, _mm_loadu_pd(xr + i));
+            _mm_storeu_pd(xr_pow + i, _mm_sqrt_pd(_mm_mul_pd(temp, _mm_sqrt_pd(temp))));
+            count = _mm_sub_epi64(count, _mm_castpd_si128(_mm_cmpgt_pd(temp, nonzero)));
+        }
+        do_q = _mm_cvtsi128_si32(count) + _mm_cvtsi128_si32(_mm_srli_si128(count, 8));
+    }
+#else
     for (i = 0; i < FRAME_LEN; i++) {
         double temp = fabs(xr[i]);
         xr_pow[i] = sqrt(temp * sqrt(temp));
         do_q += (temp > 1E-20);
     }
+#endif
 
     if (do_q) {
         CalcAllowedDist(coderInfo, psyInfo, xr, xmin, aacquantCfg->quality);
@@ -325,11 +344,33 @@ static void Quantize(const double *xp, int *pi, double istep)
 static void QuantizeBand(const double *xp, int *pi, double istep,
 			 int offset, int end, double *adj43)
 {
-  int j;
+  int j = offset;
   fi_union *fi;
 
+#if FAAC_SIMD_QUANT
+  /* same double->float rounding as below, four values at a time;
+     only the adj43 lookup stays scalar */
+  const __m128d step = _mm_set1_pd(istep);
+  const __m128d magic = _mm_set1_pd(MAGIC_FLOAT);
+  const __m128i magici = _mm_set1_epi32(MAGIC_INT);
+  int idx[4];
+
+  for (; j + 4 <= end; j += 4)
+  {
+    __m128d x0 = _mm_add_pd(_mm_mul_pd(step, _mm_loadu_pd(xp + j)), magic);
+    __m128d x1 = _mm_add_pd(_mm_mul_pd(step, _mm_loadu_pd(xp + j + 2)), magic);
+    __m128 f = _mm_movelh_ps(_mm_cvtpd_ps(x0), _mm_cvtpd_ps(x1));
+
+    _mm_storeu_si128((__m128i *)idx, _mm_sub_epi32(_mm_castps_si128(f), magici));
+    x0 = _mm_add_pd(x0, _mm_set_pd(adj43[idx[1]], adj43[idx[0]]));
+    x1 = _mm_add_pd(x1, _mm_set_pd(adj43[idx[3]], adj43[idx[2]]));
+    f = _mm_movelh_ps(_mm_cvtpd_ps(x0), _mm_cvtpd_ps(x1));
+    _mm_storeu_si128((__m128i *)(pi + j), _mm_sub_epi32(_mm_castps_si128(f), magici));
+  }
+#endif
+
   fi = (fi_union *)pi;
-  for (j = offset; j < end; j++)
+  for (; j < end; j++)
   {
     double x0 = istep * xp[j];
 
@@ -397,6 +438,74 @@ static void QuantizeBand(const double *xp, int *ix, double istep,
 }
 #endif
 
+static double BandMax(const double *xr_pow, int start, int end)
+{
+  int i = start;
+  double maxx = 0.0;
+
+#if FAAC_SIMD_QUANT
+  __m128d vmax = _mm_setzero_pd();
+
+  for (; i + 2 <= end; i += 2)
+    vmax = _mm_max_pd(vmax, _mm_loadu_pd(xr_pow + i));
+  vmax = _mm_max_sd(vmax, _mm_unpackhi_pd(vmax, vmax));
+  maxx = _mm_cvtsd_f64(vmax);
+#endif
+  for (; i < end; i++)
+  {
+    if (xr_pow[i] > maxx)
+      maxx = xr_pow[i];
+  }
+  return maxx;
+}
+
+static void ScaleBand(double *xr_pow, double fac, int start, int end)
+{
+  int i = start;
+
+#if FAAC_SIMD_QUANT
+  const __m128d vfac = _mm_set1_pd(fac);
+
+  for (; i + 2 <= end; i += 2)
+    _mm_storeu_pd(xr_pow + i, _mm_mul_pd(_mm_loadu_pd(xr_pow + i), vfac));
+#endif
+  for (; i < end; i++)
+    xr_pow[i] *= fac;
+}
+
+/* sum of xi^2; the terms are integers well below 2^53, so the result
+   doesn't depend on the summation order */
+static double BandEnergy(const int *xi, int start, int end)
+{
+  int i = start;
+  double sum = 0.0;
+  double tmp;
+
+#if FAAC_SIMD_QUANT
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+
+  for (; i + 4 <= end; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *)(xi + i));
+    __m128d lo = _mm_cvtepi32_pd(x);
+    __m128d hi = _mm_cvtepi32_pd(_mm_srli_si128(x, 8));
+
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+  }
+  acc0 = _mm_add_pd(acc0, acc1);
+  acc0 = _mm_add_sd(acc0, _mm_unpackhi_pd(acc0, acc0));
+  sum = _mm_cvtsd_f64(acc0);
+#endif
+  for (; i < end; i++)
+  {
+    tmp = xi[i];
+    sum += tmp * tmp;  // ~x^(3/2)
+  }
+  return sum;
+}
+
 static void CalcAllowedDist(CoderInfo *coderInfo, PsyInfo *psyInfo,
                             double *xr, double *xmin, int quality)
 {
@@ -484,6 +593,7 @@ static int FixNoise(CoderInfo *coderInfo,
     const double ifqstep = pow(2.0, 0.1875);
     const double log_ifqstep = 1.0 / log(ifqstep);
     const double maxstep = 0.05;
+    const double istep = IPOW20(coderInfo->global_gain);
 
     for (sb = 0; sb < coderInfo->nr_of_sfb; sb++)
     {
@@ -501,12 +611,7 @@ static int FixNoise(CoderInfo *coderInfo,
       if (!xmin[sb])
 	goto nullsfb;
 
-      maxx = 0.0;
-      for (i = start; i < end; i++)
-      {
-	if (xr_pow[i] > maxx)
-	  maxx = xr_pow[i];
-      }
+      maxx = BandMax(xr_pow, start, end);
 
       //printf("band %d: maxx: %f\n", sb, maxx);
       if (maxx < 10.0)
@@ -520,21 +625,15 @@ static int FixNoise(CoderInfo *coderInfo,
 
       sfacfix = 1.0 / maxx;
       sfac = (int)(log(sfacfix) * log_ifqstep - 0.5);
-      for (i = start; i < end; i++)
-	xr_pow[i] *= sfacfix;
+      ScaleBand(xr_pow, sfacfix, start, end);
       maxx *= sfacfix;
       coderInfo->scale_factor[sb] = sfac;
-      QuantizeBand(xr_pow, xi, IPOW20(coderInfo->global_gain), start, end,
+      QuantizeBand(xr_pow, xi, istep, start, end,
 		   adj43);
       //printf("\tsfac: %d\n", sfac);
 
     calcdist:
-      diffvol = 0.0;
-      for (i = start; i < end; i++)
-      {
-	tmp = xi[i];
-	diffvol += tmp * tmp;  // ~x^(3/2)
-      }
+      diffvol = BandEnergy(xi, start, end);
 
       if (diffvol < 1e-6)
 	diffvol = 1e-6;
@@ -595,24 +694,22 @@ static int FixNoise(CoderInfo *coderInfo,
 	{
 	  // restore best noise
 	  fac = sfacfix0 / sfacfix;
-	  for (i = start; i < end; i++)
-	    xr_pow[i] *= fac;
+	  ScaleBand(xr_pow, fac, start, end);
 	  maxx *= fac;
 	  sfacfix *= fac;
 	  coderInfo->scale_factor[sb] = log(sfacfix) * log_ifqstep - 0.5;
-	  QuantizeBand(xr_pow, xi, IPOW20(coderInfo->global_gain), start, end,
+	  QuantizeBand(xr_pow, xi, istep, start, end,
 		       adj43);
 	  continue;
 	}
 
 	if (coderInfo->scale_factor[sb] < -10)
 	{
-	  for (i = start; i < end; i++)
-	    xr_pow[i] *= fac;
+	  ScaleBand(xr_pow, fac, start, end);
           maxx *= fac;
           sfacfix *= fac;
 	  coderInfo->scale_factor[sb] = log(sfacfix) * log_ifqstep - 0.5;
-	  QuantizeBand(xr_pow, xi, IPOW20(coderInfo->global_gain), start, end,
+	  QuantizeBand(xr_pow, xi, istep, start, end,
 		       adj43);
 	  goto calcdist;
 	}
@@ -34,6 +34,11 @@ extern "C" {
 #define LARGE_BITS 100000
 #define SF_OFFSET 100
 
+/* SSE2 quantizer loops, bit exact with the scalar ones */
+#ifndef FAAC_SIMD_QUANT
+#define FAAC_SIMD_QUANT 1
+#endif
+
 #define POW20(x)  pow(2.0,((double)x)*.25)
 #define IPOW20(x)  pow(2.0,-((double)x)*.1875)
 
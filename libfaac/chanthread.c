@@ -0,0 +1,249 @@
+/*
+ * FAAC - Freeware Advanced Audio Coder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Small pool of worker threads running one job across all channels of
+ * a frame.  Channels are handed out in order from a shared counter, so
+ * which thread encodes which channel varies, but every channel only
+ * ever touches its own state and the result doesn't depend on it.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "chanthread.h"
+#include "util.h"
+
+#ifdef _WIN32
+
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION lock_t;
+typedef CONDITION_VARIABLE cond_t;
+
+#define LockInit(l)         InitializeCriticalSection(l)
+#define LockFree(l)         DeleteCriticalSection(l)
+#define Lock(l)             EnterCriticalSection(l)
+#define Unlock(l)           LeaveCriticalSection(l)
+#define CondInit(c)         InitializeConditionVariable(c)
+#define CondFree(c)
+#define CondWait(c, l)      SleepConditionVariableCS(c, l, INFINITE)
+#define CondSignal(c)       WakeConditionVariable(c)
+#define CondBroadcast(c)    WakeAllConditionVariable(c)
+
+#define THREAD_PROC(name, arg) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN 0
+
+#else
+
+typedef pthread_t thread_t;
+typedef pthread_mutex_t lock_t;
+typedef pthread_cond_t cond_t;
+
+#define LockInit(l)         pthread_mutex_init(l, NULL)
+#define LockFree(l)         pthread_mutex_destroy(l)
+#define Lock(l)             pthread_mutex_lock(l)
+#define Unlock(l)           pthread_mutex_unlock(l)
+#define CondInit(c)         pthread_cond_init(c, NULL)
+#define CondFree(c)         pthread_cond_destroy(c)
+#define CondWait(c, l)      pthread_cond_wait(c, l)
+#define CondSignal(c)       pthread_cond_signal(c)
+#define CondBroadcast(c)    pthread_cond_broadcast(c)
+
+#define THREAD_PROC(name, arg) void *name(void *arg)
+#define THREAD_RETURN NULL
+
+#endif
+
+struct ChannelThreads
+{
+    unsigned int numThreads;    /* including the thread calling Run */
+    unsigned int numWorkers;    /* workers actually started */
+    thread_t *workers;
+
+    lock_t lock;
+    cond_t wake;
+    cond_t done;
+
+    /* current run, protected by lock */
+    unsigned int generation;
+    int quit;
+    ChannelJob job;
+    void *context;
+    unsigned int numChannels;
+    unsigned int nextChannel;
+    unsigned int busyWorkers;
+};
+
+/* called and returns with the lock held */
+static void RunChannels(ChannelThreads *threads)
+{
+    while (threads->nextChannel < threads->numChannels)
+    {
+        unsigned int channel = threads->nextChannel++;
+
+        Unlock(&threads->lock);
+        threads->job(threads->context, channel);
+        Lock(&threads->lock);
+    }
+}
+
+static THREAD_PROC(ChannelWorker, arg)
+{
+    ChannelThreads *threads = (ChannelThreads*)arg;
+    unsigned int seen;
+
+    /* the pool starts at generation 0; a worker that only gets going
+       after the first run has been posted still has to take part in it */
+    seen = 0;
+
+    Lock(&threads->lock);
+
+    for (;;)
+    {
+        while (!threads->quit && threads->generation == seen)
+            CondWait(&threads->wake, &threads->lock);
+
+        if (threads->quit)
+            break;
+
+        seen = threads->generation;
+        RunChannels(threads);
+
+        if (--threads->busyWorkers == 0)
+            CondSignal(&threads->done);
+    }
+
+    Unlock(&threads->lock);
+    return THREAD_RETURN;
+}
+
+ChannelThreads *ChannelThreadsCreate(unsigned int numThreads)
+{
+    ChannelThreads *threads;
+    unsigned int i;
+
+    if (numThreads < 2)
+        return NULL;
+
+    threads = (ChannelThreads*)AllocMemory(sizeof(ChannelThreads));
+    if (!threads)
+        return NULL;
+    SetMemory(threads, 0, sizeof(ChannelThreads));
+
+    threads->workers = (thread_t*)AllocMemory((numThreads - 1) * sizeof(thread_t));
+    if (!threads->workers)
+    {
+        FreeMemory(threads);
+        return NULL;
+    }
+
+    LockInit(&threads->lock);
+    CondInit(&threads->wake);
+    CondInit(&threads->done);
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+#ifdef _WIN32
+        threads->workers[i] = CreateThread(NULL, 0, ChannelWorker, threads, 0, NULL);
+        if (!threads->workers[i])
+            break;
+#else
+        if (pthread_create(&threads->workers[i], NULL, ChannelWorker, threads) != 0)
+            break;
+#endif
+    }
+    threads->numWorkers = i;
+    threads->numThreads = i + 1;
+
+    if (!threads->numWorkers)
+    {
+        ChannelThreadsDestroy(threads);
+        return NULL;
+    }
+
+    return threads;
+}
+
+void ChannelThreadsDestroy(ChannelThreads *threads)
+{
+    unsigned int i;
+
+    if (!threads)
+        return;
+
+    Lock(&threads->lock);
+    threads->quit = 1;
+    CondBroadcast(&threads->wake);
+    Unlock(&threads->lock);
+
+    for (i = 0; i < threads->numWorkers; i++)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(threads->workers[i], INFINITE);
+        CloseHandle(threads->workers[i]);
+#else
+        pthread_join(threads->workers[i], NULL);
+#endif
+    }
+
+    CondFree(&threads->done);
+    CondFree(&threads->wake);
+    LockFree(&threads->lock);
+
+    FreeMemory(threads->workers);
+    FreeMemory(threads);
+}
+
+unsigned int ChannelThreadsCount(ChannelThreads *threads)
+{
+    return threads ? threads->numThreads : 1;
+}
+
+void ChannelThreadsRun(ChannelThreads *threads, unsigned int numChannels,
+                       ChannelJob job, void *context)
+{
+    unsigned int channel;
+
+    if (!threads || numChannels < 2)
+    {
+        for (channel = 0; channel < numChannels; channel++)
+            job(context, channel);
+        return;
+    }
+
+    Lock(&threads->lock);
+
+    threads->job = job;
+    threads->context = context;
+    threads->numChannels = numChannels;
+    threads->nextChannel = 0;
+    threads->busyWorkers = threads->numWorkers;
+    threads->generation++;
+    CondBroadcast(&threads->wake);
+
+    RunChannels(threads);
+
+    /* every worker has to check in before the next run may start */
+    while (threads->busyWorkers)
+        CondWait(&threads->done, &threads->lock);
+
+    Unlock(&threads->lock);
+}
@@ -0,0 +1,49 @@
+/*
+ * FAAC - Freeware Advanced Audio Coder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CHANTHREAD_H
+#define CHANTHREAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* a job is run once for every channel; jobs for different channels
+   must only touch that channel's state */
+typedef void (*ChannelJob)(void *context, unsigned int channel);
+
+typedef struct ChannelThreads ChannelThreads;
+
+/* starts numThreads-1 workers, the calling thread is the last one.
+   returns NULL when numThreads < 2 or the threads can't be created */
+ChannelThreads *ChannelThreadsCreate(unsigned int numThreads);
+void ChannelThreadsDestroy(ChannelThreads *threads);
+
+unsigned int ChannelThreadsCount(ChannelThreads *threads);
+
+/* runs job for channels 0..numChannels-1 and returns when all of them
+   are done.  with threads == NULL the channels run in order on the
+   calling thread */
+void ChannelThreadsRun(ChannelThreads *threads, unsigned int numChannels,
+                       ChannelJob job, void *context);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* CHANTHREAD_H */
@@ -469,6 +469,9 @@ void ffti( FFT_Tables *fft_tables, double *xr, double *xi, int logm )
 
 #else /* !defined DRM || defined DRM_1024 */
 
+static void check_tables( FFT_Tables *fft_tables, int logm);
+static void check_reorder( FFT_Tables *fft_tables, int logm);
+
 void fft_initialize( FFT_Tables *fft_tables )
 {
 	int i;
@@ -482,6 +485,14 @@ void fft_initialize( FFT_Tables *fft_tables )
 		fft_tables->negsintbl[i]	= NULL;
 		fft_tables->reordertbl[i]	= NULL;
 	}
+
+	/* build every table now rather than on first use, the channels
+	   may share them from several threads */
+	for( i = 1; i< MAXLOGM+1; i++ )
+	{
+		check_tables( fft_tables, i );
+		check_reorder( fft_tables, i );
+	}
 }
 
 void fft_terminate( FFT_Tables *fft_tables )
@@ -509,12 +520,10 @@ void fft_terminate( FFT_Tables *fft_tables )
 	fft_tables->reordertbl	= NULL;
 }
 
-static void reorder( FFT_Tables *fft_tables, double *x, int logm)
+static void check_reorder( FFT_Tables *fft_tables, int logm)
 {
 	int i;
 	int size = 1 << logm;
-	unsigned short *r;	//size
-
 
 	if ( fft_tables->reordertbl[logm] == NULL ) // create bit reversing table
 	{
@@ -534,6 +543,15 @@ static void reorder( FFT_Tables *fft_tables, double *x, int logm)
 			fft_tables->reordertbl[logm][i] = reversed;
 		}
 	}
+}
+
+static void reorder( FFT_Tables *fft_tables, double *x, int logm)
+{
+	int i;
+	int size = 1 << logm;
+	unsigned short *r;	//size
+
+	check_reorder( fft_tables, logm );
 
 	r = fft_tables->reordertbl[logm];
 
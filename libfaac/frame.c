@@ -287,6 +287,24 @@ int FAACAPI faacEncSetConfiguration(faacEncHandle hEncoder,
 	for( i = 0; i < 64; i++ )
 		hEncoder->config.channel_map[i] = config->channel_map[i];
 
+    /* (re)start the channel threads, there's no use for more threads than channels */
+#ifdef DRM
+    /* the DRM transforms set up their tables on first use */
+    config->numThreads = 0;
+#endif
+    hEncoder->config.numThreads = config->numThreads;
+    {
+        unsigned int numThreads = min(hEncoder->config.numThreads, hEncoder->numChannels);
+
+        if (numThreads < 1)
+            numThreads = 1;
+        if (ChannelThreadsCount(hEncoder->channelThreads) != numThreads)
+        {
+            ChannelThreadsDestroy(hEncoder->channelThreads);
+            hEncoder->channelThreads = ChannelThreadsCreate(numThreads);
+        }
+    }
+
     /* OK */
     return 1;
 }
@@ -405,6 +423,8 @@ int FAACAPI faacEncClose(faacEncHandle hEncoder)
 {
     unsigned int channel;
 
+    ChannelThreadsDestroy(hEncoder->channelThreads);
+
     /* Deinitialize coder functions */
     hEncoder->psymodel->PsyEnd(&hEncoder->gpsyInfo, hEncoder->psyInfo, hEncoder->numChannels);
 
@@ -441,6 +461,296 @@ int FAACAPI faacEncClose(faacEncHandle hEncoder)
     return 0;
 }
 
+typedef struct {
+    faacEncStruct *hEncoder;
+    int32_t *inputBuffer;
+    unsigned int samplesInput;
+} EncodeJob;
+
+/* the per channel stages of faacEncEncode; each one only touches the state
+   of its own channel, so they can run on the channel threads */
+
+static void UpdateChannelInput(void *context, unsigned int channel)
+{
+    EncodeJob *job = (EncodeJob*)context;
+    faacEncStruct *hEncoder = job->hEncoder;
+    int32_t *inputBuffer = job->inputBuffer;
+    unsigned int samplesInput = job->samplesInput;
+    unsigned int i;
+    double *tmp;
+
+    ChannelInfo *channelInfo = hEncoder->channelInfo;
+    unsigned int numChannels = hEncoder->numChannels;
+    unsigned int bandWidth = hEncoder->config.bandWidth;
+
+    if (hEncoder->sampleBuff[channel]) {
+        for(i = 0; i < FRAME_LEN; i++) {
+            hEncoder->ltpTimeBuff[channel][i] = hEncoder->sampleBuff[channel][i];
+        }
+    }
+    if (hEncoder->nextSampleBuff[channel]) {
+        for(i = 0; i < FRAME_LEN; i++) {
+            hEncoder->ltpTimeBuff[channel][FRAME_LEN + i] =
+					hEncoder->nextSampleBuff[channel][i];
+        }
+    }
+
+	if (!hEncoder->sampleBuff[channel])
+		hEncoder->sampleBuff[channel] = (double*)AllocMemory(FRAME_LEN*sizeof(double));
+	
+	tmp = hEncoder->sampleBuff[channel];
+
+    hEncoder->sampleBuff[channel]		= hEncoder->nextSampleBuff[channel];
+    hEncoder->nextSampleBuff[channel]	= hEncoder->next2SampleBuff[channel];
+    hEncoder->next2SampleBuff[channel]	= hEncoder->next3SampleBuff[channel];
+	hEncoder->next3SampleBuff[channel]	= tmp;
+
+    if (samplesInput == 0)
+    {
+        /* start flushing*/
+        for (i = 0; i < FRAME_LEN; i++)
+            hEncoder->next3SampleBuff[channel][i] = 0.0;
+    }
+    else
+    {
+		int samples_per_channel = samplesInput/numChannels;
+
+        /* handle the various input formats and channel remapping */
+        switch( hEncoder->config.inputFormat )
+		{
+            case FAAC_INPUT_16BIT:
+				{
+					short *input_channel = (short*)inputBuffer + hEncoder->config.channel_map[channel];
+
+					for (i = 0; i < samples_per_channel; i++)
+					{
+						hEncoder->next3SampleBuff[channel][i] = (double)*input_channel;
+						input_channel += numChannels;
+					}
+				}
+                break;
+
+            case FAAC_INPUT_32BIT:
+				{
+					int32_t *input_channel = (int32_t*)inputBuffer + hEncoder->config.channel_map[channel];
+					
+					for (i = 0; i < samples_per_channel; i++)
+					{
+						hEncoder->next3SampleBuff[channel][i] = (1.0/256) * (double)*input_channel;
+						input_channel += numChannels;
+					}
+				}
+                break;
+
+            case FAAC_INPUT_FLOAT:
+				{
+					float *input_channel = (float*)inputBuffer + hEncoder->config.channel_map[channel];
+
+					for (i = 0; i < samples_per_channel; i++)
+					{
+						hEncoder->next3SampleBuff[channel][i] = (double)*input_channel;
+						input_channel += numChannels;
+					}
+				}
+                break;
+
+            default: /* rejected in faacEncEncode */
+                break;
+        }
+
+        for (i = (int)(samplesInput/numChannels); i < FRAME_LEN; i++)
+            hEncoder->next3SampleBuff[channel][i] = 0.0;
+	}
+
+	/* Psychoacoustics */
+	/* Update buffers and run FFT on new samples */
+	/* LFE psychoacoustic can run without it */
+	if (!channelInfo[channel].lfe || channelInfo[channel].cpe)
+	{
+		hEncoder->psymodel->PsyBufferUpdate( 
+				&hEncoder->fft_tables, 
+				&hEncoder->gpsyInfo, 
+				&hEncoder->psyInfo[channel],
+				hEncoder->next3SampleBuff[channel], 
+				bandWidth,
+				hEncoder->srInfo->cb_width_short,
+				hEncoder->srInfo->num_cb_short);
+	}
+}
+
+static void AnalyzeChannel(void *context, unsigned int channel)
+{
+    EncodeJob *job = (EncodeJob*)context;
+    faacEncStruct *hEncoder = job->hEncoder;
+    int k, sb;
+    unsigned int offset;
+    TnsInfo *tnsInfo_for_LTP;
+
+    ChannelInfo *channelInfo = hEncoder->channelInfo;
+    CoderInfo *coderInfo = hEncoder->coderInfo;
+    unsigned int sampleRate = hEncoder->sampleRate;
+    unsigned int aacObjectType = hEncoder->config.aacObjectType;
+    unsigned int mpegVersion = hEncoder->config.mpegVersion;
+    unsigned int useTns = hEncoder->config.useTns;
+    unsigned int bandWidth = hEncoder->config.bandWidth;
+
+    /* AAC Filterbank, MDCT with overlap and add */
+    FilterBank(hEncoder,
+        &coderInfo[channel],
+        hEncoder->sampleBuff[channel],
+        hEncoder->freqBuff[channel],
+        hEncoder->overlapBuff[channel],
+        MOVERLAPPED);
+
+    if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
+        for (k = 0; k < 8; k++) {
+            specFilter(hEncoder->freqBuff[channel]+k*BLOCK_LEN_SHORT,
+					sampleRate, bandWidth, BLOCK_LEN_SHORT);
+        }
+    } else {
+        specFilter(hEncoder->freqBuff[channel], sampleRate,
+				bandWidth, BLOCK_LEN_LONG);
+    }
+
+    /* TMP: Build sfb offset table and other stuff */
+    channelInfo[channel].msInfo.is_present = 0;
+
+    if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
+		coderInfo[channel].max_sfb = hEncoder->srInfo->num_cb_short;
+        coderInfo[channel].nr_of_sfb = hEncoder->srInfo->num_cb_short;
+
+        coderInfo[channel].num_window_groups = 1;
+        coderInfo[channel].window_group_length[0] = 8;
+        coderInfo[channel].window_group_length[1] = 0;
+        coderInfo[channel].window_group_length[2] = 0;
+        coderInfo[channel].window_group_length[3] = 0;
+        coderInfo[channel].window_group_length[4] = 0;
+        coderInfo[channel].window_group_length[5] = 0;
+        coderInfo[channel].window_group_length[6] = 0;
+        coderInfo[channel].window_group_length[7] = 0;
+
+        offset = 0;
+        for (sb = 0; sb < coderInfo[channel].nr_of_sfb; sb++) {
+            coderInfo[channel].sfb_offset[sb] = offset;
+            offset += hEncoder->srInfo->cb_width_short[sb];
+        }
+        coderInfo[channel].sfb_offset[coderInfo[channel].nr_of_sfb] = offset;
+    } else {
+        coderInfo[channel].max_sfb = hEncoder->srInfo->num_cb_long;
+        coderInfo[channel].nr_of_sfb = hEncoder->srInfo->num_cb_long;
+
+        coderInfo[channel].num_window_groups = 1;
+        coderInfo[channel].window_group_length[0] = 1;
+
+        offset = 0;
+        for (sb = 0; sb < coderInfo[channel].nr_of_sfb; sb++) {
+            coderInfo[channel].sfb_offset[sb] = offset;
+            offset += hEncoder->srInfo->cb_width_long[sb];
+        }
+        coderInfo[channel].sfb_offset[coderInfo[channel].nr_of_sfb] = offset;
+    }
+
+    /* Perform TNS analysis and filtering */
+    if ((!channelInfo[channel].lfe) && (useTns)) {
+        TnsEncode(&(coderInfo[channel].tnsInfo),
+				coderInfo[channel].max_sfb,
+				coderInfo[channel].max_sfb,
+				coderInfo[channel].block_type,
+				coderInfo[channel].sfb_offset,
+				hEncoder->freqBuff[channel]);
+    } else {
+        coderInfo[channel].tnsInfo.tnsDataPresent = 0;      /* TNS not used for LFE */
+    }
+
+    if((coderInfo[channel].tnsInfo.tnsDataPresent != 0) && (useTns))
+        tnsInfo_for_LTP = &(coderInfo[channel].tnsInfo);
+    else
+        tnsInfo_for_LTP = NULL;
+
+    if(channelInfo[channel].present && (!channelInfo[channel].lfe) &&
+        (coderInfo[channel].block_type != ONLY_SHORT_WINDOW) &&
+        (mpegVersion == MPEG4) && (aacObjectType == LTP))
+    {
+        LtpEncode(hEncoder,
+				&coderInfo[channel],
+				&(coderInfo[channel].ltpInfo),
+				tnsInfo_for_LTP,
+				hEncoder->freqBuff[channel],
+				hEncoder->ltpTimeBuff[channel]);
+    } else {
+        coderInfo[channel].ltpInfo.global_pred_flag = 0;
+    }
+}
+
+static void QuantizeChannel(void *context, unsigned int channel)
+{
+    EncodeJob *job = (EncodeJob*)context;
+    faacEncStruct *hEncoder = job->hEncoder;
+
+    ChannelInfo *channelInfo = hEncoder->channelInfo;
+    CoderInfo *coderInfo = hEncoder->coderInfo;
+
+    if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
+        AACQuantize(&coderInfo[channel], &hEncoder->psyInfo[channel],
+				&channelInfo[channel], hEncoder->srInfo->cb_width_short,
+				hEncoder->srInfo->num_cb_short, hEncoder->freqBuff[channel],
+				&(hEncoder->aacquantCfg));
+    } else {
+        AACQuantize(&coderInfo[channel], &hEncoder->psyInfo[channel],
+				&channelInfo[channel], hEncoder->srInfo->cb_width_long,
+				hEncoder->srInfo->num_cb_long, hEncoder->freqBuff[channel],
+				&(hEncoder->aacquantCfg));
+    }
+}
+
+static void ReconstructChannel(void *context, unsigned int channel)
+{
+    EncodeJob *job = (EncodeJob*)context;
+    faacEncStruct *hEncoder = job->hEncoder;
+    TnsInfo *tnsDecInfo;
+
+    ChannelInfo *channelInfo = hEncoder->channelInfo;
+    CoderInfo *coderInfo = hEncoder->coderInfo;
+    unsigned int aacObjectType = hEncoder->config.aacObjectType;
+    unsigned int useTns = hEncoder->config.useTns;
+
+    /* If short window, reconstruction not needed for prediction */
+    if ((coderInfo[channel].block_type == ONLY_SHORT_WINDOW)) {
+        int sind;
+        for (sind = 0; sind < BLOCK_LEN_LONG; sind++) {
+			coderInfo[channel].requantFreq[sind] = 0.0;
+        }
+    } else {
+
+        if((coderInfo[channel].tnsInfo.tnsDataPresent != 0) && (useTns))
+            tnsDecInfo = &(coderInfo[channel].tnsInfo);
+        else
+            tnsDecInfo = NULL;
+
+        if ((!channelInfo[channel].lfe) && (aacObjectType == LTP)) {  /* no reconstruction needed for LFE channel*/
+
+            LtpReconstruct(&coderInfo[channel], &(coderInfo[channel].ltpInfo),
+					coderInfo[channel].requantFreq);
+
+            if(tnsDecInfo != NULL)
+                TnsDecodeFilterOnly(&(coderInfo[channel].tnsInfo), coderInfo[channel].nr_of_sfb,
+						coderInfo[channel].max_sfb, coderInfo[channel].block_type,
+						coderInfo[channel].sfb_offset, coderInfo[channel].requantFreq);
+
+            IFilterBank(hEncoder, &coderInfo[channel],
+					coderInfo[channel].requantFreq,
+					coderInfo[channel].ltpInfo.time_buffer,
+					coderInfo[channel].ltpInfo.ltp_overlap_buffer,
+					MOVERLAPPED);
+
+            LtpUpdate(&(coderInfo[channel].ltpInfo),
+					coderInfo[channel].ltpInfo.time_buffer,
+					coderInfo[channel].ltpInfo.ltp_overlap_buffer,
+					BLOCK_LEN_LONG);
+        }
+    }
+}
+
 int FAACAPI faacEncEncode(faacEncHandle hEncoder,
                           int32_t *inputBuffer,
                           unsigned int samplesInput,
@@ -448,12 +758,10 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
                           unsigned int bufferSize
                           )
 {
-    unsigned int channel, i;
-    int sb, frameBytes;
-    unsigned int offset;
+    unsigned int channel;
+    int frameBytes;
     BitStream *bitStream; /* bitstream used for writing the frame to */
-    TnsInfo *tnsInfo_for_LTP;
-    TnsInfo *tnsDecInfo;
+    EncodeJob job;
 #ifdef DRM
     int desbits, diff;
     double fix;
@@ -463,13 +771,9 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
     ChannelInfo *channelInfo = hEncoder->channelInfo;
     CoderInfo *coderInfo = hEncoder->coderInfo;
     unsigned int numChannels = hEncoder->numChannels;
-    unsigned int sampleRate = hEncoder->sampleRate;
     unsigned int aacObjectType = hEncoder->config.aacObjectType;
-    unsigned int mpegVersion = hEncoder->config.mpegVersion;
     unsigned int useLfe = hEncoder->config.useLfe;
-    unsigned int useTns = hEncoder->config.useTns;
     unsigned int allowMidside = hEncoder->config.allowMidside;
-    unsigned int bandWidth = hEncoder->config.bandWidth;
     unsigned int shortctl = hEncoder->config.shortctl;
 
     /* Increase frame number */
@@ -487,105 +791,25 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
     GetChannelInfo(channelInfo, numChannels, useLfe);
 
     /* Update current sample buffers */
-    for (channel = 0; channel < numChannels; channel++) 
-	{
-		double *tmp;
-
-        if (hEncoder->sampleBuff[channel]) {
-            for(i = 0; i < FRAME_LEN; i++) {
-                hEncoder->ltpTimeBuff[channel][i] = hEncoder->sampleBuff[channel][i];
-            }
-        }
-        if (hEncoder->nextSampleBuff[channel]) {
-            for(i = 0; i < FRAME_LEN; i++) {
-                hEncoder->ltpTimeBuff[channel][FRAME_LEN + i] =
-						hEncoder->nextSampleBuff[channel][i];
-            }
-        }
-
-		if (!hEncoder->sampleBuff[channel])
-			hEncoder->sampleBuff[channel] = (double*)AllocMemory(FRAME_LEN*sizeof(double));
-		
-		tmp = hEncoder->sampleBuff[channel];
-
-        hEncoder->sampleBuff[channel]		= hEncoder->nextSampleBuff[channel];
-        hEncoder->nextSampleBuff[channel]	= hEncoder->next2SampleBuff[channel];
-        hEncoder->next2SampleBuff[channel]	= hEncoder->next3SampleBuff[channel];
-		hEncoder->next3SampleBuff[channel]	= tmp;
-
-        if (samplesInput == 0)
-        {
-            /* start flushing*/
-            for (i = 0; i < FRAME_LEN; i++)
-                hEncoder->next3SampleBuff[channel][i] = 0.0;
-        }
-        else
+    if (samplesInput != 0)
+    {
+        switch (hEncoder->config.inputFormat)
         {
-			int samples_per_channel = samplesInput/numChannels;
-
-            /* handle the various input formats and channel remapping */
-            switch( hEncoder->config.inputFormat )
-			{
-                case FAAC_INPUT_16BIT:
-					{
-						short *input_channel = (short*)inputBuffer + hEncoder->config.channel_map[channel];
+            case FAAC_INPUT_16BIT:
+            case FAAC_INPUT_32BIT:
+            case FAAC_INPUT_FLOAT:
+                break;
 
-						for (i = 0; i < samples_per_channel; i++)
-						{
-							hEncoder->next3SampleBuff[channel][i] = (double)*input_channel;
-							input_channel += numChannels;
-						}
-					}
-                    break;
-
-                case FAAC_INPUT_32BIT:
-					{
-						int32_t *input_channel = (int32_t*)inputBuffer + hEncoder->config.channel_map[channel];
-						
-						for (i = 0; i < samples_per_channel; i++)
-						{
-							hEncoder->next3SampleBuff[channel][i] = (1.0/256) * (double)*input_channel;
-							input_channel += numChannels;
-						}
-					}
-                    break;
-
-                case FAAC_INPUT_FLOAT:
-					{
-						float *input_channel = (float*)inputBuffer + hEncoder->config.channel_map[channel];
-
-						for (i = 0; i < samples_per_channel; i++)
-						{
-							hEncoder->next3SampleBuff[channel][i] = (double)*input_channel;
-							input_channel += numChannels;
-						}
-					}
-                    break;
+            default:
+                return -1; /* invalid input format */
+        }
+    }
 
-                default:
-                    return -1; /* invalid input format */
-                    break;
-            }
+    job.hEncoder = hEncoder;
+    job.inputBuffer = inputBuffer;
+    job.samplesInput = samplesInput;
 
-            for (i = (int)(samplesInput/numChannels); i < FRAME_LEN; i++)
-                hEncoder->next3SampleBuff[channel][i] = 0.0;
-		}
-
-		/* Psychoacoustics */
-		/* Update buffers and run FFT on new samples */
-		/* LFE psychoacoustic can run without it */
-		if (!channelInfo[channel].lfe || channelInfo[channel].cpe)
-		{
-			hEncoder->psymodel->PsyBufferUpdate( 
-					&hEncoder->fft_tables, 
-					&hEncoder->gpsyInfo, 
-					&hEncoder->psyInfo[channel],
-					hEncoder->next3SampleBuff[channel], 
-					bandWidth,
-					hEncoder->srInfo->cb_width_short,
-					hEncoder->srInfo->num_cb_short);
-		}
-    }
+    ChannelThreadsRun(hEncoder->channelThreads, numChannels, UpdateChannelInput, &job);
 
     if (hEncoder->frameNum <= 3) /* Still filling up the buffers */
         return 0;
@@ -614,103 +838,8 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
 		}
     }
 
-    /* AAC Filterbank, MDCT with overlap and add */
-    for (channel = 0; channel < numChannels; channel++) {
-        int k;
-
-        FilterBank(hEncoder,
-            &coderInfo[channel],
-            hEncoder->sampleBuff[channel],
-            hEncoder->freqBuff[channel],
-            hEncoder->overlapBuff[channel],
-            MOVERLAPPED);
-
-        if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
-            for (k = 0; k < 8; k++) {
-                specFilter(hEncoder->freqBuff[channel]+k*BLOCK_LEN_SHORT,
-						sampleRate, bandWidth, BLOCK_LEN_SHORT);
-            }
-        } else {
-            specFilter(hEncoder->freqBuff[channel], sampleRate,
-					bandWidth, BLOCK_LEN_LONG);
-        }
-    }
-
-    /* TMP: Build sfb offset table and other stuff */
-    for (channel = 0; channel < numChannels; channel++) {
-        channelInfo[channel].msInfo.is_present = 0;
-
-        if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
-			coderInfo[channel].max_sfb = hEncoder->srInfo->num_cb_short;
-            coderInfo[channel].nr_of_sfb = hEncoder->srInfo->num_cb_short;
-
-            coderInfo[channel].num_window_groups = 1;
-            coderInfo[channel].window_group_length[0] = 8;
-            coderInfo[channel].window_group_length[1] = 0;
-            coderInfo[channel].window_group_length[2] = 0;
-            coderInfo[channel].window_group_length[3] = 0;
-            coderInfo[channel].window_group_length[4] = 0;
-            coderInfo[channel].window_group_length[5] = 0;
-            coderInfo[channel].window_group_length[6] = 0;
-            coderInfo[channel].window_group_length[7] = 0;
-
-            offset = 0;
-            for (sb = 0; sb < coderInfo[channel].nr_of_sfb; sb++) {
-                coderInfo[channel].sfb_offset[sb] = offset;
-                offset += hEncoder->srInfo->cb_width_short[sb];
-            }
-            coderInfo[channel].sfb_offset[coderInfo[channel].nr_of_sfb] = offset;
-        } else {
-            coderInfo[channel].max_sfb = hEncoder->srInfo->num_cb_long;
-            coderInfo[channel].nr_of_sfb = hEncoder->srInfo->num_cb_long;
-
-            coderInfo[channel].num_window_groups = 1;
-            coderInfo[channel].window_group_length[0] = 1;
-
-            offset = 0;
-            for (sb = 0; sb < coderInfo[channel].nr_of_sfb; sb++) {
-                coderInfo[channel].sfb_offset[sb] = offset;
-                offset += hEncoder->srInfo->cb_width_long[sb];
-            }
-            coderInfo[channel].sfb_offset[coderInfo[channel].nr_of_sfb] = offset;
-        }
-    }
-
-    /* Perform TNS analysis and filtering */
-    for (channel = 0; channel < numChannels; channel++) {
-        if ((!channelInfo[channel].lfe) && (useTns)) {
-            TnsEncode(&(coderInfo[channel].tnsInfo),
-					coderInfo[channel].max_sfb,
-					coderInfo[channel].max_sfb,
-					coderInfo[channel].block_type,
-					coderInfo[channel].sfb_offset,
-					hEncoder->freqBuff[channel]);
-        } else {
-            coderInfo[channel].tnsInfo.tnsDataPresent = 0;      /* TNS not used for LFE */
-        }
-    }
-
-    for(channel = 0; channel < numChannels; channel++)
-    {
-        if((coderInfo[channel].tnsInfo.tnsDataPresent != 0) && (useTns))
-            tnsInfo_for_LTP = &(coderInfo[channel].tnsInfo);
-        else
-            tnsInfo_for_LTP = NULL;
-
-        if(channelInfo[channel].present && (!channelInfo[channel].lfe) &&
-            (coderInfo[channel].block_type != ONLY_SHORT_WINDOW) &&
-            (mpegVersion == MPEG4) && (aacObjectType == LTP))
-        {
-            LtpEncode(hEncoder,
-					&coderInfo[channel],
-					&(coderInfo[channel].ltpInfo),
-					tnsInfo_for_LTP,
-					hEncoder->freqBuff[channel],
-					hEncoder->ltpTimeBuff[channel]);
-        } else {
-            coderInfo[channel].ltpInfo.global_pred_flag = 0;
-        }
-    }
+    /* Filterbank, TNS and LTP analysis */
+    ChannelThreadsRun(hEncoder->channelThreads, numChannels, AnalyzeChannel, &job);
 
     for(channel = 0; channel < numChannels; channel++)
     {
@@ -761,19 +890,7 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
     while (diff > 0) { /* if too many bits, do it again */
 #endif
     /* Quantize and code the signal */
-    for (channel = 0; channel < numChannels; channel++) {
-        if (coderInfo[channel].block_type == ONLY_SHORT_WINDOW) {
-            AACQuantize(&coderInfo[channel], &hEncoder->psyInfo[channel],
-					&channelInfo[channel], hEncoder->srInfo->cb_width_short,
-					hEncoder->srInfo->num_cb_short, hEncoder->freqBuff[channel],
-					&(hEncoder->aacquantCfg));
-        } else {
-            AACQuantize(&coderInfo[channel], &hEncoder->psyInfo[channel],
-					&channelInfo[channel], hEncoder->srInfo->cb_width_long,
-					hEncoder->srInfo->num_cb_long, hEncoder->freqBuff[channel],
-					&(hEncoder->aacquantCfg));
-        }
-    }
+    ChannelThreadsRun(hEncoder->channelThreads, numChannels, QuantizeChannel, &job);
 
 #ifdef DRM
     /* Write the AAC bitstream */
@@ -823,44 +940,8 @@ int FAACAPI faacEncEncode(faacEncHandle hEncoder,
 
     MSReconstruct(coderInfo, channelInfo, numChannels);
 
-    for (channel = 0; channel < numChannels; channel++)
-    {
-        /* If short window, reconstruction not needed for prediction */
-        if ((coderInfo[channel].block_type == ONLY_SHORT_WINDOW)) {
-            int sind;
-            for (sind = 0; sind < BLOCK_LEN_LONG; sind++) {
-				coderInfo[channel].requantFreq[sind] = 0.0;
-            }
-        } else {
-
-            if((coderInfo[channel].tnsInfo.tnsDataPresent != 0) && (useTns))
-                tnsDecInfo = &(coderInfo[channel].tnsInfo);
-            else
-                tnsDecInfo = NULL;
-
-            if ((!channelInfo[channel].lfe) && (aacObjectType == LTP)) {  /* no reconstruction needed for LFE channel*/
-
-                LtpReconstruct(&coderInfo[channel], &(coderInfo[channel].ltpInfo),
-						coderInfo[channel].requantFreq);
-
-                if(tnsDecInfo != NULL)
-                    TnsDecodeFilterOnly(&(coderInfo[channel].tnsInfo), coderInfo[channel].nr_of_sfb,
-							coderInfo[channel].max_sfb, coderInfo[channel].block_type,
-							coderInfo[channel].sfb_offset, coderInfo[channel].requantFreq);
-
-                IFilterBank(hEncoder, &coderInfo[channel],
-						coderInfo[channel].requantFreq,
-						coderInfo[channel].ltpInfo.time_buffer,
-						coderInfo[channel].ltpInfo.ltp_overlap_buffer,
-						MOVERLAPPED);
-
-                LtpUpdate(&(coderInfo[channel].ltpInfo),
-						coderInfo[channel].ltpInfo.time_buffer,
-						coderInfo[channel].ltpInfo.ltp_overlap_buffer,
-						BLOCK_LEN_LONG);
-            }
-        }
-    }
+    /* Update the LTP history */
+    ChannelThreadsRun(hEncoder->channelThreads, numChannels, ReconstructChannel, &job);
 
 #ifndef DRM
     /* Write the AAC bitstream */
@@ -49,6 +49,7 @@ extern "C" {
 #include "psych.h"
 #include "aacquant.h"
 #include "fft.h"
+#include "chanthread.h"
 
 #if defined(_WIN32) && !defined(__MINGW32__)
   #ifndef FAACAPI
@@ -124,6 +125,9 @@ typedef struct {
 
     /* output bits difference in average bitrate mode */
     int bitDiff;
+
+    /* workers for config.numThreads > 1, NULL when encoding serially */
+    ChannelThreads *channelThreads;
 } faacEncStruct, *faacEncHandle;
 
 int FAACAPI faacEncGetVersion(char **faac_id_string,
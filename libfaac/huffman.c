@@ -164,6 +164,57 @@ int BitSearch(CoderInfo *coderInfo,
 }
 
 
+static int CalcBitsPacked(int book,
+                          int *quant,
+                          int offset,
+                          int length)
+{
+  /*
+     Counts the bits of a section for two books at once, 'book' and 'book'+1
+     (book is 1, 3, 5, 7 or 9).  Both books of a pair share their index and
+     sign handling, so the lengths are read from the packed huffXYlen tables
+     and the result holds the bits for 'book' in the low 16 bits and the bits
+     for 'book'+1 in the high 16 bits; a section never comes close to 2^16
+     bits in either book.
+   */
+
+    int bits = 0;
+    int signs = 0;
+    int i;
+
+    switch (book) {
+    case 1:
+        for(i=offset;i<offset+length;i=i+4){
+            bits += huff12len[27*quant[i] + 9*quant[i+1] + 3*quant[i+2] + quant[i+3] + 40];
+        }
+        return (bits);
+    case 3:
+        for(i=offset;i<offset+length;i=i+4){
+            bits += huff34len[27*ABS(quant[i]) + 9*ABS(quant[i+1]) + 3*ABS(quant[i+2]) + ABS(quant[i+3])];
+            signs += (quant[i] != 0) + (quant[i+1] != 0) + (quant[i+2] != 0) + (quant[i+3] != 0);
+        }
+        return (bits + signs * 0x10001);
+    case 5:
+        for(i=offset;i<offset+length;i=i+2){
+            bits += huff56len[9*(quant[i]) + (quant[i+1]) + 40];
+        }
+        return (bits);
+    case 7:
+        for(i=offset;i<offset+length;i=i+2){
+            bits += huff78len[8*ABS(quant[i]) + ABS(quant[i+1])];
+            signs += (quant[i] != 0) + (quant[i+1] != 0);
+        }
+        return (bits + signs * 0x10001);
+    case 9:
+        for(i=offset;i<offset+length;i=i+2){
+            bits += huff910len[13*ABS(quant[i]) + ABS(quant[i+1])];
+            signs += (quant[i] != 0) + (quant[i+1] != 0);
+        }
+        return (bits + signs * 0x10001);
+    }
+    return 0;
+}
+
 int NoiselessBitCount(CoderInfo *coderInfo,
                       int *quant,
                       int hop,
@@ -240,42 +291,54 @@ int NoiselessBitCount(CoderInfo *coderInfo,
 
             }
             else {  /* if the section does have non-zero coefficients */
+                /* neighbouring books are priced in pairs, see CalcBitsPacked */
+                int lo, hi;
+
                 if(max_sb_coeff < 2){
-                    book_choice[j][0] = CalcBits(coderInfo,1,quant,offset,length);
+                    lo = CalcBitsPacked(1,quant,offset,length);
+                    hi = CalcBitsPacked(3,quant,offset,length);
+                    book_choice[j][0] = lo & 0xffff;
                     book_choice[j++][1] = 1;
-                    book_choice[j][0] = CalcBits(coderInfo,2,quant,offset,length);
+                    book_choice[j][0] = lo >> 16;
                     book_choice[j++][1] = 2;
-                    book_choice[j][0] = CalcBits(coderInfo,3,quant,offset,length);
+                    book_choice[j][0] = hi & 0xffff;
                     book_choice[j++][1] = 3;
                 }
                 else if (max_sb_coeff < 3){
-                    book_choice[j][0] = CalcBits(coderInfo,3,quant,offset,length);
+                    lo = CalcBitsPacked(3,quant,offset,length);
+                    hi = CalcBitsPacked(5,quant,offset,length);
+                    book_choice[j][0] = lo & 0xffff;
                     book_choice[j++][1] = 3;
-                    book_choice[j][0] = CalcBits(coderInfo,4,quant,offset,length);
+                    book_choice[j][0] = lo >> 16;
                     book_choice[j++][1] = 4;
-                    book_choice[j][0] = CalcBits(coderInfo,5,quant,offset,length);
+                    book_choice[j][0] = hi & 0xffff;
                     book_choice[j++][1] = 5;
                 }
                 else if (max_sb_coeff < 5){
-                    book_choice[j][0] = CalcBits(coderInfo,5,quant,offset,length);
+                    lo = CalcBitsPacked(5,quant,offset,length);
+                    hi = CalcBitsPacked(7,quant,offset,length);
+                    book_choice[j][0] = lo & 0xffff;
                     book_choice[j++][1] = 5;
-                    book_choice[j][0] = CalcBits(coderInfo,6,quant,offset,length);
+                    book_choice[j][0] = lo >> 16;
                     book_choice[j++][1] = 6;
-                    book_choice[j][0] = CalcBits(coderInfo,7,quant,offset,length);
+                    book_choice[j][0] = hi & 0xffff;
                     book_choice[j++][1] = 7;
                 }
                 else if (max_sb_coeff < 8){
-                    book_choice[j][0] = CalcBits(coderInfo,7,quant,offset,length);
+                    lo = CalcBitsPacked(7,quant,offset,length);
+                    hi = CalcBitsPacked(9,quant,offset,length);
+                    book_choice[j][0] = lo & 0xffff;
                     book_choice[j++][1] = 7;
-                    book_choice[j][0] = CalcBits(coderInfo,8,quant,offset,length);
+                    book_choice[j][0] = lo >> 16;
                     book_choice[j++][1] = 8;
-                    book_choice[j][0] = CalcBits(coderInfo,9,quant,offset,length);
+                    book_choice[j][0] = hi & 0xffff;
                     book_choice[j++][1] = 9;
                 }
                 else if (max_sb_coeff < 13){
-                    book_choice[j][0] = CalcBits(coderInfo,9,quant,offset,length);
+                    lo = CalcBitsPacked(9,quant,offset,length);
+                    book_choice[j][0] = lo & 0xffff;
                     book_choice[j++][1] = 9;
-                    book_choice[j][0] = CalcBits(coderInfo,10,quant,offset,length);
+                    book_choice[j][0] = lo >> 16;
                     book_choice[j++][1] = 10;
                 }
                 /* (max_sb_coeff >= 13), choose table 11 */
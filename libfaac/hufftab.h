@@ -329,3 +329,104 @@ unsigned int huff12[][2] = {
     };
 
 
+
+/* codeword lengths of two books sharing an index, packed as
+   len(low book) | len(high book) << 16, so that one pass over a
+   section prices both books */
+
+unsigned int huff12len[] = {
+        0x9000b, 0x70009, 0x9000b, 0x8000a, 0x60007, 0x8000a,
+        0x9000b, 0x80009, 0x9000b, 0x8000a, 0x60007, 0x7000a,
+        0x60007, 0x50005, 0x60007, 0x70009, 0x60007, 0x8000a,
+        0x9000b, 0x70009, 0x8000b, 0x80009, 0x60007, 0x80009,
+        0x9000b, 0x70009, 0x9000b, 0x80009, 0x60007, 0x70009,
+        0x60007, 0x50005, 0x60007, 0x70009, 0x60007, 0x80009,
+        0x60007, 0x50005, 0x60007, 0x50005, 0x30001, 0x50005,
+        0x60007, 0x50005, 0x60007, 0x80009, 0x60007, 0x70009,
+        0x60007, 0x50005, 0x60007, 0x80009, 0x60007, 0x80009,
+        0x9000b, 0x70009, 0x9000b, 0x80009, 0x60007, 0x80009,
+        0x8000b, 0x70009, 0x9000b, 0x8000a, 0x60007, 0x70009,
+        0x60007, 0x40005, 0x60007, 0x80009, 0x60007, 0x7000a,
+        0x9000b, 0x70009, 0x9000b, 0x7000a, 0x60007, 0x80009,
+        0x9000b, 0x70009, 0x9000b
+    };
+
+unsigned int huff34len[] = {
+        0x40001, 0x50004, 0x80008, 0x50004, 0x40005, 0x80008,
+        0x90009, 0x80009, 0xb000a, 0x50004, 0x50006, 0x80009,
+        0x50006, 0x40006, 0x80009, 0x80009, 0x70009, 0xa000a,
+        0x90009, 0x8000a, 0xb000d, 0x80009, 0x80009, 0xa000b,
+        0xb000b, 0xa000a, 0xb000c, 0x40004, 0x50006, 0x8000a,
+        0x40006, 0x40007, 0x8000a, 0x8000a, 0x8000a, 0xa000c,
+        0x40005, 0x40007, 0x8000b, 0x40006, 0x40007, 0x7000a,
+        0x80009, 0x70009, 0x9000b, 0x80009, 0x8000a, 0xa000d,
+        0x70008, 0x70009, 0x9000c, 0xa000a, 0x9000b, 0xa000c,
+        0x80008, 0x8000a, 0xb000f, 0x80009, 0x7000b, 0xa000f,
+        0xb000d, 0xa000e, 0xc0010, 0x80008, 0x7000a, 0xa000e,
+        0x70009, 0x7000a, 0x9000e, 0xa000c, 0x9000c, 0xb000f,
+        0xb000b, 0xa000c, 0xc0010, 0xa000a, 0x9000b, 0xb000f,
+        0xb000c, 0xa000c, 0xb000f
+    };
+
+unsigned int huff56len[] = {
+        0xb000d, 0xa000c, 0x9000b, 0x9000b, 0x9000a, 0x9000b,
+        0x9000b, 0xa000c, 0xb000d, 0xa000c, 0x9000b, 0x8000a,
+        0x70009, 0x70008, 0x70009, 0x8000a, 0x9000b, 0xa000c,
+        0x9000c, 0x8000a, 0x60009, 0x60008, 0x60007, 0x60008,
+        0x60009, 0x8000a, 0x9000b, 0x9000b, 0x70009, 0x60008,
+        0x40005, 0x40004, 0x40005, 0x60008, 0x70009, 0x9000b,
+        0x9000a, 0x70008, 0x60007, 0x40004, 0x40001, 0x40004,
+        0x60007, 0x70008, 0x9000b, 0x9000b, 0x70009, 0x60008,
+        0x40005, 0x40004, 0x40005, 0x60008, 0x70009, 0x9000b,
+        0x9000b, 0x8000a, 0x60009, 0x60008, 0x60007, 0x60008,
+        0x60009, 0x8000a, 0x9000b, 0xa000c, 0x9000b, 0x8000a,
+        0x70009, 0x70008, 0x70009, 0x7000a, 0x8000b, 0xa000c,
+        0xb000d, 0xa000c, 0x9000c, 0x9000b, 0x9000a, 0x9000a,
+        0x9000b, 0xa000c, 0xb000d
+    };
+
+unsigned int huff78len[] = {
+        0x50001, 0x40003, 0x50006, 0x60007, 0x70008, 0x80009,
+        0x9000a, 0xa000b, 0x40003, 0x30004, 0x40006, 0x50007,
+        0x60008, 0x70008, 0x70009, 0x80009, 0x50006, 0x40006,
+        0x40007, 0x50008, 0x60008, 0x70009, 0x70009, 0x8000a,
+        0x60007, 0x50007, 0x50008, 0x60008, 0x60009, 0x70009,
+        0x8000a, 0x8000a, 0x70008, 0x60008, 0x60009, 0x60009,
+        0x7000a, 0x7000a, 0x8000a, 0x9000b, 0x80009, 0x70008,
+        0x60009, 0x70009, 0x7000a, 0x8000a, 0x8000b, 0xa000b,
+        0x9000a, 0x70009, 0x70009, 0x8000a, 0x8000a, 0x8000b,
+        0x9000c, 0x9000c, 0xa000b, 0x8000a, 0x8000a, 0x8000a,
+        0x9000b, 0x9000b, 0x9000c, 0xa000c
+    };
+
+unsigned int huff910len[] = {
+        0x60001, 0x50003, 0x60006, 0x60008, 0x70009, 0x8000a,
+        0x9000a, 0xa000b, 0xa000b, 0xa000c, 0xb000c, 0xb000d,
+        0xc000d, 0x50003, 0x40004, 0x40006, 0x50007, 0x60008,
+        0x70008, 0x70009, 0x8000a, 0x8000a, 0x9000a, 0xa000b,
+        0xa000c, 0xb000c, 0x60006, 0x40006, 0x50007, 0x50008,
+        0x60008, 0x60009, 0x7000a, 0x8000a, 0x8000a, 0x9000b,
+        0x9000c, 0xa000c, 0xa000c, 0x60008, 0x50007, 0x50008,
+        0x50009, 0x60009, 0x7000a, 0x7000a, 0x8000b, 0x8000b,
+        0x9000b, 0x9000c, 0xa000c, 0xa000d, 0x70009, 0x60008,
+        0x60009, 0x60009, 0x6000a, 0x7000a, 0x7000b, 0x8000b,
+        0x8000b, 0x9000c, 0x9000c, 0xa000c, 0xa000d, 0x8000a,
+        0x70009, 0x60009, 0x7000a, 0x7000b, 0x7000b, 0x8000b,
+        0x8000c, 0x8000b, 0x9000c, 0xa000c, 0xa000d, 0xb000d,
+        0x9000b, 0x70009, 0x7000a, 0x7000b, 0x7000b, 0x8000b,
+        0x8000c, 0x9000c, 0x9000c, 0x9000c, 0xa000d, 0xa000d,
+        0xb000d, 0x9000b, 0x8000a, 0x8000a, 0x8000b, 0x8000b,
+        0x8000c, 0x9000c, 0x9000d, 0x9000d, 0xa000d, 0xa000d,
+        0xb000d, 0xb000d, 0x9000b, 0x8000a, 0x8000a, 0x8000b,
+        0x8000b, 0x8000b, 0x9000c, 0x9000c, 0xa000d, 0xa000d,
+        0xa000e, 0xb000d, 0xb000e, 0xa000b, 0x9000a, 0x9000b,
+        0x9000b, 0x9000c, 0x9000c, 0x9000c, 0xa000c, 0xa000d,
+        0xa000d, 0xb000e, 0xb000e, 0xc000e, 0xa000c, 0x9000b,
+        0x9000b, 0x9000c, 0x9000c, 0xa000c, 0xa000d, 0xa000d,
+        0xa000d, 0xb000e, 0xb000e, 0xb000e, 0xc000f, 0xb000c,
+        0xa000b, 0x9000c, 0xa000c, 0xa000c, 0xa000d, 0xa000d,
+        0xa000d, 0xb000d, 0xb000e, 0xb000e, 0xb000f, 0xc000f,
+        0xb000d, 0xa000c, 0xa000c, 0xa000c, 0xa000d, 0xa000d,
+        0xa000d, 0xb000d, 0xb000e, 0xc000e, 0xc000e, 0xc000e,
+        0xc000f
+    };
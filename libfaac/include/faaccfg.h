@@ -22,7 +22,7 @@
 #ifndef _FAACCFG_H_
 #define _FAACCFG_H_
 
-#define FAAC_CFG_VERSION 104
+#define FAAC_CFG_VERSION 105
 
 /* MPEG ID's */
 #define MPEG2 1
@@ -115,6 +115,15 @@ typedef struct faacEncConfiguration
 	*/
 	int channel_map[64];	
 
+    /*
+		Encoder threads (since config version 105)
+
+		0 or 1		encode all channels on the calling thread (DEFAULT)
+		n > 1		encode up to n channels at once on a pool of worker threads,
+					the output is the same as with a single thread
+	*/
+    unsigned int numThreads;
+
 } faacEncConfiguration, *faacEncConfigurationPtr;
 
 #pragma pack(pop)
@@ -62,6 +62,9 @@
 /* Set to 1 to enable debugging. */
 #define ENABLE_DEBUG 0
 
+/* Set to 1 to use SSE2 for the mono and stereo sinc converter inner loops. */
+#define ENABLE_SINC_SSE2 1
+
 /* Major version of GCC or 3 otherwise. */
 /* #undef GCC_MAJOR_VERSION */
 
@@ -30,6 +30,10 @@
 #include "float_cast.h"
 #include "common.h"
 
+#if ENABLE_SINC_SSE2
+#include <emmintrin.h>
+#endif
+
 #define	SINC_MAGIC_MARKER	MAKE_MAGIC (' ', 's', 'i', 'n', 'c', ' ')
 
 /*========================================================================================
@@ -273,6 +277,142 @@ sinc_reset (SRC_PRIVATE *psrc)
 **	Beware all ye who dare pass this point. There be dragons here.
 */
 
+#if ENABLE_SINC_SSE2
+
+/*
+**	The SSE2 versions of calc_output_single and calc_output_stereo below work on
+**	four filter taps at a time. The filter indices for the taps are kept in a
+**	vector so the coefficient interpolation is done in parallel, the buffer is
+**	read with unaligned loads and the sums are accumulated in float. Whatever is
+**	left over at the end of each half of the filter goes through the original
+**	scalar code.
+*/
+
+/* Number of taps in the left half of the filter, ie filter_index >= 0. */
+static inline int
+left_tap_count (increment_t filter_index, increment_t increment)
+{	return filter_index / increment + 1 ;
+} /* left_tap_count */
+
+/* Number of taps in the right half of the filter, ie filter_index > 0 (at least one). */
+static inline int
+right_tap_count (increment_t filter_index, increment_t increment)
+{	if (filter_index <= MAKE_INCREMENT_T (0))
+		return 1 ;
+	return (filter_index - 1) / increment + 1 ;
+} /* right_tap_count */
+
+/* Interpolated coefficients for the four filter indices in filter_index. */
+static inline __m128
+calc_coeffs_sse2 (coeff_t const *coeffs, __m128i filter_index)
+{	__m128		fraction, lo, hi ;
+	int			indx [4] ;
+
+	fraction = _mm_cvtepi32_ps (_mm_and_si128 (filter_index, _mm_set1_epi32 ((1 << SHIFT_BITS) - 1))) ;
+	fraction = _mm_mul_ps (fraction, _mm_set1_ps ((float) INV_FP_ONE)) ;
+
+	/* No gather in SSE2, so the coefficients are loaded one at a time. */
+	_mm_storeu_si128 ((__m128i *) indx, _mm_srai_epi32 (filter_index, SHIFT_BITS)) ;
+	lo = _mm_setr_ps (coeffs [indx [0]], coeffs [indx [1]], coeffs [indx [2]], coeffs [indx [3]]) ;
+	hi = _mm_setr_ps (coeffs [indx [0] + 1], coeffs [indx [1] + 1], coeffs [indx [2] + 1], coeffs [indx [3] + 1]) ;
+
+	return _mm_add_ps (lo, _mm_mul_ps (fraction, _mm_sub_ps (hi, lo))) ;
+} /* calc_coeffs_sse2 */
+
+static inline __m128i
+filter_index_sse2 (increment_t filter_index, increment_t increment)
+{	return _mm_setr_epi32 (filter_index, filter_index - increment, filter_index - 2 * increment, filter_index - 3 * increment) ;
+} /* filter_index_sse2 */
+
+static inline double
+horizontal_sum_sse2 (__m128 sum)
+{	float	total [4] ;
+
+	_mm_storeu_ps (total, sum) ;
+	return ((double) total [0] + total [1]) + ((double) total [2] + total [3]) ;
+} /* horizontal_sum_sse2 */
+
+static inline double
+calc_output_single (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index)
+{	double		fraction, left, right, icoeff ;
+	increment_t	filter_index, max_filter_index ;
+	int			data_index, coeff_count, indx, taps ;
+	__m128i		vindex, vstep ;
+	__m128		sum, coeffs ;
+
+	/* Convert input parameters into fixed point. */
+	max_filter_index = int_to_fp (filter->coeff_half_len) ;
+	vstep = _mm_set1_epi32 (4 * increment) ;
+
+	/* First apply the left half of the filter. */
+	filter_index = start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current - coeff_count ;
+
+	taps = left_tap_count (filter_index, increment) ;
+	vindex = filter_index_sse2 (filter_index, increment) ;
+	sum = _mm_setzero_ps () ;
+	for ( ; taps >= 4 ; taps -= 4)
+	{	coeffs = calc_coeffs_sse2 (filter->coeffs, vindex) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (coeffs, _mm_loadu_ps (filter->buffer + data_index))) ;
+
+		vindex = _mm_sub_epi32 (vindex, vstep) ;
+		filter_index -= 4 * increment ;
+		data_index += 4 ;
+		} ;
+
+	left = horizontal_sum_sse2 (sum) ;
+	for ( ; taps > 0 ; taps --)
+	{	fraction = fp_to_double (filter_index) ;
+		indx = fp_to_int (filter_index) ;
+
+		icoeff = filter->coeffs [indx] + fraction * (filter->coeffs [indx + 1] - filter->coeffs [indx]) ;
+
+		left += icoeff * filter->buffer [data_index] ;
+
+		filter_index -= increment ;
+		data_index = data_index + 1 ;
+		} ;
+
+	/* Now apply the right half of the filter. */
+	filter_index = increment - start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current + 1 + coeff_count ;
+
+	taps = right_tap_count (filter_index, increment) ;
+	vindex = filter_index_sse2 (filter_index, increment) ;
+	sum = _mm_setzero_ps () ;
+	for ( ; taps >= 4 ; taps -= 4)
+	{	/* The data runs backwards here, so the coefficients are reversed. */
+		coeffs = calc_coeffs_sse2 (filter->coeffs, vindex) ;
+		coeffs = _mm_shuffle_ps (coeffs, coeffs, _MM_SHUFFLE (0, 1, 2, 3)) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (coeffs, _mm_loadu_ps (filter->buffer + data_index - 3))) ;
+
+		vindex = _mm_sub_epi32 (vindex, vstep) ;
+		filter_index -= 4 * increment ;
+		data_index -= 4 ;
+		} ;
+
+	right = horizontal_sum_sse2 (sum) ;
+	for ( ; taps > 0 ; taps --)
+	{	fraction = fp_to_double (filter_index) ;
+		indx = fp_to_int (filter_index) ;
+
+		icoeff = filter->coeffs [indx] + fraction * (filter->coeffs [indx + 1] - filter->coeffs [indx]) ;
+
+		right += icoeff * filter->buffer [data_index] ;
+
+		filter_index -= increment ;
+		data_index = data_index - 1 ;
+		} ;
+
+	return (left + right) ;
+} /* calc_output_single */
+
+#else
+
 static inline double
 calc_output_single (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index)
 {	double		fraction, left, right, icoeff ;
@@ -325,6 +465,8 @@ calc_output_single (SINC_FILTER *filter, increment_t increment, increment_t star
 	return (left + right) ;
 } /* calc_output_single */
 
+#endif
+
 static int
 sinc_mono_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 {	SINC_FILTER *filter ;
@@ -419,6 +561,99 @@ sinc_mono_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 	return SRC_ERR_NO_ERROR ;
 } /* sinc_mono_vari_process */
 
+#if ENABLE_SINC_SSE2
+
+static inline void
+calc_output_stereo (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
+{	double		fraction, left [2], right [2], icoeff ;
+	increment_t	filter_index, max_filter_index ;
+	int			data_index, coeff_count, indx, taps ;
+	__m128i		vindex, vstep ;
+	__m128		sum, coeffs ;
+	float		total [4] ;
+
+	/* Convert input parameters into fixed point. */
+	max_filter_index = int_to_fp (filter->coeff_half_len) ;
+	vstep = _mm_set1_epi32 (4 * increment) ;
+
+	/* First apply the left half of the filter. */
+	filter_index = start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current - filter->channels * coeff_count ;
+
+	taps = left_tap_count (filter_index, increment) ;
+	vindex = filter_index_sse2 (filter_index, increment) ;
+	sum = _mm_setzero_ps () ;
+	for ( ; taps >= 4 ; taps -= 4)
+	{	/* Each coefficient is used for a left/right pair of samples. */
+		coeffs = calc_coeffs_sse2 (filter->coeffs, vindex) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_unpacklo_ps (coeffs, coeffs), _mm_loadu_ps (filter->buffer + data_index))) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_unpackhi_ps (coeffs, coeffs), _mm_loadu_ps (filter->buffer + data_index + 4))) ;
+
+		vindex = _mm_sub_epi32 (vindex, vstep) ;
+		filter_index -= 4 * increment ;
+		data_index += 8 ;
+		} ;
+
+	_mm_storeu_ps (total, sum) ;
+	left [0] = (double) total [0] + total [2] ;
+	left [1] = (double) total [1] + total [3] ;
+	for ( ; taps > 0 ; taps --)
+	{	fraction = fp_to_double (filter_index) ;
+		indx = fp_to_int (filter_index) ;
+
+		icoeff = filter->coeffs [indx] + fraction * (filter->coeffs [indx + 1] - filter->coeffs [indx]) ;
+
+		left [0] += icoeff * filter->buffer [data_index] ;
+		left [1] += icoeff * filter->buffer [data_index + 1] ;
+
+		filter_index -= increment ;
+		data_index = data_index + 2 ;
+		} ;
+
+	/* Now apply the right half of the filter. */
+	filter_index = increment - start_filter_index ;
+	coeff_count = (max_filter_index - filter_index) / increment ;
+	filter_index = filter_index + coeff_count * increment ;
+	data_index = filter->b_current + filter->channels * (1 + coeff_count) ;
+
+	taps = right_tap_count (filter_index, increment) ;
+	vindex = filter_index_sse2 (filter_index, increment) ;
+	sum = _mm_setzero_ps () ;
+	for ( ; taps >= 4 ; taps -= 4)
+	{	/* The data runs backwards here, so the coefficient pairs are swapped. */
+		coeffs = calc_coeffs_sse2 (filter->coeffs, vindex) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (coeffs, coeffs, _MM_SHUFFLE (0, 0, 1, 1)), _mm_loadu_ps (filter->buffer + data_index - 2))) ;
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (coeffs, coeffs, _MM_SHUFFLE (2, 2, 3, 3)), _mm_loadu_ps (filter->buffer + data_index - 6))) ;
+
+		vindex = _mm_sub_epi32 (vindex, vstep) ;
+		filter_index -= 4 * increment ;
+		data_index -= 8 ;
+		} ;
+
+	_mm_storeu_ps (total, sum) ;
+	right [0] = (double) total [0] + total [2] ;
+	right [1] = (double) total [1] + total [3] ;
+	for ( ; taps > 0 ; taps --)
+	{	fraction = fp_to_double (filter_index) ;
+		indx = fp_to_int (filter_index) ;
+
+		icoeff = filter->coeffs [indx] + fraction * (filter->coeffs [indx + 1] - filter->coeffs [indx]) ;
+
+		right [0] += icoeff * filter->buffer [data_index] ;
+		right [1] += icoeff * filter->buffer [data_index + 1] ;
+
+		filter_index -= increment ;
+		data_index = data_index - 2 ;
+		} ;
+
+	output [0] = scale * (left [0] + right [0]) ;
+	output [1] = scale * (left [1] + right [1]) ;
+} /* calc_output_stereo */
+
+#else
+
 static inline void
 calc_output_stereo (SINC_FILTER *filter, increment_t increment, increment_t start_filter_index, double scale, float * output)
 {	double		fraction, left [2], right [2], icoeff ;
@@ -474,6 +709,8 @@ calc_output_stereo (SINC_FILTER *filter, increment_t increment, increment_t star
 	output [1] = scale * (left [1] + right [1]) ;
 } /* calc_output_stereo */
 
+#endif
+
 static int
 sinc_stereo_vari_process (SRC_PRIVATE *psrc, SRC_DATA *data)
 {	SINC_FILTER *filter ;